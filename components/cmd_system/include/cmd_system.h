@@ -12,9 +12,43 @@
 extern "C" {
 #endif
 
+#include "esp_err.h"
+
 // Register system functions
 void register_system();
 
+/**
+ * @brief Function run before the restart, deep_sleep and light_sleep commands take effect
+ *
+ */
+typedef void (*system_shutdown_hook_t)(void);
+
+/**
+ * @brief Register a hook, hooks run in the order they were registered
+ *
+ * @param hook function to run, for example to write out data kept in RAM
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if all slots are taken
+ */
+esp_err_t register_system_shutdown_hook(system_shutdown_hook_t hook);
+
+/**
+ * @brief Function run by the heap command after the heap figures, to print what other components hold
+ *
+ */
+typedef void (*system_heap_report_hook_t)(void);
+
+/**
+ * @brief Register a report, reports are printed in the order they were registered
+ *
+ * @param hook function printing to stdout, for example the counters of a block pool
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if all slots are taken
+ */
+esp_err_t register_system_heap_report_hook(system_heap_report_hook_t hook);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,12 @@
 
 static const char *TAG = "cmd_system";
 
+#define SHUTDOWN_HOOKS_MAX 4
+#define HEAP_REPORT_HOOKS_MAX 4
+
+static system_shutdown_hook_t shutdown_hooks[SHUTDOWN_HOOKS_MAX];
+static system_heap_report_hook_t heap_report_hooks[HEAP_REPORT_HOOKS_MAX];
+
 static void register_free();
 static void register_heap();
 static void register_version();
@@ -53,6 +59,35 @@ void register_system()
 #endif
 }
 
+esp_err_t register_system_shutdown_hook(system_shutdown_hook_t hook)
+{
+    for (int i = 0; i < SHUTDOWN_HOOKS_MAX; i++) {
+        if (!shutdown_hooks[i]) {
+            shutdown_hooks[i] = hook;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static void run_shutdown_hooks()
+{
+    for (int i = 0; i < SHUTDOWN_HOOKS_MAX && shutdown_hooks[i]; i++) {
+        shutdown_hooks[i]();
+    }
+}
+
+esp_err_t register_system_heap_report_hook(system_heap_report_hook_t hook)
+{
+    for (int i = 0; i < HEAP_REPORT_HOOKS_MAX; i++) {
+        if (!heap_report_hooks[i]) {
+            heap_report_hooks[i] = hook;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
 /* 'version' command */
 static int get_version(int argc, char **argv)
 {
@@ -88,6 +123,7 @@ static void register_version()
 static int restart(int argc, char **argv)
 {
     ESP_LOGI(TAG, "Restarting");
+    run_shutdown_hooks();
     esp_restart();
 }
 
@@ -121,11 +157,16 @@ static void register_free()
     ESP_ERROR_CHECK( esp_console_cmd_register(&cmd) );
 }
 
-/* 'heap' command prints minumum heap size */
+/* 'heap' command prints minumum heap size, fragmentation and the registered reports */
 static int heap_size(int argc, char **argv)
 {
     uint32_t heap_size = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
     ESP_LOGI(TAG, "min heap size: %u", heap_size);
+    printf("free: %u bytes, largest free block: %u bytes\n", heap_caps_get_free_size(MALLOC_CAP_DEFAULT),
+           heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+    for (int i = 0; i < HEAP_REPORT_HOOKS_MAX && heap_report_hooks[i]; i++) {
+        heap_report_hooks[i]();
+    }
     return 0;
 }
 
@@ -133,7 +174,8 @@ static void register_heap()
 {
     const esp_console_cmd_t heap_cmd = {
         .command = "heap",
-        .help = "Get minimum size of free heap memory that was available during program execution",
+        .help = "Get minimum size of free heap memory that was available during program execution, "
+                "the largest free block and the modem buffer pools",
         .hint = NULL,
         .func = &heap_size,
     };
@@ -218,6 +260,7 @@ static int deep_sleep(int argc, char **argv)
         ESP_ERROR_CHECK( esp_sleep_enable_ext1_wakeup(1ULL << io_num, level) );
     }
     rtc_gpio_isolate(GPIO_NUM_12);
+    run_shutdown_hooks();
     esp_deep_sleep_start();
 }
 
@@ -291,6 +334,7 @@ static int light_sleep(int argc, char **argv)
         ESP_ERROR_CHECK( uart_set_wakeup_threshold(CONFIG_ESP_CONSOLE_UART_NUM, 3) );
         ESP_ERROR_CHECK( esp_sleep_enable_uart_wakeup(CONFIG_ESP_CONSOLE_UART_NUM) );
     }
+    run_shutdown_hooks();
     fflush(stdout);
     uart_tx_wait_idle(CONFIG_ESP_CONSOLE_UART_NUM);
     esp_light_sleep_start();
@@ -0,0 +1,149 @@
+/* Throughput of the line handlers and the DTE framer, lines per second
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "fuzz_target.h"
+
+#define BENCH_NAME_LENGTH (64)
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Lines per second of one target on its samples, best of a few rounds
+ */
+static double bench_target(const fuzz_target_t *target, double seconds, int rounds)
+{
+    /* The samples in one input, so that the framer sees a stream */
+    char input[4096] = "";
+    for (const char *const *sample = target->samples; *sample; sample++) {
+        strncat(input, *sample, sizeof(input) - strlen(input) - 1);
+    }
+    size_t len = strlen(input);
+    double best = 0;
+    for (int round = 0; round < rounds; round++) {
+        size_t lines = 0;
+        double start = bench_now(), elapsed;
+        do {
+            for (int i = 0; i < 64; i++) {
+                lines += fuzz_run(target, (const uint8_t *)input, len);
+            }
+            elapsed = bench_now() - start;
+        } while (elapsed < seconds / rounds);
+        if (lines / elapsed > best) {
+            best = lines / elapsed;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Rate of a target in a file written with -o, 0 if it is not there
+ */
+static double bench_baseline(FILE *f, const char *name)
+{
+    char line[256], key[BENCH_NAME_LENGTH];
+    double rate;
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, " \"%63[^\"]\": %lf", key, &rate) == 2 && !strcmp(key, name)) {
+            return rate;
+        }
+    }
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-t target] [-d seconds] [-o file] [-c baseline] [-T percent]\n"
+            "  -t target   only this target\n"
+            "  -d seconds  time per target, default 0.5\n"
+            "  -o file     write the rates as JSON\n"
+            "  -c baseline compare with rates written by -o, fail if a target got slower\n"
+            "  -T percent  slowdown tolerated by -c, default 10\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *only = NULL, *output = NULL, *compare = NULL;
+    double seconds = 0.5, tolerance = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:o:c:T:h")) != -1) {
+        switch (opt) {
+        case 't': only = optarg; break;
+        case 'd': seconds = atof(optarg); break;
+        case 'o': output = optarg; break;
+        case 'c': compare = optarg; break;
+        case 'T': tolerance = atof(optarg); break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    FILE *baseline = NULL, *json = NULL;
+    if (compare && !(baseline = fopen(compare, "r"))) {
+        perror(compare);
+        return 2;
+    }
+    if (output && !(json = fopen(output, "w"))) {
+        perror(output);
+        return 2;
+    }
+
+    /* The report goes to stderr, stdout carries what the handlers print */
+    fuzz_quiet();
+    int count, regressions = 0;
+    const fuzz_target_t *const *targets = fuzz_targets(&count);
+    fprintf(stderr, "%-40s %12s%s\n", "handler", "lines/s", baseline ? "    baseline  change" : "");
+    if (json) {
+        fprintf(json, "{\n");
+    }
+    for (int i = 0; i < count; i++) {
+        if (only && strcmp(only, targets[i]->name)) {
+            continue;
+        }
+        double rate = bench_target(targets[i], seconds, 5);
+        fprintf(stderr, "%-40s %12.0f", targets[i]->name, rate);
+        if (baseline) {
+            double before = bench_baseline(baseline, targets[i]->name);
+            if (before > 0) {
+                double change = (rate - before) * 100 / before;
+                bool slower = change < -tolerance;
+                fprintf(stderr, " %12.0f %+6.1f%%%s", before, change, slower ? "  SLOWER" : "");
+                regressions += slower;
+            } else {
+                fprintf(stderr, " %12s", "new");
+            }
+        }
+        fprintf(stderr, "\n");
+        if (json) {
+            fprintf(json, "  \"%s\": %.0f%s\n", targets[i]->name, rate, i + 1 < count && !only ? "," : "");
+        }
+    }
+    if (json) {
+        fprintf(json, "}\n");
+        fclose(json);
+    }
+    if (baseline) {
+        fclose(baseline);
+        if (regressions) {
+            fprintf(stderr, "%d handler(s) more than %.0f%% slower than %s\n", regressions, tolerance, compare);
+        }
+    }
+    return regressions ? 1 : 0;
+}
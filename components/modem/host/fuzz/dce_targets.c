@@ -0,0 +1,156 @@
+/* Shared DCE line handlers under fuzzing and benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+/* The probe handler is static, the driver registry is compiled here instead of linked */
+#include "../../src/esp_modem_driver.c"
+#include "esp_modem_cache.h"
+#include "esp_modem_ext.h"
+#include "fuzz_target.h"
+
+static modem_dce_t *fuzz_dce(void *resource)
+{
+    static modem_dce_t dce = {
+        .dte = &fuzz_dte,
+    };
+    dce.state = MODEM_STATE_PROCESSING;
+    dce.priv_resource = resource;
+    return &dce;
+}
+
+static esp_err_t fuzz_dce_handle_response_default(const char *line)
+{
+    return esp_modem_dce_handle_response_default(fuzz_dce(NULL), line);
+}
+
+/**
+ * @brief Run the generic command handler with the format of one command
+ */
+static esp_err_t fuzz_dce_handle_command(const esp_modem_format_t *format, void *out, const char *line)
+{
+    const esp_modem_dce_command_t command = {"AT\r", format, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT};
+    esp_modem_dce_result_t result = {
+        .command = &command,
+        .out = out,
+    };
+    return esp_modem_dce_handle_command_line(fuzz_dce(&result), line);
+}
+
+static esp_err_t fuzz_dce_handle_csq(const char *line)
+{
+    esp_modem_csq_t csq;
+    return fuzz_dce_handle_command(&esp_modem_format_csq, &csq, line);
+}
+
+static esp_err_t fuzz_dce_handle_cbc(const char *line)
+{
+    esp_modem_cbc_t cbc;
+    return fuzz_dce_handle_command(&esp_modem_format_cbc, &cbc, line);
+}
+
+static esp_err_t fuzz_dce_handle_creg(const char *line)
+{
+    esp_modem_creg_t creg;
+    return fuzz_dce_handle_command(&esp_modem_format_creg, &creg, line);
+}
+
+static esp_err_t fuzz_dce_handle_cops(const char *line)
+{
+    esp_modem_cops_t cops;
+    return fuzz_dce_handle_command(&esp_modem_format_cops, &cops, line);
+}
+
+static esp_err_t fuzz_dce_handle_name(const char *line)
+{
+    char name[MODEM_MAX_NAME_LENGTH];
+    return fuzz_dce_handle_command(&esp_modem_format_name, name, line);
+}
+
+static esp_err_t fuzz_dce_handle_imei(const char *line)
+{
+    char imei[MODEM_IMEI_LENGTH + 1];
+    return fuzz_dce_handle_command(&esp_modem_format_imei, imei, line);
+}
+
+static esp_err_t fuzz_dce_handle_imsi(const char *line)
+{
+    char imsi[MODEM_IMSI_LENGTH + 1];
+    return fuzz_dce_handle_command(&esp_modem_format_imsi, imsi, line);
+}
+
+static esp_err_t fuzz_probe_handle_model(const char *line)
+{
+    modem_dce_t *dce = fuzz_dce(NULL);
+    /* A new probe for every final result code, as esp_modem_probe_model() does */
+    if (dce->name[0] && (strstr(line, MODEM_RESULT_CODE_SUCCESS) || strstr(line, MODEM_RESULT_CODE_ERROR))) {
+        dce->name[0] = '\0';
+    }
+    return esp_modem_probe_handle_model(dce, line);
+}
+
+static esp_err_t fuzz_cached_signal_quality(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber)
+{
+    return ESP_FAIL;
+}
+
+static esp_err_t fuzz_cached_battery_status(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage)
+{
+    return ESP_FAIL;
+}
+
+static esp_err_t fuzz_cached_network_status(modem_dce_t *dce, uint32_t *mode, uint32_t *stat)
+{
+    return ESP_FAIL;
+}
+
+static esp_err_t fuzz_cached_deinit(modem_dce_t *dce)
+{
+    return ESP_OK;
+}
+
+static esp_err_t fuzz_cache_handle_urc(const char *line)
+{
+    static modem_dce_t dce = {
+        .dte = &fuzz_dte,
+        .get_signal_quality = fuzz_cached_signal_quality,
+        .get_battery_status = fuzz_cached_battery_status,
+        .get_network_status = fuzz_cached_network_status,
+        .deinit = fuzz_cached_deinit,
+        .ext.lock = portMUX_INITIALIZER_UNLOCKED,
+    };
+    if (!dce.cache) {
+        const esp_modem_cache_config_t config = ESP_MODEM_CACHE_DEFAULT_CONFIG();
+        ESP_ERROR_CHECK(esp_modem_cache_enable(&dce, &config));
+    }
+    esp_modem_ext_handle_urc(&dce, line);
+    return ESP_OK;
+}
+
+static const char *const fuzz_dce_results[] = {"OK\r\n", "ERROR\r\n", "+CME ERROR: 100\r\n", "AT\r\n", NULL};
+static const char *const fuzz_dce_csq[] = {"+CSQ: 18,0\r\n", "+CSQ: 99,99\r\n", "OK\r\n", NULL};
+static const char *const fuzz_dce_cbc[] = {"+CBC: 0,80,4000\r\n", "+CBC: 1,100,4205\r\n", "OK\r\n", NULL};
+static const char *const fuzz_dce_creg[] = {"+CREG: 0,1\r\n", "+CREG: 2,5,\"1A2B\",\"3C4D\"\r\n", "OK\r\n", NULL};
+static const char *const fuzz_dce_cops[] = {"+COPS: 0,0,\"Vodafone UK\"\r\n", "+COPS: 0\r\n", "OK\r\n", NULL};
+static const char *const fuzz_dce_name[] = {"SIMCOM_SIM800L\r\n", "BG96\r\n", "OK\r\n", NULL};
+static const char *const fuzz_dce_imei[] = {"868000012345678\r\n", "OK\r\n", NULL};
+static const char *const fuzz_dce_imsi[] = {"234150012345678\r\n", "OK\r\n", NULL};
+static const char *const fuzz_probe_model[] = {"+CPIN: READY\r\n", "SIMCOM_SIM800L\r\n", "OK\r\n", "Quectel\r\n", "BG96\r\n", "OK\r\n", NULL};
+static const char *const fuzz_cache_urcs[] = {"+CSQN: 18,0\r\n", "+CREG: 1\r\n", "UNDER-VOLTAGE WARNNING\r\n", "RING\r\n", NULL};
+
+const fuzz_target_t fuzz_dce_targets[] = {
+    {"esp_modem_dce_handle_response_default", fuzz_dce_handle_response_default, NULL, fuzz_dce_results},
+    {"esp_modem_dce_handle_command_line/csq", fuzz_dce_handle_csq, NULL, fuzz_dce_csq},
+    {"esp_modem_dce_handle_command_line/cbc", fuzz_dce_handle_cbc, NULL, fuzz_dce_cbc},
+    {"esp_modem_dce_handle_command_line/creg", fuzz_dce_handle_creg, NULL, fuzz_dce_creg},
+    {"esp_modem_dce_handle_command_line/cops", fuzz_dce_handle_cops, NULL, fuzz_dce_cops},
+    {"esp_modem_dce_handle_command_line/name", fuzz_dce_handle_name, NULL, fuzz_dce_name},
+    {"esp_modem_dce_handle_command_line/imei", fuzz_dce_handle_imei, NULL, fuzz_dce_imei},
+    {"esp_modem_dce_handle_command_line/imsi", fuzz_dce_handle_imsi, NULL, fuzz_dce_imsi},
+    {"esp_modem_probe_handle_model", fuzz_probe_handle_model, NULL, fuzz_probe_model},
+    {"esp_modem_cache_handle_urc", fuzz_cache_handle_urc, NULL, fuzz_cache_urcs},
+    {NULL},
+};
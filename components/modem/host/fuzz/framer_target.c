@@ -0,0 +1,107 @@
+/* DTE line framer under fuzzing and benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+/* The framer is static, the DTE is compiled here instead of linked */
+#include "../../src/esp_modem.c"
+#include "esp_modem_dce_service.h"
+#include "host_port.h"
+#include "fuzz_target.h"
+
+#define FUZZ_FRAMER_UART UART_NUM_2
+#define FUZZ_FRAMER_FIFO (120) /*!< Bytes per RX interrupt, the events are handled in between */
+
+static esp_modem_dte_t fuzz_esp_dte;
+static modem_dce_t fuzz_framer_dce;
+
+/**
+ * @brief A DTE in command mode on a UART without a tty, its events handled by the caller
+ */
+static void fuzz_framer_init(void)
+{
+    esp_modem_dte_t *esp_dte = &fuzz_esp_dte;
+    esp_dte->uart_port = FUZZ_FRAMER_UART;
+    esp_dte->buffer = calloc(1, ESP_MODEM_LINE_BUFFER_SIZE);
+    ESP_ERROR_CHECK(uart_host_set_device(esp_dte->uart_port, "/dev/null"));
+    ESP_ERROR_CHECK(uart_driver_install(esp_dte->uart_port, CONFIG_EXAMPLE_UART_RX_BUFFER_SIZE, CONFIG_EXAMPLE_UART_TX_BUFFER_SIZE,
+                                        CONFIG_EXAMPLE_UART_EVENT_QUEUE_SIZE, &(esp_dte->event_queue), 0));
+    ESP_ERROR_CHECK(uart_disable_rx_intr(esp_dte->uart_port));
+    ESP_ERROR_CHECK(uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE));
+    ESP_ERROR_CHECK(uart_pattern_queue_reset(esp_dte->uart_port, CONFIG_EXAMPLE_UART_PATTERN_QUEUE_SIZE));
+    esp_event_loop_args_t loop_args = {
+        .queue_size = ESP_MODEM_EVENT_QUEUE_SIZE,
+    };
+    ESP_ERROR_CHECK(esp_event_loop_create(&loop_args, &esp_dte->event_loop_hdl));
+    esp_dte->process_sem = xSemaphoreCreateBinary();
+    esp_dte->parent.process_cmd_done = esp_modem_dte_process_cmd_done;
+    esp_dte->parent.dce = &fuzz_framer_dce;
+    fuzz_framer_dce.dte = &esp_dte->parent;
+    fuzz_framer_dce.mode = MODEM_COMMAND_MODE;
+    fuzz_framer_dce.handle_line = esp_modem_dce_handle_response_default;
+    fuzz_framer_dce.handle_line_default = esp_modem_dce_handle_response_default;
+}
+
+/**
+ * @brief What uart_event_task_entry() does in command mode, until no event is left
+ */
+static size_t fuzz_framer_drain(esp_modem_dte_t *esp_dte)
+{
+    uart_event_t event;
+    size_t lines = 0;
+    while (xQueueReceive(esp_dte->event_queue, &event, 0)) {
+        switch (event.type) {
+        case UART_PATTERN_DET:
+            esp_handle_uart_pattern(esp_dte);
+            lines++;
+            break;
+        case UART_BUFFER_FULL:
+            esp_dte->stats.buffer_full++;
+            esp_modem_dte_drop_input(esp_dte);
+            break;
+        default:
+            break;
+        }
+        /* Unknown lines are posted, the queue must not fill up */
+        esp_event_loop_run(esp_dte->event_loop_hdl, 0);
+    }
+    xSemaphoreTake(esp_dte->process_sem, 0);
+    return lines;
+}
+
+static size_t fuzz_framer_stream(const uint8_t *data, size_t len)
+{
+    if (!fuzz_esp_dte.buffer) {
+        fuzz_framer_init();
+    }
+    size_t lines = 0;
+    fuzz_framer_dce.state = MODEM_STATE_PROCESSING;
+    while (len) {
+        size_t n = len < FUZZ_FRAMER_FIFO ? len : FUZZ_FRAMER_FIFO;
+        uart_host_feed(fuzz_esp_dte.uart_port, data, n);
+        lines += fuzz_framer_drain(&fuzz_esp_dte);
+        data += n;
+        len -= n;
+    }
+    /* Whatever did not end with a '\n' would stay for the next input */
+    uart_flush(fuzz_esp_dte.uart_port);
+    uart_pattern_queue_reset(fuzz_esp_dte.uart_port, CONFIG_EXAMPLE_UART_PATTERN_QUEUE_SIZE);
+    return lines;
+}
+
+static const char *const fuzz_framer_samples[] = {
+    "\r\n+CSQ: 18,0\r\n\r\nOK\r\n",
+    "AT+COPS?\r\r\n+COPS: 0,0,\"Vodafone UK\"\r\n\r\nOK\r\n",
+    "\r\n+CREG: 1\r\n",
+    "\r\nRDY\r\n\r\n+CFUN: 1\r\n\r\n+CPIN: READY\r\n",
+    "~\x7d\x23\xff\x7d\x23\xc0\x21~\r\nNO CARRIER\r\n",
+    NULL
+};
+
+const fuzz_target_t fuzz_framer_targets[] = {
+    {"esp_handle_uart_pattern", NULL, fuzz_framer_stream, fuzz_framer_samples},
+    {NULL},
+};
@@ -0,0 +1,264 @@
+/* Fuzzing entry points of the line handlers and the DTE framer
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fuzz_target.h"
+
+/*
+ * libFuzzer and AFL see a single target: the first byte of the input selects the handler,
+ * the rest is what the handler gets.
+ */
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    fuzz_quiet();
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    int count;
+    const fuzz_target_t *const *targets = fuzz_targets(&count);
+    if (size) {
+        fuzz_run(targets[data[0] % count], data + 1, size - 1);
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+#define FUZZ_INPUT_MAX (8192)
+
+static const char fuzz_interesting[] = {',', '"', ':', ' ', '\r', '\n', '\0', '-', '9', '+', 0x7e, 0x7d, (char)0xff};
+
+/* The input being run, saved if it brings the program down */
+static uint8_t s_input[FUZZ_INPUT_MAX + 1];
+static size_t s_input_len;
+
+static void fuzz_save_input(void)
+{
+    int fd = open("crash-input", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (write(fd, s_input, s_input_len) < 0) {
+            /* Nothing left to report it to */
+        }
+        close(fd);
+    }
+}
+
+static void fuzz_crash(int signum)
+{
+    fuzz_save_input();
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
+/* Defined when built with a sanitizer, which exits without raising a signal */
+extern void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-l] [-t target] [-n iterations] [-r seed] [-S dir] [file...]\n"
+            "  -l            list the targets\n"
+            "  -t target     give inputs to this target only, instead of selecting it by the first byte\n"
+            "  -n iterations mutate the samples of the targets this many times\n"
+            "  -r seed       random seed of -n\n"
+            "  -S dir        write the samples as a seed corpus for AFL or libFuzzer\n"
+            "  file...       run each file as one input, - for stdin, as afl-fuzz ... -- %s @@\n"
+            "An input that crashes is saved to crash-input.\n", name, name);
+}
+
+static size_t fuzz_read(FILE *f, uint8_t *buffer, size_t size)
+{
+    size_t len = 0, n;
+    while (len < size && (n = fread(buffer + len, 1, size - len, f)) > 0) {
+        len += n;
+    }
+    return len;
+}
+
+static void fuzz_one(const fuzz_target_t *target, const uint8_t *data, size_t len)
+{
+    if (target) {
+        fuzz_run(target, data, len);
+    } else {
+        LLVMFuzzerTestOneInput(data, len);
+    }
+}
+
+static int fuzz_write_seeds(const char *dir)
+{
+    int count, files = 0;
+    const fuzz_target_t *const *targets = fuzz_targets(&count);
+    mkdir(dir, 0755);
+    for (int i = 0; i < count; i++) {
+        /* One seed per target holding all its samples, so that sequences are kept */
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%02d", dir, i);
+        FILE *f = fopen(path, "wb");
+        if (!f) {
+            perror(path);
+            return 1;
+        }
+        fputc(i, f);
+        for (const char *const *sample = targets[i]->samples; *sample; sample++) {
+            fputs(*sample, f);
+        }
+        fclose(f);
+        files++;
+    }
+    fprintf(stderr, "%d seeds written to %s\n", files, dir);
+    return 0;
+}
+
+/**
+ * @brief Build an input from the samples of a target and break it a little
+ */
+static size_t fuzz_mutate(const fuzz_target_t *target, uint8_t *buffer, size_t size)
+{
+    size_t len = 0, samples = 0;
+    while (target->samples[samples]) {
+        samples++;
+    }
+    for (int i = 1 + rand() % 4; i > 0; i--) {
+        const char *sample = target->samples[rand() % samples];
+        size_t n = strlen(sample);
+        if (len + n > size) {
+            break;
+        }
+        memcpy(buffer + len, sample, n);
+        len += n;
+    }
+    for (int i = 1 + rand() % 8; i > 0 && len; i--) {
+        size_t at = rand() % len;
+        switch (rand() % 6) {
+        case 0:
+            buffer[at] ^= 1 << (rand() % 8);
+            break;
+        case 1:
+            buffer[at] = fuzz_interesting[rand() % sizeof(fuzz_interesting)];
+            break;
+        case 2:
+            if (len < size) {
+                memmove(buffer + at + 1, buffer + at, len - at);
+                buffer[at] = rand() % 256;
+                len++;
+            }
+            break;
+        case 3: {
+            size_t n = 1 + rand() % (len - at);
+            memmove(buffer + at, buffer + at + n, len - at - n);
+            len -= n;
+            break;
+        }
+        case 4: {
+            /* Repeat a byte, for fields and lines longer than any buffer */
+            size_t n = rand() % 512;
+            n = len + n > size ? size - len : n;
+            memmove(buffer + at + n, buffer + at, len - at);
+            memset(buffer + at, buffer[at + n], n);
+            len += n;
+            break;
+        }
+        default:
+            len = at;
+            break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    const fuzz_target_t *target = NULL;
+    long iterations = 0;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "lt:n:r:S:h")) != -1) {
+        switch (opt) {
+        case 'l': {
+            int count;
+            const fuzz_target_t *const *targets = fuzz_targets(&count);
+            for (int i = 0; i < count; i++) {
+                printf("%2d %s\n", i, targets[i]->name);
+            }
+            return 0;
+        }
+        case 't':
+            target = fuzz_target_find(optarg);
+            if (!target) {
+                fprintf(stderr, "no target %s, -l lists them\n", optarg);
+                return 2;
+            }
+            break;
+        case 'n': iterations = atol(optarg); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        case 'S': return fuzz_write_seeds(optarg);
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!iterations && optind == argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    LLVMFuzzerInitialize(&argc, &argv);
+    signal(SIGSEGV, fuzz_crash);
+    signal(SIGBUS, fuzz_crash);
+    signal(SIGABRT, fuzz_crash);
+    if (__sanitizer_set_death_callback) {
+        __sanitizer_set_death_callback(fuzz_save_input);
+    }
+
+    for (int i = optind; i < argc; i++) {
+        FILE *f = strcmp(argv[i], "-") ? fopen(argv[i], "rb") : stdin;
+        if (!f) {
+            perror(argv[i]);
+            return 1;
+        }
+        s_input_len = fuzz_read(f, s_input, FUZZ_INPUT_MAX);
+        if (f != stdin) {
+            fclose(f);
+        }
+        fuzz_one(target, s_input, s_input_len);
+    }
+
+    int count;
+    const fuzz_target_t *const *targets = fuzz_targets(&count);
+    srand(seed);
+    for (long i = 0; i < iterations; i++) {
+        const fuzz_target_t *mutated = target ? target : targets[i % count];
+        uint8_t *data = s_input;
+        size_t size = FUZZ_INPUT_MAX;
+        if (!target) {
+            /* Saved with its selector byte, so that crash-input replays without -t */
+            s_input[0] = i % count;
+            data++;
+            size--;
+        }
+        s_input_len = fuzz_mutate(mutated, data, size) + (data - s_input);
+        fuzz_run(mutated, data, s_input_len - (data - s_input));
+        if ((i + 1) % 100000 == 0) {
+            fprintf(stderr, "%ld inputs\n", i + 1);
+        }
+    }
+    if (iterations) {
+        fprintf(stderr, "%ld inputs on %d targets, no crash\n", iterations, target ? 1 : count);
+    }
+    return 0;
+}
+
+#endif /* FUZZ_LIBFUZZER */
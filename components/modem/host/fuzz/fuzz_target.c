@@ -0,0 +1,92 @@
+/* Line handlers and DTE framer under fuzzing and benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "fuzz_target.h"
+#include "sdkconfig.h"
+
+/* As the DTE: half the RX buffer, one byte kept for the NUL */
+#define FUZZ_LINE_BUFFER_SIZE (CONFIG_EXAMPLE_UART_RX_BUFFER_SIZE / 2)
+#define FUZZ_TARGETS_MAX (32)
+
+static esp_err_t fuzz_process_cmd_done(modem_dte_t *dte)
+{
+    return ESP_OK;
+}
+
+modem_dte_t fuzz_dte = {
+    .process_cmd_done = fuzz_process_cmd_done,
+};
+
+static const fuzz_target_t *const fuzz_groups[] = {
+    fuzz_sim800_targets,
+    fuzz_dce_targets,
+    fuzz_script_targets,
+    fuzz_framer_targets,
+};
+
+const fuzz_target_t *const *fuzz_targets(int *count)
+{
+    static const fuzz_target_t *targets[FUZZ_TARGETS_MAX];
+    static int targets_count;
+    if (!targets_count) {
+        for (int i = 0; i < sizeof(fuzz_groups) / sizeof(fuzz_groups[0]); i++) {
+            for (const fuzz_target_t *target = fuzz_groups[i]; target->name && targets_count < FUZZ_TARGETS_MAX; target++) {
+                targets[targets_count++] = target;
+            }
+        }
+    }
+    *count = targets_count;
+    return targets;
+}
+
+const fuzz_target_t *fuzz_target_find(const char *name)
+{
+    int count;
+    const fuzz_target_t *const *targets = fuzz_targets(&count);
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(targets[i]->name, name)) {
+            return targets[i];
+        }
+    }
+    return NULL;
+}
+
+size_t fuzz_run(const fuzz_target_t *target, const uint8_t *data, size_t len)
+{
+    if (target->stream) {
+        return target->stream(data, len);
+    }
+    char line[FUZZ_LINE_BUFFER_SIZE];
+    size_t lines = 0;
+    while (len) {
+        const uint8_t *end = memchr(data, '\n', len);
+        size_t n = end ? (size_t)(end - data) + 1 : len;
+        size_t copied = n < sizeof(line) - 1 ? n : sizeof(line) - 1;
+        memcpy(line, data, copied);
+        line[copied] = '\0';
+        data += n;
+        len -= n;
+        if (strlen(line) > 2) {
+            target->line(line);
+            lines++;
+        }
+    }
+    return lines;
+}
+
+void fuzz_quiet(void)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    /* The handlers print what they see, which is not what is being measured or searched */
+    if (!freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "cannot silence stdout\n");
+    }
+}
@@ -0,0 +1,66 @@
+/* Line handlers and DTE framer under fuzzing and benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_modem_dte.h"
+
+/**
+ * @brief One handler the harness can drive
+ *
+ * Line targets get the input cut into lines the way the DTE delivers them: ending with the
+ * '\n', at most a line buffer long, cut at the first NUL, lines of two bytes or less skipped.
+ * Stream targets get the raw bytes.
+ */
+typedef struct {
+    const char *name;                                 /*!< Function under test */
+    esp_err_t (*line)(const char *line);              /*!< Handle one line, NULL for a stream target */
+    size_t (*stream)(const uint8_t *data, size_t len); /*!< Handle raw bytes, returns the lines seen */
+    const char *const *samples;                       /*!< Lines a modem really sends, NULL terminated */
+} fuzz_target_t;
+
+/* Each group ends with an entry without name */
+extern const fuzz_target_t fuzz_sim800_targets[];
+extern const fuzz_target_t fuzz_dce_targets[];
+extern const fuzz_target_t fuzz_script_targets[];
+extern const fuzz_target_t fuzz_framer_targets[];
+
+/**
+ * @brief DTE of the line targets, completing commands does nothing
+ */
+extern modem_dte_t fuzz_dte;
+
+/**
+ * @brief Every target, in a fixed order
+ *
+ * @param count set to the number of targets
+ * @return the targets
+ */
+const fuzz_target_t *const *fuzz_targets(int *count);
+
+/**
+ * @brief Find a target by name
+ *
+ * @return the target, NULL if there is none of that name
+ */
+const fuzz_target_t *fuzz_target_find(const char *name);
+
+/**
+ * @brief Feed input to a target
+ *
+ * @return lines handled
+ */
+size_t fuzz_run(const fuzz_target_t *target, const uint8_t *data, size_t len);
+
+/**
+ * @brief Silence the logs and what the handlers print, before running targets
+ */
+void fuzz_quiet(void);
@@ -0,0 +1,432 @@
+/* Replay of UART captures through the command tables of the models
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_modem_capture.h"
+#include "esp_modem_dce_service.h"
+#include "replay.h"
+
+#define REPLAY_LINE_LENGTH (256)
+#define REPLAY_TIMEOUT_NOTE "command timeout"
+
+/**
+ * @brief One command of a capture: what the DTE sent and what came back until the next command
+ */
+typedef struct {
+    char *command;  /*!< Bytes sent, NUL terminated */
+    char *answer;   /*!< Bytes received, NUL terminated */
+    bool timed_out; /*!< The firmware noted a timeout of the command */
+} replay_exchange_t;
+
+/**
+ * @brief DTE answering each command with the recorded bytes
+ */
+typedef struct {
+    modem_dte_t parent;                /*!< DTE the DCE sends through */
+    const replay_exchange_t *exchange; /*!< Exchange being replayed */
+    bool command_differs;              /*!< The DCE sent something else than the capture */
+    bool timed_out;                    /*!< The recorded bytes ended without a final result code */
+    uint32_t unsolicited;              /*!< Lines the running handler refused or got after the final result code */
+} replay_dte_t;
+
+typedef struct {
+    uint32_t exchanges;   /*!< Commands replayed */
+    uint32_t table;       /*!< Of them, commands of the model table */
+    uint32_t values;      /*!< Answers compared with a parse of their own */
+    uint32_t unsolicited; /*!< Lines left to the URC path */
+    uint32_t mismatches;  /*!< Outcomes or values differing from the capture */
+} replay_counts_t;
+
+static const struct {
+    const char *name;
+    const esp_modem_dce_model_t *const *model;
+} replay_models[] = {
+    {"sim800", &replay_sim800_model},
+    {"bg96", &replay_bg96_model},
+};
+
+/**
+ * @brief Append bytes to a NUL terminated buffer
+ */
+static void replay_append(char **buffer, const void *data, size_t len)
+{
+    size_t used = *buffer ? strlen(*buffer) : 0;
+    char *grown = realloc(*buffer, used + len + 1);
+    if (!grown) {
+        perror("realloc");
+        exit(2);
+    }
+    memcpy(grown + used, data, len);
+    grown[used + len] = '\0';
+    *buffer = grown;
+}
+
+/**
+ * @brief Cut a capture into exchanges, the records of one port only
+ *
+ * @return exchanges, NULL if the file is not a capture
+ */
+static replay_exchange_t *replay_load(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    esp_modem_capture_file_header_t header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, ESP_MODEM_CAPTURE_MAGIC, 4) ||
+            header.version != ESP_MODEM_CAPTURE_VERSION || header.header_size != sizeof(esp_modem_capture_record_header_t)) {
+        fprintf(stderr, "%s: not a version %d capture\n", path, ESP_MODEM_CAPTURE_VERSION);
+        fclose(f);
+        return NULL;
+    }
+    replay_exchange_t *exchanges = NULL;
+    size_t n = 0;
+    int port = -1;
+    uint8_t last_dir = ESP_MODEM_CAPTURE_RX;
+    for (uint32_t i = 0; i < header.records; i++) {
+        esp_modem_capture_record_header_t record;
+        char data[UINT16_MAX + 1];
+        if (fread(&record, sizeof(record), 1, f) != 1 || fread(data, 1, record.length, f) != record.length) {
+            fprintf(stderr, "%s: cut after %u of %u records\n", path, i, header.records);
+            break;
+        }
+        if (port < 0) {
+            port = record.port;
+        }
+        uint8_t dir = record.dir & ~ESP_MODEM_CAPTURE_TRUNCATED;
+        if (record.port != port) {
+            continue;
+        }
+        /* A command written in several pieces is still one command */
+        if (dir == ESP_MODEM_CAPTURE_TX && (last_dir != ESP_MODEM_CAPTURE_TX || !n)) {
+            replay_exchange_t *grown = realloc(exchanges, (n + 1) * sizeof(*exchanges));
+            if (!grown) {
+                perror("realloc");
+                exit(2);
+            }
+            exchanges = grown;
+            exchanges[n++] = (replay_exchange_t) {
+                0
+            };
+        }
+        /* What came before the first command is left out, nothing asked for it */
+        if (n) {
+            if (dir == ESP_MODEM_CAPTURE_TX) {
+                replay_append(&exchanges[n - 1].command, data, record.length);
+            } else if (dir == ESP_MODEM_CAPTURE_RX) {
+                replay_append(&exchanges[n - 1].answer, data, record.length);
+            } else if (record.length == strlen(REPLAY_TIMEOUT_NOTE) && !memcmp(data, REPLAY_TIMEOUT_NOTE, record.length)) {
+                exchanges[n - 1].timed_out = true;
+            }
+        }
+        last_dir = dir;
+    }
+    fclose(f);
+    for (size_t i = 0; i < n; i++) {
+        if (!exchanges[i].answer) {
+            replay_append(&exchanges[i].answer, "", 0);
+        }
+    }
+    *count = n;
+    return exchanges;
+}
+
+static void replay_free(replay_exchange_t *exchanges, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        free(exchanges[i].command);
+        free(exchanges[i].answer);
+    }
+    free(exchanges);
+}
+
+/**
+ * @brief Next line of an answer the way the DTE delivers it: up to the '\n', heading "\r\n" stripped
+ *
+ * @return false at the end of the answer
+ */
+static bool replay_next_line(const char **pos, char *line, size_t size)
+{
+    if (!**pos) {
+        return false;
+    }
+    const char *end = strchr(*pos, '\n');
+    size_t len = end ? (size_t)(end - *pos) + 1 : strlen(*pos);
+    const char *start = *pos;
+    *pos += len;
+    while (len && (*start == '\r' || *start == '\n')) {
+        start++;
+        len--;
+    }
+    if (len > size - 1) {
+        len = size - 1;
+    }
+    memcpy(line, start, len);
+    line[len] = '\0';
+    return true;
+}
+
+static esp_err_t replay_send_cmd(modem_dte_t *dte, const char *command, uint32_t timeout)
+{
+    replay_dte_t *replay = __containerof(dte, replay_dte_t, parent);
+    modem_dce_t *dce = dte->dce;
+    if (strcmp(command, replay->exchange->command)) {
+        replay->command_differs = true;
+        return ESP_FAIL;
+    }
+    dce->state = MODEM_STATE_PROCESSING;
+    char line[REPLAY_LINE_LENGTH];
+    const char *pos = replay->exchange->answer;
+    while (replay_next_line(&pos, line, sizeof(line))) {
+        /* The DTE skips pure "\r\n" lines */
+        if (strlen(line) <= 2) {
+            continue;
+        }
+        if (dce->state != MODEM_STATE_PROCESSING || !dce->handle_line || dce->handle_line(dce, line) != ESP_OK) {
+            replay->unsolicited++;
+        }
+    }
+    if (dce->state == MODEM_STATE_PROCESSING) {
+        dce->state = MODEM_STATE_FAIL;
+        replay->timed_out = true;
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t replay_process_cmd_done(modem_dte_t *dte)
+{
+    return ESP_OK;
+}
+
+/**
+ * @brief How the command ended in the capture
+ */
+static modem_state_t replay_recorded_state(const replay_exchange_t *exchange)
+{
+    char line[REPLAY_LINE_LENGTH];
+    const char *pos = exchange->answer;
+    if (exchange->timed_out) {
+        return MODEM_STATE_PROCESSING;
+    }
+    while (replay_next_line(&pos, line, sizeof(line))) {
+        if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
+            return MODEM_STATE_FAIL;
+        }
+    }
+    return MODEM_STATE_SUCCESS;
+}
+
+static bool replay_is_digits(const char *line, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!isdigit((unsigned char)line[i])) {
+            return false;
+        }
+    }
+    return !strcmp(line + count, "\r\n");
+}
+
+/**
+ * @brief Compare what the table parsed with a parse of the answer by sscanf
+ *
+ * @return false if they differ
+ */
+static bool replay_check_value(esp_modem_dce_cmd_id_t id, const void *out, const replay_exchange_t *exchange)
+{
+    char line[REPLAY_LINE_LENGTH];
+    const char *pos = exchange->answer;
+    bool found = false, same = false;
+    while (replay_next_line(&pos, line, sizeof(line))) {
+        int a, b, c;
+        char text[MODEM_MAX_OPERATOR_LENGTH] = "";
+        switch (id) {
+        case ESP_MODEM_DCE_CMD_SIGNAL_QUALITY: {
+            const esp_modem_csq_t *csq = out;
+            if (sscanf(line, "+CSQ: %d,%d", &a, &b) == 2) {
+                found = true;
+                same = csq->rssi == a && csq->ber == b;
+            }
+            break;
+        }
+        case ESP_MODEM_DCE_CMD_BATTERY_STATUS: {
+            const esp_modem_cbc_t *cbc = out;
+            if (sscanf(line, "+CBC: %d,%d,%d", &a, &b, &c) == 3) {
+                found = true;
+                same = cbc->bcs == a && cbc->bcl == b && cbc->voltage == c;
+            }
+            break;
+        }
+        case ESP_MODEM_DCE_CMD_NETWORK_STATUS: {
+            /* "+CREG: <stat>" is the URC, the answer has the mode first */
+            const esp_modem_creg_t *creg = out;
+            if (sscanf(line, "+CREG: %d,%d", &a, &b) == 2) {
+                found = true;
+                same = creg->n == a && creg->stat == b;
+            }
+            break;
+        }
+        case ESP_MODEM_DCE_CMD_OPERATOR: {
+            const esp_modem_cops_t *cops = out;
+            int fields = sscanf(line, "+COPS: %d,%d,\"%31[^\"]\"", &a, &b, text);
+            if (fields >= 1) {
+                found = true;
+                same = cops->mode == a && (fields < 2 || cops->format == b) && !strcmp(cops->oper, text);
+            }
+            break;
+        }
+        case ESP_MODEM_DCE_CMD_IMEI:
+        case ESP_MODEM_DCE_CMD_IMSI: {
+            size_t digits = id == ESP_MODEM_DCE_CMD_IMEI ? MODEM_IMEI_LENGTH : MODEM_IMSI_LENGTH;
+            if (replay_is_digits(line, digits)) {
+                found = true;
+                same = !strncmp(out, line, digits) && !((const char *)out)[digits];
+            }
+            break;
+        }
+        case ESP_MODEM_DCE_CMD_MODULE_NAME:
+            /* Whichever line it is, the name is one of them */
+            if (!strncmp(out, line, strlen(out)) && !strcmp(line + strlen(out), "\r\n")) {
+                return true;
+            }
+            break;
+        default:
+            return true;
+        }
+    }
+    return found && same;
+}
+
+/**
+ * @brief Send one recorded command through the DCE and compare the outcome
+ */
+static void replay_exchange(modem_dce_t *dce, replay_dte_t *replay, const replay_exchange_t *exchange,
+                            replay_counts_t *counts)
+{
+    union {
+        esp_modem_csq_t csq;
+        esp_modem_cbc_t cbc;
+        esp_modem_creg_t creg;
+        esp_modem_cops_t cops;
+        char name[MODEM_MAX_NAME_LENGTH];
+    } out;
+    int id;
+    for (id = 0; id < ESP_MODEM_DCE_CMD_MAX; id++) {
+        const char *command = dce->model->commands[id].command;
+        if (command && !strcmp(command, exchange->command)) {
+            break;
+        }
+    }
+    memset(&out, 0, sizeof(out));
+    replay->exchange = exchange;
+    replay->command_differs = false;
+    replay->timed_out = false;
+    if (id < ESP_MODEM_DCE_CMD_MAX) {
+        esp_modem_dce_execute(dce, id, &out);
+        counts->table++;
+    } else {
+        esp_modem_dce_command(dce, exchange->command, MODEM_COMMAND_TIMEOUT_DEFAULT,
+                              esp_modem_dce_handle_response_default, NULL);
+    }
+    counts->exchanges++;
+    modem_state_t state = replay->timed_out ? MODEM_STATE_PROCESSING : dce->state;
+    modem_state_t recorded = replay_recorded_state(exchange);
+    bool same = !replay->command_differs && state == recorded;
+    if (same && id < ESP_MODEM_DCE_CMD_MAX && state == MODEM_STATE_SUCCESS && dce->model->commands[id].format) {
+        same = replay_check_value(id, &out, exchange);
+        counts->values++;
+    }
+    if (!same) {
+        counts->mismatches++;
+        printf("mismatch on %.*s: %s, answer:\n%s\n", (int)strcspn(exchange->command, "\r"), exchange->command,
+               replay->command_differs ? "command differs" : state != recorded ? "outcome differs" : "value differs",
+               exchange->answer);
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s -m model capture...\n"
+            "  -m model    sim800 or bg96, whose command table answers the captures\n"
+            "  -v          print every exchange\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    const esp_modem_dce_model_t *model = NULL;
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:vh")) != -1) {
+        switch (opt) {
+        case 'm':
+            for (int i = 0; i < sizeof(replay_models) / sizeof(replay_models[0]); i++) {
+                if (!strcmp(optarg, replay_models[i].name)) {
+                    model = *replay_models[i].model;
+                }
+            }
+            break;
+        case 'v': verbose = true; break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!model || optind == argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (int arg = optind; arg < argc; arg++) {
+        size_t count;
+        replay_exchange_t *exchanges = replay_load(argv[arg], &count);
+        if (!exchanges) {
+            return 2;
+        }
+        replay_dte_t replay = {
+            .parent = {
+                .send_cmd = replay_send_cmd,
+                .process_cmd_done = replay_process_cmd_done,
+            },
+        };
+        modem_dce_t *dce = calloc(1, sizeof(modem_dce_t));
+        if (!dce || esp_modem_dce_bind(dce, model) != ESP_OK) {
+            fprintf(stderr, "no memory for the DCE\n");
+            return 2;
+        }
+        dce->dte = &replay.parent;
+        replay.parent.dce = dce;
+        replay_counts_t counts = {0};
+        for (size_t i = 0; i < count; i++) {
+            replay_exchange(dce, &replay, &exchanges[i], &counts);
+            if (verbose) {
+                printf("%.*s: %s\n", (int)strcspn(exchanges[i].command, "\r"), exchanges[i].command,
+                       dce->state == MODEM_STATE_SUCCESS ? "ok" : "failed");
+            }
+        }
+        counts.unsolicited = replay.unsolicited;
+        printf("%s (%s): %u commands, %u from the table, %u answers compared, %u lines to the URC path, %u mismatches\n",
+               argv[arg], model->name, counts.exchanges, counts.table, counts.values, counts.unsolicited,
+               counts.mismatches);
+        /* A capture without a table command tested nothing */
+        if (counts.mismatches || !counts.values) {
+            failed++;
+        }
+        esp_modem_dce_unbind(dce);
+        free(dce);
+        replay_free(exchanges, count);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+/* Replay of UART captures through the command tables of the models
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+
+#include "esp_modem_dce_service.h"
+
+/* The tables are static, each driver is compiled in its own file to reach them */
+extern const esp_modem_dce_model_t *const replay_sim800_model;
+extern const esp_modem_dce_model_t *const replay_bg96_model;
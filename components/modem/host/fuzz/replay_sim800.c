@@ -0,0 +1,13 @@
+/* SIM800 command table for the capture replay
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+/* The table is static, the driver is compiled here instead of linked */
+#include "../../src/sim800.c"
+#include "replay.h"
+
+const esp_modem_dce_model_t *const replay_sim800_model = &sim800_model;
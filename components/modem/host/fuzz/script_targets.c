@@ -0,0 +1,53 @@
+/* AT script line handler under fuzzing and benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+/* The handler is static, the script runner is compiled here instead of linked */
+#include "../../src/esp_modem_script.c"
+#include "fuzz_target.h"
+
+static esp_err_t fuzz_script_handle(esp_modem_script_step_t *step, const char *line)
+{
+    static modem_dce_t dce = {
+        .dte = &fuzz_dte,
+    };
+    dce.state = MODEM_STATE_PROCESSING;
+    dce.priv_resource = step;
+    /* A new step after every final result code, as the runner does */
+    if (esp_modem_script_is_final(line)) {
+        step->matched = false;
+    }
+    return esp_modem_script_handle_line(&dce, line);
+}
+
+/* send "AT+COPS?" expect "+COPS: " capture oper field 2 */
+static esp_err_t fuzz_script_handle_capture(const char *line)
+{
+    static esp_modem_script_step_t step = {
+        .expect = "+COPS: ",
+        .field = 2,
+    };
+    return fuzz_script_handle(&step, line);
+}
+
+/* send "AT+CFUN=1" */
+static esp_err_t fuzz_script_handle_ok(const char *line)
+{
+    static esp_modem_script_step_t step;
+    return fuzz_script_handle(&step, line);
+}
+
+static const char *const fuzz_script_cops[] = {
+    "+COPS: 0,0,\"Vodafone UK\"\r\n", "+COPS: 0\r\n", "OK\r\n", "+CME ERROR: 30\r\n", NULL
+};
+static const char *const fuzz_script_results[] = {"OK\r\n", "NO CARRIER\r\n", "+CMS ERROR: 500\r\n", "CONNECT 115200\r\n", NULL};
+
+const fuzz_target_t fuzz_script_targets[] = {
+    {"esp_modem_script_handle_line/capture", fuzz_script_handle_capture, NULL, fuzz_script_cops},
+    {"esp_modem_script_handle_line/ok", fuzz_script_handle_ok, NULL, fuzz_script_results},
+    {NULL},
+};
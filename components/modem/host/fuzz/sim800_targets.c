@@ -0,0 +1,107 @@
+/* SIM800 line handlers under fuzzing and benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+/* The handlers are static, the driver is compiled here instead of linked */
+#include "../../src/sim800.c"
+#include "fuzz_target.h"
+
+/**
+ * @brief The DCE every SIM800 target shares, with the resource of the running command
+ */
+static modem_dce_t *fuzz_sim800_dce(void *resource)
+{
+    static sim800_modem_dce_t sim800_dce;
+    if (!sim800_dce.identity.events) {
+        esp_modem_ext_task_init(&sim800_dce.identity);
+        sim800_dce.parent.dte = &fuzz_dte;
+    }
+    sim800_dce.parent.state = MODEM_STATE_PROCESSING;
+    sim800_dce.parent.priv_resource = resource;
+    return &sim800_dce.parent;
+}
+
+static esp_err_t fuzz_sim800_handle_urc(const char *line)
+{
+    return sim800_handle_urc(fuzz_sim800_dce(NULL), line);
+}
+
+static esp_err_t fuzz_sim800_handle_response_default(const char *line)
+{
+    return sim800_handle_response_default(fuzz_sim800_dce(NULL), line);
+}
+
+static esp_err_t fuzz_sim800_handle_at_response(const char *line)
+{
+    return sim800_handle_at_response(fuzz_sim800_dce(NULL), line);
+}
+
+static esp_err_t fuzz_sim800_handle_creg(const char *line)
+{
+    static esp_modem_creg_t creg;
+    static esp_modem_dce_result_t result = {
+        .command = &sim800_model.commands[ESP_MODEM_DCE_CMD_NETWORK_STATUS],
+        .out = &creg,
+    };
+    return sim800_handle_creg(fuzz_sim800_dce(&result), line);
+}
+
+static esp_err_t fuzz_sim800_handle_profile_check(const char *line)
+{
+    static bool match;
+    return sim800_handle_profile_check(fuzz_sim800_dce(&match), line);
+}
+
+static esp_err_t fuzz_sim800_handle_baud_probe(const char *line)
+{
+    static sim800_baud_probe_t probe;
+    return sim800_handle_baud_probe(fuzz_sim800_dce(&probe), line);
+}
+
+static esp_err_t fuzz_sim800_handle_soak(const char *line)
+{
+    static uint32_t bytes;
+    return sim800_handle_soak(fuzz_sim800_dce(&bytes), line);
+}
+
+static esp_err_t fuzz_sim800_handle_ccid(const char *line)
+{
+    static char iccid[SIM800_ICCID_LENGTH + 1];
+    return sim800_handle_ccid(fuzz_sim800_dce(iccid), line);
+}
+
+static const char *const fuzz_sim800_urcs[] = {
+    "RDY\r\n", "+CFUN: 1\r\n", "+CPIN: READY\r\n", "Call Ready\r\n", "SMS Ready\r\n", "+CREG: 1\r\n",
+    "+CREG: 2,5\r\n", "+COPS: 0,0,\"Vodafone UK\"\r\n", "*PSUTTZ: 20,6,14,9,30,12,\"+4\",1\r\n", "OK\r\n", NULL
+};
+
+static const char *const fuzz_sim800_responses[] = {
+    "+CFUN: 1\r\n", "*PSUTTZ: 20,6,14,9,30,12,\"+4\",1\r\n", "+CIEV: 10,\"23415\",\"Vodafone\",\"Vodafone\", 0,0\r\n",
+    "DST: 1\r\n", "+CSQN: 18,0\r\n", "NORMAL POWER DOWN\r\n", "OK\r\n", "ERROR\r\n", "+CLTS: 1\r\n", NULL
+};
+
+static const char *const fuzz_sim800_at[] = {
+    "+CGMR: Revision:1418B04SIM800L24\r\n", "OK\r\n", "+CME ERROR: operation not allowed\r\n", "ERROR\r\n", NULL
+};
+
+static const char *const fuzz_sim800_creg[] = {"+CREG: 1,5\r\n", "+CREG: 0,1,\"1A2B\",\"3C4D\"\r\n", "+CREG: 2\r\n", "OK\r\n", NULL};
+static const char *const fuzz_sim800_cmee[] = {"+CMEE: 2\r\n", "+CMEE: 0\r\n", "OK\r\n", NULL};
+static const char *const fuzz_sim800_cgsn[] = {"868000012345678\r\n", "OK\r\n", "86800001234567\xb8\r\n", NULL};
+static const char *const fuzz_sim800_clac[] = {"AT+CSQ\r\n", "AT+CREG\r\n", "AT+COPS\r\n", "AT+CPOWD\r\n", "OK\r\n", NULL};
+static const char *const fuzz_sim800_ccid[] = {"89440000000000012345\r\n", "8944000000000001234F\r\n", "OK\r\n", NULL};
+
+const fuzz_target_t fuzz_sim800_targets[] = {
+    {"sim800_handle_urc", fuzz_sim800_handle_urc, NULL, fuzz_sim800_urcs},
+    {"sim800_handle_response_default", fuzz_sim800_handle_response_default, NULL, fuzz_sim800_responses},
+    {"sim800_handle_at_response", fuzz_sim800_handle_at_response, NULL, fuzz_sim800_at},
+    {"sim800_handle_creg", fuzz_sim800_handle_creg, NULL, fuzz_sim800_creg},
+    {"sim800_handle_profile_check", fuzz_sim800_handle_profile_check, NULL, fuzz_sim800_cmee},
+    {"sim800_handle_baud_probe", fuzz_sim800_handle_baud_probe, NULL, fuzz_sim800_cgsn},
+    {"sim800_handle_soak", fuzz_sim800_handle_soak, NULL, fuzz_sim800_clac},
+    {"sim800_handle_ccid", fuzz_sim800_handle_ccid, NULL, fuzz_sim800_ccid},
+    {NULL},
+};
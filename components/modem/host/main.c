@@ -0,0 +1,968 @@
+/* Host runner of the modem component
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem.h"
+#include "esp_modem_arbiter.h"
+#include "esp_modem_cache.h"
+#include "esp_modem_capture.h"
+#include "esp_modem_health.h"
+#include "esp_modem_shutdown.h"
+#include "esp_modem_sleep.h"
+#include "esp_modem_supply.h"
+#include "esp_modem_stats.h"
+#include "esp_modem_pool.h"
+#include "esp_modem_dce_service.h"
+#include "sim800.h"
+#include "bg96.h"
+#include "host_port.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "modem_host";
+
+#define CONNECT_BIT BIT0
+#define STOP_BIT BIT1
+#define LOAD_DONE_BIT BIT2
+
+#define PPP_CONNECT_TIMEOUT_MS (30000)
+#define PPP_UPLINK_FRAME (256)
+/* tools/modem_sim.py polls the pty every 50 ms, it powers the modem on again once it has seen it closed */
+#define CYCLE_PAUSE_MS (120)
+/* Longest a hang may take to be found and recovered, reset and registration included */
+#define HEALTH_RECOVERY_TIMEOUT_MS (60000)
+/* Between two telemetry rounds of -S, well past the idle time of run_sleep() */
+#define SLEEP_ROUND_INTERVAL_MS (1500)
+/* How often -V looks at the governor and feeds the uplink */
+#define SUPPLY_TICK_MS (10)
+/* Channel deadline of the -A caller meant to miss it, shorter than any answer */
+#define ARBITER_SHORT_DEADLINE_MS (20)
+
+static struct {
+    const char *device;
+    const char *model;
+    int tasks;
+    int commands;
+    int ppp_seconds;
+    int uplink_rate;
+    bool cache;
+    const char *capture;
+    const char *json;
+    int cycles;
+    int layout_rounds;
+    int recoveries;
+    int sleep_rounds;
+    int supply_seconds;
+    int arbiter_rounds;
+} options = {
+    .model = "auto",
+    .tasks = 4,
+    .commands = 100,
+};
+
+static EventGroupHandle_t event_group;
+static modem_dce_t *dce;
+static portMUX_TYPE load_lock = portMUX_INITIALIZER_UNLOCKED;
+static int load_running;
+static uint32_t load_ok;
+static uint32_t load_failed;
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s -d device [options]\n"
+            "  -d device   tty of the modem, for example the pty of tools/modem_sim.py\n"
+            "  -m model    sim800, bg96 or auto (probe), default auto\n"
+            "  -t tasks    tasks sending commands at the same time, default 4\n"
+            "  -n count    commands sent by each task, default 100\n"
+            "  -p seconds  stay in PPP mode this long after the load, default 0 (skip)\n"
+            "  -u bytes/s  uplink sent while in PPP mode, default 0\n"
+            "  -C          enable the query cache\n"
+            "  -c file     dump the UART capture to file at the end\n"
+            "  -j file     write the command latencies as JSON to file\n"
+            "  -r cycles   only start and stop the modem this many times, reporting heap churn and leaks\n"
+            "  -L rounds   only compare task layouts: AT+CLAC round trips, then -p seconds of PPP, under each\n"
+            "  -H count    only let the health monitor recover the modem this many times, in PPP mode with -p;\n"
+            "              run tools/modem_sim.py with --hang-after\n"
+            "  -S rounds   only send this many telemetry rounds with the modem sleeping on DTR in between,\n"
+            "              reporting the wake-ups and the energy per round\n"
+            "  -V seconds  only stay in PPP mode this long with -u bytes/s of uplink under the supply governor;\n"
+            "              run tools/modem_sim.py with --supply-dip\n"
+            "  -A rounds   only let callers of every priority send their own command this many times each,\n"
+            "              checking the answers and the arbiter counters\n"
+            "  -v          debug logs\n",
+            name);
+}
+
+static void modem_event_handler(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    switch (event_id) {
+    case MODEM_EVENT_PPP_CONNECT: {
+        ppp_client_ip_info_t *ipinfo = (ppp_client_ip_info_t *)(event_data);
+        ESP_LOGI(TAG, "PPP connected, IP " IPSTR, IP2STR(&ipinfo->ip));
+        xEventGroupSetBits(event_group, CONNECT_BIT);
+        break;
+    }
+    case MODEM_EVENT_PPP_DISCONNECT:
+        ESP_LOGI(TAG, "PPP disconnected");
+        xEventGroupClearBits(event_group, CONNECT_BIT);
+        break;
+    case MODEM_EVENT_PPP_STOP:
+        ESP_LOGI(TAG, "PPP stopped");
+        xEventGroupClearBits(event_group, CONNECT_BIT);
+        xEventGroupSetBits(event_group, STOP_BIT);
+        break;
+    case MODEM_EVENT_PPP_CLOSING:
+        /* The uplink generators stand for the sockets, and stop here */
+        ESP_LOGI(TAG, "PPP closing");
+        xEventGroupClearBits(event_group, CONNECT_BIT);
+        break;
+    case MODEM_EVENT_UNKNOWN:
+        ESP_LOGW(TAG, "Unknown line from DCE: %s", (char *)event_data);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Each task cycles through the queries the console and MQTT reporting send most */
+static void load_task(void *param)
+{
+    int index = (int)(intptr_t)param;
+    uint32_t ok = 0;
+    uint32_t failed = 0;
+    for (int i = 0; i < options.commands; i++) {
+        uint32_t a, b, c;
+        esp_err_t err;
+        switch ((i + index) % 4) {
+        case 0:
+            err = dce->get_signal_quality(dce, &a, &b);
+            break;
+        case 1:
+            err = dce->get_battery_status(dce, &a, &b, &c);
+            break;
+        case 2:
+            err = dce->get_network_status(dce, &a, &b);
+            break;
+        default:
+            err = esp_modem_dce_get_operator_name(dce);
+            break;
+        }
+        if (err == ESP_OK) {
+            ok++;
+        } else {
+            failed++;
+        }
+    }
+    portENTER_CRITICAL(&load_lock);
+    load_ok += ok;
+    load_failed += failed;
+    if (--load_running == 0) {
+        xEventGroupSetBits(event_group, LOAD_DONE_BIT);
+    }
+    portEXIT_CRITICAL(&load_lock);
+    vTaskDelete(NULL);
+}
+
+static bool run_load(void)
+{
+    char name[16];
+    load_running = options.tasks;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < options.tasks; i++) {
+        snprintf(name, sizeof(name), "load%d", i);
+        if (xTaskCreate(load_task, name, 4096, (void *)(intptr_t)i, 5, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "create load task failed");
+            return false;
+        }
+    }
+    xEventGroupWaitBits(event_group, LOAD_DONE_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+    int64_t elapsed = esp_timer_get_time() - start;
+    printf("load: %d tasks, %u ok, %u failed in %lld ms, %.1f commands/s\n", options.tasks, load_ok, load_failed,
+           (long long)(elapsed / 1000), (load_ok + load_failed) * 1e6 / (elapsed ? elapsed : 1));
+    return load_failed == 0;
+}
+
+static bool run_ppp(modem_dte_t *dte, double *downlink)
+{
+    if (esp_modem_setup_ppp(dte) != ESP_OK) {
+        ESP_LOGE(TAG, "setup PPP failed");
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(event_group, CONNECT_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(PPP_CONNECT_TIMEOUT_MS));
+    bool connected = bits & CONNECT_BIT;
+    if (!connected) {
+        ESP_LOGE(TAG, "no PPP frame from the modem in %d ms", PPP_CONNECT_TIMEOUT_MS);
+    } else {
+        ppp_host_stats_t before;
+        ppp_host_get_stats(&before);
+        int64_t start = esp_timer_get_time();
+        int64_t end = start + options.ppp_seconds * 1000000LL;
+        uint64_t sent = 0;
+        while (esp_timer_get_time() < end) {
+            /* Keep the uplink at the requested rate, in whole frames */
+            int64_t due = options.uplink_rate * (esp_timer_get_time() - start) / 1000000;
+            while ((int64_t)sent + PPP_UPLINK_FRAME <= due && ppp_host_send(PPP_UPLINK_FRAME) == ESP_OK) {
+                sent += PPP_UPLINK_FRAME;
+            }
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        ppp_host_stats_t after;
+        ppp_host_get_stats(&after);
+        double seconds = (esp_timer_get_time() - start) / 1e6;
+        printf("ppp: downlink %.0f bytes/s in %u frames, %u FCS errors, %u runts, %u overlong; "
+               "uplink %.0f bytes/s in %u frames\n",
+               (after.bytes_in - before.bytes_in) / seconds, after.frames_in - before.frames_in,
+               after.fcs_errors - before.fcs_errors, after.runts - before.runts, after.overlong - before.overlong,
+               (after.bytes_out - before.bytes_out) / seconds, after.frames_out - before.frames_out);
+        connected = after.fcs_errors == before.fcs_errors;
+        if (downlink) {
+            *downlink = (after.bytes_in - before.bytes_in) / seconds;
+        }
+    }
+    if (esp_modem_exit_ppp(dte) != ESP_OK) {
+        ESP_LOGE(TAG, "exit PPP failed");
+        return false;
+    }
+    xEventGroupWaitBits(event_group, STOP_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(5000));
+    return connected;
+}
+
+static void print_stats(modem_dte_t *dte)
+{
+    if (dce->stats) {
+        esp_modem_stats_verb_t *verb = esp_modem_pool_alloc(sizeof(esp_modem_stats_verb_t));
+        if (verb) {
+            printf("%-10s %6s %5s %5s | %-22s | %-22s %8s\n", "verb", "count", "error", "t/o",
+                   "first line p50/95/99", "final p50/95/99 (ms)", "max");
+            for (int i = 0; esp_modem_stats_get(dce->stats, i, verb) == ESP_OK; i++) {
+                printf("%-10s %6u %5u %5u | %6u %7u %7u | %6u %7u %7u %8u\n", verb->verb, verb->count, verb->errors,
+                       verb->timeouts, esp_modem_stats_percentile(&verb->first_line, 50),
+                       esp_modem_stats_percentile(&verb->first_line, 95), esp_modem_stats_percentile(&verb->first_line, 99),
+                       esp_modem_stats_percentile(&verb->final_result, 50), esp_modem_stats_percentile(&verb->final_result, 95),
+                       esp_modem_stats_percentile(&verb->final_result, 99), verb->final_result.max_ms);
+            }
+            esp_modem_pool_free(verb);
+        }
+        if (options.json) {
+            FILE *fp = fopen(options.json, "w");
+            if (fp) {
+                esp_modem_stats_write_json(dce->stats, dce->imei[0] ? dce->imei : "unknown", fp);
+                fclose(fp);
+            } else {
+                ESP_LOGE(TAG, "cannot open %s", options.json);
+            }
+        }
+    }
+    esp_modem_uart_stats_t uart;
+    esp_modem_get_uart_stats(dte, &uart);
+    printf("uart: fifo overflows: %u, buffer full: %u, pattern overflows: %u, bytes dropped: %u\n",
+           uart.fifo_overflows, uart.buffer_full, uart.pattern_overflows, uart.bytes_dropped);
+    esp_modem_pool_report();
+}
+
+/**
+ * @brief Power on the modem and bring up the DTE and the DCE, as "modem start" does
+ */
+static modem_dce_t *modem_start(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    if (!bg96) {
+        sim800_power_on(sim800_config);
+    }
+    modem_dte_t *dte = esp_modem_dte_init(dte_config);
+    if (!dte) {
+        ESP_LOGE(TAG, "DTE init failed");
+        return NULL;
+    }
+    ESP_ERROR_CHECK(esp_modem_add_event_handler(dte, modem_event_handler, NULL));
+
+    modem_dce_t *started;
+    if (bg96) {
+        started = bg96_init(dte);
+    } else if (!strcmp(options.model, "sim800")) {
+        started = sim800_init(dte, sim800_config);
+    } else {
+        started = esp_modem_driver_init(dte, sim800_config);
+    }
+    if (!started) {
+        ESP_LOGE(TAG, "DCE init failed");
+        esp_modem_remove_event_handler(dte, modem_event_handler);
+        esp_modem_dte_deinit(dte);
+        return NULL;
+    }
+    if (options.cache) {
+        const esp_modem_cache_config_t cache_config = ESP_MODEM_CACHE_DEFAULT_CONFIG();
+        if (esp_modem_cache_enable(started, &cache_config) != ESP_OK) {
+            ESP_LOGW(TAG, "Query cache not enabled");
+        }
+    }
+    return started;
+}
+
+/**
+ * @brief Power down the modem and tear down the DCE and the DTE, as "modem stop" does
+ */
+static void modem_stop(modem_dce_t *dce, const sim800_config_t *sim800_config, bool bg96,
+                       esp_modem_shutdown_report_t *report)
+{
+    esp_modem_shutdown(dce, report);
+    if (!bg96) {
+        sim800_power_off(sim800_config);
+    }
+}
+
+/**
+ * @brief Start and stop the modem over and over, what is left on the heap after the first cycle is a leak
+ */
+static bool run_cycles(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    heap_host_stats_t before, first, after, cycle_start, cycle_end;
+    esp_modem_shutdown_report_t report;
+    uint64_t shutdown_ms = 0;
+    uint32_t shutdown_max_ms = 0;
+    long long delta_min = 0, delta_max = 0;
+    int failed = 0, stopped = 0, unconfirmed = 0;
+    heap_host_get_stats(&before);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < options.cycles; i++) {
+        heap_host_get_stats(&cycle_start);
+        modem_dce_t *started = modem_start(dte_config, sim800_config, bg96);
+        if (started) {
+            modem_stop(started, sim800_config, bg96, &report);
+            stopped++;
+            shutdown_ms += report.total_ms;
+            if (report.total_ms > shutdown_max_ms) {
+                shutdown_max_ms = report.total_ms;
+            }
+            unconfirmed += !report.confirmed;
+        } else {
+            failed++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(CYCLE_PAUSE_MS));
+        heap_host_get_stats(&cycle_end);
+        long long delta = (long long)cycle_end.in_use - (long long)cycle_start.in_use;
+        /* The first cycle sets up what stays, such as the PWKEY timer */
+        if (i == 1) {
+            delta_min = delta_max = delta;
+        } else if (i > 1) {
+            delta_min = delta < delta_min ? delta : delta_min;
+            delta_max = delta > delta_max ? delta : delta_max;
+        }
+        if (i == 0) {
+            /* Whatever is set up once, such as the PWKEY timer and the NVS handles, is in by now */
+            heap_host_get_stats(&first);
+        }
+        if ((i + 1) % 100 == 0) {
+            heap_host_get_stats(&after);
+            printf("cycle %d: %zu bytes in use, %zu free in the arena\n", i + 1, after.in_use, after.arena_free);
+        }
+    }
+    heap_host_get_stats(&after);
+    int64_t elapsed = esp_timer_get_time() - start;
+    int cycles = options.cycles;
+    uint64_t allocations = after.allocations - first.allocations;
+    long long leaked = (long long)after.in_use - (long long)first.in_use;
+    printf("cycles: %d, %d failed in %lld ms, static allocation %s\n", cycles, failed, (long long)(elapsed / 1000),
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+           "on"
+#else
+           "off"
+#endif
+          );
+    printf("heap: first cycle %llu allocations, then %.1f per cycle; %lld bytes leaked after the first cycle, "
+           "peak %zu bytes, arena free %zu -> %zu bytes\n",
+           (unsigned long long)(first.allocations - before.allocations), cycles > 1 ? (double)allocations / (cycles - 1) : 0.0,
+           leaked, after.peak, first.arena_free, after.arena_free);
+    printf("heap delta per cycle after the first: %lld to %lld bytes\n", delta_min, delta_max);
+    printf("shutdown: mean %llu ms, max %u ms, %d without the modem's confirmation\n",
+           stopped ? (unsigned long long)(shutdown_ms / stopped) : 0ULL, shutdown_max_ms, unconfirmed);
+    return failed == 0 && unconfirmed == 0 && leaked <= 0;
+}
+
+#define LAYOUT_EVENT_PRIORITY (5)
+#define LAYOUT_HIGH_PRIORITY (19)
+
+/* The layouts of "start pinbench", core n is CPU n here and priorities are not enforced */
+static const struct {
+    const char *name;
+    BaseType_t rx_core;
+    UBaseType_t rx_priority;
+    BaseType_t event_core;
+    UBaseType_t event_priority;
+} layouts[] = {
+    {"floating", tskNO_AFFINITY, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, tskNO_AFFINITY, 0},
+    {"rx 0", 0, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, tskNO_AFFINITY, 0},
+    {"rx 1", 1, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, tskNO_AFFINITY, 0},
+    {"rx 1, events 0", 1, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, 0, LAYOUT_EVENT_PRIORITY},
+    {"rx 1 high, events 0", 1, LAYOUT_HIGH_PRIORITY, 0, LAYOUT_EVENT_PRIORITY},
+};
+
+static int compare_us(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Start the modem under each task layout, time AT+CLAC round trips and measure the PPP downlink
+ */
+static bool run_layouts(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    int64_t *round_us = calloc(options.layout_rounds, sizeof(int64_t));
+    bool ok = round_us != NULL;
+    printf("%-20s %6s %7s %7s %7s %9s %9s %11s\n", "layout", "rounds", "p50 ms", "p99 ms", "max ms", "jitter ms",
+           "rx bytes/s", "ppp bytes/s");
+    for (size_t l = 0; ok && l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        esp_modem_dte_config_t config = *dte_config;
+        config.rx_task_core = layouts[l].rx_core;
+        config.rx_task_priority = layouts[l].rx_priority;
+        config.event_task_core = layouts[l].event_core;
+        config.event_task_priority = layouts[l].event_priority;
+        dce = modem_start(&config, sim800_config, bg96);
+        if (!dce) {
+            ok = false;
+            break;
+        }
+        sim800_soak_result_t result;
+        /* The first round also waits for the identity read in the background */
+        sim800_soak_test(dce, 1, &result);
+        int rounds = 0;
+        uint64_t bytes = 0;
+        int64_t busy_us = 0;
+        for (int i = 0; i < options.layout_rounds; i++) {
+            int64_t start = esp_timer_get_time();
+            if (sim800_soak_test(dce, 1, &result) != ESP_OK) {
+                ok = false;
+                continue;
+            }
+            round_us[rounds] = esp_timer_get_time() - start;
+            busy_us += round_us[rounds++];
+            bytes += result.bytes;
+        }
+        double downlink = 0;
+        if (options.ppp_seconds > 0) {
+            ok &= run_ppp(dce->dte, &downlink);
+        }
+        modem_stop(dce, sim800_config, bg96, NULL);
+        dce = NULL;
+        vTaskDelay(pdMS_TO_TICKS(CYCLE_PAUSE_MS));
+        if (!rounds) {
+            printf("%-20s no complete round\n", layouts[l].name);
+            continue;
+        }
+        qsort(round_us, rounds, sizeof(round_us[0]), compare_us);
+        int64_t p50 = round_us[rounds / 2], p99 = round_us[rounds * 99 / 100];
+        printf("%-20s %6d %7.1f %7.1f %7.1f %9.1f %9.0f %11.0f\n", layouts[l].name, rounds, p50 / 1e3, p99 / 1e3,
+               round_us[rounds - 1] / 1e3, (p99 - p50) / 1e3, busy_us ? bytes * 1e6 / busy_us : 0.0, downlink);
+    }
+    free(round_us);
+    return ok;
+}
+
+/**
+ * @brief Wait for the health monitor to bring a hanging modem back, reporting each step and the time to recover
+ */
+static bool run_health(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    /* Tighter than the Kconfig defaults, so that a run takes seconds */
+    const esp_modem_health_config_t health_config = {
+        .check_interval_ms = 200,
+        .silence_ms = 2000,
+        .ppp_silence_ms = 3000,
+        .max_timeouts = 2,
+        .sync_attempts = 2,
+    };
+    esp_modem_health_stats_t stats;
+    bool ppp = options.ppp_seconds > 0;
+    bool ok = true;
+    int done = 0;
+
+    dce = modem_start(dte_config, sim800_config, bg96);
+    if (!dce) {
+        return false;
+    }
+    if (esp_modem_health_enable(dce, &health_config) != ESP_OK) {
+        ESP_LOGE(TAG, "health monitor not enabled");
+        modem_stop(dce, sim800_config, bg96, NULL);
+        return false;
+    }
+    if (ppp && esp_modem_setup_ppp(dce->dte) != ESP_OK) {
+        ESP_LOGE(TAG, "setup PPP failed");
+        ok = false;
+    }
+    while (ok && done < options.recoveries) {
+        int64_t deadline = esp_timer_get_time() + HEALTH_RECOVERY_TIMEOUT_MS * 1000LL;
+        do {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            esp_modem_health_get_stats(dce, &stats);
+            int ended = stats.failures;
+            for (int i = 0; i < ESP_MODEM_HEALTH_LEVEL_MAX; i++) {
+                ended += stats.recovered[i];
+            }
+            if (ended > done) {
+                done = ended;
+                break;
+            }
+        } while (esp_timer_get_time() < deadline);
+        if (esp_timer_get_time() >= deadline) {
+            ESP_LOGE(TAG, "no recovery within %d ms", HEALTH_RECOVERY_TIMEOUT_MS);
+            ok = false;
+        } else if (ppp && dce->mode != MODEM_PPP_MODE) {
+            ESP_LOGE(TAG, "recovery %d did not restore PPP", done);
+            ok = false;
+        } else {
+            printf("recovery %d: %u ms\n", done, stats.last_mttr_ms);
+        }
+    }
+    esp_modem_health_get_stats(dce, &stats);
+    int recovered = 0;
+    printf("health: %d recoveries in %s mode, %u failed;", done, ppp ? "PPP" : "command", stats.failures);
+    for (int i = 0; i < ESP_MODEM_HEALTH_LEVEL_MAX; i++) {
+        printf(" %s %u", esp_modem_health_level_name(i), stats.recovered[i]);
+        recovered += stats.recovered[i];
+    }
+    printf("\nhealth: time to recover mean %llu ms, max %u ms; %u command timeouts, %u AT probes\n",
+           recovered ? (unsigned long long)(stats.total_mttr_ms / recovered) : 0ULL, stats.max_mttr_ms, stats.timeouts,
+           stats.probes);
+    ok &= stats.failures == 0;
+    /* Closes PPP on the way down */
+    esp_modem_shutdown_report_t report;
+    modem_stop(dce, sim800_config, bg96, &report);
+    printf("shutdown: %u ms, flush %u ms, ppp %u ms\n", report.total_ms, report.flush_ms, report.ppp_ms);
+    dce = NULL;
+    return ok;
+}
+
+/**
+ * @brief Send telemetry rounds with the modem put to sleep in between, reporting wake-ups and energy per round
+ */
+static bool run_sleep(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    /* Tighter idle time than the Kconfig default, so that a run takes seconds */
+    const esp_modem_sleep_config_t sleep_config = {
+        .dtr_io_num = CONFIG_EXAMPLE_MODEM_DTR,
+        .ri_io_num = -1,
+        .idle_ms = 300,
+        .settle_ms = CONFIG_EXAMPLE_MODEM_SLEEP_SETTLE,
+        .latency_budget_ms = CONFIG_EXAMPLE_MODEM_SLEEP_LATENCY_BUDGET,
+        .rearm_ms = CONFIG_EXAMPLE_MODEM_SLEEP_REARM,
+    };
+    const esp_modem_sleep_power_t power = ESP_MODEM_SLEEP_DEFAULT_POWER();
+    esp_modem_sleep_stats_t stats;
+    uint32_t failed = 0;
+    int64_t max_round_us = 0;
+
+    dce = modem_start(dte_config, sim800_config, bg96);
+    if (!dce) {
+        return false;
+    }
+    if (esp_modem_sleep_enable(dce, &sleep_config) != ESP_OK) {
+        ESP_LOGE(TAG, "sleep manager not enabled");
+        modem_stop(dce, sim800_config, bg96, NULL);
+        return false;
+    }
+    /* The SIM800 driver reads the identity in the background, let it finish before counting */
+    vTaskDelay(pdMS_TO_TICKS(SLEEP_ROUND_INTERVAL_MS));
+    esp_modem_sleep_reset_stats(dce);
+    for (int i = 0; i < options.sleep_rounds; i++) {
+        uint32_t a, b, c;
+        int64_t start = esp_timer_get_time();
+        esp_modem_cache_invalidate(dce, ESP_MODEM_CACHE_MAX);
+        if (dce->get_signal_quality(dce, &a, &b) != ESP_OK || dce->get_battery_status(dce, &a, &b, &c) != ESP_OK ||
+            dce->get_network_status(dce, &a, &b) != ESP_OK) {
+            failed++;
+        }
+        int64_t round_us = esp_timer_get_time() - start;
+        if (round_us > max_round_us) {
+            max_round_us = round_us;
+        }
+        vTaskDelay(pdMS_TO_TICKS(SLEEP_ROUND_INTERVAL_MS));
+    }
+    esp_modem_sleep_get_stats(dce, &stats);
+    uint64_t total_us = stats.asleep_us + stats.awake_us;
+    printf("sleep: %d rounds, %u failed, longest %lld ms; %u sleeps, %u refused, %u wakes, %.1f%% asleep\n",
+           options.sleep_rounds, failed, (long long)(max_round_us / 1000), stats.sleeps, stats.refused, stats.wakes,
+           total_us ? stats.asleep_us * 100.0 / total_us : 0.0);
+    printf("sleep: wake-up last %u ms, max %u ms, budget %u ms, %u over%s\n", stats.last_wake_ms, stats.max_wake_ms,
+           sleep_config.latency_budget_ms, stats.over_budget, stats.disabled ? ", sleep disabled" : "");
+    printf("sleep: energy per round %.1f mJ awake, %.1f mJ modem sleep, %.1f mJ modem and chip sleep\n",
+           esp_modem_sleep_awake_energy_uj(&stats, &power) / 1e3 / options.sleep_rounds,
+           esp_modem_sleep_energy_uj(&stats, &power, false) / 1e3 / options.sleep_rounds,
+           esp_modem_sleep_energy_uj(&stats, &power, true) / 1e3 / options.sleep_rounds);
+    /* The last round may not have been followed by a wake-up yet */
+    bool ok = failed == 0 && !stats.disabled && stats.over_budget == 0 && stats.wakes + 1 >= options.sleep_rounds;
+    modem_stop(dce, sim800_config, bg96, NULL);
+    dce = NULL;
+    return ok;
+}
+
+/**
+ * @brief Keep PPP busy through a supply that sags then dips, letting the governor throttle, pause and resume it
+ */
+static bool run_supply(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    /* Tighter timings than the Kconfig defaults, so that a run takes seconds */
+    const esp_modem_supply_config_t supply_config = {
+        .throttle_mv = 3600,
+        .pause_mv = 3500,
+        .resume_mv = 3750,
+        .over_mv = 4300,
+        .hold_ms = 2000,
+        .poll_ms = 1000,
+        .alarm_poll_ms = 500,
+        .ppp_check_ms = 2000,
+        .uplink_rate = 1000,
+        .uplink_burst = 512,
+    };
+    esp_modem_supply_stats_t stats;
+    esp_modem_supply_level_t level = ESP_MODEM_SUPPLY_NORMAL;
+    uint64_t sent = 0;
+    uint32_t lcp_sent = 0, lcp_refused = 0;
+    bool ok = true;
+
+    dce = modem_start(dte_config, sim800_config, bg96);
+    if (!dce) {
+        return false;
+    }
+    if (esp_modem_supply_enable(dce, &supply_config) != ESP_OK) {
+        ESP_LOGE(TAG, "supply governor not enabled");
+        modem_stop(dce, sim800_config, bg96, NULL);
+        return false;
+    }
+    /* PPP is only left for a reading once one has found the supply low */
+    for (int i = 0; i < 50 && esp_modem_supply_get_stats(dce, &stats) == ESP_OK && !stats.readings; i++) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    if (esp_modem_setup_ppp(dce->dte) != ESP_OK) {
+        ESP_LOGE(TAG, "setup PPP failed");
+        ok = false;
+    }
+    int64_t start = esp_timer_get_time();
+    int64_t end = start + options.supply_seconds * 1000000LL;
+    int64_t last = start;
+    int64_t credit = 0;
+    while (ok && esp_timer_get_time() < end) {
+        vTaskDelay(pdMS_TO_TICKS(SUPPLY_TICK_MS));
+        int64_t now = esp_timer_get_time();
+        esp_modem_supply_level_t current = esp_modem_supply_get_level(dce);
+        if (current != level) {
+            printf("%lld ms: %s -> %s\n", (long long)((now - start) / 1000), esp_modem_supply_level_name(level),
+                   esp_modem_supply_level_name(current));
+            level = current;
+        }
+        /* Offer the uplink at the requested rate while the session is up, the governor decides what goes */
+        if (!(xEventGroupGetBits(event_group) & CONNECT_BIT)) {
+            credit = 0;
+        } else {
+            credit += options.uplink_rate * (now - last) / 1000000;
+            while (credit >= PPP_UPLINK_FRAME && ppp_host_send(PPP_UPLINK_FRAME) == ESP_OK) {
+                credit -= PPP_UPLINK_FRAME;
+                sent += PPP_UPLINK_FRAME;
+            }
+            /* Past the burst too, an LCP frame must go or the session would die of the throttle */
+            if (current == ESP_MODEM_SUPPLY_THROTTLE) {
+                esp_err_t err = ppp_host_send_protocol(0xc021, 12);
+                lcp_sent += err == ESP_OK;
+                lcp_refused += err == ESP_FAIL;
+            }
+        }
+        last = now;
+    }
+    esp_modem_supply_get_stats(dce, &stats);
+    printf("supply: %s, last %u mV, min %u mV, max %u mV in %u readings, %u UNDER-VOLTAGE, %u OVER-VOLTAGE\n",
+           esp_modem_supply_level_name(stats.level), stats.last_mv, stats.min_mv, stats.max_mv, stats.readings,
+           stats.under_urcs, stats.over_urcs);
+    printf("supply: %u throttles for %llu ms, %u pauses for %llu ms, %u resumes, %u PPP checks\n", stats.throttles,
+           (unsigned long long)(stats.throttled_us / 1000), stats.pauses, (unsigned long long)(stats.paused_us / 1000),
+           stats.resumes, stats.ppp_checks);
+    printf("supply: uplink %llu bytes sent, %llu paced, %u frames (%llu bytes) dropped\n", (unsigned long long)sent,
+           (unsigned long long)stats.paced_bytes, stats.dropped_frames, (unsigned long long)stats.dropped_bytes);
+    printf("supply: %u LCP frames sent while throttled, %u refused\n", lcp_sent, lcp_refused);
+    ok &= stats.throttles > 0 && stats.pauses > 0 && stats.resumes > 0 && stats.level == ESP_MODEM_SUPPLY_NORMAL;
+    ok &= lcp_sent > 0 && !lcp_refused;
+    if (dce->mode != MODEM_PPP_MODE) {
+        ESP_LOGE(TAG, "PPP not resumed after the dip");
+        ok = false;
+    }
+    /* Closes PPP on the way down */
+    modem_stop(dce, sim800_config, bg96, NULL);
+    dce = NULL;
+    return ok;
+}
+
+/**
+ * @brief One caller of -A: a priority, a command of its own and what its answer looks like
+ */
+typedef struct {
+    esp_modem_priority_t priority;
+    uint32_t deadline_ms;     /*!< How long it waits for the channel */
+    const char *command;
+    const char *expect;       /*!< The information line, exactly or as a prefix */
+    bool exact;
+    uint32_t answered;        /*!< Commands whose answer was its own */
+    uint32_t crossed;         /*!< Commands that saw the answer of another caller, or none */
+    uint32_t failed;          /*!< Commands that failed once the channel was granted */
+    uint32_t granted;         /*!< Channel grants */
+    uint32_t misses;          /*!< Channel deadlines missed */
+    char line[64];            /*!< Information line of the command in flight */
+    int lines;                /*!< Information lines of the command in flight that belong to a caller */
+} arbiter_caller_t;
+
+static arbiter_caller_t *arbiter_callers;
+static int arbiter_caller_count;
+
+static bool arbiter_line_matches(const arbiter_caller_t *caller, const char *line)
+{
+    return caller->exact ? !strcmp(line, caller->expect) : !strncmp(line, caller->expect, strlen(caller->expect));
+}
+
+/**
+ * @brief Keep the information lines any caller could claim, the URCs of the simulator match none
+ */
+static esp_err_t arbiter_handle_line(modem_dce_t *dce, const char *line)
+{
+    arbiter_caller_t *caller = (arbiter_caller_t *)dce->priv_resource;
+    char stripped[64];
+    snprintf(stripped, sizeof(stripped), "%s", line);
+    stripped[strcspn(stripped, "\r\n")] = '\0';
+    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
+        return esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
+    }
+    if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
+        return esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+    }
+    for (int i = 0; i < arbiter_caller_count; i++) {
+        if (arbiter_line_matches(&arbiter_callers[i], stripped)) {
+            snprintf(caller->line, sizeof(caller->line), "%s", stripped);
+            caller->lines++;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+static void arbiter_task(void *param)
+{
+    arbiter_caller_t *caller = (arbiter_caller_t *)param;
+    for (int i = 0; i < options.arbiter_rounds; i++) {
+        if (esp_modem_arbiter_acquire(dce->arbiter, caller->priority, caller->deadline_ms) != ESP_OK) {
+            caller->misses++;
+            /* Let the others move before trying again */
+            vTaskDelay(pdMS_TO_TICKS(ARBITER_SHORT_DEADLINE_MS));
+            continue;
+        }
+        caller->granted++;
+        caller->line[0] = '\0';
+        caller->lines = 0;
+        esp_err_t err = esp_modem_dce_command(dce, caller->command, MODEM_COMMAND_TIMEOUT_DEFAULT, arbiter_handle_line, caller);
+        esp_modem_arbiter_release(dce->arbiter);
+        if (err != ESP_OK) {
+            caller->failed++;
+        } else if (caller->lines == 1 && arbiter_line_matches(caller, caller->line)) {
+            caller->answered++;
+        } else {
+            ESP_LOGE(TAG, "%s got \"%s\" (%d lines)", caller->command, caller->line, caller->lines);
+            caller->crossed++;
+        }
+    }
+    portENTER_CRITICAL(&load_lock);
+    if (--load_running == 0) {
+        xEventGroupSetBits(event_group, LOAD_DONE_BIT);
+    }
+    portEXIT_CRITICAL(&load_lock);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Callers of every priority send their own command at once; every answer must be the caller's own,
+ *        a low priority caller is served after at most the bypass limit of overtakes, and the deadline
+ *        misses the callers saw are the ones the arbiter counted
+ */
+static bool run_arbiter(const esp_modem_dte_config_t *dte_config, const sim800_config_t *sim800_config, bool bg96)
+{
+    esp_modem_arbiter_stats_t stats[ESP_MODEM_PRIORITY_MAX];
+    uint32_t granted[ESP_MODEM_PRIORITY_MAX] = {0};
+    uint32_t misses[ESP_MODEM_PRIORITY_MAX] = {0};
+    bool ok = true;
+    char name[16];
+
+    dce = modem_start(dte_config, sim800_config, bg96);
+    if (!dce) {
+        return false;
+    }
+    arbiter_caller_t callers[] = {
+        {ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT, "AT+CGSN\r", dce->imei, true},
+        {ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT, "AT+CBC\r", "+CBC:", false},
+        {ESP_MODEM_PRIORITY_NORMAL, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT, "AT+CIMI\r", dce->imsi, true},
+        {ESP_MODEM_PRIORITY_NORMAL, ARBITER_SHORT_DEADLINE_MS, "AT+CSQ\r", "+CSQ:", false},
+        {ESP_MODEM_PRIORITY_INTERACTIVE, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT, "AT+COPS?\r", "+COPS:", false},
+        {ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT, "AT+CGMM\r", dce->name, true},
+    };
+    arbiter_callers = callers;
+    arbiter_caller_count = sizeof(callers) / sizeof(callers[0]);
+    /* The identity worker is done with the boot queries by now, what it does later counts too */
+    esp_modem_arbiter_reset_stats(dce->arbiter);
+    load_running = arbiter_caller_count;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < arbiter_caller_count; i++) {
+        snprintf(name, sizeof(name), "arbiter%d", i);
+        if (xTaskCreate(arbiter_task, name, 4096, &callers[i], 5, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "create arbiter task failed");
+            return false;
+        }
+    }
+    xEventGroupWaitBits(event_group, LOAD_DONE_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+    int64_t elapsed = esp_timer_get_time() - start;
+    esp_modem_arbiter_get_stats(dce->arbiter, stats);
+
+    printf("arbiter: %d callers, %d rounds each in %lld ms\n", arbiter_caller_count, options.arbiter_rounds,
+           (long long)(elapsed / 1000));
+    for (int i = 0; i < arbiter_caller_count; i++) {
+        arbiter_caller_t *caller = &callers[i];
+        printf("%-12s %-10s %u answered, %u crossed, %u failed, %u deadline misses\n",
+               esp_modem_arbiter_priority_name(caller->priority), caller->command, caller->answered, caller->crossed,
+               caller->failed, caller->misses);
+        granted[caller->priority] += caller->granted;
+        misses[caller->priority] += caller->misses;
+        ok &= !caller->crossed && !caller->failed && caller->answered + caller->misses == options.arbiter_rounds;
+        /* Only the short deadline may run out, the others must be served within the bypass limit */
+        ok &= caller->deadline_ms == ARBITER_SHORT_DEADLINE_MS || !caller->misses;
+    }
+    printf("priority      granted immediate overtaken  aged misses\n");
+    for (int p = 0; p < ESP_MODEM_PRIORITY_MAX; p++) {
+        uint32_t waits = stats[p].granted - stats[p].immediate + stats[p].deadline_misses;
+        printf("%-12s %8u %9u %9u %5u %6u\n", esp_modem_arbiter_priority_name(p), stats[p].granted,
+               stats[p].immediate, stats[p].overtaken, stats[p].aged, stats[p].deadline_misses);
+        /* The identity worker may add background grants, nobody else asks for the channel */
+        ok &= stats[p].granted >= granted[p] && stats[p].deadline_misses == misses[p];
+        /* Each wait is overtaken at most the bypass limit of times before it goes next */
+        if (stats[p].overtaken > waits * CONFIG_EXAMPLE_MODEM_ARBITER_MAX_BYPASS) {
+            ESP_LOGE(TAG, "%s waiters overtaken %u times in %u waits, over the limit of %d",
+                     esp_modem_arbiter_priority_name(p), stats[p].overtaken, waits, CONFIG_EXAMPLE_MODEM_ARBITER_MAX_BYPASS);
+            ok = false;
+        }
+    }
+    /* Under steady higher priority demand, the background callers only got through by aging */
+    if (!stats[ESP_MODEM_PRIORITY_BACKGROUND].aged || !misses[ESP_MODEM_PRIORITY_NORMAL]) {
+        ESP_LOGE(TAG, "no background caller aged or no deadline missed, the run did not load the arbiter");
+        ok = false;
+    }
+    arbiter_callers = NULL;
+    modem_stop(dce, sim800_config, bg96, NULL);
+    dce = NULL;
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "d:m:t:n:p:u:Cc:j:r:L:H:S:V:A:vh")) != -1) {
+        switch (opt) {
+        case 'd': options.device = optarg; break;
+        case 'm': options.model = optarg; break;
+        case 't': options.tasks = atoi(optarg); break;
+        case 'n': options.commands = atoi(optarg); break;
+        case 'p': options.ppp_seconds = atoi(optarg); break;
+        case 'u': options.uplink_rate = atoi(optarg); break;
+        case 'C': options.cache = true; break;
+        case 'c': options.capture = optarg; break;
+        case 'j': options.json = optarg; break;
+        case 'r': options.cycles = atoi(optarg); break;
+        case 'L': options.layout_rounds = atoi(optarg); break;
+        case 'H': options.recoveries = atoi(optarg); break;
+        case 'S': options.sleep_rounds = atoi(optarg); break;
+        case 'V': options.supply_seconds = atoi(optarg); break;
+        case 'A': options.arbiter_rounds = atoi(optarg); break;
+        case 'v': esp_log_level_set("*", ESP_LOG_DEBUG); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (!options.device || options.tasks < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    event_group = xEventGroupCreate();
+    ESP_ERROR_CHECK(uart_host_set_device(UART_NUM_1, options.device));
+    ESP_ERROR_CHECK(esp_modem_driver_register(&sim800_driver));
+    ESP_ERROR_CHECK(esp_modem_driver_register(&bg96_driver));
+
+    const esp_modem_dte_config_t dte_config = ESP_MODEM_DTE_DEFAULT_CONFIG();
+    const sim800_config_t sim800_config = SIM800_DEFAULT_CONFIG();
+    bool bg96 = !strcmp(options.model, "bg96");
+    /* A reset or a power cycle of the SIM800 closes the pty, which the simulator takes for a power off */
+    ESP_ERROR_CHECK(uart_host_set_power_pins(UART_NUM_1, sim800_config.rst_io_num, sim800_config.power_io_num));
+    /* DTR reaches the simulator on <device>.pins */
+    ESP_ERROR_CHECK(uart_host_set_dtr_pin(UART_NUM_1, CONFIG_EXAMPLE_MODEM_DTR));
+    if (options.cycles > 0) {
+        bool ok = run_cycles(&dte_config, &sim800_config, bg96);
+        vEventGroupDelete(event_group);
+        return ok ? 0 : 1;
+    }
+    if (options.recoveries > 0) {
+        bool ok = run_health(&dte_config, &sim800_config, bg96);
+        vEventGroupDelete(event_group);
+        return ok ? 0 : 1;
+    }
+    if (options.sleep_rounds > 0) {
+        bool ok = run_sleep(&dte_config, &sim800_config, bg96);
+        vEventGroupDelete(event_group);
+        return ok ? 0 : 1;
+    }
+    if (options.supply_seconds > 0) {
+        bool ok = run_supply(&dte_config, &sim800_config, bg96);
+        vEventGroupDelete(event_group);
+        return ok ? 0 : 1;
+    }
+    if (options.arbiter_rounds > 0) {
+        bool ok = run_arbiter(&dte_config, &sim800_config, bg96);
+        vEventGroupDelete(event_group);
+        return ok ? 0 : 1;
+    }
+    if (options.layout_rounds > 0) {
+        bool ok = run_layouts(&dte_config, &sim800_config, bg96);
+        vEventGroupDelete(event_group);
+        return ok ? 0 : 1;
+    }
+
+    int64_t start = esp_timer_get_time();
+    dce = modem_start(&dte_config, &sim800_config, bg96);
+    if (!dce) {
+        return 1;
+    }
+    modem_dte_t *dte = dce->dte;
+    printf("init: %lld ms\n", (long long)((esp_timer_get_time() - start) / 1000));
+
+    bool ok = run_load();
+    /* The SIM800 driver reads the identity in the background, it is in by now */
+    printf("modem: %s, IMEI %s, IMSI %s, operator %s\n", dce->name, dce->imei, dce->imsi, dce->oper);
+    if (options.ppp_seconds > 0) {
+        ok &= run_ppp(dte, NULL);
+    }
+    print_stats(dte);
+    if (options.capture && esp_modem_capture_dump(options.capture) != ESP_OK) {
+        ESP_LOGW(TAG, "capture not written to %s", options.capture);
+    }
+
+    esp_modem_shutdown_report_t report;
+    modem_stop(dce, &sim800_config, bg96, &report);
+    printf("shutdown: %u ms, flush %u ms, quiesce %u ms, ppp %u ms, power down %u ms%s, teardown %u ms\n",
+           report.total_ms, report.flush_ms, report.quiesce_ms, report.ppp_ms, report.power_down_ms,
+           report.confirmed ? "" : " (unconfirmed)", report.teardown_ms);
+    ok &= report.confirmed;
+    vEventGroupDelete(event_group);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include "esp_event.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+typedef struct esp_event_handler_node {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+    struct esp_event_handler_node *next;
+} esp_event_handler_node_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    void *data;              /*!< Copy of the posted data, freed after dispatch */
+} esp_event_post_t;
+
+/**
+ * @brief Event loop, a queue of posts and a list of handlers
+ *
+ * Handlers run with the loop lock held, which is recursive so that they may register and
+ * unregister handlers, as the IDF loop allows.
+ */
+struct esp_event_loop {
+    QueueHandle_t queue;
+    pthread_mutex_t lock;
+    esp_event_handler_node_t *handlers;
+    TaskHandle_t task;       /*!< NULL if run with esp_event_loop_run() */
+};
+
+static void esp_event_loop_task(void *args)
+{
+    esp_event_loop_handle_t loop = args;
+    while (1) {
+        esp_event_loop_run(loop, portMAX_DELAY);
+    }
+}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *event_loop_args, esp_event_loop_handle_t *event_loop)
+{
+    if (!event_loop_args || !event_loop) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_event_loop *loop = calloc(1, sizeof(struct esp_event_loop));
+    if (!loop) {
+        return ESP_ERR_NO_MEM;
+    }
+    loop->queue = xQueueCreate(event_loop_args->queue_size, sizeof(esp_event_post_t));
+    if (!loop->queue) {
+        free(loop);
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&loop->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (event_loop_args->task_name &&
+            xTaskCreatePinnedToCore(esp_event_loop_task, event_loop_args->task_name, event_loop_args->task_stack_size,
+                                    loop, event_loop_args->task_priority, &loop->task,
+                                    event_loop_args->task_core_id) != pdPASS) {
+        pthread_mutex_destroy(&loop->lock);
+        vQueueDelete(loop->queue);
+        free(loop);
+        return ESP_FAIL;
+    }
+    *event_loop = loop;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
+{
+    if (!event_loop) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (event_loop->task) {
+        vTaskDelete(event_loop->task);
+    }
+    esp_event_post_t post;
+    while (xQueueReceive(event_loop->queue, &post, 0) == pdTRUE) {
+        free(post.data);
+    }
+    while (event_loop->handlers) {
+        esp_event_handler_node_t *node = event_loop->handlers;
+        event_loop->handlers = node->next;
+        free(node);
+    }
+    vQueueDelete(event_loop->queue);
+    pthread_mutex_destroy(&event_loop->lock);
+    free(event_loop);
+    return ESP_OK;
+}
+
+static void esp_event_dispatch(esp_event_loop_handle_t loop, esp_event_post_t *post)
+{
+    pthread_mutex_lock(&loop->lock);
+    esp_event_handler_node_t *node = loop->handlers;
+    while (node) {
+        /* The handler may unregister itself */
+        esp_event_handler_node_t *next = node->next;
+        if ((node->base == ESP_EVENT_ANY_BASE || node->base == post->base) &&
+                (node->id == ESP_EVENT_ANY_ID || node->id == post->id)) {
+            node->handler(node->arg, post->base, post->id, post->data);
+        }
+        node = next;
+    }
+    pthread_mutex_unlock(&loop->lock);
+}
+
+esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
+{
+    if (!event_loop) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* As in IDF, keep dispatching until ticks_to_run have passed */
+    TickType_t start = xTaskGetTickCount();
+    TickType_t remaining = ticks_to_run;
+    esp_event_post_t post;
+    while (xQueueReceive(event_loop->queue, &post, remaining) == pdTRUE) {
+        esp_event_dispatch(event_loop, &post);
+        free(post.data);
+        if (ticks_to_run != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= ticks_to_run) {
+                break;
+            }
+            remaining = ticks_to_run - elapsed;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base,
+                                          int32_t event_id, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    if (!event_loop || !event_handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_event_handler_node_t *node = calloc(1, sizeof(esp_event_handler_node_t));
+    if (!node) {
+        return ESP_ERR_NO_MEM;
+    }
+    node->base = event_base;
+    node->id = event_id;
+    node->handler = event_handler;
+    node->arg = event_handler_arg;
+    pthread_mutex_lock(&event_loop->lock);
+    esp_event_handler_node_t **tail = &event_loop->handlers;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = node;
+    pthread_mutex_unlock(&event_loop->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base,
+                                            int32_t event_id, esp_event_handler_t event_handler)
+{
+    if (!event_loop) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&event_loop->lock);
+    for (esp_event_handler_node_t **it = &event_loop->handlers; *it; it = &(*it)->next) {
+        esp_event_handler_node_t *node = *it;
+        if (node->base == event_base && node->id == event_id && node->handler == event_handler) {
+            *it = node->next;
+            free(node);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&event_loop->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                            void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    if (!event_loop) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_event_post_t post = {
+        .base = event_base,
+        .id = event_id,
+    };
+    if (event_data && event_data_size) {
+        post.data = malloc(event_data_size);
+        if (!post.data) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(post.data, event_data, event_data_size);
+    }
+    if (xQueueSend(event_loop->queue, &post, ticks_to_wait) != pdTRUE) {
+        free(post.data);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
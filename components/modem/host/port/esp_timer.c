@@ -0,0 +1,193 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include "esp_timer.h"
+#include "host_wait.h"
+
+/**
+ * @brief Software timer, armed ones are kept in a list sorted by alarm time
+ *
+ */
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t alarm;          /*!< esp_timer time to fire at */
+    uint64_t period;        /*!< 0 for one shot timers */
+    bool armed;
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t s_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_timer_cond;
+static pthread_once_t s_timer_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *s_armed;
+static struct timespec s_start;
+
+__attribute__((constructor)) static void esp_timer_init_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_start);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - s_start.tv_sec) * 1000000 + (now.tv_nsec - s_start.tv_nsec) / 1000;
+}
+
+static void timer_unlink(struct esp_timer *timer)
+{
+    for (struct esp_timer **it = &s_armed; *it; it = &(*it)->next) {
+        if (*it == timer) {
+            *it = timer->next;
+            break;
+        }
+    }
+    timer->armed = false;
+}
+
+static void timer_insert(struct esp_timer *timer)
+{
+    struct esp_timer **it = &s_armed;
+    while (*it && (*it)->alarm <= timer->alarm) {
+        it = &(*it)->next;
+    }
+    timer->next = *it;
+    *it = timer;
+    timer->armed = true;
+}
+
+static void *timer_task(void *arg)
+{
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    pthread_mutex_lock(&s_timer_lock);
+    while (1) {
+        if (!s_armed) {
+            host_cond_wait(&s_timer_cond, &s_timer_lock, NULL);
+            continue;
+        }
+        int64_t wait_us = s_armed->alarm - esp_timer_get_time();
+        if (wait_us > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += wait_us / 1000000;
+            deadline.tv_nsec += (wait_us % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            host_cond_wait(&s_timer_cond, &s_timer_lock, &deadline);
+            continue;
+        }
+        struct esp_timer *timer = s_armed;
+        timer_unlink(timer);
+        if (timer->period) {
+            timer->alarm += timer->period;
+            timer_insert(timer);
+        }
+        esp_timer_cb_t callback = timer->callback;
+        void *cb_arg = timer->arg;
+        pthread_mutex_unlock(&s_timer_lock);
+        callback(cb_arg);
+        pthread_mutex_lock(&s_timer_lock);
+    }
+    return NULL;
+}
+
+static void timer_start_task(void)
+{
+    pthread_t thread;
+    host_cond_init(&s_timer_cond);
+    pthread_create(&thread, NULL, timer_task, NULL);
+    pthread_setname_np(thread, "esp_timer");
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *timer = calloc(1, sizeof(struct esp_timer));
+    if (!timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_once(&s_timer_once, timer_start_task);
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->name = create_args->name;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    pthread_mutex_lock(&s_timer_lock);
+    if (!timer->armed) {
+        timer->alarm = esp_timer_get_time() + timeout_us;
+        timer->period = period;
+        timer_insert(timer);
+        pthread_cond_signal(&s_timer_cond);
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    return ret;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return timer_arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    pthread_mutex_lock(&s_timer_lock);
+    if (timer->armed) {
+        timer_unlink(timer);
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_timer_lock);
+    bool armed = timer->armed;
+    pthread_mutex_unlock(&s_timer_lock);
+    if (armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    free(timer);
+    return ESP_OK;
+}
@@ -0,0 +1,707 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "host_wait.h"
+
+/**
+ * @brief A task is a joinable thread
+ *
+ * Threads run with cancellation disabled except inside host_cond_wait(), so vTaskDelete()
+ * of another task only takes effect while that task is blocked, never with a lock held.
+ */
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t entry;
+    void *param;
+    char name[16];
+    UBaseType_t priority;
+    bool foreign;            /*!< Thread not started by xTaskCreate, such as main */
+    bool is_static;          /*!< In a StaticTask_t, not freed */
+    pthread_mutex_t lock;    /*!< Protects notified */
+    pthread_cond_t cond;
+    uint32_t notified;
+};
+
+static __thread struct host_task *s_current;
+
+_Static_assert(sizeof(struct host_task) <= sizeof(StaticTask_t), "StaticTask_t too small");
+
+void host_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+struct timespec *host_deadline(TickType_t ticks, struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    deadline->tv_sec += ms / 1000;
+    deadline->tv_nsec += (ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+static void host_unlock(void *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+int host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *deadline)
+{
+    int ret;
+    int state;
+    pthread_cleanup_push(host_unlock, mutex);
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &state);
+    ret = deadline ? pthread_cond_timedwait(cond, mutex, deadline) : pthread_cond_wait(cond, mutex);
+    pthread_setcancelstate(state, NULL);
+    pthread_cleanup_pop(0);
+    return ret;
+}
+
+/* ------------------------------------------------------------------ tasks */
+
+static struct host_task *host_task_init(struct host_task *task, const char *name)
+{
+    memset(task, 0, sizeof(struct host_task));
+    snprintf(task->name, sizeof(task->name), "%s", name ? name : "");
+    pthread_mutex_init(&task->lock, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+static struct host_task *host_task_new(const char *name)
+{
+    struct host_task *task = malloc(sizeof(struct host_task));
+    return task ? host_task_init(task, name) : NULL;
+}
+
+static void host_task_free(struct host_task *task)
+{
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->cond);
+    if (!task->is_static) {
+        free(task);
+    }
+}
+
+static void *host_task_entry(void *arg)
+{
+    struct host_task *task = arg;
+    s_current = task;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    task->entry(task->param);
+    /* Returning from a task is a bug on the target, here it ends the task */
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+/* A pinned task runs on the CPU of the same number if the process may use it, priorities are not enforced */
+static BaseType_t host_task_start(struct host_task *task, TaskFunction_t entry, void *param, UBaseType_t priority,
+                                  BaseType_t core)
+{
+    task->entry = entry;
+    task->param = param;
+    task->priority = priority;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    cpu_set_t cpus;
+    if (core != tskNO_AFFINITY && sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_ISSET(core, &cpus)) {
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    int err = pthread_create(&task->thread, &attr, host_task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        host_task_free(task);
+        return pdFAIL;
+    }
+    /* Shows up in top, gdb and perf */
+    pthread_setname_np(task->thread, task->name);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                                   void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID)
+{
+    struct host_task *task = host_task_new(pcName);
+    if (!task) {
+        return pdFAIL;
+    }
+    if (pvCreatedTask) {
+        *pvCreatedTask = task;
+    }
+    return host_task_start(task, pvTaskCode, pvParameters, uxPriority, xCoreID);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t ulStackDepth,
+                                           void *const pvParameters, UBaseType_t uxPriority, StackType_t *const puxStackBuffer,
+                                           StaticTask_t *const pxTaskBuffer, const BaseType_t xCoreID)
+{
+    if (!puxStackBuffer || !pxTaskBuffer) {
+        return NULL;
+    }
+    struct host_task *task = host_task_init((struct host_task *)pxTaskBuffer, pcName);
+    task->is_static = true;
+    return host_task_start(task, pvTaskCode, pvParameters, uxPriority, xCoreID) == pdPASS ? task : NULL;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t ulStackDepth,
+                               void *const pvParameters, UBaseType_t uxPriority, StackType_t *const puxStackBuffer,
+                               StaticTask_t *const pxTaskBuffer)
+{
+    return xTaskCreateStaticPinnedToCore(pvTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, puxStackBuffer,
+                                         pxTaskBuffer, tskNO_AFFINITY);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask)
+{
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask,
+                                   tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!s_current) {
+        char name[16] = "";
+        s_current = host_task_new(NULL);
+        s_current->thread = pthread_self();
+        s_current->foreign = true;
+        pthread_getname_np(s_current->thread, name, sizeof(name));
+        snprintf(s_current->name, sizeof(s_current->name), "%s", name);
+    }
+    return s_current;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    struct host_task *task = xTaskToDelete ? xTaskToDelete : xTaskGetCurrentTaskHandle();
+    if (task == s_current) {
+        pthread_detach(task->thread);
+        s_current = NULL;
+        host_task_free(task);
+        pthread_exit(NULL);
+    }
+    if (task->foreign) {
+        return;
+    }
+    /* As on the target the task is gone when this returns */
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+    host_task_free(task);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    int state;
+    struct timespec ts = {
+        .tv_sec = xTicksToDelay * portTICK_PERIOD_MS / 1000,
+        .tv_nsec = (xTicksToDelay * portTICK_PERIOD_MS % 1000) * 1000000L,
+    };
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &state);
+    if (!xTicksToDelay) {
+        sched_yield();
+    } else {
+        while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+        }
+    }
+    pthread_setcancelstate(state, NULL);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000 * portTICK_PERIOD_MS));
+}
+
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery)
+{
+    struct host_task *task = xTaskToQuery ? xTaskToQuery : xTaskGetCurrentTaskHandle();
+    return task->name;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+{
+    struct host_task *task = xTask ? xTask : xTaskGetCurrentTaskHandle();
+    return task->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority)
+{
+    struct host_task *task = xTask ? xTask : xTaskGetCurrentTaskHandle();
+    task->priority = uxNewPriority;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec ts;
+    struct timespec *deadline = host_deadline(xTicksToWait, &ts);
+    pthread_mutex_lock(&task->lock);
+    while (!task->notified && xTicksToWait) {
+        if (host_cond_wait(&task->cond, &task->lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    uint32_t value = task->notified;
+    if (value) {
+        task->notified = xClearCountOnExit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    struct host_task *task = xTaskToNotify;
+    pthread_mutex_lock(&task->lock);
+    task->notified++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+/* ------------------------------------------------------- critical sections */
+
+void vPortCPUInitializeMutex(portMUX_TYPE *mux)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mux->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_lock(&mux->mutex);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&mux->mutex);
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return sched_getcpu() % portNUM_PROCESSORS;
+}
+
+/* ------------------------------------------------------------------ queues */
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;        /*!< Next item to receive */
+    UBaseType_t count;
+    uint8_t *items;
+    bool is_static;          /*!< In a StaticQueue_t with caller storage, not freed */
+};
+
+_Static_assert(sizeof(struct host_queue) <= sizeof(StaticQueue_t), "StaticQueue_t too small");
+
+static QueueHandle_t host_queue_init(struct host_queue *queue, UBaseType_t length, UBaseType_t item_size, uint8_t *items)
+{
+    memset(queue, 0, sizeof(struct host_queue));
+    queue->items = items;
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    host_cond_init(&queue->not_empty);
+    host_cond_init(&queue->not_full);
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    struct host_queue *queue = malloc(sizeof(struct host_queue));
+    if (!queue) {
+        return NULL;
+    }
+    uint8_t *items = calloc(uxQueueLength, uxItemSize ? uxItemSize : 1);
+    if (!items) {
+        free(queue);
+        return NULL;
+    }
+    return host_queue_init(queue, uxQueueLength, uxItemSize, items);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t *pucQueueStorageBuffer,
+                                 StaticQueue_t *pxQueueBuffer)
+{
+    if (!pxQueueBuffer || (uxItemSize && !pucQueueStorageBuffer)) {
+        return NULL;
+    }
+    struct host_queue *queue = host_queue_init((struct host_queue *)pxQueueBuffer, uxQueueLength, uxItemSize,
+                                               pucQueueStorageBuffer);
+    queue->is_static = true;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    pthread_mutex_destroy(&xQueue->lock);
+    pthread_cond_destroy(&xQueue->not_empty);
+    pthread_cond_destroy(&xQueue->not_full);
+    if (!xQueue->is_static) {
+        free(xQueue->items);
+        free(xQueue);
+    }
+}
+
+static BaseType_t host_queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool front)
+{
+    struct timespec ts;
+    struct timespec *deadline = host_deadline(ticks, &ts);
+    BaseType_t ret = pdFAIL;
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length && ticks) {
+        if (host_cond_wait(&queue->not_full, &queue->lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (queue->count < queue->length) {
+        UBaseType_t slot;
+        if (front) {
+            queue->head = (queue->head + queue->length - 1) % queue->length;
+            slot = queue->head;
+        } else {
+            slot = (queue->head + queue->count) % queue->length;
+        }
+        memcpy(queue->items + slot * queue->item_size, item, queue->item_size);
+        queue->count++;
+        pthread_cond_signal(&queue->not_empty);
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ret;
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return host_queue_send(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    return host_queue_send(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    struct timespec ts;
+    struct timespec *deadline = host_deadline(xTicksToWait, &ts);
+    BaseType_t ret = pdFAIL;
+    pthread_mutex_lock(&xQueue->lock);
+    while (!xQueue->count && xTicksToWait) {
+        if (host_cond_wait(&xQueue->not_empty, &xQueue->lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (xQueue->count) {
+        memcpy(pvBuffer, xQueue->items + xQueue->head * xQueue->item_size, xQueue->item_size);
+        xQueue->head = (xQueue->head + 1) % xQueue->length;
+        xQueue->count--;
+        pthread_cond_signal(&xQueue->not_full);
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&xQueue->lock);
+    return ret;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    xQueue->head = 0;
+    xQueue->count = 0;
+    pthread_cond_broadcast(&xQueue->not_full);
+    pthread_mutex_unlock(&xQueue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    pthread_mutex_lock(&xQueue->lock);
+    UBaseType_t count = xQueue->count;
+    pthread_mutex_unlock(&xQueue->lock);
+    return count;
+}
+
+/* -------------------------------------------------------------- semaphores */
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max;
+    struct host_task *holder;  /*!< Mutexes only */
+    UBaseType_t depth;         /*!< Recursive mutexes only */
+    bool is_static;            /*!< In a StaticSemaphore_t, not freed */
+};
+
+_Static_assert(sizeof(struct host_semaphore) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t too small");
+
+static SemaphoreHandle_t host_semaphore_new(UBaseType_t max, UBaseType_t initial, StaticSemaphore_t *buffer)
+{
+    struct host_semaphore *sem = buffer ? (struct host_semaphore *)buffer : malloc(sizeof(struct host_semaphore));
+    if (!sem) {
+        return NULL;
+    }
+    memset(sem, 0, sizeof(struct host_semaphore));
+    sem->is_static = buffer != NULL;
+    sem->max = max;
+    sem->count = initial;
+    pthread_mutex_init(&sem->lock, NULL);
+    host_cond_init(&sem->cond);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_semaphore_new(1, 0, NULL);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return host_semaphore_new(uxMaxCount, uxInitialCount, NULL);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_semaphore_new(1, 1, NULL);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return host_semaphore_new(1, 1, NULL);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *pxSemaphoreBuffer)
+{
+    return pxSemaphoreBuffer ? host_semaphore_new(1, 0, pxSemaphoreBuffer) : NULL;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount,
+                                                 StaticSemaphore_t *pxSemaphoreBuffer)
+{
+    return pxSemaphoreBuffer ? host_semaphore_new(uxMaxCount, uxInitialCount, pxSemaphoreBuffer) : NULL;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *pxMutexBuffer)
+{
+    return pxMutexBuffer ? host_semaphore_new(1, 1, pxMutexBuffer) : NULL;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *pxMutexBuffer)
+{
+    return pxMutexBuffer ? host_semaphore_new(1, 1, pxMutexBuffer) : NULL;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+    pthread_mutex_destroy(&xSemaphore->lock);
+    pthread_cond_destroy(&xSemaphore->cond);
+    if (!xSemaphore->is_static) {
+        free(xSemaphore);
+    }
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    struct timespec ts;
+    struct timespec *deadline = host_deadline(xBlockTime, &ts);
+    BaseType_t ret = pdFAIL;
+    pthread_mutex_lock(&xSemaphore->lock);
+    while (!xSemaphore->count && xBlockTime) {
+        if (host_cond_wait(&xSemaphore->cond, &xSemaphore->lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (xSemaphore->count) {
+        xSemaphore->count--;
+        xSemaphore->holder = xTaskGetCurrentTaskHandle();
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    BaseType_t ret = pdFAIL;
+    pthread_mutex_lock(&xSemaphore->lock);
+    if (xSemaphore->count < xSemaphore->max) {
+        xSemaphore->count++;
+        xSemaphore->holder = NULL;
+        pthread_cond_signal(&xSemaphore->cond);
+        ret = pdPASS;
+    }
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xBlockTime)
+{
+    pthread_mutex_lock(&xMutex->lock);
+    if (xMutex->holder == xTaskGetCurrentTaskHandle() && !xMutex->count) {
+        xMutex->depth++;
+        pthread_mutex_unlock(&xMutex->lock);
+        return pdPASS;
+    }
+    pthread_mutex_unlock(&xMutex->lock);
+    return xSemaphoreTake(xMutex, xBlockTime);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex)
+{
+    pthread_mutex_lock(&xMutex->lock);
+    if (xMutex->holder != xTaskGetCurrentTaskHandle()) {
+        pthread_mutex_unlock(&xMutex->lock);
+        return pdFAIL;
+    }
+    if (xMutex->depth) {
+        xMutex->depth--;
+        pthread_mutex_unlock(&xMutex->lock);
+        return pdPASS;
+    }
+    pthread_mutex_unlock(&xMutex->lock);
+    return xSemaphoreGive(xMutex);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore)
+{
+    pthread_mutex_lock(&xSemaphore->lock);
+    UBaseType_t count = xSemaphore->count;
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return count;
+}
+
+/* ------------------------------------------------------------ event groups */
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+    bool is_static;          /*!< In a StaticEventGroup_t, not freed */
+};
+
+_Static_assert(sizeof(struct host_event_group) <= sizeof(StaticEventGroup_t), "StaticEventGroup_t too small");
+
+static EventGroupHandle_t host_event_group_init(struct host_event_group *group)
+{
+    memset(group, 0, sizeof(struct host_event_group));
+    pthread_mutex_init(&group->lock, NULL);
+    host_cond_init(&group->cond);
+    return group;
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *group = malloc(sizeof(struct host_event_group));
+    return group ? host_event_group_init(group) : NULL;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *pxEventGroupBuffer)
+{
+    if (!pxEventGroupBuffer) {
+        return NULL;
+    }
+    struct host_event_group *group = host_event_group_init((struct host_event_group *)pxEventGroupBuffer);
+    group->is_static = true;
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup)
+{
+    pthread_mutex_destroy(&xEventGroup->lock);
+    pthread_cond_destroy(&xEventGroup->cond);
+    if (!xEventGroup->is_static) {
+        free(xEventGroup);
+    }
+}
+
+static bool host_bits_match(EventBits_t bits, EventBits_t wanted, BaseType_t all)
+{
+    return all ? (bits & wanted) == wanted : (bits & wanted) != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait)
+{
+    struct timespec ts;
+    struct timespec *deadline = host_deadline(xTicksToWait, &ts);
+    pthread_mutex_lock(&xEventGroup->lock);
+    while (!host_bits_match(xEventGroup->bits, uxBitsToWaitFor, xWaitForAllBits) && xTicksToWait) {
+        if (host_cond_wait(&xEventGroup->cond, &xEventGroup->lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    EventBits_t bits = xEventGroup->bits;
+    if (xClearOnExit && host_bits_match(bits, uxBitsToWaitFor, xWaitForAllBits)) {
+        xEventGroup->bits &= ~uxBitsToWaitFor;
+    }
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    pthread_mutex_lock(&xEventGroup->lock);
+    xEventGroup->bits |= uxBitsToSet;
+    EventBits_t bits = xEventGroup->bits;
+    pthread_cond_broadcast(&xEventGroup->cond);
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+    pthread_mutex_lock(&xEventGroup->lock);
+    EventBits_t bits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+    pthread_mutex_lock(&xEventGroup->lock);
+    EventBits_t bits = xEventGroup->bits;
+    pthread_mutex_unlock(&xEventGroup->lock);
+    return bits;
+}
@@ -0,0 +1,108 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <malloc.h>
+#include <string.h>
+#include "host_port.h"
+
+/*
+ * Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free,--wrap=strdup, so only the calls
+ * made by the component, the port and the runner land here.
+ */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static uint64_t s_allocations;
+static uint64_t s_frees;
+static size_t s_in_use;
+static size_t s_peak;
+
+static void heap_host_account(void *ptr)
+{
+    if (ptr) {
+        size_t in_use = __atomic_add_fetch(&s_in_use, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s_allocations, 1, __ATOMIC_RELAXED);
+        size_t peak = __atomic_load_n(&s_peak, __ATOMIC_RELAXED);
+        while (in_use > peak && !__atomic_compare_exchange_n(&s_peak, &peak, in_use, true, __ATOMIC_RELAXED,
+                                                             __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+static void heap_host_release(void *ptr)
+{
+    if (ptr) {
+        __atomic_sub_fetch(&s_in_use, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s_frees, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    heap_host_account(ptr);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __real_calloc(nmemb, size);
+    heap_host_account(ptr);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    size_t before = ptr ? malloc_usable_size(ptr) : 0;
+    void *moved = __real_realloc(ptr, size);
+    if (moved || !size) {
+        /* The old block is gone, the new one counts as an allocation */
+        if (before) {
+            __atomic_sub_fetch(&s_in_use, before, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&s_frees, 1, __ATOMIC_RELAXED);
+        }
+        heap_host_account(moved);
+    }
+    return moved;
+}
+
+void __wrap_free(void *ptr)
+{
+    heap_host_release(ptr);
+    __real_free(ptr);
+}
+
+/* glibc's strdup() calls its own malloc(), the copy must be counted before free() takes it off */
+char *__wrap_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = __wrap_malloc(len);
+    return copy ? memcpy(copy, s, len) : NULL;
+}
+
+void heap_host_get_stats(heap_host_stats_t *stats)
+{
+    stats->allocations = __atomic_load_n(&s_allocations, __ATOMIC_RELAXED);
+    stats->frees = __atomic_load_n(&s_frees, __ATOMIC_RELAXED);
+    stats->in_use = __atomic_load_n(&s_in_use, __ATOMIC_RELAXED);
+    stats->peak = __atomic_load_n(&s_peak, __ATOMIC_RELAXED);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    stats->arena_free = mallinfo2().fordblks;
+#else
+    stats->arena_free = mallinfo().fordblks;
+#endif
+}
@@ -0,0 +1,39 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+/* Blocking helpers shared by the POSIX port, not part of any IDF API */
+
+#include <pthread.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Initialize a condition variable that times out on CLOCK_MONOTONIC
+ */
+void host_cond_init(pthread_cond_t *cond);
+
+/**
+ * @brief Turn a timeout in ticks into an absolute CLOCK_MONOTONIC deadline
+ *
+ * @return deadline, or NULL for portMAX_DELAY (wait forever)
+ */
+struct timespec *host_deadline(TickType_t ticks, struct timespec *deadline);
+
+/**
+ * @brief Wait on a condition variable, the only place where a task may be cancelled
+ *
+ * @return 0 when signalled, ETIMEDOUT when the deadline passed
+ */
+int host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *deadline);
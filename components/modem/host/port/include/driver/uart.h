@@ -0,0 +1,153 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+/**
+ * @brief UART driver on a tty, for the host build
+ *
+ * Each port is bound to a device with uart_host_set_device() (host_port.h), usually the pty
+ * of tools/modem_sim.py. A reader thread plays the RX interrupt: it fills the ring buffer,
+ * queues pattern positions and posts the same events as the driver in ESP-IDF, including
+ * UART_BUFFER_FULL when the ring is full (with hardware flow control the reader stops
+ * reading instead, as RTS would hold the modem off).
+ */
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int uart_port_t;
+
+#define UART_NUM_0 (0)
+#define UART_NUM_1 (1)
+#define UART_NUM_2 (2)
+#define UART_NUM_MAX (3)
+
+#define UART_PIN_NO_CHANGE (-1)
+#define UART_FIFO_LEN (128)
+
+typedef enum {
+    UART_DATA_5_BITS = 0x0,
+    UART_DATA_6_BITS = 0x1,
+    UART_DATA_7_BITS = 0x2,
+    UART_DATA_8_BITS = 0x3,
+    UART_DATA_BITS_MAX = 0x4,
+} uart_word_length_t;
+
+typedef enum {
+    UART_STOP_BITS_1 = 0x1,
+    UART_STOP_BITS_1_5 = 0x2,
+    UART_STOP_BITS_2 = 0x3,
+    UART_STOP_BITS_MAX = 0x4,
+} uart_stop_bits_t;
+
+typedef enum {
+    UART_PARITY_DISABLE = 0x0,
+    UART_PARITY_EVEN = 0x2,
+    UART_PARITY_ODD = 0x3
+} uart_parity_t;
+
+typedef enum {
+    UART_HW_FLOWCTRL_DISABLE = 0x0,
+    UART_HW_FLOWCTRL_RTS = 0x1,
+    UART_HW_FLOWCTRL_CTS = 0x2,
+    UART_HW_FLOWCTRL_CTS_RTS = 0x3,
+    UART_HW_FLOWCTRL_MAX = 0x4,
+} uart_hw_flowcontrol_t;
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    bool use_ref_tick;
+} uart_config_t;
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+} uart_event_t;
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t uart_num, uart_hw_flowcontrol_t flow_ctrl, uint8_t rx_thresh);
+esp_err_t uart_set_sw_flow_ctrl(uart_port_t uart_num, bool enable, uint8_t rx_thresh_xon, uint8_t rx_thresh_xoff);
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate);
+esp_err_t uart_get_baudrate(uart_port_t uart_num, uint32_t *baudrate);
+
+/**
+ * @brief Open the device bound to the port and start the reader thread
+ *
+ * tx_buffer_size and intr_alloc_flags are ignored, writes go straight to the device.
+ */
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_driver_delete(uart_port_t uart_num);
+
+#define UART_RXFIFO_FULL_INT_ENA_M (1 << 0)
+#define UART_FRM_ERR_INT_ENA_M (1 << 3)
+#define UART_PARITY_ERR_INT_ENA_M (1 << 2)
+#define UART_RXFIFO_OVF_INT_ENA_M (1 << 4)
+#define UART_BRK_DET_INT_ENA_M (1 << 7)
+#define UART_RXFIFO_TOUT_INT_ENA_M (1 << 8)
+
+typedef struct {
+    uint32_t intr_enable_mask;
+    uint8_t rx_timeout_thresh;
+    uint8_t txfifo_empty_intr_thresh;
+    uint8_t rxfifo_full_thresh;
+} uart_intr_config_t;
+
+/**
+ * @brief Check the thresholds, the reader thread has no FIFO to apply them to
+ */
+esp_err_t uart_intr_config(uart_port_t uart_num, const uart_intr_config_t *intr_conf);
+esp_err_t uart_enable_rx_intr(uart_port_t uart_num);
+esp_err_t uart_disable_rx_intr(uart_port_t uart_num);
+esp_err_t uart_enable_pattern_det_intr(uart_port_t uart_num, char pattern_chr, uint8_t chr_num,
+                                       int chr_tout, int post_idle, int pre_idle);
+esp_err_t uart_disable_pattern_det_intr(uart_port_t uart_num);
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length);
+int uart_pattern_pop_pos(uart_port_t uart_num);
+int uart_pattern_get_pos(uart_port_t uart_num);
+
+int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait);
+int uart_write_bytes(uart_port_t uart_num, const char *src, size_t size);
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size);
+esp_err_t uart_flush(uart_port_t uart_num);
+esp_err_t uart_flush_input(uart_port_t uart_num);
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+/**
+ * @brief Start a task as a thread named after it
+ *
+ * usStackDepth and uxPriority are ignored.
+ */
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                                   void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pvCreatedTask,
+                                   const BaseType_t xCoreID);
+
+/**
+ * @brief End a task
+ *
+ * NULL ends the calling task. Another task is cancelled at its next blocking call.
+ */
+/* The thread runs on a stack of its own, puxStackBuffer is only checked */
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t ulStackDepth,
+                               void *const pvParameters, UBaseType_t uxPriority, StackType_t *const puxStackBuffer,
+                               StaticTask_t *const pxTaskBuffer);
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t pvTaskCode, const char *const pcName, const uint32_t ulStackDepth,
+                                           void *const pvParameters, UBaseType_t uxPriority, StackType_t *const puxStackBuffer,
+                                           StaticTask_t *const pxTaskBuffer, const BaseType_t xCoreID);
+
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+void vTaskDelay(const TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask);
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority);
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+
+#ifdef __cplusplus
+}
+#endif
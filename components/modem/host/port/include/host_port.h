@@ -0,0 +1,155 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+/* What only the host build has: binding UARTs to devices and looking into the PPP stand-in */
+
+#include "esp_err.h"
+#include "driver/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bind a UART port to a tty, before uart_driver_install()
+ *
+ * @param uart_num port
+ * @param path device, for example the pty printed by tools/modem_sim.py
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the port is out of range
+ */
+esp_err_t uart_host_set_device(uart_port_t uart_num, const char *path);
+
+/**
+ * @brief Wire the reset and power pins of the modem on a port
+ *
+ * While either pin is low the port talks to /dev/null instead of the tty, which
+ * tools/modem_sim.py takes for the modem losing power; the tty is opened again once both
+ * are high. Levels set while the driver is not installed are ignored.
+ *
+ * @param uart_num port
+ * @param rst_io reset pin, -1 for none
+ * @param power_io supply pin, -1 for none
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the port is out of range
+ */
+esp_err_t uart_host_set_power_pins(uart_port_t uart_num, int rst_io, int power_io);
+
+/**
+ * @brief Name the DTR pin of the modem on a port
+ *
+ * Its levels are written as "DTR <level>" lines to "<device>.pins", a FIFO that
+ * tools/modem_sim.py creates next to its --link. Nothing is written if there is none.
+ *
+ * @param uart_num port
+ * @param dtr_io DTR pin, -1 for none
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the port is out of range
+ */
+esp_err_t uart_host_set_dtr_pin(uart_port_t uart_num, int dtr_io);
+
+/**
+ * @brief Tell the ports about a pin level, called by gpio_set_level()
+ *
+ * @param gpio_num pin
+ * @param level new level
+ */
+void uart_host_gpio_level(int gpio_num, uint32_t level);
+
+/**
+ * @brief Receive bytes on an installed port as if they had come from the tty
+ *
+ * For harnesses driving the DTE without a modem; bind the port to /dev/null to install it.
+ *
+ * @param uart_num port
+ * @param data bytes
+ * @param len number of bytes
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the port is out of range
+ *      - ESP_FAIL if the driver is not installed
+ */
+esp_err_t uart_host_feed(uart_port_t uart_num, const void *data, size_t len);
+
+/**
+ * @brief Counters of the PPP stand-in, since the program started
+ *
+ */
+typedef struct {
+    uint64_t bytes_in;     /*!< Bytes passed to pppos_input_tcpip() */
+    uint32_t frames_in;    /*!< Frames with a good FCS */
+    uint32_t fcs_errors;   /*!< Frames with a bad FCS */
+    uint32_t runts;        /*!< Frames too short to hold an FCS */
+    uint32_t overlong;     /*!< Frames longer than the MRU */
+    uint64_t bytes_out;    /*!< Bytes handed to the output callback */
+    uint32_t frames_out;   /*!< Frames sent with ppp_host_send() */
+    int64_t first_in_us;   /*!< esp_timer time of the first input byte, 0 if none */
+    int64_t last_in_us;    /*!< esp_timer time of the last input byte */
+} ppp_host_stats_t;
+
+/**
+ * @brief Get the counters of the PPP stand-in
+ *
+ * @param stats where to put them
+ */
+void ppp_host_get_stats(ppp_host_stats_t *stats);
+
+/**
+ * @brief Send one HDLC framed packet to the modem through the open PPP session
+ *
+ * @param payload_len bytes of payload, filled with a counter
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if no PPP session is open
+ *      - ESP_FAIL if the output callback did not take the whole frame
+ */
+esp_err_t ppp_host_send(size_t payload_len);
+
+/**
+ * @brief Send one HDLC framed packet of another protocol, such as LCP (0xc021)
+ *
+ * @param protocol PPP protocol field
+ * @param payload_len bytes of payload, filled with a counter
+ * @return esp_err_t as ppp_host_send()
+ */
+esp_err_t ppp_host_send_protocol(uint16_t protocol, size_t payload_len);
+
+/**
+ * @brief Heap use of the component and the port, since the program started
+ *
+ * The build wraps malloc(), calloc(), realloc() and free() of its own objects, the C
+ * library and the simulator are not counted.
+ */
+typedef struct {
+    uint64_t allocations;  /*!< Blocks handed out, a realloc() counts as one */
+    uint64_t frees;        /*!< Blocks given back */
+    size_t in_use;         /*!< Bytes held now, as malloc_usable_size() sees them */
+    size_t peak;           /*!< Most bytes held at once */
+    size_t arena_free;     /*!< Free bytes inside the C library heap, grows with fragmentation */
+} heap_host_stats_t;
+
+/**
+ * @brief Get the heap counters
+ *
+ * @param stats where to put them
+ */
+void heap_host_get_stats(heap_host_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+/* The few lwIP types the modem component uses, laid out as in lwIP */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t u8_t;
+typedef int8_t s8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef s8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_ARG -16
+
+typedef struct ip4_addr {
+    u32_t addr;
+} ip4_addr_t;
+
+typedef struct ip_addr {
+    union {
+        ip4_addr_t ip4;
+    } u_addr;
+    u8_t type;
+} ip_addr_t;
+
+#define IPADDR_TYPE_V4 0U
+
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+    (ipaddr)->addr = ((u32_t)((d) & 0xff) << 24) | ((u32_t)((c) & 0xff) << 16) | ((u32_t)((b) & 0xff) << 8) | (u32_t)((a) & 0xff)
+
+#define IP2STR(ipaddr) ((uint8_t *)(ipaddr))[0], ((uint8_t *)(ipaddr))[1], ((uint8_t *)(ipaddr))[2], ((uint8_t *)(ipaddr))[3]
+#define IPSTR "%d.%d.%d.%d"
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+/**
+ * @brief PPPoS stand-in for the host build
+ *
+ * There is no LCP/IPCP negotiation. pppos_input_tcpip() removes the HDLC framing of what the
+ * modem sends and checks the FCS of every frame, the first good frame counts as the link
+ * coming up. The LCP echo settings are kept but no echo request is sent. The counters are read
+ * with ppp_host_get_stats() from host_port.h.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "lwip/ip_addr.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PPP_NOTIFY_PHASE CONFIG_LWIP_PPP_NOTIFY_PHASE_SUPPORT
+#define PAP_SUPPORT CONFIG_LWIP_PPP_PAP_SUPPORT
+#define CHAP_SUPPORT CONFIG_LWIP_PPP_CHAP_SUPPORT
+
+#define PPPERR_NONE 0        /* No error. */
+#define PPPERR_PARAM 1       /* Invalid parameter. */
+#define PPPERR_OPEN 2        /* Unable to open PPP session. */
+#define PPPERR_DEVICE 3      /* Invalid I/O device for PPP. */
+#define PPPERR_ALLOC 4       /* Unable to allocate resources. */
+#define PPPERR_USER 5        /* User interrupt. */
+#define PPPERR_CONNECT 6     /* Connection lost. */
+#define PPPERR_AUTHFAIL 7    /* Failed authentication challenge. */
+#define PPPERR_PROTOCOL 8    /* Failed to meet protocol. */
+#define PPPERR_PEERDEAD 9    /* Connection timeout */
+#define PPPERR_IDLETIMEOUT 10 /* Idle Timeout */
+#define PPPERR_CONNECTTIME 11 /* Max connect time reached */
+#define PPPERR_LOOPBACK 12   /* Loopback detected */
+
+#define PPP_PHASE_DEAD 0
+#define PPP_PHASE_MASTER 1
+#define PPP_PHASE_HOLDOFF 2
+#define PPP_PHASE_INITIALIZE 3
+#define PPP_PHASE_SERIALCONN 4
+#define PPP_PHASE_DORMANT 5
+#define PPP_PHASE_ESTABLISH 6
+#define PPP_PHASE_AUTHENTICATE 7
+#define PPP_PHASE_CALLBACK 8
+#define PPP_PHASE_NETWORK 9
+#define PPP_PHASE_RUNNING 10
+#define PPP_PHASE_TERMINATE 11
+#define PPP_PHASE_DISCONNECT 12
+
+#define PPPAUTHTYPE_NONE 0x00
+#define PPPAUTHTYPE_PAP 0x01
+#define PPPAUTHTYPE_CHAP 0x02
+
+struct netif {
+    ip_addr_t ip_addr;
+    ip_addr_t netmask;
+    ip_addr_t gw;
+};
+
+#define PPP_HOST_MRU (1500)
+
+typedef struct ppp_pcb_s ppp_pcb;
+
+typedef void (*ppp_link_status_cb_fn)(ppp_pcb *pcb, int err_code, void *ctx);
+typedef void (*ppp_notify_phase_cb_fn)(ppp_pcb *pcb, u8_t phase, void *ctx);
+typedef u32_t (*pppos_output_cb_fn)(ppp_pcb *pcb, u8_t *data, u32_t len, void *ctx);
+
+/**
+ * @brief The lwIP session settings the driver writes
+ *
+ */
+typedef struct ppp_settings_s {
+    u8_t lcp_echo_interval;  /*!< Seconds between LCP echo requests, 0 for none */
+    u8_t lcp_echo_fails;     /*!< Unanswered echo requests before lwIP drops the link, 0 for never */
+} ppp_settings;
+
+/**
+ * @brief The one PPP session of the stand-in
+ *
+ */
+struct ppp_pcb_s {
+    ppp_settings settings;   /*!< Set by the driver, the stand-in sends no LCP echo */
+    struct netif *pppif;
+    pppos_output_cb_fn output_cb;
+    ppp_link_status_cb_fn link_status_cb;
+    ppp_notify_phase_cb_fn notify_phase_cb;
+    void *ctx;
+    bool connecting;         /*!< pppapi_connect() was called */
+    bool up;                 /*!< A good frame came in */
+    bool in_frame;           /*!< A flag was seen, bytes before the first one are line noise */
+    bool escaped;
+    bool overlong;           /*!< Drop bytes until the next flag */
+    size_t len;
+    uint8_t frame[PPP_HOST_MRU + 8];
+    uint8_t tx_counter;
+};
+
+
+struct netif *ppp_netif(ppp_pcb *pcb);
+void ppp_set_usepeerdns(ppp_pcb *pcb, u8_t usepeerdns);
+void ppp_set_notify_phase_callback(ppp_pcb *pcb, ppp_notify_phase_cb_fn notify_phase_cb);
+
+/**
+ * @brief Feed bytes received from the modem
+ *
+ * Runs in the caller, where lwIP would copy them to the tcpip thread.
+ */
+err_t pppos_input_tcpip(ppp_pcb *pcb, u8_t *s, int l);
+
+#ifdef __cplusplus
+}
+#endif
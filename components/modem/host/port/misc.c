@@ -0,0 +1,154 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "esp32/rom/crc.h"
+#include "host_port.h"
+
+/* ----------------------------------------------------------------- esp_err */
+
+#define ERR_TBL_IT(err) { err, #err }
+
+static const struct {
+    esp_err_t code;
+    const char *msg;
+} s_esp_err_msg_table[] = {
+    ERR_TBL_IT(ESP_OK),
+    ERR_TBL_IT(ESP_FAIL),
+    ERR_TBL_IT(ESP_ERR_NO_MEM),
+    ERR_TBL_IT(ESP_ERR_INVALID_ARG),
+    ERR_TBL_IT(ESP_ERR_INVALID_STATE),
+    ERR_TBL_IT(ESP_ERR_INVALID_SIZE),
+    ERR_TBL_IT(ESP_ERR_NOT_FOUND),
+    ERR_TBL_IT(ESP_ERR_NOT_SUPPORTED),
+    ERR_TBL_IT(ESP_ERR_TIMEOUT),
+    ERR_TBL_IT(ESP_ERR_INVALID_RESPONSE),
+    ERR_TBL_IT(ESP_ERR_INVALID_CRC),
+    ERR_TBL_IT(ESP_ERR_INVALID_VERSION),
+    ERR_TBL_IT(ESP_ERR_INVALID_MAC),
+    ERR_TBL_IT(ESP_ERR_NVS_NOT_INITIALIZED),
+    ERR_TBL_IT(ESP_ERR_NVS_NOT_FOUND),
+    ERR_TBL_IT(ESP_ERR_NVS_TYPE_MISMATCH),
+    ERR_TBL_IT(ESP_ERR_NVS_READ_ONLY),
+    ERR_TBL_IT(ESP_ERR_NVS_NOT_ENOUGH_SPACE),
+    ERR_TBL_IT(ESP_ERR_NVS_INVALID_NAME),
+    ERR_TBL_IT(ESP_ERR_NVS_INVALID_HANDLE),
+    ERR_TBL_IT(ESP_ERR_NVS_INVALID_LENGTH),
+    ERR_TBL_IT(ESP_ERR_NVS_VALUE_TOO_LONG),
+};
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    for (size_t i = 0; i < sizeof(s_esp_err_msg_table) / sizeof(s_esp_err_msg_table[0]); i++) {
+        if (s_esp_err_msg_table[i].code == code) {
+            return s_esp_err_msg_table[i].msg;
+        }
+    }
+    return "UNKNOWN ERROR";
+}
+
+/* ----------------------------------------------------------------- esp_log */
+
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    s_log_level = level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > s_log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    /* One line at a time, tasks are real threads here */
+    flockfile(stdout);
+    printf("%c (%u) %s: ", letters[level], esp_log_timestamp(), tag);
+    vprintf(format, args);
+    putchar('\n');
+    funlockfile(stdout);
+    va_end(args);
+}
+
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t level)
+{
+    const uint8_t *bytes = buffer;
+    char line[16 * 3 + 1];
+    for (uint16_t offset = 0; offset < buff_len; offset += 16) {
+        size_t len = 0;
+        for (uint16_t i = offset; i < buff_len && i < offset + 16; i++) {
+            len += sprintf(line + len, "%02x ", bytes[i]);
+        }
+        esp_log_write(level, tag, "%s", line);
+    }
+}
+
+/* -------------------------------------------------------------------- gpio */
+
+static const char *GPIO_TAG = "gpio_host";
+static uint32_t s_gpio_levels[GPIO_NUM_MAX];
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+    if (!pGPIOConfig || pGPIOConfig->pin_bit_mask >> GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio_levels[gpio_num] = level ? 1 : 0;
+    ESP_LOGD(GPIO_TAG, "GPIO%d = %u", gpio_num, s_gpio_levels[gpio_num]);
+    uart_host_gpio_level(gpio_num, level);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) {
+        return 0;
+    }
+    return s_gpio_levels[gpio_num];
+}
+
+/* --------------------------------------------------------------------- crc */
+
+uint32_t crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+    }
+    return ~crc;
+}
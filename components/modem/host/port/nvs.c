@@ -0,0 +1,210 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "nvs.h"
+
+#define NVS_HOST_NAME_LEN (16)
+#define NVS_HOST_NAMESPACES (32)
+#define NVS_HOST_ENTRIES (128)
+#define NVS_HOST_STR_LEN (128)
+
+typedef enum {
+    NVS_HOST_U32,
+    NVS_HOST_STR,
+} nvs_host_type_t;
+
+/* A fixed table like the flash partition, so that writing keys does not show up as heap growth */
+typedef struct {
+    bool used;
+    uint8_t ns;
+    char key[NVS_HOST_NAME_LEN];
+    nvs_host_type_t type;
+    uint32_t u32;
+    char str[NVS_HOST_STR_LEN];
+} nvs_host_entry_t;
+
+/* Handles are namespace index + 1, with the top bit set for READWRITE */
+#define NVS_HOST_RW (0x80000000u)
+
+static pthread_mutex_t s_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static char s_namespaces[NVS_HOST_NAMESPACES][NVS_HOST_NAME_LEN];
+static int s_namespace_count;
+static nvs_host_entry_t s_entries[NVS_HOST_ENTRIES];
+
+static int nvs_host_ns(nvs_handle_t handle)
+{
+    int ns = (int)(handle & ~NVS_HOST_RW) - 1;
+    return ns >= 0 && ns < s_namespace_count ? ns : -1;
+}
+
+static nvs_host_entry_t *nvs_host_find(int ns, const char *key)
+{
+    for (nvs_host_entry_t *entry = s_entries; entry < s_entries + NVS_HOST_ENTRIES; entry++) {
+        if (entry->used && entry->ns == ns && !strcmp(entry->key, key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!name || strlen(name) >= NVS_HOST_NAME_LEN) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_nvs_lock);
+    int ns = 0;
+    while (ns < s_namespace_count && strcmp(s_namespaces[ns], name)) {
+        ns++;
+    }
+    if (ns == s_namespace_count) {
+        if (open_mode == NVS_READONLY) {
+            ret = ESP_ERR_NVS_NOT_FOUND;
+        } else if (s_namespace_count == NVS_HOST_NAMESPACES) {
+            ret = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        } else {
+            strcpy(s_namespaces[s_namespace_count++], name);
+        }
+    }
+    if (ret == ESP_OK) {
+        *out_handle = (ns + 1) | (open_mode == NVS_READWRITE ? NVS_HOST_RW : 0);
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+static esp_err_t nvs_host_set(nvs_handle_t handle, const char *key, nvs_host_type_t type, uint32_t u32, const char *str)
+{
+    int ns = nvs_host_ns(handle);
+    if (ns < 0) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!(handle & NVS_HOST_RW)) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (!key || strlen(key) >= NVS_HOST_NAME_LEN) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    if (type == NVS_HOST_STR && strlen(str) >= NVS_HOST_STR_LEN) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+    pthread_mutex_lock(&s_nvs_lock);
+    nvs_host_entry_t *entry = nvs_host_find(ns, key);
+    for (int i = 0; !entry && i < NVS_HOST_ENTRIES; i++) {
+        if (!s_entries[i].used) {
+            entry = &s_entries[i];
+            entry->used = true;
+            entry->ns = ns;
+            strcpy(entry->key, key);
+        }
+    }
+    if (!entry) {
+        pthread_mutex_unlock(&s_nvs_lock);
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    entry->type = type;
+    entry->u32 = u32;
+    strcpy(entry->str, type == NVS_HOST_STR ? str : "");
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_host_set(handle, key, NVS_HOST_U32, value, NULL);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    if (!value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return nvs_host_set(handle, key, NVS_HOST_STR, 0, value);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    int ns = nvs_host_ns(handle);
+    if (ns < 0) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&s_nvs_lock);
+    nvs_host_entry_t *entry = nvs_host_find(ns, key);
+    if (entry && entry->type == NVS_HOST_U32) {
+        *out_value = entry->u32;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    int ns = nvs_host_ns(handle);
+    if (ns < 0) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&s_nvs_lock);
+    nvs_host_entry_t *entry = nvs_host_find(ns, key);
+    if (entry && entry->type == NVS_HOST_STR) {
+        size_t needed = strlen(entry->str) + 1;
+        if (!out_value) {
+            *length = needed;
+            ret = ESP_OK;
+        } else if (*length < needed) {
+            ret = ESP_ERR_NVS_INVALID_LENGTH;
+        } else {
+            memcpy(out_value, entry->str, needed);
+            *length = needed;
+            ret = ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    int ns = nvs_host_ns(handle);
+    if (ns < 0) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!(handle & NVS_HOST_RW)) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&s_nvs_lock);
+    nvs_host_entry_t *entry = nvs_host_find(ns, key);
+    if (entry) {
+        entry->used = false;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_nvs_lock);
+    return ret;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return nvs_host_ns(handle) < 0 ? ESP_ERR_NVS_INVALID_HANDLE : ESP_OK;
+}
@@ -0,0 +1,298 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "netif/ppp/pppapi.h"
+#include "lwip/dns.h"
+#include "host_port.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "ppp_host";
+
+#define PPP_HOST_FLAG (0x7E)
+#define PPP_HOST_ESCAPE (0x7D)
+#define PPP_HOST_TRANS (0x20)
+#define PPP_HOST_FCS_INIT (0xFFFF)
+#define PPP_HOST_FCS_GOOD (0xF0B8)
+
+static pthread_mutex_t s_ppp_lock = PTHREAD_MUTEX_INITIALIZER;
+static ppp_pcb *s_session;
+static ppp_host_stats_t s_stats;
+static uint16_t s_fcs_table[256];
+static ip_addr_t s_dns[2];
+
+__attribute__((constructor)) static void ppp_host_init(void)
+{
+    for (int b = 0; b < 256; b++) {
+        uint16_t v = b;
+        for (int i = 0; i < 8; i++) {
+            v = v & 1 ? (v >> 1) ^ 0x8408 : v >> 1;
+        }
+        s_fcs_table[b] = v;
+    }
+}
+
+static uint16_t ppp_host_fcs(uint16_t fcs, const uint8_t *data, size_t len)
+{
+    while (len--) {
+        fcs = (fcs >> 8) ^ s_fcs_table[(fcs ^ *data++) & 0xff];
+    }
+    return fcs;
+}
+
+static void ppp_host_phase(ppp_pcb *pcb, u8_t phase)
+{
+    if (pcb->notify_phase_cb) {
+        pcb->notify_phase_cb(pcb, phase, pcb->ctx);
+    }
+}
+
+/**
+ * @brief The first good frame plays the part of LCP and IPCP completing
+ */
+static void ppp_host_link_up(ppp_pcb *pcb)
+{
+    pcb->up = true;
+    ppp_host_phase(pcb, PPP_PHASE_ESTABLISH);
+    ppp_host_phase(pcb, PPP_PHASE_NETWORK);
+    IP4_ADDR(&pcb->pppif->ip_addr.u_addr.ip4, 10, 64, 64, 2);
+    IP4_ADDR(&pcb->pppif->gw.u_addr.ip4, 10, 64, 64, 1);
+    IP4_ADDR(&pcb->pppif->netmask.u_addr.ip4, 255, 255, 255, 255);
+    IP4_ADDR(&s_dns[0].u_addr.ip4, 10, 64, 64, 1);
+    IP4_ADDR(&s_dns[1].u_addr.ip4, 10, 64, 64, 3);
+    ppp_host_phase(pcb, PPP_PHASE_RUNNING);
+    pcb->link_status_cb(pcb, PPPERR_NONE, pcb->ctx);
+}
+
+static void ppp_host_end_frame(ppp_pcb *pcb)
+{
+    if (pcb->overlong) {
+        s_stats.overlong++;
+    } else if (pcb->len < 3) {
+        /* Back to back flags are fine, anything else this short is a runt */
+        if (pcb->len) {
+            s_stats.runts++;
+        }
+    } else if (ppp_host_fcs(PPP_HOST_FCS_INIT, pcb->frame, pcb->len) != PPP_HOST_FCS_GOOD) {
+        s_stats.fcs_errors++;
+    } else {
+        s_stats.frames_in++;
+        if (!pcb->up && pcb->connecting) {
+            ppp_host_link_up(pcb);
+        }
+    }
+    pcb->len = 0;
+    pcb->escaped = false;
+    pcb->overlong = false;
+}
+
+err_t pppos_input_tcpip(ppp_pcb *pcb, u8_t *s, int l)
+{
+    pthread_mutex_lock(&s_ppp_lock);
+    if (pcb != s_session) {
+        pthread_mutex_unlock(&s_ppp_lock);
+        return ERR_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+    if (!s_stats.first_in_us) {
+        s_stats.first_in_us = now;
+    }
+    s_stats.last_in_us = now;
+    s_stats.bytes_in += l;
+    for (int i = 0; i < l; i++) {
+        uint8_t byte = s[i];
+        if (byte == PPP_HOST_FLAG) {
+            if (pcb->in_frame) {
+                ppp_host_end_frame(pcb);
+            }
+            pcb->in_frame = true;
+            continue;
+        }
+        if (!pcb->in_frame || pcb->overlong) {
+            continue;
+        }
+        if (byte == PPP_HOST_ESCAPE) {
+            pcb->escaped = true;
+            continue;
+        }
+        if (pcb->escaped) {
+            byte ^= PPP_HOST_TRANS;
+            pcb->escaped = false;
+        }
+        if (pcb->len == sizeof(pcb->frame)) {
+            pcb->overlong = true;
+            continue;
+        }
+        pcb->frame[pcb->len++] = byte;
+    }
+    pthread_mutex_unlock(&s_ppp_lock);
+    return ERR_OK;
+}
+
+ppp_pcb *pppapi_pppos_create(struct netif *pppif, pppos_output_cb_fn output_cb,
+                             ppp_link_status_cb_fn link_status_cb, void *ctx_cb)
+{
+    ppp_pcb *pcb = calloc(1, sizeof(ppp_pcb));
+    if (!pcb) {
+        return NULL;
+    }
+    pcb->pppif = pppif;
+    pcb->output_cb = output_cb;
+    pcb->link_status_cb = link_status_cb;
+    pcb->ctx = ctx_cb;
+    pthread_mutex_lock(&s_ppp_lock);
+    if (s_session) {
+        pthread_mutex_unlock(&s_ppp_lock);
+        ESP_LOGE(TAG, "only one PPP session at a time");
+        free(pcb);
+        return NULL;
+    }
+    s_session = pcb;
+    pthread_mutex_unlock(&s_ppp_lock);
+    return pcb;
+}
+
+struct netif *ppp_netif(ppp_pcb *pcb)
+{
+    return pcb->pppif;
+}
+
+void ppp_set_usepeerdns(ppp_pcb *pcb, u8_t usepeerdns)
+{
+}
+
+void ppp_set_notify_phase_callback(ppp_pcb *pcb, ppp_notify_phase_cb_fn notify_phase_cb)
+{
+    pcb->notify_phase_cb = notify_phase_cb;
+}
+
+err_t pppapi_set_default(ppp_pcb *pcb)
+{
+    return pcb ? ERR_OK : ERR_ARG;
+}
+
+void pppapi_set_auth(ppp_pcb *pcb, u8_t authtype, const char *user, const char *passwd)
+{
+}
+
+err_t pppapi_connect(ppp_pcb *pcb, u16_t holdoff)
+{
+    if (!pcb) {
+        return ERR_ARG;
+    }
+    ppp_host_phase(pcb, PPP_PHASE_INITIALIZE);
+    pthread_mutex_lock(&s_ppp_lock);
+    pcb->connecting = true;
+    pthread_mutex_unlock(&s_ppp_lock);
+    return ERR_OK;
+}
+
+err_t pppapi_close(ppp_pcb *pcb, u8_t nocarrier)
+{
+    if (!pcb) {
+        return ERR_ARG;
+    }
+    pthread_mutex_lock(&s_ppp_lock);
+    pcb->connecting = false;
+    pcb->up = false;
+    pthread_mutex_unlock(&s_ppp_lock);
+    ppp_host_phase(pcb, PPP_PHASE_TERMINATE);
+    ppp_host_phase(pcb, PPP_PHASE_DEAD);
+    /* lwIP reports the user close from the tcpip thread, usually freeing the pcb there */
+    pcb->link_status_cb(pcb, PPPERR_USER, pcb->ctx);
+    return ERR_OK;
+}
+
+err_t pppapi_free(ppp_pcb *pcb)
+{
+    if (!pcb) {
+        return ERR_ARG;
+    }
+    pthread_mutex_lock(&s_ppp_lock);
+    if (s_session == pcb) {
+        s_session = NULL;
+    }
+    pthread_mutex_unlock(&s_ppp_lock);
+    free(pcb);
+    return ERR_OK;
+}
+
+const ip_addr_t *dns_getserver(u8_t numdns)
+{
+    return numdns < 2 ? &s_dns[numdns] : NULL;
+}
+
+void ppp_host_get_stats(ppp_host_stats_t *stats)
+{
+    pthread_mutex_lock(&s_ppp_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_ppp_lock);
+}
+
+static size_t ppp_host_put(uint8_t *out, uint8_t byte)
+{
+    if (byte == PPP_HOST_FLAG || byte == PPP_HOST_ESCAPE || byte < PPP_HOST_TRANS) {
+        out[0] = PPP_HOST_ESCAPE;
+        out[1] = byte ^ PPP_HOST_TRANS;
+        return 2;
+    }
+    out[0] = byte;
+    return 1;
+}
+
+esp_err_t ppp_host_send(size_t payload_len)
+{
+    return ppp_host_send_protocol(0x0021, payload_len);
+}
+
+esp_err_t ppp_host_send_protocol(uint16_t protocol, size_t payload_len)
+{
+    if (payload_len > PPP_HOST_MRU) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Address, control and the protocol field, as lwIP sends without ACFC/PFC */
+    uint8_t frame[4 + PPP_HOST_MRU + 2] = { 0xFF, 0x03, protocol >> 8, protocol & 0xff };
+    uint8_t wire[2 * sizeof(frame) + 2];
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_ppp_lock);
+    ppp_pcb *pcb = s_session;
+    if (!pcb || !pcb->up) {
+        pthread_mutex_unlock(&s_ppp_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t len = 4;
+    for (size_t i = 0; i < payload_len; i++) {
+        frame[len++] = pcb->tx_counter++;
+    }
+    uint16_t fcs = ~ppp_host_fcs(PPP_HOST_FCS_INIT, frame, len);
+    frame[len++] = fcs & 0xff;
+    frame[len++] = fcs >> 8;
+    size_t wire_len = 0;
+    wire[wire_len++] = PPP_HOST_FLAG;
+    for (size_t i = 0; i < len; i++) {
+        wire_len += ppp_host_put(wire + wire_len, frame[i]);
+    }
+    wire[wire_len++] = PPP_HOST_FLAG;
+    u32_t sent = pcb->output_cb(pcb, wire, wire_len, pcb->ctx);
+    if (sent == wire_len) {
+        s_stats.frames_out++;
+        s_stats.bytes_out += sent;
+    } else {
+        ret = ESP_FAIL;
+    }
+    pthread_mutex_unlock(&s_ppp_lock);
+    return ret;
+}
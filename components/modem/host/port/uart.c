@@ -0,0 +1,656 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "driver/uart.h"
+#include "host_port.h"
+#include "esp_log.h"
+#include "host_wait.h"
+
+static const char *TAG = "uart_host";
+
+/*
+ * The reader takes at most this much per read() and posts one UART_DATA for it. Bigger than
+ * the RX FIFO full threshold of the chip, because a pty delivers bursts as they were written:
+ * one event per 120 bytes would outrun the event task, which also runs the event loop for
+ * 10 ms each turn, and delay the pattern events behind them.
+ */
+#define UART_HOST_CHUNK (512)
+
+/**
+ * @brief One port: the tty, the ring buffer the reader thread fills and the pattern queue
+ *
+ * Byte positions are absolute counters since the driver was installed, so pattern positions
+ * never need to be adjusted on reads; the ones already consumed are dropped when popped.
+ */
+typedef struct {
+    char *device;                  /*!< Set by uart_host_set_device() */
+    uart_config_t config;
+    bool installed;
+    int fd;
+    int wake[2];                   /*!< Pipe to stop the reader */
+    pthread_t reader;
+    pthread_mutex_t lock;
+    pthread_cond_t readable;       /*!< Bytes arrived */
+    pthread_cond_t writable;       /*!< Space freed, for hardware flow control */
+    uint8_t *ring;
+    size_t ring_size;
+    uint64_t head;                 /*!< Absolute position of the next byte to read */
+    uint64_t tail;                 /*!< Absolute position of the next byte to store */
+    QueueHandle_t events;
+    bool rx_intr;                  /*!< Post UART_DATA */
+    bool pattern_enabled;
+    char pattern;
+    int64_t *patterns;             /*!< Queue of absolute pattern positions */
+    int pattern_len;
+    int pattern_first;
+    int pattern_count;
+    bool full_reported;            /*!< UART_BUFFER_FULL posted for the current overflow */
+    bool stopping;                 /*!< The wake pipe stops the reader, otherwise it polls fd again */
+    int rst_io;                    /*!< Pins of the modem on the tty, -1 if none */
+    int power_io;
+    int dtr_io;                    /*!< Reported on "<device>.pins", -1 if none */
+    bool rst_low;
+    bool power_low;
+    bool cut;                      /*!< fd points at /dev/null, the modem sees the tty closed */
+} uart_host_port_t;
+
+static uart_host_port_t s_ports[UART_NUM_MAX];
+
+#define UART_HOST_CHECK_PORT(uart_num)                          \
+    do {                                                        \
+        if ((uart_num) < 0 || (uart_num) >= UART_NUM_MAX) {     \
+            return ESP_ERR_INVALID_ARG;                         \
+        }                                                       \
+    } while (0)
+
+#define UART_HOST_CHECK_INSTALLED(uart_num)                     \
+    do {                                                        \
+        UART_HOST_CHECK_PORT(uart_num);                         \
+        if (!s_ports[uart_num].installed) {                     \
+            return ESP_FAIL;                                    \
+        }                                                       \
+    } while (0)
+
+/* Locks live as long as the program, flow control may be set before the driver is installed */
+__attribute__((constructor)) static void uart_host_init(void)
+{
+    for (int i = 0; i < UART_NUM_MAX; i++) {
+        pthread_mutex_init(&s_ports[i].lock, NULL);
+        host_cond_init(&s_ports[i].readable);
+        host_cond_init(&s_ports[i].writable);
+        s_ports[i].rst_io = s_ports[i].power_io = s_ports[i].dtr_io = -1;
+    }
+}
+
+esp_err_t uart_host_set_device(uart_port_t uart_num, const char *path)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    free(s_ports[uart_num].device);
+    s_ports[uart_num].device = path ? strdup(path) : NULL;
+    return ESP_OK;
+}
+
+esp_err_t uart_host_set_power_pins(uart_port_t uart_num, int rst_io, int power_io)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    s_ports[uart_num].rst_io = rst_io;
+    s_ports[uart_num].power_io = power_io;
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_host_set_dtr_pin(uart_port_t uart_num, int dtr_io)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    s_ports[uart_num].dtr_io = dtr_io;
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+static speed_t uart_host_speed(uint32_t baudrate)
+{
+    switch (baudrate) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B115200;
+    }
+}
+
+/**
+ * @brief Open the device raw, at the configured rate
+ */
+static int uart_host_open(uart_host_port_t *port)
+{
+    int fd = open(port->device, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "open %s failed: %s", port->device, strerror(errno));
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        cfsetspeed(&tio, uart_host_speed(port->config.baud_rate));
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static void uart_host_post(uart_host_port_t *port, uart_event_type_t type, size_t size)
+{
+    uart_event_t event = {
+        .type = type,
+        .size = size,
+    };
+    /* As from the ISR: if the queue is full the event is lost */
+    xQueueSend(port->events, &event, 0);
+}
+
+/**
+ * @brief Store what was read, called with the lock held
+ */
+static void uart_host_store(uart_host_port_t *port, const uint8_t *data, size_t len)
+{
+    size_t stored = 0;
+    while (stored < len) {
+        size_t space = port->ring_size - (size_t)(port->tail - port->head);
+        if (!space) {
+            if (port->config.flow_ctrl & UART_HW_FLOWCTRL_RTS) {
+                if (!port->full_reported) {
+                    port->full_reported = true;
+                    pthread_mutex_unlock(&port->lock);
+                    uart_host_post(port, UART_BUFFER_FULL, 0);
+                    pthread_mutex_lock(&port->lock);
+                }
+                host_cond_wait(&port->writable, &port->lock, NULL);
+                continue;
+            }
+            if (!port->full_reported) {
+                port->full_reported = true;
+                uart_host_post(port, UART_BUFFER_FULL, 0);
+            }
+            /* The rest is lost, as when the FIFO overflows behind a full ring */
+            return;
+        }
+        uint8_t byte = data[stored++];
+        if (port->pattern_enabled && byte == port->pattern) {
+            if (port->pattern_count < port->pattern_len) {
+                port->patterns[(port->pattern_first + port->pattern_count) % port->pattern_len] = port->tail;
+                port->pattern_count++;
+            }
+            /* Posted even when the position did not fit, the handler then pops -1 */
+            uart_host_post(port, UART_PATTERN_DET, 0);
+        }
+        port->ring[port->tail % port->ring_size] = byte;
+        port->tail++;
+    }
+}
+
+/**
+ * @brief Take bytes in as the RX interrupt would
+ */
+static void uart_host_receive(uart_host_port_t *port, const uint8_t *data, size_t len)
+{
+    pthread_mutex_lock(&port->lock);
+    uart_host_store(port, data, len);
+    pthread_cond_broadcast(&port->readable);
+    bool rx_intr = port->rx_intr;
+    pthread_mutex_unlock(&port->lock);
+    if (rx_intr) {
+        uart_host_post(port, UART_DATA, len);
+    }
+}
+
+static void *uart_host_reader(void *arg)
+{
+    uart_host_port_t *port = arg;
+    uint8_t chunk[UART_HOST_CHUNK];
+    struct pollfd fds[2] = {
+        { .fd = port->fd, .events = POLLIN },
+        { .fd = port->wake[0], .events = POLLIN },
+    };
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            char wake;
+            if (port->stopping || read(port->wake[0], &wake, 1) != 1) {
+                break;
+            }
+            /* fd now refers to another file, poll that one instead */
+            continue;
+        }
+        ssize_t len = read(port->fd, chunk, sizeof(chunk));
+        if (len <= 0) {
+            /* The other end of the pty is closed, wait for it to come back */
+            if (len < 0 && errno != EIO && errno != EAGAIN && errno != EINTR) {
+                ESP_LOGE(TAG, "read failed: %s", strerror(errno));
+            }
+            usleep(10000);
+            continue;
+        }
+        uart_host_receive(port, chunk, len);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Tell the simulator about DTR, which a pty does not carry
+ */
+static void uart_host_dtr_level(uart_host_port_t *port, uint32_t level)
+{
+    char path[256], line[16];
+    snprintf(path, sizeof(path), "%s.pins", port->device);
+    /* Non-blocking, a simulator without the FIFO or not reading it must not stall the DTE */
+    int fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        ESP_LOGD(TAG, "DTR %u not reported: %s", level, strerror(errno));
+        return;
+    }
+    int len = snprintf(line, sizeof(line), "DTR %u\n", level ? 1 : 0);
+    if (write(fd, line, len) != len) {
+        ESP_LOGW(TAG, "DTR %u not reported", level);
+    }
+    close(fd);
+}
+
+void uart_host_gpio_level(int gpio_num, uint32_t level)
+{
+    for (int i = 0; i < UART_NUM_MAX; i++) {
+        uart_host_port_t *port = &s_ports[i];
+        pthread_mutex_lock(&port->lock);
+        if (port->installed && gpio_num == port->dtr_io) {
+            uart_host_dtr_level(port, level);
+        }
+        if (!port->installed || (gpio_num != port->rst_io && gpio_num != port->power_io)) {
+            pthread_mutex_unlock(&port->lock);
+            continue;
+        }
+        if (gpio_num == port->rst_io) {
+            port->rst_low = !level;
+        }
+        if (gpio_num == port->power_io) {
+            port->power_low = !level;
+        }
+        bool off = port->rst_low || port->power_low;
+        int fd = -1;
+        if (off && !port->cut) {
+            /* Closing our end of the pty is what tools/modem_sim.py takes for a power off */
+            fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+        } else if (!off && port->cut) {
+            fd = uart_host_open(port);
+        }
+        if (fd >= 0) {
+            dup2(fd, port->fd);
+            close(fd);
+            port->cut = off;
+            ESP_LOGD(TAG, "UART%d %s", i, off ? "cut off the modem" : "back on the modem");
+            /* The reader may sit in poll() on the old file, keeping it open */
+            if (write(port->wake[1], "", 1) != 1) {
+                ESP_LOGW(TAG, "reader not woken");
+            }
+        }
+        pthread_mutex_unlock(&port->lock);
+    }
+}
+
+esp_err_t uart_host_feed(uart_port_t uart_num, const void *data, size_t len)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    uart_host_receive(&s_ports[uart_num], data, len);
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    if (!uart_config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[uart_num].config = *uart_config;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t uart_num, uart_hw_flowcontrol_t flow_ctrl, uint8_t rx_thresh)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    uart_host_port_t *port = &s_ports[uart_num];
+    pthread_mutex_lock(&port->lock);
+    port->config.flow_ctrl = flow_ctrl;
+    port->config.rx_flow_ctrl_thresh = rx_thresh;
+    pthread_cond_broadcast(&port->writable);
+    pthread_mutex_unlock(&port->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_sw_flow_ctrl(uart_port_t uart_num, bool enable, uint8_t rx_thresh_xon, uint8_t rx_thresh_xoff)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    uart_host_port_t *port = &s_ports[uart_num];
+    port->config.baud_rate = baudrate;
+    if (port->installed) {
+        struct termios tio;
+        if (tcgetattr(port->fd, &tio) == 0) {
+            cfsetspeed(&tio, uart_host_speed(baudrate));
+            tcsetattr(port->fd, TCSADRAIN, &tio);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t uart_num, uint32_t *baudrate)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    *baudrate = s_ports[uart_num].config.baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    uart_host_port_t *port = &s_ports[uart_num];
+    if (port->installed) {
+        return ESP_FAIL;
+    }
+    if (!port->device) {
+        ESP_LOGE(TAG, "no device bound to UART%d", uart_num);
+        return ESP_ERR_INVALID_STATE;
+    }
+    port->fd = uart_host_open(port);
+    if (port->fd < 0) {
+        return ESP_FAIL;
+    }
+    port->ring_size = rx_buffer_size;
+    port->ring = malloc(rx_buffer_size);
+    port->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+    if (!port->ring || !port->events || pipe2(port->wake, O_CLOEXEC) != 0) {
+        goto err;
+    }
+    port->head = port->tail = 0;
+    port->rx_intr = true;
+    port->stopping = false;
+    port->rst_low = port->power_low = port->cut = false;
+    port->installed = true;
+    if (pthread_create(&port->reader, NULL, uart_host_reader, port) != 0) {
+        port->installed = false;
+        close(port->wake[0]);
+        close(port->wake[1]);
+        goto err;
+    }
+    pthread_setname_np(port->reader, "uart_rx");
+    if (uart_queue) {
+        *uart_queue = port->events;
+    }
+    return ESP_OK;
+err:
+    if (port->events) {
+        vQueueDelete(port->events);
+        port->events = NULL;
+    }
+    free(port->ring);
+    port->ring = NULL;
+    close(port->fd);
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    uart_host_port_t *port = &s_ports[uart_num];
+    port->stopping = true;
+    if (write(port->wake[1], "", 1) != 1) {
+        pthread_cancel(port->reader);
+    }
+    /* A reader held off by flow control waits for space */
+    pthread_mutex_lock(&port->lock);
+    port->config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    pthread_cond_broadcast(&port->writable);
+    pthread_mutex_unlock(&port->lock);
+    pthread_join(port->reader, NULL);
+    port->installed = false;
+    close(port->wake[0]);
+    close(port->wake[1]);
+    close(port->fd);
+    vQueueDelete(port->events);
+    port->events = NULL;
+    free(port->ring);
+    port->ring = NULL;
+    free(port->patterns);
+    port->patterns = NULL;
+    port->pattern_len = port->pattern_count = port->pattern_first = 0;
+    return ESP_OK;
+}
+
+esp_err_t uart_intr_config(uart_port_t uart_num, const uart_intr_config_t *intr_conf)
+{
+    UART_HOST_CHECK_PORT(uart_num);
+    if (!intr_conf || intr_conf->rxfifo_full_thresh >= UART_FIFO_LEN || intr_conf->txfifo_empty_intr_thresh >= UART_FIFO_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_rx_intr(uart_port_t uart_num)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    s_ports[uart_num].rx_intr = true;
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_disable_rx_intr(uart_port_t uart_num)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    s_ports[uart_num].rx_intr = false;
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_intr(uart_port_t uart_num, char pattern_chr, uint8_t chr_num,
+                                       int chr_tout, int post_idle, int pre_idle)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    if (chr_num != 1) {
+        /* Only single character patterns, all the modem component uses */
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    s_ports[uart_num].pattern = pattern_chr;
+    s_ports[uart_num].pattern_enabled = true;
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_disable_pattern_det_intr(uart_port_t uart_num)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    s_ports[uart_num].pattern_enabled = false;
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    if (queue_length <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t *patterns = malloc(queue_length * sizeof(int64_t));
+    if (!patterns) {
+        return ESP_ERR_NO_MEM;
+    }
+    uart_host_port_t *port = &s_ports[uart_num];
+    pthread_mutex_lock(&port->lock);
+    free(port->patterns);
+    port->patterns = patterns;
+    port->pattern_len = queue_length;
+    port->pattern_first = 0;
+    port->pattern_count = 0;
+    pthread_mutex_unlock(&port->lock);
+    return ESP_OK;
+}
+
+static int uart_host_pattern_pos(uart_host_port_t *port, bool pop)
+{
+    int pos = -1;
+    pthread_mutex_lock(&port->lock);
+    while (port->pattern_count) {
+        int64_t abs_pos = port->patterns[port->pattern_first];
+        if (abs_pos < (int64_t)port->head) {
+            /* Already read or flushed */
+            port->pattern_first = (port->pattern_first + 1) % port->pattern_len;
+            port->pattern_count--;
+            continue;
+        }
+        pos = (int)(abs_pos - port->head);
+        if (pop) {
+            port->pattern_first = (port->pattern_first + 1) % port->pattern_len;
+            port->pattern_count--;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&port->lock);
+    return pos;
+}
+
+int uart_pattern_pop_pos(uart_port_t uart_num)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || !s_ports[uart_num].installed) {
+        return -1;
+    }
+    return uart_host_pattern_pos(&s_ports[uart_num], true);
+}
+
+int uart_pattern_get_pos(uart_port_t uart_num)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || !s_ports[uart_num].installed) {
+        return -1;
+    }
+    return uart_host_pattern_pos(&s_ports[uart_num], false);
+}
+
+int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || !s_ports[uart_num].installed || !buf) {
+        return -1;
+    }
+    uart_host_port_t *port = &s_ports[uart_num];
+    struct timespec ts;
+    struct timespec *deadline = host_deadline(ticks_to_wait, &ts);
+    uint32_t copied = 0;
+    pthread_mutex_lock(&port->lock);
+    while (1) {
+        while (copied < length && port->head < port->tail) {
+            buf[copied++] = port->ring[port->head % port->ring_size];
+            port->head++;
+        }
+        if (copied == length || !ticks_to_wait ||
+                host_cond_wait(&port->readable, &port->lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (copied) {
+        port->full_reported = false;
+        pthread_cond_broadcast(&port->writable);
+    }
+    pthread_mutex_unlock(&port->lock);
+    return copied;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const char *src, size_t size)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || !s_ports[uart_num].installed || !src) {
+        return -1;
+    }
+    size_t written = 0;
+    while (written < size) {
+        ssize_t len = write(s_ports[uart_num].fd, src + written, size - written);
+        if (len < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            ESP_LOGE(TAG, "write failed: %s", strerror(errno));
+            return -1;
+        }
+        written += len;
+    }
+    return written;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    pthread_mutex_lock(&s_ports[uart_num].lock);
+    *size = (size_t)(s_ports[uart_num].tail - s_ports[uart_num].head);
+    pthread_mutex_unlock(&s_ports[uart_num].lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    uart_host_port_t *port = &s_ports[uart_num];
+    pthread_mutex_lock(&port->lock);
+    port->head = port->tail;
+    port->full_reported = false;
+    pthread_cond_broadcast(&port->writable);
+    pthread_mutex_unlock(&port->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_flush(uart_port_t uart_num)
+{
+    return uart_flush_input(uart_num);
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    UART_HOST_CHECK_INSTALLED(uart_num);
+    return tcdrain(s_ports[uart_num].fd) == 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
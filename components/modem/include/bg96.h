@@ -19,6 +19,13 @@ extern "C" {
 
 #include "esp_modem_dce_service.h"
 #include "esp_modem.h"
+#include "esp_modem_driver.h"
+
+/**
+ * @brief Driver for esp_modem_driver_register(), matches "BG96" models
+ *
+ */
+extern const esp_modem_driver_t bg96_driver;
 
 /**
  * @brief Create and initialize BG96 object
@@ -17,10 +17,12 @@
 extern "C" {
 #endif
 
+#include "freertos/FreeRTOS.h"
 #include "esp_modem_dce.h"
 #include "esp_modem_dte.h"
 #include "esp_event.h"
 #include "driver/uart.h"
+#include "sdkconfig.h"
 
 /**
  * @brief Declare Event Base for ESP Modem
@@ -40,6 +42,7 @@ typedef enum
     MODEM_EVENT_PPP_CONNECT,    /*!< ESP Modem Connect to PPP Server */
     MODEM_EVENT_PPP_DISCONNECT, /*!< ESP Modem Disconnect from PPP Server */
     MODEM_EVENT_PPP_STOP,       /*!< ESP Modem Stop PPP Session*/
+    MODEM_EVENT_PPP_CLOSING,    /*!< ESP Modem PPP Session about to close, close the sockets over it */
     MODEM_EVENT_UNKNOWN         /*!< ESP Modem Unknown Response */
 } esp_modem_event_t;
 
@@ -54,8 +57,22 @@ typedef struct {
     uart_parity_t parity;           /*!< Parity type */
     modem_flow_ctrl_t flow_control; /*!< Flow control type */
     uint32_t baud_rate;             /*!< Communication baud rate */
+    int tx_io_num;                  /*!< TXD pin */
+    int rx_io_num;                  /*!< RXD pin */
+    int rts_io_num;                 /*!< RTS pin, used with hardware flow control */
+    int cts_io_num;                 /*!< CTS pin, used with hardware flow control */
+    BaseType_t rx_task_core;        /*!< Core of the UART event task, tskNO_AFFINITY for either */
+    UBaseType_t rx_task_priority;   /*!< Priority of the UART event task */
+    BaseType_t event_task_core;     /*!< Core of the event dispatch task, tskNO_AFFINITY for either */
+    UBaseType_t event_task_priority; /*!< Priority of the event dispatch task, 0 to dispatch from the UART event task */
 } esp_modem_dte_config_t;
 
+/**
+ * @brief Core number of a Kconfig option, where -1 means no affinity
+ *
+ */
+#define ESP_MODEM_TASK_CORE(core) ((core) < 0 ? tskNO_AFFINITY : (core))
+
 /**
  * @brief ESP Modem DTE Default Configuration
  *
@@ -67,7 +84,15 @@ typedef struct {
         .stop_bits = UART_STOP_BITS_1,          \
         .parity = UART_PARITY_DISABLE,          \
         .baud_rate = 115200,                    \
-        .flow_control = MODEM_FLOW_CONTROL_NONE  \
+        .flow_control = MODEM_FLOW_CONTROL_NONE, \
+        .tx_io_num = CONFIG_EXAMPLE_UART_MODEM_TX_PIN,   \
+        .rx_io_num = CONFIG_EXAMPLE_UART_MODEM_RX_PIN,   \
+        .rts_io_num = CONFIG_EXAMPLE_UART_MODEM_RTS_PIN, \
+        .cts_io_num = CONFIG_EXAMPLE_UART_MODEM_CTS_PIN, \
+        .rx_task_core = ESP_MODEM_TASK_CORE(CONFIG_EXAMPLE_UART_EVENT_TASK_CORE),      \
+        .rx_task_priority = CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY,                   \
+        .event_task_core = ESP_MODEM_TASK_CORE(CONFIG_EXAMPLE_MODEM_EVENT_TASK_CORE),  \
+        .event_task_priority = CONFIG_EXAMPLE_MODEM_EVENT_TASK_PRIORITY                \
     }
 
 /**
@@ -112,6 +137,41 @@ esp_err_t esp_modem_dte_deinit(modem_dte_t *dte);
  */
 esp_err_t esp_modem_remove_event_handler(modem_dte_t *dte, esp_event_handler_t handler);
 
+/**
+ * @brief Receive overrun and traffic counters of the DTE UART
+ *
+ */
+typedef struct {
+    uint32_t fifo_overflows;    /*!< Hardware FIFO overflowed */
+    uint32_t buffer_full;       /*!< Driver ring buffer filled up */
+    uint32_t pattern_overflows; /*!< Line positions lost because the pattern queue was full */
+    uint32_t bytes_dropped;     /*!< Bytes thrown away recovering from the above */
+    uint32_t bytes_received;    /*!< Bytes passed to PPP */
+    uint32_t bytes_sent;        /*!< PPP bytes written to the modem */
+} esp_modem_uart_stats_t;
+
+/**
+ * @brief Change flow control on both ends of the link
+ *
+ * The modem is switched with AT+IFC first, then the UART follows. The modem is rolled
+ * back if the UART cannot be changed.
+ *
+ * @param dte Modem DTE object
+ * @param flow_ctrl flow control type
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_set_flow_ctrl(modem_dte_t *dte, modem_flow_ctrl_t flow_ctrl);
+
+/**
+ * @brief Get the receive overrun counters
+ *
+ * @param dte Modem DTE object
+ * @param stats filled with the counters since the DTE was created
+ */
+void esp_modem_get_uart_stats(modem_dte_t *dte, esp_modem_uart_stats_t *stats);
+
 /**
  * @brief PPPoS Client IP Information
  *
@@ -134,9 +194,28 @@ typedef struct {
  */
 esp_err_t esp_modem_setup_ppp(modem_dte_t *dte);
 
+/**
+ * @brief Let the sockets over PPP close before the session does
+ *
+ * MODEM_EVENT_PPP_CLOSING is posted for the application to close its sockets, then this
+ * waits, with the session still open, for the uplink to go quiet and the UART to send
+ * what is queued.
+ *
+ * @param dte Modem DTE Object
+ * @param timeout_ms longest wait
+ * @return esp_err_t
+ *      - ESP_OK once the uplink went quiet
+ *      - ESP_ERR_TIMEOUT if it was still busy after timeout_ms
+ *      - ESP_FAIL if the DCE is not in PPP mode
+ */
+esp_err_t esp_modem_flush_ppp(modem_dte_t *dte, uint32_t timeout_ms);
+
 /**
  * @brief Exit PPP Session
  *
+ * PPP is closed with LCP first, and the escape to command mode waits for the session
+ * to end, or for lwIP to give up on the peer, and for queued output to be sent.
+ *
  * @param dte Modem DTE Object
  * @return esp_err_t
  *      - ESP_OK on success
@@ -144,6 +223,20 @@ esp_err_t esp_modem_setup_ppp(modem_dte_t *dte);
  */
 esp_err_t esp_modem_exit_ppp(modem_dte_t *dte);
 
+/**
+ * @brief Drop a PPP session the modem no longer answers in
+ *
+ * Unlike esp_modem_exit_ppp(), nothing is asked of the modem: the DTE goes back to
+ * command mode and the session is closed without a terminate request. The caller then
+ * gets the modem itself out of data mode, by "+++" or by resetting it.
+ *
+ * @param dte Modem DTE Object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL if the DCE is not in PPP mode
+ */
+esp_err_t esp_modem_drop_ppp(modem_dte_t *dte);
+
 #ifdef __cplusplus
 }
 #endif
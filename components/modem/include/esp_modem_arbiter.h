@@ -0,0 +1,146 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Arbiter of the command channel of one modem
+ *
+ * Only the owning task may set handle_line, priv_resource and send commands. Ownership
+ * is recursive, so a caller holding it across several commands (a baud rate change, a
+ * console command) can still use the DCE methods, which take it themselves.
+ */
+typedef struct esp_modem_arbiter esp_modem_arbiter_t;
+
+/**
+ * @brief Priority of a caller, waiters are served highest first and in arrival order within one priority
+ *
+ */
+typedef enum {
+    ESP_MODEM_PRIORITY_BACKGROUND = 0, /*!< Telemetry and identity refresh */
+    ESP_MODEM_PRIORITY_NORMAL,         /*!< DCE methods called without a scope */
+    ESP_MODEM_PRIORITY_INTERACTIVE,    /*!< Console commands */
+    ESP_MODEM_PRIORITY_RECOVERY,       /*!< Link changes and recovery */
+    ESP_MODEM_PRIORITY_MAX
+} esp_modem_priority_t;
+
+/**
+ * @brief Wait for the channel without a deadline
+ *
+ */
+#define ESP_MODEM_ARBITER_WAIT_FOREVER (UINT32_MAX)
+
+/**
+ * @brief Counters of one priority
+ *
+ */
+typedef struct {
+    uint32_t granted;         /*!< Times the channel was taken */
+    uint32_t immediate;       /*!< Of those, without waiting */
+    uint32_t overtaken;       /*!< Times a waiter saw a later higher priority caller served first */
+    uint32_t aged;            /*!< Times a waiter was served early for having been overtaken too often */
+    uint32_t deadline_misses; /*!< Waits that ran out of time */
+    uint32_t max_wait_us;     /*!< Longest wait */
+    uint64_t total_wait_us;   /*!< Sum of the waits of granted callers */
+} esp_modem_arbiter_stats_t;
+
+/**
+ * @brief Create an arbiter
+ *
+ * @param max_bypass times a waiter can be overtaken before it is served next
+ * @return esp_modem_arbiter_t* arbiter, NULL on allocation failure
+ */
+esp_modem_arbiter_t *esp_modem_arbiter_create(uint8_t max_bypass);
+
+/**
+ * @brief Wait until nobody owns the arbiter or waits for it
+ *
+ * Callers still waiting are served in turn; they must find out quickly that there is
+ * nothing left to do, for example from a DCE in MODEM_POWER_OFF_MODE.
+ *
+ * @param arbiter arbiter
+ * @param timeout_ms longest wait
+ * @return esp_err_t
+ *      - ESP_OK once the arbiter is idle
+ *      - ESP_ERR_TIMEOUT if it is still owned or waited for
+ */
+esp_err_t esp_modem_arbiter_wait_idle(esp_modem_arbiter_t *arbiter, uint32_t timeout_ms);
+
+/**
+ * @brief Delete an arbiter, once nobody owns it or waits for it
+ *
+ * Waits up to CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT for the arbiter to become idle. An
+ * arbiter still in use is left allocated rather than freed under its waiters.
+ *
+ * @param arbiter arbiter, NULL does nothing
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if it was still in use, and was not deleted
+ */
+esp_err_t esp_modem_arbiter_delete(esp_modem_arbiter_t *arbiter);
+
+/**
+ * @brief Take the channel for the calling task
+ *
+ * A NULL arbiter is always granted, for DCE objects used before any other task can see them.
+ *
+ * @param arbiter arbiter
+ * @param priority priority of the caller, ignored if it already owns the channel
+ * @param timeout_ms deadline, Unit: millisecond, or ESP_MODEM_ARBITER_WAIT_FOREVER
+ * @return esp_err_t
+ *      - ESP_OK on success, to be balanced by esp_modem_arbiter_release()
+ *      - ESP_ERR_TIMEOUT if the deadline passed
+ *      - ESP_ERR_INVALID_ARG on a bad priority
+ */
+esp_err_t esp_modem_arbiter_acquire(esp_modem_arbiter_t *arbiter, esp_modem_priority_t priority, uint32_t timeout_ms);
+
+/**
+ * @brief Give the channel back, handing it to the next waiter on the last release
+ *
+ * @param arbiter arbiter
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the calling task does not own the channel
+ */
+esp_err_t esp_modem_arbiter_release(esp_modem_arbiter_t *arbiter);
+
+/**
+ * @brief Get the counters of every priority
+ *
+ * @param arbiter arbiter
+ * @param stats array of ESP_MODEM_PRIORITY_MAX entries
+ */
+void esp_modem_arbiter_get_stats(esp_modem_arbiter_t *arbiter, esp_modem_arbiter_stats_t *stats);
+
+/**
+ * @brief Reset the counters of every priority
+ *
+ * @param arbiter arbiter
+ */
+void esp_modem_arbiter_reset_stats(esp_modem_arbiter_t *arbiter);
+
+/**
+ * @brief Get a printable name of a priority
+ */
+const char *esp_modem_arbiter_priority_name(esp_modem_priority_t priority);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_modem_dce.h"
+
+/**
+ * @brief Cached queries
+ *
+ */
+typedef enum {
+    ESP_MODEM_CACHE_SIGNAL_QUALITY = 0, /*!< get_signal_quality, AT+CSQ */
+    ESP_MODEM_CACHE_BATTERY_STATUS,     /*!< get_battery_status, AT+CBC */
+    ESP_MODEM_CACHE_NETWORK_STATUS,     /*!< get_network_status, AT+CREG? */
+    ESP_MODEM_CACHE_MAX
+} esp_modem_cache_query_t;
+
+/**
+ * @brief Time to live of each query, Unit: millisecond. 0 only coalesces concurrent calls
+ *
+ */
+typedef struct {
+    uint32_t ttl_ms[ESP_MODEM_CACHE_MAX];
+} esp_modem_cache_config_t;
+
+/**
+ * @brief Cache configuration from Kconfig
+ *
+ */
+#define ESP_MODEM_CACHE_DEFAULT_CONFIG()                                  \
+    {                                                                     \
+        .ttl_ms = {                                                       \
+            [ESP_MODEM_CACHE_SIGNAL_QUALITY] = CONFIG_EXAMPLE_MODEM_CACHE_TTL_CSQ, \
+            [ESP_MODEM_CACHE_BATTERY_STATUS] = CONFIG_EXAMPLE_MODEM_CACHE_TTL_CBC, \
+            [ESP_MODEM_CACHE_NETWORK_STATUS] = CONFIG_EXAMPLE_MODEM_CACHE_TTL_CREG \
+        }                                                                 \
+    }
+
+/**
+ * @brief Counters of one query
+ *
+ */
+typedef struct {
+    uint32_t hits;          /*!< Answered from the cache */
+    uint32_t misses;        /*!< Sent to the modem */
+    uint32_t coalesced;     /*!< Waited for a command already sent by another caller */
+    uint32_t invalidations; /*!< Entries dropped by a URC or esp_modem_cache_invalidate() */
+    uint32_t errors;        /*!< Commands that failed */
+} esp_modem_cache_stats_t;
+
+/**
+ * @brief Put a cache in front of the signal, battery and network status getters of a DCE
+ *
+ * The getters, the URC handler and deinit of the DCE are wrapped, so callers keep using
+ * dce->get_signal_quality() and friends. The cache is freed with the DCE.
+ *
+ * @param dce Modem DCE object
+ * @param config time to live of each query
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the cache is already enabled
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_cache_enable(modem_dce_t *dce, const esp_modem_cache_config_t *config);
+
+/**
+ * @brief Drop a cached answer, so the next call asks the modem
+ *
+ * An answer still on its way is not cached either, it may predate what made the entry stale.
+ *
+ * @param dce Modem DCE object
+ * @param query query to drop, ESP_MODEM_CACHE_MAX for all
+ */
+void esp_modem_cache_invalidate(modem_dce_t *dce, esp_modem_cache_query_t query);
+
+/**
+ * @brief Get the counters of every query
+ *
+ * @param dce Modem DCE object
+ * @param stats array of ESP_MODEM_CACHE_MAX entries
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the cache is not enabled
+ */
+esp_err_t esp_modem_cache_get_stats(modem_dce_t *dce, esp_modem_cache_stats_t *stats);
+
+/**
+ * @brief Reset the counters of every query
+ *
+ * @param dce Modem DCE object
+ */
+void esp_modem_cache_reset_stats(modem_dce_t *dce);
+
+/**
+ * @brief Get a printable name of a query
+ */
+const char *esp_modem_cache_query_name(esp_modem_cache_query_t query);
+
+#ifdef __cplusplus
+}
+#endif
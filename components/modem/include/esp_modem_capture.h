@@ -0,0 +1,167 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Capture of the UART traffic of every modem
+ *
+ * One fixed-size ring shared by all DTEs keeps the most recent bytes sent and received,
+ * each transfer as a record with its time and direction. The oldest records are
+ * overwritten. A dump is a file made of an esp_modem_capture_file_header_t followed by the
+ * records in time order, each an esp_modem_capture_record_header_t and its bytes.
+ * tools/capture_replay.py reads it.
+ */
+
+#define ESP_MODEM_CAPTURE_MAGIC "MCAP"    /*!< First bytes of a dump */
+#define ESP_MODEM_CAPTURE_VERSION (1)     /*!< Dump format version */
+
+/**
+ * @brief What a record holds
+ *
+ */
+typedef enum {
+    ESP_MODEM_CAPTURE_RX = 0, /*!< Bytes received from the modem */
+    ESP_MODEM_CAPTURE_TX,     /*!< Bytes sent to the modem */
+    ESP_MODEM_CAPTURE_NOTE,   /*!< Text noted by the firmware, such as the reason of a fault */
+} esp_modem_capture_dir_t;
+
+#define ESP_MODEM_CAPTURE_TRUNCATED (0x80) /*!< Set in dir when the bytes were cut to fit the ring */
+
+/**
+ * @brief Header of a dump, little endian
+ *
+ */
+typedef struct {
+    char magic[4];         /*!< ESP_MODEM_CAPTURE_MAGIC */
+    uint16_t version;      /*!< ESP_MODEM_CAPTURE_VERSION */
+    uint16_t header_size;  /*!< sizeof(esp_modem_capture_record_header_t) */
+    uint32_t records;      /*!< Records that follow */
+    uint32_t overwritten;  /*!< Older records lost to the ring before the dump */
+} esp_modem_capture_file_header_t;
+
+/**
+ * @brief Header of a record, little endian
+ *
+ */
+typedef struct {
+    uint32_t time_us; /*!< esp_timer time, wraps after 71 minutes */
+    uint16_t length;  /*!< Bytes that follow */
+    uint8_t dir;      /*!< esp_modem_capture_dir_t, maybe with ESP_MODEM_CAPTURE_TRUNCATED */
+    uint8_t port;     /*!< UART port of the DTE */
+} esp_modem_capture_record_header_t;
+
+/**
+ * @brief Counters of the ring
+ *
+ */
+typedef struct {
+    uint32_t size;        /*!< Ring size in bytes */
+    uint32_t used;        /*!< Bytes in use */
+    uint32_t records;     /*!< Records in the ring */
+    uint32_t overwritten; /*!< Records overwritten since the last clear */
+    uint32_t truncated;   /*!< Records cut to fit */
+    uint32_t faults;      /*!< Faults reported */
+    uint32_t dumps;       /*!< Dumps written */
+} esp_modem_capture_stats_t;
+
+/**
+ * @brief Allocate the ring and start capturing, does nothing if already done
+ *
+ * @param size ring size in bytes
+ * @param fault_path where esp_modem_capture_fault() dumps the ring, NULL to only note faults
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_capture_init(size_t size, const char *fault_path);
+
+/**
+ * @brief Pause or resume capturing
+ *
+ * @param enable whether to record
+ */
+void esp_modem_capture_enable(bool enable);
+
+/**
+ * @brief Record a transfer, callable from any task
+ *
+ * Does nothing before esp_modem_capture_init() or while paused.
+ *
+ * @param port UART port of the DTE
+ * @param dir direction
+ * @param data bytes
+ * @param length number of bytes
+ */
+void esp_modem_capture_record(uint8_t port, esp_modem_capture_dir_t dir, const void *data, size_t length);
+
+/**
+ * @brief Note a fault and have the ring dumped to the fault path in the background
+ *
+ * Dumps are spaced by at least the configured interval, later faults are only noted.
+ *
+ * @param port UART port of the DTE
+ * @param reason text stored in a note record
+ */
+void esp_modem_capture_fault(uint8_t port, const char *reason);
+
+/**
+ * @brief Write the ring to a file
+ *
+ * @param path file to create
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if capture is not initialized
+ *      - ESP_ERR_NO_MEM on allocation failure
+ *      - ESP_FAIL if the file cannot be written
+ */
+esp_err_t esp_modem_capture_dump(const char *path);
+
+/**
+ * @brief Print the last records as text
+ *
+ * @param fp where to print
+ * @param count number of records, counted back from the newest
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if capture is not initialized
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_capture_print(FILE *fp, size_t count);
+
+/**
+ * @brief Drop every record and reset the counters
+ *
+ */
+void esp_modem_capture_clear(void);
+
+/**
+ * @brief Get the counters
+ *
+ * @param stats where to put them
+ */
+void esp_modem_capture_get_stats(esp_modem_capture_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
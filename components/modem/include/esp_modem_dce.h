@@ -19,11 +19,36 @@ extern "C"
 #endif
 
 #include "esp_types.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_modem_dte.h"
+#include "esp_modem_arbiter.h"
+#include "sdkconfig.h"
 
     typedef struct modem_dce modem_dce_t;
     typedef struct modem_dte modem_dte_t;
+    typedef struct esp_modem_dce_model esp_modem_dce_model_t;
+    typedef struct esp_modem_cache esp_modem_cache_t;
+    typedef struct esp_modem_stats esp_modem_stats_t;
+    typedef struct esp_modem_health esp_modem_health_t;
+    typedef struct esp_modem_sleep esp_modem_sleep_t;
+    typedef struct esp_modem_supply esp_modem_supply_t;
+    typedef struct esp_modem_ext esp_modem_ext_t;
+
+/**
+ * @brief Placement of the line framer, the URC classifier and their tables
+ *
+ * With CONFIG_EXAMPLE_MODEM_RX_IN_IRAM the functions a received line goes through are kept in
+ * IRAM and their tables in DRAM, so a line is not held up by flash cache misses.
+ */
+#if CONFIG_EXAMPLE_MODEM_RX_IN_IRAM
+#define ESP_MODEM_RX_ATTR IRAM_ATTR
+#define ESP_MODEM_RX_DATA_ATTR DRAM_ATTR
+#else
+#define ESP_MODEM_RX_ATTR
+#define ESP_MODEM_RX_DATA_ATTR
+#endif
 
 /**
  * @brief Result Code from DCE
@@ -55,7 +80,8 @@ extern "C"
 #define MODEM_COMMAND_TIMEOUT_OPERATOR (75000)   /*!< Timeout value for getting operator status */
 #define MODEM_COMMAND_TIMEOUT_MODE_CHANGE (3000) /*!< Timeout value for changing working mode */
 #define MODEM_COMMAND_TIMEOUT_HANG_UP (90000)    /*!< Timeout value for hang up */
-#define MODEM_COMMAND_TIMEOUT_POWEROFF (1000)    /*!< Timeout value for power down */
+#define MODEM_COMMAND_TIMEOUT_POWEROFF (5000)    /*!< Timeout value for power down, the modem logs off the network first */
+#define MODEM_COMMAND_TIMEOUT_RADIO (15000)      /*!< Timeout value for switching the radio off or on */
 
     /**
  * @brief Working state of DCE
@@ -74,6 +100,18 @@ extern "C"
  *
  */
 
+    /**
+ * @brief Extensions of a DCE, see esp_modem_ext.h
+ *
+ */
+    typedef struct
+    {
+        esp_modem_ext_t *head;                 /*!< Newest first */
+        esp_err_t (*deinit)(modem_dce_t *dce); /*!< deinit of the model, run once every extension is detached */
+        portMUX_TYPE lock;                     /*!< Protects head and busy */
+        volatile bool busy;                    /*!< The UART task is going through the chain */
+    } esp_modem_ext_chain_t;
+
     /**
  * @brief DCE(Data Communication Equipment)
  *
@@ -87,22 +125,34 @@ extern "C"
         modem_state_t state;                  /*!< Modem working state */
         modem_mode_t mode;                    /*!< Working mode */
         modem_dte_t *dte;                     /*!< DTE which connect to DCE */
-        xSemaphoreHandle atcmdHandle;
+        const esp_modem_dce_model_t *model;   /*!< Command table of the model, see esp_modem_dce_bind() */
+        void *priv_resource;                  /*!< Where the handler of the running command stores its results */
+        esp_modem_cache_t *cache;             /*!< Query cache, NULL if not enabled */
+        esp_modem_arbiter_t *arbiter;         /*!< Orders the tasks sending commands, NULL while only one can */
+        esp_modem_stats_t *stats;             /*!< Command latencies, NULL if not enabled */
+        esp_modem_health_t *health;           /*!< Health monitor, NULL if not enabled */
+        esp_modem_sleep_t *sleep;             /*!< Sleep manager, NULL if not enabled */
+        esp_modem_supply_t *supply;           /*!< Supply governor, NULL if not enabled */
+        esp_modem_ext_chain_t ext;            /*!< Extensions, set up by esp_modem_dce_bind() */
         esp_err_t (*handle_buffer)(modem_dce_t *dce, uint8_t *buffer); /*!< Handle line strategy */
         esp_err_t (*handle_buffer_default)(modem_dce_t *dce, uint8_t *buffer);
         esp_err_t (*handle_line)(modem_dce_t *dce, const char *line); /*!< Handle line strategy */
         esp_err_t (*handle_line_default)(modem_dce_t *dce, const char *line);
+        esp_err_t (*handle_urc)(modem_dce_t *dce, const char *line);                                        /*!< Inspect every line for URCs before handle_line (optional) */
         esp_err_t (*sync)(modem_dce_t *dce);                                                                /*!< Synchronization */
         esp_err_t (*echo_mode)(modem_dce_t *dce, bool on);                                                  /*!< Echo command on or off */
         esp_err_t (*store_profile)(modem_dce_t *dce);                                                       /*!< Store user settings */
         esp_err_t (*set_flow_ctrl)(modem_dce_t *dce, modem_flow_ctrl_t flow_ctrl);                          /*!< Flow control on or off */
         esp_err_t (*get_signal_quality)(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber);                   /*!< Get signal quality */
         esp_err_t (*get_battery_status)(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage); /*!< Get battery status */
+        esp_err_t (*get_network_status)(modem_dce_t *dce, uint32_t *mode, uint32_t *stat);                  /*!< Get network registration status */
         esp_err_t (*define_pdp_context)(modem_dce_t *dce, uint32_t cid,
                                         const char *type, const char *apn); /*!< Set PDP Contex */
         esp_err_t (*set_working_mode)(modem_dce_t *dce, modem_mode_t mode); /*!< Set working mode */
         esp_err_t (*hang_up)(modem_dce_t *dce);                             /*!< Hang up */
-        esp_err_t (*hard_reset)(modem_dce_t *dce);                          /*!< Hang up */
+        esp_err_t (*set_radio)(modem_dce_t *dce, bool on);                  /*!< Radio off (AT+CFUN=0) or on */
+        esp_err_t (*hard_reset)(modem_dce_t *dce);                          /*!< Reset pin pulse, then boot and configure again (optional) */
+        esp_err_t (*power_cycle)(modem_dce_t *dce);                         /*!< Supply off and on, then boot and configure again (optional) */
         esp_err_t (*power_down)(modem_dce_t *dce);                          /*!< Normal power down */
         esp_err_t (*deinit)(modem_dce_t *dce);                              /*!< Deinitialize */
     };
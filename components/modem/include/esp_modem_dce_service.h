@@ -18,6 +18,7 @@ extern "C" {
 #endif
 
 #include "esp_modem_dce.h"
+#include "esp_modem_parse.h"
 
 /**
  * @brief Indicate that processing current command has done
@@ -127,6 +128,307 @@ esp_err_t esp_modem_dce_define_pdp_context(modem_dce_t *dce, uint32_t cid, const
  */
 esp_err_t esp_modem_dce_hang_up(modem_dce_t *dce);
 
+/**
+ * @brief Commands every model answers, each with the wording given in its esp_modem_dce_model_t
+ *
+ */
+typedef enum {
+    ESP_MODEM_DCE_CMD_SIGNAL_QUALITY = 0, /*!< AT+CSQ */
+    ESP_MODEM_DCE_CMD_BATTERY_STATUS,     /*!< AT+CBC */
+    ESP_MODEM_DCE_CMD_MODULE_NAME,        /*!< AT+CGMM */
+    ESP_MODEM_DCE_CMD_IMEI,               /*!< AT+CGSN */
+    ESP_MODEM_DCE_CMD_IMSI,               /*!< AT+CIMI */
+    ESP_MODEM_DCE_CMD_OPERATOR,           /*!< AT+COPS? */
+    ESP_MODEM_DCE_CMD_NETWORK_STATUS,     /*!< AT+CREG? */
+    ESP_MODEM_DCE_CMD_COMMAND_MODE,       /*!< +++ */
+    ESP_MODEM_DCE_CMD_PPP_MODE,           /*!< ATD*99# */
+    ESP_MODEM_DCE_CMD_POWER_DOWN,         /*!< AT+CPOWD=1 */
+    ESP_MODEM_DCE_CMD_RADIO_OFF,          /*!< AT+CFUN=0 */
+    ESP_MODEM_DCE_CMD_RADIO_ON,           /*!< AT+CFUN=1 */
+    ESP_MODEM_DCE_CMD_SLEEP_ON_DTR,       /*!< AT+CSCLK=1 */
+    ESP_MODEM_DCE_CMD_MAX
+} esp_modem_dce_cmd_id_t;
+
+/**
+ * @brief Wording of one command for a model
+ *
+ */
+typedef struct {
+    const char *command;               /*!< Command line with the trailing "\r", NULL if the model lacks the command */
+    const esp_modem_format_t *format;  /*!< Layout of the information line, NULL if only the final result code matters */
+    const char *success[2];            /*!< Result codes ending the command successfully, "OK" if none given */
+    uint32_t timeout;                  /*!< Timeout value, Unit: millisecond */
+    esp_err_t (*handle_line)(modem_dce_t *dce, const char *line); /*!< Replaces the generic handler (optional) */
+} esp_modem_dce_command_t;
+
+/**
+ * @brief Command table of a model
+ *
+ */
+struct esp_modem_dce_model {
+    const char *name;                                         /*!< Model name, used in logs */
+    esp_modem_dce_command_t commands[ESP_MODEM_DCE_CMD_MAX];  /*!< Indexed by esp_modem_dce_cmd_id_t */
+};
+
+/**
+ * @brief Where a command stores what it parsed, reachable from dce->priv_resource while it runs
+ *
+ */
+typedef struct {
+    const esp_modem_dce_command_t *command; /*!< Running command, set by esp_modem_dce_execute() */
+    void *out;                              /*!< Struct the format of the command writes into */
+} esp_modem_dce_result_t;
+
+/**
+ * @brief +CSQ: <rssi>,<ber>
+ *
+ */
+typedef struct {
+    int32_t rssi; /*!< Received signal strength indication */
+    int32_t ber;  /*!< Bit error ratio */
+} esp_modem_csq_t;
+
+/**
+ * @brief +CBC: <bcs>,<bcl>,<voltage>
+ *
+ */
+typedef struct {
+    int32_t bcs;     /*!< Battery charge status */
+    int32_t bcl;     /*!< Battery connection level */
+    int32_t voltage; /*!< Battery voltage */
+} esp_modem_cbc_t;
+
+/**
+ * @brief +CREG: <n>,<stat>[,<lac>,<ci>]
+ *
+ */
+typedef struct {
+    int32_t n;    /*!< URC reporting mode */
+    int32_t stat; /*!< Registration status */
+} esp_modem_creg_t;
+
+/**
+ * @brief +COPS: <mode>[,<format>,<oper>]
+ *
+ */
+typedef struct {
+    int32_t mode;                         /*!< Selection mode */
+    int32_t format;                       /*!< Format of oper */
+    char oper[MODEM_MAX_OPERATOR_LENGTH]; /*!< Operator name, empty if not registered */
+} esp_modem_cops_t;
+
+/**
+ * @brief Formats of the answers most models share, for the command tables
+ *
+ */
+extern const esp_modem_format_t esp_modem_format_csq;  /*!< Into esp_modem_csq_t */
+extern const esp_modem_format_t esp_modem_format_cbc;  /*!< Into esp_modem_cbc_t */
+extern const esp_modem_format_t esp_modem_format_creg; /*!< Into esp_modem_creg_t */
+extern const esp_modem_format_t esp_modem_format_cops; /*!< Into esp_modem_cops_t */
+extern const esp_modem_format_t esp_modem_format_name; /*!< The whole line into a MODEM_MAX_NAME_LENGTH buffer */
+extern const esp_modem_format_t esp_modem_format_imei; /*!< Into a MODEM_IMEI_LENGTH + 1 buffer */
+extern const esp_modem_format_t esp_modem_format_imsi; /*!< Into a MODEM_IMSI_LENGTH + 1 buffer */
+
+/**
+ * @brief Generic handler of a table command
+ *
+ * Ends the command on one of its success codes or on ERROR, and parses the information
+ * line with the format of the command. Override hooks can call it for the lines they do not handle.
+ *
+ * @param dce Modem DCE object
+ * @param line line string
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_handle_command_line(modem_dce_t *dce, const char *line);
+
+/**
+ * @brief Run a command from the model table
+ *
+ * @param dce Modem DCE object
+ * @param id command
+ * @param out struct the format of the command writes into, NULL if it has no format
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the model lacks the command
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_execute(modem_dce_t *dce, esp_modem_dce_cmd_id_t id, void *out);
+
+/**
+ * @brief Send one command with its own line handler, holding the command channel meanwhile
+ *
+ * The channel is taken at ESP_MODEM_PRIORITY_NORMAL unless the calling task already owns it.
+ *
+ * @param dce Modem DCE object
+ * @param command command string, with its "\r"
+ * @param timeout timeout value, Unit: millisecond
+ * @param handle_line handler of the answer lines
+ * @param resource what handle_line finds in dce->priv_resource
+ * @return esp_err_t
+ *      - ESP_OK if the command succeeded
+ *      - ESP_ERR_TIMEOUT if the channel or the answer did not come in time
+ *      - ESP_ERR_INVALID_STATE if the modem is powered down
+ *      - ESP_FAIL if the modem reported an error
+ */
+esp_err_t esp_modem_dce_command(modem_dce_t *dce, const char *command, uint32_t timeout,
+                                esp_err_t (*handle_line)(modem_dce_t *dce, const char *line), void *resource);
+
+/**
+ * @brief Fail the command waiting for an answer, if any, so that its caller gives the channel back
+ *
+ * For a modem known not to answer: a command such as AT+COPS? would otherwise hold the
+ * channel for its whole timeout.
+ *
+ * @param dce Modem DCE object
+ * @return true if a command was failed
+ */
+bool esp_modem_dce_abort(modem_dce_t *dce);
+
+/**
+ * @brief Bind a model table and the generic methods to a DCE
+ *
+ * Models replace the methods they implement differently after this call.
+ *
+ * @param dce Modem DCE object
+ * @param model command table, must stay valid while the DCE exists
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the command arbiter could not be created
+ */
+esp_err_t esp_modem_dce_bind(modem_dce_t *dce, const esp_modem_dce_model_t *model);
+
+/**
+ * @brief Release what esp_modem_dce_bind() allocated, from the deinit of the model
+ *
+ * @param dce Modem DCE object
+ */
+void esp_modem_dce_unbind(modem_dce_t *dce);
+
+/**
+ * @brief Get signal quality
+ *
+ * @param dce Modem DCE object
+ * @param rssi received signal strength indication
+ * @param ber bit error ratio
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_signal_quality(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber);
+
+/**
+ * @brief Get battery status
+ *
+ * @param dce Modem DCE object
+ * @param bcs Battery charge status
+ * @param bcl Battery connection level
+ * @param voltage Battery voltage
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_battery_status(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage);
+
+/**
+ * @brief Get network registration status
+ *
+ * @param dce Modem DCE object
+ * @param mode URC reporting mode
+ * @param stat registration status
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_network_status(modem_dce_t *dce, uint32_t *mode, uint32_t *stat);
+
+/**
+ * @brief Get DCE module name into dce->name
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_module_name(modem_dce_t *dce);
+
+/**
+ * @brief Get DCE module IMEI number into dce->imei
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_imei_number(modem_dce_t *dce);
+
+/**
+ * @brief Get DCE module IMSI number into dce->imsi
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_imsi_number(modem_dce_t *dce);
+
+/**
+ * @brief Get Operator's name into dce->oper
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_get_operator_name(modem_dce_t *dce);
+
+/**
+ * @brief Set Working Mode
+ *
+ * @param dce Modem DCE object
+ * @param mode woking mode
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_set_working_mode(modem_dce_t *dce, modem_mode_t mode);
+
+/**
+ * @brief Normal power down
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_power_down(modem_dce_t *dce);
+
+/**
+ * @brief Switch the radio off or on, leaving the modem answering AT commands
+ *
+ * @param dce Modem DCE object
+ * @param on true for full functionality (AT+CFUN=1), false for minimum (AT+CFUN=0)
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the model lacks the command
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_set_radio(modem_dce_t *dce, bool on);
+
+/**
+ * @brief Let the modem sleep whenever DTR is high, and wake when it is pulled low
+ *
+ * The setting is lost on a reset or a power cycle.
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_SUPPORTED if the model lacks the command
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_dce_sleep_on_dtr(modem_dce_t *dce);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,85 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_modem_dce.h"
+#include "esp_modem_dte.h"
+
+/**
+ * @brief Maximum number of registered DCE drivers
+ *
+ */
+#define ESP_MODEM_DRIVER_MAX (4)
+
+/**
+ * @brief DCE driver
+ *
+ */
+typedef struct {
+    const char *name;                                               /*!< Driver name */
+    const char *const *models;                                      /*!< NULL terminated substrings of the AT+CGMM or ATI answer this driver handles */
+    modem_dce_t *(*init)(modem_dte_t *dte, const void *config);     /*!< Create the DCE, config is passed through from esp_modem_driver_init() */
+} esp_modem_driver_t;
+
+/**
+ * @brief Register a DCE driver
+ *
+ * @param driver driver, must stay valid while registered
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the registry is full
+ */
+esp_err_t esp_modem_driver_register(const esp_modem_driver_t *driver);
+
+/**
+ * @brief Wait for the modem to answer and read its model
+ *
+ * Syncs, turns echo off and asks AT+CGMM, falling back to ATI, with a temporary DCE
+ * bound to the DTE. Every driver needs the sync and echo steps anyway, so they find the
+ * modem ready.
+ *
+ * @param dte Modem DTE object, not bound to a DCE
+ * @param model buffer for the model
+ * @param length size of the buffer
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_TIMEOUT if the modem did not answer within the boot timeout
+ *      - ESP_FAIL on error
+ */
+esp_err_t esp_modem_probe(modem_dte_t *dte, char *model, size_t length);
+
+/**
+ * @brief Find the driver handling a model
+ *
+ * @param model answer of AT+CGMM or ATI
+ * @return const esp_modem_driver_t* driver, NULL if none matches
+ */
+const esp_modem_driver_t *esp_modem_driver_find(const char *model);
+
+/**
+ * @brief Probe the modem and create its DCE with the matching driver
+ *
+ * @param dte Modem DTE object, not bound to a DCE
+ * @param config driver specific configuration
+ * @return modem_dce_t* Modem DCE object, NULL if the modem did not answer or no driver matched
+ */
+modem_dce_t *esp_modem_driver_init(modem_dte_t *dte, const void *config);
+
+#ifdef __cplusplus
+}
+#endif
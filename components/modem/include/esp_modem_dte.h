@@ -30,7 +30,8 @@ typedef struct modem_dce modem_dce_t;
  */
 typedef enum {
     MODEM_COMMAND_MODE = 0, /*!< Command Mode */
-    MODEM_PPP_MODE          /*!< PPP Mode */
+    MODEM_PPP_MODE,         /*!< PPP Mode */
+    MODEM_POWER_OFF_MODE    /*!< Powered down, commands fail at once */
 } modem_mode_t;
 
 /**
@@ -49,6 +50,7 @@ typedef enum {
  */
 struct modem_dte {
     modem_flow_ctrl_t flow_ctrl;                                                    /*!< Flow control of DTE */
+    uint32_t baud_rate;                                                             /*!< Baud rate of DTE */
     modem_dce_t *dce;                                                               /*!< DCE which connected to the DTE */
     esp_err_t (*send_cmd)(modem_dte_t *dte, const char *command, uint32_t timeout); /*!< Send command to DCE */
     int (*send_data)(modem_dte_t *dte, const char *data, uint32_t length);          /*!< Send data to DCE */
@@ -56,6 +58,8 @@ struct modem_dte {
                            const char *prompt, uint32_t timeout);      /*!< Wait for specific prompt */
     esp_err_t (*change_mode)(modem_dte_t *dte, modem_mode_t new_mode); /*!< Changing working mode */
     esp_err_t (*process_cmd_done)(modem_dte_t *dte);                   /*!< Callback when DCE process command done */
+    esp_err_t (*set_baud_rate)(modem_dte_t *dte, uint32_t baud_rate);  /*!< Change the UART baud rate */
+    esp_err_t (*set_flow_ctrl)(modem_dte_t *dte, modem_flow_ctrl_t flow_ctrl); /*!< Change the UART flow control */
     esp_err_t (*deinit)(modem_dte_t *dte);                             /*!< Deinitialize */
 };
 
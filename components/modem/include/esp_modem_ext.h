@@ -0,0 +1,152 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_modem_dce.h"
+
+/**
+ * @brief Event bits of an extension task, the bits below are free for the extension
+ *
+ */
+#define ESP_MODEM_EXT_TASK_STOP_BIT BIT6   /*!< Ask the task to exit */
+#define ESP_MODEM_EXT_TASK_EXITED_BIT BIT7 /*!< Task has exited */
+
+/**
+ * @brief Something riding on a DCE: a cache, a monitor, a manager
+ *
+ * Embedded in the extension's own object and linked into the DCE by esp_modem_ext_attach().
+ */
+struct esp_modem_ext {
+    void (*handle_urc)(modem_dce_t *dce, const char *line); /*!< Sees every line before the model, NULL if not needed */
+    void (*detach)(modem_dce_t *dce);                        /*!< Stops and frees the extension, run by the DCE's deinit */
+    esp_modem_ext_t *next;                                   /*!< Next older extension, owned by the chain */
+};
+
+/**
+ * @brief Task of an extension, with the event group that wakes it and tells it to stop
+ *
+ */
+typedef struct {
+    TaskHandle_t handle;              /*!< Task, deleted by esp_modem_ext_task_join() */
+    EventGroupHandle_t events;        /*!< Bits of the extension and the two above */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StaticEventGroup_t events_buffer; /*!< Memory of events */
+    StaticTask_t task_buffer;         /*!< Memory of the task */
+#endif
+} esp_modem_ext_task_t;
+
+/**
+ * @brief Link an extension into a DCE
+ *
+ * The newest extension sees a line first, and is detached first when the DCE is
+ * deinitialized, whatever the order the extensions were enabled in. The deinit of the
+ * model runs once every extension is detached.
+ *
+ * @param dce Modem DCE object
+ * @param ext extension, valid until its detach has run
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the DCE has no deinit or ext has no detach
+ */
+esp_err_t esp_modem_ext_attach(modem_dce_t *dce, esp_modem_ext_t *ext);
+
+/**
+ * @brief Unlink an extension, for an enable that fails after esp_modem_ext_attach()
+ *
+ * Returns once the UART task no longer runs its handle_urc, detach is not called.
+ *
+ * @param dce Modem DCE object
+ * @param ext extension
+ */
+void esp_modem_ext_detach(modem_dce_t *dce, esp_modem_ext_t *ext);
+
+/**
+ * @brief Show a line to every extension, newest first, then to the model, called by the DTE
+ *
+ * @param dce Modem DCE object
+ * @param line line received
+ */
+void esp_modem_ext_handle_urc(modem_dce_t *dce, const char *line);
+
+/**
+ * @brief Create the event group of an extension task, before anything can set its bits
+ *
+ * @param task task of the extension
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_ext_task_init(esp_modem_ext_task_t *task);
+
+/**
+ * @brief Start an extension task
+ *
+ * @param task task of the extension, initialized
+ * @param entry task function, ends with esp_modem_ext_task_exit()
+ * @param name task name
+ * @param stack_size stack size
+ * @param priority task priority
+ * @param arg argument of entry
+ * @param stack stack memory of stack_size with CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION, else NULL
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the task was not created
+ */
+esp_err_t esp_modem_ext_task_start(esp_modem_ext_task_t *task, TaskFunction_t entry, const char *name,
+                                   uint32_t stack_size, UBaseType_t priority, void *arg, StackType_t *stack);
+
+/**
+ * @brief Whether the task was asked to exit, for long work between two waits
+ *
+ * @param task task of the extension
+ * @return true once esp_modem_ext_task_stop() was called
+ */
+bool esp_modem_ext_task_stopping(esp_modem_ext_task_t *task);
+
+/**
+ * @brief Ask the task to exit, without waiting for it
+ *
+ * @param task task of the extension
+ */
+void esp_modem_ext_task_stop(esp_modem_ext_task_t *task);
+
+/**
+ * @brief End of the task function: report the exit and wait to be deleted
+ *
+ * The task is deleted by esp_modem_ext_task_join(), so that a static task is off every
+ * list before its memory is reused.
+ *
+ * @param task task of the extension
+ */
+void esp_modem_ext_task_exit(esp_modem_ext_task_t *task) __attribute__((noreturn));
+
+/**
+ * @brief Stop the task, wait for it to exit, delete it and its event group
+ *
+ * A task that was never started only has its event group deleted.
+ *
+ * @param task task of the extension
+ */
+void esp_modem_ext_task_join(esp_modem_ext_task_t *task);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,160 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_modem_dce.h"
+
+/**
+ * @brief Steps of a recovery, each one tried when the one before did not bring the modem back
+ *
+ */
+typedef enum {
+    ESP_MODEM_HEALTH_SYNC = 0, /*!< Leave data mode with "+++" and probe with AT */
+    ESP_MODEM_HEALTH_RADIO,    /*!< AT+CFUN=0, then AT+CFUN=1 */
+    ESP_MODEM_HEALTH_RESET,    /*!< dce->hard_reset(), a pulse on the reset pin */
+    ESP_MODEM_HEALTH_POWER,    /*!< dce->power_cycle(), the supply off and on */
+    ESP_MODEM_HEALTH_LEVEL_MAX
+} esp_modem_health_level_t;
+
+/**
+ * @brief When the modem counts as unresponsive, Unit: millisecond
+ *
+ */
+typedef struct {
+    uint32_t check_interval_ms; /*!< How often the monitor looks at the modem */
+    uint32_t silence_ms;        /*!< Command mode: probe with AT after this long without a line from the modem */
+    uint32_t ppp_silence_ms;    /*!< PPP mode: recover after this long without a byte, needs LCP echo, 0 to leave PPP alone */
+    uint32_t max_timeouts;      /*!< Consecutive command timeouts that start a recovery */
+    uint32_t sync_attempts;     /*!< AT probes of the first recovery step */
+} esp_modem_health_config_t;
+
+/**
+ * @brief Health monitor configuration from Kconfig
+ *
+ */
+#define ESP_MODEM_HEALTH_DEFAULT_CONFIG()                                \
+    {                                                                    \
+        .check_interval_ms = CONFIG_EXAMPLE_MODEM_HEALTH_INTERVAL,       \
+        .silence_ms = CONFIG_EXAMPLE_MODEM_HEALTH_SILENCE,               \
+        .ppp_silence_ms = CONFIG_EXAMPLE_MODEM_HEALTH_PPP_SILENCE,       \
+        .max_timeouts = CONFIG_EXAMPLE_MODEM_HEALTH_MAX_TIMEOUTS,        \
+        .sync_attempts = CONFIG_EXAMPLE_MODEM_HEALTH_SYNC_ATTEMPTS       \
+    }
+
+/**
+ * @brief Counters of the health monitor
+ *
+ * The time to recover runs from the moment the modem was found unresponsive to the moment
+ * it answered again in the mode it was in, PPP included.
+ */
+typedef struct {
+    bool recovering;                                  /*!< A recovery is running */
+    uint32_t consecutive_timeouts;                    /*!< Command timeouts since the last answer */
+    uint32_t timeouts;                                /*!< Command timeouts */
+    uint32_t probes;                                  /*!< AT probes sent after a silence */
+    uint32_t urcs;                                    /*!< Lines received with no command running */
+    int64_t last_line_us;                             /*!< esp_timer time of the last line from the modem */
+    uint32_t recovered[ESP_MODEM_HEALTH_LEVEL_MAX];   /*!< Recoveries ended by each step */
+    uint32_t failures;                                /*!< Recoveries where every step failed */
+    uint32_t last_mttr_ms;                            /*!< Time to recover of the last successful recovery */
+    uint32_t max_mttr_ms;                             /*!< Longest time to recover */
+    uint64_t total_mttr_ms;                           /*!< Sum over the successful recoveries */
+} esp_modem_health_stats_t;
+
+/**
+ * @brief Watch a DCE and bring it back when it stops answering
+ *
+ * Every line from the modem and the outcome of every command are recorded. A task checks
+ * them periodically: after consecutive command timeouts, after PPP silence, or when an AT
+ * probe sent after a silence goes unanswered, it takes the command channel at
+ * ESP_MODEM_PRIORITY_RECOVERY and escalates through esp_modem_health_level_t, checking
+ * with AT after each step, until the modem is back in the mode it was in. Steps the
+ * model lacks are skipped. The monitor is stopped and freed with the DCE.
+ *
+ * @param dce Modem DCE object
+ * @param config thresholds, copied
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is wrong
+ *      - ESP_ERR_INVALID_STATE if the monitor is already enabled
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_health_enable(modem_dce_t *dce, const esp_modem_health_config_t *config);
+
+/**
+ * @brief Note the outcome of a command, called by esp_modem_dce_command()
+ *
+ * Does nothing when health is NULL.
+ *
+ * @param health health monitor of the DCE
+ * @param result what the command returned
+ */
+void esp_modem_health_command(esp_modem_health_t *health, esp_err_t result);
+
+/**
+ * @brief Ask for a recovery now, whatever the modem looks like
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK if the monitor will start one
+ *      - ESP_ERR_INVALID_STATE if the monitor is not enabled
+ */
+esp_err_t esp_modem_health_recover(modem_dce_t *dce);
+
+/**
+ * @brief Stop watching a modem that is about to go down
+ *
+ * Returns at once, the task ends after its current check or recovery step. The
+ * monitor keeps its counters and is freed with the DCE as usual.
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the monitor is not enabled
+ */
+esp_err_t esp_modem_health_stop(modem_dce_t *dce);
+
+/**
+ * @brief Copy the counters
+ *
+ * @param dce Modem DCE object
+ * @param stats where to copy them
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the monitor is not enabled
+ */
+esp_err_t esp_modem_health_get_stats(modem_dce_t *dce, esp_modem_health_stats_t *stats);
+
+/**
+ * @brief Clear the counters of past recoveries
+ *
+ * @param dce Modem DCE object
+ */
+void esp_modem_health_reset_stats(modem_dce_t *dce);
+
+/**
+ * @brief Get the name of a recovery step
+ *
+ * @param level step
+ * @return const char* name
+ */
+const char *esp_modem_health_level_name(esp_modem_health_level_t level);
+
+#ifdef __cplusplus
+}
+#endif
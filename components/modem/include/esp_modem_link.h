@@ -0,0 +1,110 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Maximum number of links the scheduler spreads transfers over
+ *
+ */
+#define ESP_MODEM_LINK_MAX (4)
+
+typedef struct esp_modem_link esp_modem_link_t;
+
+/**
+ * @brief Outbound link description
+ *
+ */
+typedef struct {
+    const char *name;                                         /*!< Name used in logs and statistics */
+    uint32_t bit_rate;                                        /*!< Nominal rate, used to estimate when queued data is out */
+    int (*send)(void *ctx, const uint8_t *data, size_t len);  /*!< Send a chunk, blocking. Returns the bytes sent or -1 */
+    bool (*is_up)(void *ctx);                                 /*!< Whether the link can carry traffic now (optional) */
+    void *ctx;                                                /*!< Argument of the callbacks */
+} esp_modem_link_config_t;
+
+/**
+ * @brief Per link counters
+ *
+ */
+typedef struct {
+    const char *name;     /*!< Link name */
+    bool up;              /*!< Link usable at the time of the query */
+    uint32_t chunks;      /*!< Chunks sent */
+    uint32_t errors;      /*!< Chunks the link failed to send */
+    uint64_t bytes;       /*!< Bytes sent */
+    uint64_t busy_us;     /*!< Time spent sending */
+} esp_modem_link_stats_t;
+
+/**
+ * @brief Add a link to the scheduler
+ *
+ * Every link gets its own sender task, so chunks on different links go out in parallel.
+ *
+ * @param config link description, copied
+ * @return esp_modem_link_t* link handle, NULL on error
+ */
+esp_modem_link_t *esp_modem_link_add(const esp_modem_link_config_t *config);
+
+/**
+ * @brief Remove a link, waiting for the chunk it is sending
+ *
+ * @param link link handle
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the link is unknown
+ */
+esp_err_t esp_modem_link_remove(esp_modem_link_t *link);
+
+/**
+ * @brief Send a transfer spread over the links that are up
+ *
+ * The transfer is cut into chunks, each going to the link expected to finish it first
+ * given what it already has queued and its bit rate. Returns when every chunk is out.
+ * A chunk a link fails to send is handed to another link.
+ *
+ * @param data data to send
+ * @param len length of data
+ * @param chunk_size chunk size, 0 for the default
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if no link is up
+ *      - ESP_FAIL if a chunk could not be sent on any link
+ */
+esp_err_t esp_modem_link_send(const uint8_t *data, size_t len, size_t chunk_size);
+
+/**
+ * @brief Get the counters of every link
+ *
+ * @param stats array of ESP_MODEM_LINK_MAX entries
+ * @return int number of entries filled
+ */
+int esp_modem_link_get_stats(esp_modem_link_stats_t *stats);
+
+/**
+ * @brief Reset the counters of every link
+ */
+void esp_modem_link_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,95 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief NVS namespace holding modem settings that survive a restart
+ *
+ * Modem instances other than the first one get their index appended.
+ */
+#define ESP_MODEM_NVS_NAMESPACE "esp_modem"
+
+/**
+ * @brief Read an unsigned value from the modem namespace
+ *
+ * @param instance modem instance
+ * @param key NVS key
+ * @param value read value
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NVS_NOT_FOUND if the key was never written
+ *      - other NVS errors
+ */
+esp_err_t esp_modem_nvs_get_u32(uint8_t instance, const char *key, uint32_t *value);
+
+/**
+ * @brief Write an unsigned value to the modem namespace, skipping the flash write if unchanged
+ *
+ * @param instance modem instance
+ * @param key NVS key
+ * @param value value to store
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - NVS errors
+ */
+esp_err_t esp_modem_nvs_set_u32(uint8_t instance, const char *key, uint32_t value);
+
+/**
+ * @brief Read a string from the modem namespace
+ *
+ * @param instance modem instance
+ * @param key NVS key
+ * @param value buffer for the string
+ * @param length size of the buffer
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NVS_NOT_FOUND if the key was never written
+ *      - other NVS errors
+ */
+esp_err_t esp_modem_nvs_get_str(uint8_t instance, const char *key, char *value, size_t length);
+
+/**
+ * @brief Write a string to the modem namespace, skipping the flash write if unchanged
+ *
+ * @param instance modem instance
+ * @param key NVS key
+ * @param value string to store
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - NVS errors
+ */
+esp_err_t esp_modem_nvs_set_str(uint8_t instance, const char *key, const char *value);
+
+/**
+ * @brief Erase a key from the modem namespace
+ *
+ * @param instance modem instance
+ * @param key NVS key
+ * @return esp_err_t
+ *      - ESP_OK on success, or if the key did not exist
+ *      - NVS errors
+ */
+esp_err_t esp_modem_nvs_erase(uint8_t instance, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Kind of a response field
+ *
+ */
+typedef enum {
+    ESP_MODEM_FIELD_INT,    /*!< Decimal integer, optionally signed, into an int8_t, int16_t or int32_t sized member */
+    ESP_MODEM_FIELD_STRING, /*!< Quoted string without its quotes, or a bare token up to the next comma */
+    ESP_MODEM_FIELD_TEXT,   /*!< Everything up to the end of the line, commas included */
+    ESP_MODEM_FIELD_SKIP,   /*!< Field that is present but not stored */
+} esp_modem_field_type_t;
+
+/**
+ * @brief Description of one comma separated field
+ *
+ */
+typedef struct {
+    const char *name;   /*!< Field name, for error reports */
+    uint8_t type;       /*!< esp_modem_field_type_t */
+    bool optional;      /*!< A missing field leaves the member untouched, the fields after it must be optional too */
+    uint16_t offset;    /*!< Offset of the member in the output struct */
+    uint16_t size;      /*!< Size of the member */
+} esp_modem_field_t;
+
+/**
+ * @brief Layout of a response line
+ *
+ * Fields the modem sends beyond the described ones are ignored, so a model adding
+ * fields at the end of an answer still parses.
+ */
+typedef struct {
+    const char *prefix;              /*!< Start of the line up to the first field, e.g. "+CSQ: ", NULL for none */
+    const esp_modem_field_t *fields; /*!< Fields in order */
+    uint8_t count;                   /*!< Number of fields */
+} esp_modem_format_t;
+
+/**
+ * @brief Where parsing stopped
+ *
+ */
+typedef struct {
+    uint8_t field;      /*!< Index of the field that failed, or the number of fields parsed on success */
+    uint16_t column;    /*!< Offset in the line where it failed */
+} esp_modem_parse_error_t;
+
+#define ESP_MODEM_FIELD(type, member, kind, opt) \
+    {#member, kind, opt, offsetof(type, member), sizeof(((type *)0)->member)}
+
+/**
+ * @brief Field descriptors, e.g. ESP_MODEM_INT(esp_modem_csq_t, rssi)
+ *
+ */
+#define ESP_MODEM_INT(type, member) ESP_MODEM_FIELD(type, member, ESP_MODEM_FIELD_INT, false)
+#define ESP_MODEM_INT_OPT(type, member) ESP_MODEM_FIELD(type, member, ESP_MODEM_FIELD_INT, true)
+#define ESP_MODEM_STRING(type, member) ESP_MODEM_FIELD(type, member, ESP_MODEM_FIELD_STRING, false)
+#define ESP_MODEM_STRING_OPT(type, member) ESP_MODEM_FIELD(type, member, ESP_MODEM_FIELD_STRING, true)
+#define ESP_MODEM_TEXT(type, member) ESP_MODEM_FIELD(type, member, ESP_MODEM_FIELD_TEXT, false)
+#define ESP_MODEM_SKIP() {NULL, ESP_MODEM_FIELD_SKIP, false, 0, 0}
+#define ESP_MODEM_SKIP_OPT() {NULL, ESP_MODEM_FIELD_SKIP, true, 0, 0}
+
+/**
+ * @brief Field descriptor storing a whole buffer rather than a struct member, e.g. dce->name
+ *
+ */
+#define ESP_MODEM_BUFFER(kind, length) {"value", kind, false, 0, length}
+
+/**
+ * @brief Build a format from a prefix and an array of field descriptors
+ *
+ */
+#define ESP_MODEM_FORMAT(line_prefix, field_array) \
+    {.prefix = line_prefix, .fields = field_array, .count = sizeof(field_array) / sizeof(field_array[0])}
+
+/**
+ * @brief Parse a response line into a struct
+ *
+ * Nothing is allocated and the line is not modified. Members of fields that were parsed
+ * keep their value even when a later field fails.
+ *
+ * @param format layout of the line
+ * @param line line string, the trailing "\r\n" is optional
+ * @param out struct the field offsets refer to
+ * @param error where parsing stopped (optional)
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the line does not start with the prefix
+ *      - ESP_ERR_INVALID_RESPONSE if a field is malformed or a mandatory one is missing
+ *      - ESP_ERR_INVALID_SIZE if a string does not fit its member
+ */
+esp_err_t esp_modem_parse(const esp_modem_format_t *format, const char *line, void *out, esp_modem_parse_error_t *error);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,91 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Fixed-size blocks for the short-lived buffers of the modem path
+ *
+ * Prompts read by send_wait and the copies of statistics entries are taken from two
+ * static pools, small and scratch, sized in Kconfig, instead of the heap. A request
+ * gets a block of the smallest pool it fits in. When that pool is empty, or when the
+ * request is larger than every block, the buffer comes from the heap and the miss is
+ * counted. The counters tell whether the pools are big enough.
+ */
+typedef struct {
+    const char *name;      /*!< "small" or "scratch" */
+    size_t block_size;     /*!< Bytes per block */
+    size_t blocks;         /*!< Blocks in the pool */
+    size_t in_use;         /*!< Blocks taken now */
+    size_t high_water;     /*!< Most blocks taken at the same time */
+    uint32_t allocations;  /*!< Blocks handed out */
+    uint32_t exhausted;    /*!< Requests that fit but found the pool empty, served by the heap */
+} esp_modem_pool_stats_t;
+
+/**
+ * @brief Take a buffer, the way malloc() would
+ *
+ * @param size bytes needed
+ * @return A pool block or, if none fits or is free, heap memory; NULL if the heap is out too
+ */
+void *esp_modem_pool_alloc(size_t size);
+
+/**
+ * @brief Take a zeroed buffer, the way calloc() would
+ *
+ * @param size bytes needed
+ * @return See esp_modem_pool_alloc()
+ */
+void *esp_modem_pool_calloc(size_t size);
+
+/**
+ * @brief Give a buffer back to its pool or to the heap
+ *
+ * @param ptr buffer from esp_modem_pool_alloc() or esp_modem_pool_calloc(), NULL is ignored
+ */
+void esp_modem_pool_free(void *ptr);
+
+/**
+ * @brief Copy the counters of one pool
+ *
+ * @param index pool number, from 0
+ * @param stats where to copy them
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if there is no such pool
+ */
+esp_err_t esp_modem_pool_get_stats(size_t index, esp_modem_pool_stats_t *stats);
+
+/**
+ * @brief Requests larger than every block, served by the heap
+ *
+ */
+uint32_t esp_modem_pool_get_oversize(void);
+
+/**
+ * @brief Print the counters of every pool, for the heap console command
+ *
+ */
+void esp_modem_pool_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,94 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include "esp_modem_dce.h"
+
+/**
+ * @brief AT scripts
+ *
+ * One statement per line, "$name" or "${name}" is replaced by a variable anywhere:
+ *
+ *     # comment
+ *     :label
+ *     set <name> <value>
+ *     send <command> [expect=<text>] [timeout=<ms>] [retry=<n>] [capture=<name>] [field=<n>] [onfail=<label>]
+ *     if <value> <==|!=|<|<=|>|>=|contains> <value> goto <label>
+ *     goto <label>
+ *     wait <ms>
+ *     echo <text>
+ *     fail <text>
+ *     end
+ *
+ * A send step passes on OK, or when expect is given, on any final result code after a line
+ * containing the expected text. capture stores what follows the expected text up to the next
+ * comma, or the field-th comma separated value after it, without quotes. A failed step is
+ * retried, then jumps to onfail or stops the script. Steps follow each other without delay.
+ */
+
+#define ESP_MODEM_SCRIPT_MAX_REPORT (32)   /*!< Steps with their own timing line in the report */
+#define ESP_MODEM_SCRIPT_COMMAND_LENGTH (24) /*!< Characters of the command kept in the report */
+
+/**
+ * @brief Timing of one send step, all passes over its line together
+ *
+ */
+typedef struct {
+    uint16_t line;                                   /*!< Script line number */
+    uint16_t runs;                                   /*!< Times the step ran */
+    uint16_t attempts;                               /*!< Commands sent, retries included */
+    uint16_t failures;                               /*!< Runs that failed after their retries */
+    uint32_t total_ms;                               /*!< Time of all runs */
+    uint32_t max_ms;                                 /*!< Longest run */
+    char command[ESP_MODEM_SCRIPT_COMMAND_LENGTH];   /*!< Start of the command */
+} esp_modem_script_step_report_t;
+
+/**
+ * @brief Outcome of a script
+ *
+ */
+typedef struct {
+    esp_modem_script_step_report_t steps[ESP_MODEM_SCRIPT_MAX_REPORT]; /*!< In order of first run */
+    uint8_t count;                                                     /*!< Entries in steps */
+    uint32_t elapsed_ms;                                               /*!< Whole script */
+    uint16_t error_line;                                               /*!< Line the script stopped at, 0 if it ended normally */
+    char error[64];                                                    /*!< Why it stopped */
+} esp_modem_script_report_t;
+
+/**
+ * @brief Run a script file
+ *
+ * The command channel is held for the whole script except during wait statements.
+ *
+ * @param dce Modem DCE object
+ * @param path script file
+ * @param echo print the lines the modem answers
+ * @param report where to put the timings
+ * @return esp_err_t
+ *      - ESP_OK if the script reached its end
+ *      - ESP_ERR_NOT_FOUND if the file cannot be opened
+ *      - ESP_ERR_INVALID_SIZE if it is larger than the configured maximum
+ *      - ESP_ERR_INVALID_ARG on a syntax error, see report->error_line
+ *      - ESP_FAIL if a step failed or the script ran fail
+ */
+esp_err_t esp_modem_script_run(modem_dce_t *dce, const char *path, bool echo, esp_modem_script_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,66 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_modem_dce.h"
+
+/**
+ * @brief How a shutdown went, Unit: millisecond
+ *
+ */
+typedef struct {
+    uint32_t flush_ms;      /*!< Letting the sockets over PPP close and their data go out */
+    uint32_t quiesce_ms;    /*!< Getting the command channel from background work */
+    uint32_t ppp_ms;        /*!< Closing PPP: LCP, queued output, "+++" and ATH */
+    uint32_t power_down_ms; /*!< From the power down command to the modem's last line */
+    uint32_t teardown_ms;   /*!< Stopping the tasks and freeing the DCE and the DTE */
+    uint32_t total_ms;      /*!< All of the above */
+    bool ppp;               /*!< PPP was up */
+    bool confirmed;         /*!< The modem reported that it powered down */
+} esp_modem_shutdown_report_t;
+
+/**
+ * @brief Power the modem down and free the DCE and the DTE
+ *
+ * The health monitor is told to stop first and winds down while the rest goes on. In PPP
+ * mode the application is then asked to close its sockets with MODEM_EVENT_PPP_CLOSING,
+ * and the link stays up until the uplink goes quiet, for at most
+ * CONFIG_EXAMPLE_MODEM_SHUTDOWN_FLUSH. The
+ * command channel is then taken at ESP_MODEM_PRIORITY_RECOVERY, failing a command that
+ * waits for an answer, and held until the modem is down. An open PPP session is closed
+ * with LCP before "+++" and ATH, and the power down command ends on the modem's
+ * "NORMAL POWER DOWN" (SIM800) or "POWERED DOWN" (BG96) instead of a fixed delay. From
+ * then on commands fail at once, so that no background query waits for a timeout on a
+ * modem that is gone, and the callers queued for the channel are let through and out
+ * before the DCE goes. Last, the DCE and the DTE are deinitialized, their tasks finishing
+ * what they are doing before they exit.
+ *
+ * The supply, if the board switches it, can be cut as soon as this returns. Event
+ * handlers of the DTE are removed with its event loop.
+ *
+ * @param dce Modem DCE object, freed with its DTE whatever the result
+ * @param report where to store the timings, may be NULL
+ * @return esp_err_t
+ *      - ESP_OK if the modem confirmed the power down
+ *      - ESP_ERR_TIMEOUT if it did not, the caller should cut the supply
+ */
+esp_err_t esp_modem_shutdown(modem_dce_t *dce, esp_modem_shutdown_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
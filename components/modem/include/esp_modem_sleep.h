@@ -0,0 +1,190 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_modem_dce.h"
+
+/**
+ * @brief Pins and timings of the sleep manager, Unit: millisecond
+ *
+ */
+typedef struct {
+    int dtr_io_num;             /*!< DTR pin, high lets the modem sleep */
+    int ri_io_num;              /*!< RI pin, wakes the chip from light sleep for a URC, -1 if not wired */
+    uint32_t idle_ms;           /*!< No command for this long puts the modem to sleep */
+    uint32_t settle_ms;         /*!< From DTR low to the first command, the SIM800 needs 50 ms */
+    uint32_t latency_budget_ms; /*!< Longest a command may be held up by waking the modem */
+    uint32_t rearm_ms;          /*!< Kept awake this long before sleeping is tried again, 0 until reset */
+} esp_modem_sleep_config_t;
+
+/**
+ * @brief Sleep manager configuration from Kconfig
+ *
+ */
+#define ESP_MODEM_SLEEP_DEFAULT_CONFIG()                                   \
+    {                                                                      \
+        .dtr_io_num = CONFIG_EXAMPLE_MODEM_DTR,                            \
+        .ri_io_num = CONFIG_EXAMPLE_MODEM_RI,                              \
+        .idle_ms = CONFIG_EXAMPLE_MODEM_SLEEP_IDLE,                        \
+        .settle_ms = CONFIG_EXAMPLE_MODEM_SLEEP_SETTLE,                    \
+        .latency_budget_ms = CONFIG_EXAMPLE_MODEM_SLEEP_LATENCY_BUDGET,    \
+        .rearm_ms = CONFIG_EXAMPLE_MODEM_SLEEP_REARM                       \
+    }
+
+/**
+ * @brief Counters of the sleep manager
+ *
+ */
+typedef struct {
+    bool asleep;            /*!< DTR is high and the modem sleeps */
+    bool disabled;          /*!< Wake-ups broke the budget, the modem is kept awake */
+    uint32_t rearm_in_ms;   /*!< While disabled, time until sleeping is tried again, 0 if only a reset does */
+    uint32_t rearms;        /*!< Times sleeping was tried again after being disabled */
+    uint32_t sleeps;        /*!< Times the modem was put to sleep */
+    uint32_t refused;       /*!< Times the modem did not take the sleep command */
+    uint32_t wakes;         /*!< Times a command woke the modem */
+    uint32_t last_wake_ms;  /*!< From DTR low to the modem answering, last wake-up */
+    uint32_t max_wake_ms;   /*!< Longest wake-up */
+    uint32_t over_budget;   /*!< Wake-ups longer than the budget */
+    uint32_t urcs_asleep;   /*!< Lines the modem sent while it was meant to sleep, RING or SMS */
+    uint64_t asleep_us;     /*!< Time asleep, the current stretch included */
+    uint64_t awake_us;      /*!< Time awake since the manager was enabled */
+} esp_modem_sleep_stats_t;
+
+/**
+ * @brief Supply currents for the energy estimate, Unit: microampere and millivolt
+ *
+ */
+typedef struct {
+    uint32_t modem_sleep_ua; /*!< Modem in DTR sleep, registered */
+    uint32_t modem_idle_ua;  /*!< Modem awake and registered, no call or data */
+    uint32_t chip_sleep_ua;  /*!< ESP32 in light sleep */
+    uint32_t chip_awake_ua;  /*!< ESP32 running, radios off */
+    uint32_t modem_mv;       /*!< Modem supply */
+    uint32_t chip_mv;        /*!< ESP32 supply */
+} esp_modem_sleep_power_t;
+
+/**
+ * @brief Supply currents from Kconfig
+ *
+ */
+#define ESP_MODEM_SLEEP_DEFAULT_POWER()                                    \
+    {                                                                      \
+        .modem_sleep_ua = CONFIG_EXAMPLE_MODEM_SLEEP_CURRENT,              \
+        .modem_idle_ua = CONFIG_EXAMPLE_MODEM_IDLE_CURRENT,                \
+        .chip_sleep_ua = CONFIG_EXAMPLE_CHIP_SLEEP_CURRENT,                \
+        .chip_awake_ua = CONFIG_EXAMPLE_CHIP_AWAKE_CURRENT,                \
+        .modem_mv = CONFIG_EXAMPLE_MODEM_SUPPLY_MV,                        \
+        .chip_mv = CONFIG_EXAMPLE_CHIP_SUPPLY_MV                           \
+    }
+
+/**
+ * @brief Put the modem to sleep while the command channel is idle
+ *
+ * After idle_ms without a command in command mode, a task takes the channel at
+ * ESP_MODEM_PRIORITY_BACKGROUND, sends the model's sleep command (AT+CSCLK=1 on the
+ * SIM800) and raises DTR. The next command first pulls DTR low, waits settle_ms and
+ * probes with AT, the time until the answer being the wake-up latency. A wake-up over
+ * the budget is counted, and after three in a row the modem is kept awake for rearm_ms,
+ * twice as long each time the wake-ups are still slow afterwards, up to 16 times rearm_ms.
+ * Resetting the counters lets it sleep again at once. The PPP session, if any, keeps the
+ * modem awake.
+ *
+ * With CONFIG_PM_ENABLE the manager holds a no light sleep lock while the modem is
+ * awake, since the UART loses what arrives during light sleep, and lets the chip sleep
+ * otherwise. RI, if wired, wakes the chip and keeps it awake for idle_ms so that the
+ * URC behind it is read. The manager is stopped and freed with the DCE.
+ *
+ * @param dce Modem DCE object
+ * @param config pins and timings, copied
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is wrong or the budget is below settle_ms
+ *      - ESP_ERR_INVALID_STATE if the manager is already enabled
+ *      - ESP_ERR_NOT_SUPPORTED if the model cannot sleep on DTR
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_sleep_enable(modem_dce_t *dce, const esp_modem_sleep_config_t *config);
+
+/**
+ * @brief Wake the modem if it sleeps, called by esp_modem_dce_command() with the channel held
+ *
+ * Does nothing when sleep is NULL.
+ *
+ * @param sleep sleep manager of the DCE
+ */
+void esp_modem_sleep_command_begin(esp_modem_sleep_t *sleep);
+
+/**
+ * @brief Restart the idle time, called by esp_modem_dce_command()
+ *
+ * Does nothing when sleep is NULL.
+ *
+ * @param sleep sleep manager of the DCE
+ */
+void esp_modem_sleep_command_end(esp_modem_sleep_t *sleep);
+
+/**
+ * @brief Whether the modem sleeps, so that its silence is expected
+ *
+ * @param dce Modem DCE object
+ * @return true if the manager put the modem to sleep
+ */
+bool esp_modem_sleep_is_asleep(modem_dce_t *dce);
+
+/**
+ * @brief Copy the counters
+ *
+ * @param dce Modem DCE object
+ * @param stats where to copy them
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the manager is not enabled
+ */
+esp_err_t esp_modem_sleep_get_stats(modem_dce_t *dce, esp_modem_sleep_stats_t *stats);
+
+/**
+ * @brief Clear the counters, and let the modem sleep again at once after budget violations
+ *
+ * @param dce Modem DCE object
+ */
+void esp_modem_sleep_reset_stats(modem_dce_t *dce);
+
+/**
+ * @brief Estimate the energy used over the time the counters cover
+ *
+ * @param stats counters
+ * @param power supply currents
+ * @param chip_sleep the ESP32 sleeps while the modem does, as with CONFIG_PM_ENABLE
+ * @return energy in microjoule
+ */
+uint64_t esp_modem_sleep_energy_uj(const esp_modem_sleep_stats_t *stats, const esp_modem_sleep_power_t *power,
+                                   bool chip_sleep);
+
+/**
+ * @brief Estimate the energy both would use over the same time, always awake
+ *
+ * @param stats counters
+ * @param power supply currents
+ * @return energy in microjoule
+ */
+uint64_t esp_modem_sleep_awake_energy_uj(const esp_modem_sleep_stats_t *stats, const esp_modem_sleep_power_t *power);
+
+#ifdef __cplusplus
+}
+#endif
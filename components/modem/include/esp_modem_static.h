@@ -0,0 +1,75 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+/**
+ * @brief Objects in a static array instead of the heap, one slot per modem
+ *
+ * With CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION the DTE, the DCE and everything they create
+ * take a slot of a pool instead of calling calloc(), and their tasks, semaphores and
+ * event groups use the xxxCreateStatic() variants with the memory kept in that slot.
+ * Starting and stopping a modem then leaves the heap as it was.
+ */
+typedef struct {
+    portMUX_TYPE lock;  /*!< Protects used */
+    uint32_t used;      /*!< Bit per slot */
+    void *slots;        /*!< The array */
+    size_t size;        /*!< Bytes per slot */
+    size_t count;       /*!< Slots in the array, up to 32 */
+} esp_modem_static_pool_t;
+
+/**
+ * @brief Slots of every pool, enough for all modems to run at the same time
+ *
+ */
+#define ESP_MODEM_STATIC_SLOTS CONFIG_EXAMPLE_MODEM_INSTANCES
+
+/**
+ * @brief Define a pool of ESP_MODEM_STATIC_SLOTS objects of a type, in the file using it
+ *
+ */
+#define ESP_MODEM_STATIC_POOL(name, type)                                                     \
+    static type name##_slots[ESP_MODEM_STATIC_SLOTS];                                         \
+    static esp_modem_static_pool_t name = {                                                   \
+        portMUX_INITIALIZER_UNLOCKED, 0, name##_slots, sizeof(type), ESP_MODEM_STATIC_SLOTS   \
+    }
+
+/**
+ * @brief Take a free slot, the way calloc() would
+ *
+ * @param pool Pool defined by ESP_MODEM_STATIC_POOL()
+ * @return The slot, zeroed, or NULL if every slot is in use
+ */
+void *esp_modem_static_calloc(esp_modem_static_pool_t *pool);
+
+/**
+ * @brief Give a slot back, the way free() would
+ *
+ * @param pool Pool the slot was taken from
+ * @param object The slot, NULL is ignored
+ */
+void esp_modem_static_free(esp_modem_static_pool_t *pool, void *object);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,170 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Latencies of the AT commands of one modem, per command verb
+ *
+ * The verb is the name of the command without prefix, parameters or suffix: "+COPS" for
+ * "AT+COPS?", "&W" for "AT&W", "E" for "ATE0" and "AT" for a bare "AT". A full table makes
+ * room for a new verb by folding the least used one, the least recent among equals, into
+ * "other".
+ */
+typedef struct esp_modem_stats esp_modem_stats_t;
+
+#define ESP_MODEM_STATS_BUCKETS (68)      /*!< 4 buckets per power of two, from 1 ms up to 262 s */
+#define ESP_MODEM_STATS_VERB_LENGTH (12)  /*!< Longest verb kept, including the terminator */
+
+/**
+ * @brief How a command ended
+ *
+ */
+typedef enum {
+    ESP_MODEM_STATS_OK,      /*!< Final result OK */
+    ESP_MODEM_STATS_ERROR,   /*!< Any other final result code */
+    ESP_MODEM_STATS_TIMEOUT, /*!< No final result code in time */
+} esp_modem_stats_result_t;
+
+/**
+ * @brief Log-scale histogram of latencies, Unit: millisecond
+ *
+ * Counts are halved when one of them would overflow, which keeps the shape of the
+ * distribution.
+ */
+typedef struct {
+    uint16_t buckets[ESP_MODEM_STATS_BUCKETS]; /*!< See esp_modem_stats_bucket_limit() */
+    uint32_t max_ms;                           /*!< Largest sample */
+    uint32_t samples;                          /*!< Samples recorded */
+    uint64_t total_ms;                         /*!< Sum of the samples */
+} esp_modem_stats_histogram_t;
+
+/**
+ * @brief Everything recorded for one verb
+ *
+ */
+typedef struct {
+    char verb[ESP_MODEM_STATS_VERB_LENGTH];   /*!< Command verb */
+    uint32_t count;                           /*!< Commands sent */
+    uint32_t errors;                          /*!< Commands ending with a final result other than OK */
+    uint32_t timeouts;                        /*!< Commands without a final result in time */
+    uint32_t last_command;                    /*!< Sequence number of its last command, for eviction */
+    esp_modem_stats_histogram_t first_line;   /*!< Send to the first line that is not the echo */
+    esp_modem_stats_histogram_t final_result; /*!< Send to the final result code, timeouts left out */
+} esp_modem_stats_verb_t;
+
+/**
+ * @brief Create the statistics of a modem
+ *
+ * @param verbs number of verbs with their own entry
+ * @return esp_modem_stats_t* statistics, NULL on allocation failure
+ */
+esp_modem_stats_t *esp_modem_stats_create(size_t verbs);
+
+/**
+ * @brief Delete the statistics of a modem
+ *
+ * @param stats statistics, may be NULL
+ */
+void esp_modem_stats_delete(esp_modem_stats_t *stats);
+
+/**
+ * @brief Note that a command is about to be sent, called with the command channel held
+ *
+ * This and the other recording functions do nothing when stats is NULL.
+ *
+ * @param stats statistics
+ */
+void esp_modem_stats_begin(esp_modem_stats_t *stats);
+
+/**
+ * @brief Note a line received while the command runs, only the first one not echoing the command counts
+ *
+ * @param stats statistics
+ * @param line received line
+ */
+void esp_modem_stats_line(esp_modem_stats_t *stats, const char *line);
+
+/**
+ * @brief Record the outcome of the command started by esp_modem_stats_begin()
+ *
+ * @param stats statistics
+ * @param command command as sent
+ * @param result how it ended
+ */
+void esp_modem_stats_end(esp_modem_stats_t *stats, const char *command, esp_modem_stats_result_t result);
+
+/**
+ * @brief Copy the entry of one verb
+ *
+ * @param stats statistics
+ * @param index entry number, from 0
+ * @param verb where to copy it
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if there is no such entry
+ */
+esp_err_t esp_modem_stats_get(esp_modem_stats_t *stats, size_t index, esp_modem_stats_verb_t *verb);
+
+/**
+ * @brief Clear every entry
+ *
+ * @param stats statistics
+ */
+void esp_modem_stats_reset(esp_modem_stats_t *stats);
+
+/**
+ * @brief Get a percentile of a histogram
+ *
+ * @param histogram histogram
+ * @param percent percentile, 1 to 100
+ * @return uint32_t upper end of the bucket holding it, never above max_ms, 0 if empty
+ */
+uint32_t esp_modem_stats_percentile(const esp_modem_stats_histogram_t *histogram, uint32_t percent);
+
+/**
+ * @brief Get the end of a bucket
+ *
+ * @param bucket bucket index
+ * @return uint32_t smallest latency in ms above the bucket
+ */
+uint32_t esp_modem_stats_bucket_limit(size_t bucket);
+
+/**
+ * @brief Write every entry as one JSON object
+ *
+ * Each histogram is written as percentiles plus its non-empty buckets as [limit, count]
+ * pairs, so exports of several devices can be merged bucket by bucket.
+ *
+ * @param stats statistics
+ * @param device identifier of the device, for example the IMEI
+ * @param fp where to write
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if out of memory
+ *      - ESP_FAIL if writing failed
+ */
+esp_err_t esp_modem_stats_write_json(esp_modem_stats_t *stats, const char *device, FILE *fp);
+
+#ifdef __cplusplus
+}
+#endif
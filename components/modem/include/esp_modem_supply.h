@@ -0,0 +1,196 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_modem_dce.h"
+
+/**
+ * @brief What the governor lets through, each level holding back more than the one before
+ *
+ */
+typedef enum {
+    ESP_MODEM_SUPPLY_NORMAL = 0, /*!< Supply fine, nothing held back */
+    ESP_MODEM_SUPPLY_THROTTLE,   /*!< Uplink paced to short bursts */
+    ESP_MODEM_SUPPLY_PAUSE,      /*!< PPP closed until the supply recovers */
+    ESP_MODEM_SUPPLY_LEVEL_MAX
+} esp_modem_supply_level_t;
+
+/**
+ * @brief Policy of the governor, Unit: millivolt, millisecond and byte
+ *
+ * Readings at or below throttle_mv, or at or above over_mv, pace the uplink; at or below
+ * pause_mv PPP is closed. Only readings from resume_mv up to below over_mv, for hold_ms
+ * in a row, bring the governor back to normal, so that a supply hovering around a
+ * threshold does not toggle it.
+ */
+typedef struct {
+    uint32_t throttle_mv;   /*!< Pace the uplink at or below */
+    uint32_t pause_mv;      /*!< Close PPP at or below, under throttle_mv */
+    uint32_t resume_mv;     /*!< Back to normal at or above, over throttle_mv */
+    uint32_t over_mv;       /*!< Pace the uplink at or above, over resume_mv */
+    uint32_t hold_ms;       /*!< How long readings must allow resuming */
+    uint32_t poll_ms;       /*!< AT+CBC interval in command mode while normal */
+    uint32_t alarm_poll_ms; /*!< AT+CBC interval while throttled or paused */
+    uint32_t ppp_check_ms;  /*!< Close PPP this often for a reading while throttled, never 0 */
+    uint32_t uplink_rate;   /*!< Uplink bytes/s while throttled */
+    uint32_t uplink_burst;  /*!< Uplink bytes sent back to back before the rate applies */
+} esp_modem_supply_config_t;
+
+/**
+ * @brief Governor policy from Kconfig
+ *
+ */
+#define ESP_MODEM_SUPPLY_DEFAULT_CONFIG()                                  \
+    {                                                                      \
+        .throttle_mv = CONFIG_EXAMPLE_MODEM_SUPPLY_THROTTLE_MV,            \
+        .pause_mv = CONFIG_EXAMPLE_MODEM_SUPPLY_PAUSE_MV,                  \
+        .resume_mv = CONFIG_EXAMPLE_MODEM_SUPPLY_RESUME_MV,                \
+        .over_mv = CONFIG_EXAMPLE_MODEM_SUPPLY_OVER_MV,                    \
+        .hold_ms = CONFIG_EXAMPLE_MODEM_SUPPLY_HOLD,                       \
+        .poll_ms = CONFIG_EXAMPLE_MODEM_SUPPLY_POLL,                       \
+        .alarm_poll_ms = CONFIG_EXAMPLE_MODEM_SUPPLY_ALARM_POLL,           \
+        .ppp_check_ms = CONFIG_EXAMPLE_MODEM_SUPPLY_PPP_CHECK,             \
+        .uplink_rate = CONFIG_EXAMPLE_MODEM_SUPPLY_UPLINK_RATE,            \
+        .uplink_burst = CONFIG_EXAMPLE_MODEM_SUPPLY_UPLINK_BURST           \
+    }
+
+/**
+ * @brief Counters of the governor
+ *
+ */
+typedef struct {
+    esp_modem_supply_level_t level; /*!< Current level */
+    uint32_t last_mv;               /*!< Last AT+CBC reading, 0 before the first */
+    uint32_t min_mv;                /*!< Lowest reading */
+    uint32_t max_mv;                /*!< Highest reading */
+    uint32_t readings;              /*!< AT+CBC answered */
+    uint32_t under_urcs;            /*!< UNDER-VOLTAGE lines */
+    uint32_t over_urcs;             /*!< OVER-VOLTAGE lines */
+    uint32_t throttles;             /*!< Times the uplink started to be paced */
+    uint32_t pauses;                /*!< Times PPP was closed for the supply */
+    uint32_t resumes;               /*!< Times a closed PPP session was opened again */
+    uint32_t ppp_checks;            /*!< Times PPP was closed for a reading */
+    uint64_t paced_bytes;           /*!< Uplink bytes sent while not normal */
+    uint32_t dropped_frames;        /*!< Uplink frames dropped over the rate */
+    uint64_t dropped_bytes;         /*!< Bytes of those frames refused */
+    uint64_t throttled_us;          /*!< Time throttled, the current stretch included */
+    uint64_t paused_us;             /*!< Time paused, the current stretch included */
+} esp_modem_supply_stats_t;
+
+/**
+ * @brief Govern the transmissions of a DCE by the state of its supply
+ *
+ * A task reads the supply with AT+CBC at ESP_MODEM_PRIORITY_BACKGROUND, every poll_ms
+ * while the supply is fine and every alarm_poll_ms otherwise, and the UNDER-VOLTAGE and
+ * OVER-VOLTAGE URCs of the SIM800 raise the level at once: a warning throttles, a power
+ * down notice pauses. Throttled, the PPP uplink is paced to uplink_rate in bursts of
+ * uplink_burst bytes: an IP frame over the rate is dropped, never waited for on the lwIP
+ * thread, and TCP backs off. The frames that keep the session up are never dropped. Paused, PPP is closed,
+ * and kept closed should someone open it, until the supply allows resuming; a session
+ * the governor closed is then opened again.
+ *
+ * In PPP mode the modem neither sends URCs nor takes AT+CBC. Once a reading or a URC has
+ * throttled the uplink, every ppp_check_ms the session is closed for a reading and opened
+ * again unless the supply calls for a pause; each check drops every socket and may change
+ * the address. Without it a throttle that began before PPP would never end, so it cannot
+ * be 0. With a normal supply PPP is left alone.
+ * The governor is stopped and freed with the DCE.
+ *
+ * @param dce Modem DCE object
+ * @param config policy, copied
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is wrong, the thresholds are out of order or ppp_check_ms is 0
+ *      - ESP_ERR_INVALID_STATE if the governor is already enabled
+ *      - ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t esp_modem_supply_enable(modem_dce_t *dce, const esp_modem_supply_config_t *config);
+
+/**
+ * @brief Change the policy of a running governor
+ *
+ * @param dce Modem DCE object
+ * @param config policy, copied
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the thresholds are out of order or ppp_check_ms is 0
+ *      - ESP_ERR_INVALID_STATE if the governor is not enabled
+ */
+esp_err_t esp_modem_supply_set_config(modem_dce_t *dce, const esp_modem_supply_config_t *config);
+
+/**
+ * @brief Copy the policy of a running governor
+ *
+ * @param dce Modem DCE object
+ * @param config where to copy it
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the governor is not enabled
+ */
+esp_err_t esp_modem_supply_get_config(modem_dce_t *dce, esp_modem_supply_config_t *config);
+
+/**
+ * @brief Whether a chunk of the PPP uplink may go, called by the PPP output of the DTE
+ *
+ * Never blocks, it runs on the lwIP thread. Only the first chunk of an IP frame is refused,
+ * the rest of a frame already started is let through, and LCP, IPCP and PAP frames always go.
+ *
+ * @param supply governor of the DCE, NULL lets everything through
+ * @param data chunk about to be sent
+ * @param len bytes of data
+ * @return true to send the chunk, false to drop the frame
+ */
+bool esp_modem_supply_uplink(esp_modem_supply_t *supply, const uint8_t *data, size_t len);
+
+/**
+ * @brief Current level, for an application that wants to defer its own bursts
+ *
+ * @param dce Modem DCE object
+ * @return level, ESP_MODEM_SUPPLY_NORMAL if the governor is not enabled
+ */
+esp_modem_supply_level_t esp_modem_supply_get_level(modem_dce_t *dce);
+
+/**
+ * @brief Copy the counters
+ *
+ * @param dce Modem DCE object
+ * @param stats where to copy them
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the governor is not enabled
+ */
+esp_err_t esp_modem_supply_get_stats(modem_dce_t *dce, esp_modem_supply_stats_t *stats);
+
+/**
+ * @brief Clear the counters, the level and the readings behind it stay
+ *
+ * @param dce Modem DCE object
+ */
+void esp_modem_supply_reset_stats(modem_dce_t *dce);
+
+/**
+ * @brief Name of a level, for logs and the console
+ *
+ * @param level governor level
+ * @return const char* level name
+ */
+const char *esp_modem_supply_level_name(esp_modem_supply_level_t level);
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,6 +19,8 @@ extern "C" {
 
 #include "esp_modem_dce_service.h"
 #include "esp_modem.h"
+#include "esp_modem_driver.h"
+#include "sdkconfig.h"
 
 typedef enum {
     MODEM_DISCONNECTED=0, /*!< In processing */
@@ -30,30 +32,174 @@ typedef enum {
     DCE_READY,    
 } modem_status_t;
 
+/**
+ * @brief Milestones of the SIM800 boot sequence, in the order they are usually reached
+ *
+ */
+typedef enum {
+    SIM800_BOOT_PHASE_POWER_ON = 0, /*!< PWKEY pulse started */
+    SIM800_BOOT_PHASE_PWKEY_DONE,   /*!< PWKEY released */
+    SIM800_BOOT_PHASE_RDY,          /*!< "RDY" received */
+    SIM800_BOOT_PHASE_SYNC,         /*!< First "AT" answered */
+    SIM800_BOOT_PHASE_CFUN,         /*!< "+CFUN: 1" received */
+    SIM800_BOOT_PHASE_CONFIGURED,   /*!< Init strings applied */
+    SIM800_BOOT_PHASE_CALL_READY,   /*!< "Call Ready" received */
+    SIM800_BOOT_PHASE_REGISTERED,   /*!< "+CREG: 1" or "+CREG: 5" seen */
+    SIM800_BOOT_PHASE_MAX
+} sim800_boot_phase_t;
+
+
+/**
+ * @brief SIM800 pins and instance
+ *
+ */
+typedef struct {
+    uint8_t instance; /*!< Index of the modem, below CONFIG_EXAMPLE_MODEM_INSTANCES. Selects its NVS namespace and boot timeline */
+    int pwkey_io_num; /*!< PWKEY pin */
+    int rst_io_num;   /*!< RST pin */
+    int power_io_num; /*!< Pin switching the modem power supply */
+} sim800_config_t;
+
+/**
+ * @brief SIM800 Default Configuration, the first modem
+ *
+ */
+#define SIM800_DEFAULT_CONFIG()                          \
+    {                                                    \
+        .instance = 0,                                   \
+        .pwkey_io_num = CONFIG_EXAMPLE_UART_MODEM_PWKEY, \
+        .rst_io_num = CONFIG_EXAMPLE_UART_MODEM_RST,     \
+        .power_io_num = CONFIG_EXAMPLE_UART_MODEM_POWER  \
+    }
+
+/**
+ * @brief Driver for esp_modem_driver_register(), matches "SIM800" models
+ *
+ */
+extern const esp_modem_driver_t sim800_driver;
 
 /**
  * @brief Create and initialize SIM800 object
  *
  * @param dte Modem DTE object
+ * @param config pins and instance of the modem, the same as given to sim800_power_on()
  * @return modem_dce_t* Modem DCE object
  */
-modem_dce_t *sim800_init(modem_dte_t *dte);
+modem_dce_t *sim800_init(modem_dte_t *dte, const sim800_config_t *config);
 void sim800_set_default_line_handler(modem_dce_t *dce);
 esp_err_t sim800_at(modem_dce_t *dce, const char *at_command,uint16_t timeout);
 esp_err_t sim800_send_raw(modem_dce_t *dce, const char *line, uint16_t timeout);
-void sim800_power_on();
-void sim800_power_off();
 
-#define _NUMARGS(...) (sizeof((void *[]){0, ##__VA_ARGS__})/sizeof(void *)-1)
+/**
+ * @brief Apply the modem configuration
+ *
+ * Settings stored in the modem's profile are only sent (and saved with AT&W) when
+ * their fingerprint differs from the one kept in NVS, or the modem lost its profile.
+ * Settings that do not survive a power cycle are always sent.
+ *
+ * @param dce Modem DCE object
+ * @param force true to resend and store the whole profile regardless of the fingerprint
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL if any setting failed
+ */
+esp_err_t sim800_configure(modem_dce_t *dce, bool force);
+
+/**
+ * @brief Step the link up to the highest baud rate that passes an integrity check
+ *
+ * Each rate is set with AT+IPR, then the DTE UART follows and the IMEI is read back
+ * repeatedly to check the link and measure its throughput. A rate that fails is rolled
+ * back and ends the negotiation. The rate reached is persisted and restored on the next start.
+ *
+ * @param dce Modem DCE object
+ * @param max_baud_rate highest rate to try
+ * @return esp_err_t
+ *      - ESP_OK on success, also when the link stays at its current rate
+ *      - ESP_FAIL on error
+ */
+esp_err_t sim800_negotiate_baud(modem_dce_t *dce, uint32_t max_baud_rate);
 
 /**
- * Scanf a response and return -1 if it fails.
+ * @brief Move the link to a given baud rate, rolling back if it does not pass the integrity check
+ *
+ * @param dce Modem DCE object
+ * @param baud_rate new baud rate, one of the rates accepted by AT+IPR
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
  */
-#define at_simple_scanf(_response, format, ...)                             \
-    do {                                                                    \
-        if (!_response)                                                     \
-            return -1; /* timeout */                                        \
-        if (sscanf(_response, format, __VA_ARGS__) != _NUMARGS(__VA_ARGS__)) { \
-            return -1;                                                      \
-        }                                                                   \
-    } while (0)
+esp_err_t sim800_set_baud(modem_dce_t *dce, uint32_t baud_rate);
+
+/**
+ * @brief Result of sim800_soak_test()
+ *
+ */
+typedef struct {
+    uint32_t rounds;        /*!< Rounds completed */
+    uint32_t failed;        /*!< Rounds without a final OK */
+    uint32_t mismatched;    /*!< Rounds whose length differed from the first one */
+    uint32_t expected;      /*!< Bytes per round */
+    uint32_t bytes;         /*!< Bytes received in completed rounds */
+    uint32_t overruns;      /*!< FIFO and pattern queue overflows during the test */
+    uint32_t bytes_dropped; /*!< Bytes the DTE threw away during the test */
+    uint32_t elapsed_ms;    /*!< Duration of the test */
+} sim800_soak_result_t;
+
+/**
+ * @brief Pull large responses over the link back to back and check nothing was lost
+ *
+ * @param dce Modem DCE object
+ * @param rounds number of AT+CLAC round trips
+ * @param result filled with the counters of the test
+ * @return esp_err_t
+ *      - ESP_OK if every round was complete and no data was dropped
+ *      - ESP_FAIL otherwise
+ */
+esp_err_t sim800_soak_test(modem_dce_t *dce, uint32_t rounds, sim800_soak_result_t *result);
+
+/**
+ * @brief Ask for module name, IMEI, IMSI and operator to be queried again in the background
+ *
+ * The cached values in the DCE stay available meanwhile and are persisted to NVS when they change.
+ * Asked during PPP, the refresh runs once the modem is back in command mode.
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+esp_err_t sim800_refresh_identity(modem_dce_t *dce);
+
+/**
+ * @brief Check whether the modem is registered on the network, as last reported by +CREG
+ *
+ * @param dce Modem DCE object
+ * @return true if registered (home or roaming)
+ */
+bool sim800_is_registered(modem_dce_t *dce);
+
+/**
+ * @brief Power the modem and start the PWKEY pulse
+ *
+ * Returns as soon as the pulse has started, so the DTE can be set up while
+ * the modem boots. sim800_init() then waits for the boot URCs.
+ *
+ * @param config pins and instance of the modem
+ */
+void sim800_power_on(const sim800_config_t *config);
+void sim800_power_off(const sim800_config_t *config);
+
+/**
+ * @brief Get the time at which each boot phase was reached
+ *
+ * @param instance modem instance
+ * @param timeline filled with milliseconds since sim800_power_on(), -1 for phases not reached
+ */
+void sim800_get_boot_timeline(uint8_t instance, int32_t timeline[SIM800_BOOT_PHASE_MAX]);
+
+/**
+ * @brief Get a printable name of a boot phase
+ */
+const char *sim800_boot_phase_name(sim800_boot_phase_t phase);
+
@@ -15,6 +15,7 @@
 #include <string.h>
 #include "esp_log.h"
 #include "bg96.h"
+#include "esp_modem_static.h"
 
 #define MODEM_RESULT_CODE_POWERDOWN "POWERED DOWN"
 
@@ -38,384 +39,35 @@ static const char *DCE_TAG = "bg96";
  *
  */
 typedef struct {
-    void *priv_resource; /*!< Private resource */
     modem_dce_t parent;  /*!< DCE parent class */
 } bg96_modem_dce_t;
 
-/**
- * @brief Handle response from AT+CSQ
- */
-static esp_err_t bg96_handle_csq(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    bg96_modem_dce_t *bg96_dce = __containerof(dce, bg96_modem_dce_t, parent);
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    } else if (!strncmp(line, "+CSQ", strlen("+CSQ"))) {
-        /* store value of rssi and ber */
-        uint32_t **csq = bg96_dce->priv_resource;
-        /* +CSQ: <rssi>,<ber> */
-        sscanf(line, "%*s%d,%d", csq[0], csq[1]);
-        err = ESP_OK;
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from AT+CBC
- */
-static esp_err_t bg96_handle_cbc(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    bg96_modem_dce_t *bg96_dce = __containerof(dce, bg96_modem_dce_t, parent);
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    } else if (!strncmp(line, "+CBC", strlen("+CBC"))) {
-        /* store value of bcs, bcl, voltage */
-        uint32_t **cbc = bg96_dce->priv_resource;
-        /* +CBC: <bcs>,<bcl>,<voltage> */
-        sscanf(line, "%*s%d,%d,%d", cbc[0], cbc[1], cbc[2]);
-        err = ESP_OK;
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from +++
- */
-static esp_err_t bg96_handle_exit_data_mode(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_NO_CARRIER)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from ATD*99#
- */
-static esp_err_t bg96_handle_atd_ppp(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_CONNECT)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from AT+CGMM
- */
-static esp_err_t bg96_handle_cgmm(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    } else {
-        int len = snprintf(dce->name, MODEM_MAX_NAME_LENGTH, "%s", line);
-        if (len > 2) {
-            /* Strip "\r\n" */
-            strip_cr_lf_tail(dce->name, len);
-            err = ESP_OK;
-        }
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from AT+CGSN
- */
-static esp_err_t bg96_handle_cgsn(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    } else {
-        int len = snprintf(dce->imei, MODEM_IMEI_LENGTH + 1, "%s", line);
-        if (len > 2) {
-            /* Strip "\r\n" */
-            strip_cr_lf_tail(dce->imei, len);
-            err = ESP_OK;
-        }
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from AT+CIMI
- */
-static esp_err_t bg96_handle_cimi(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    } else {
-        int len = snprintf(dce->imsi, MODEM_IMSI_LENGTH + 1, "%s", line);
-        if (len > 2) {
-            /* Strip "\r\n" */
-            strip_cr_lf_tail(dce->imsi, len);
-            err = ESP_OK;
-        }
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from AT+COPS?
- */
-static esp_err_t bg96_handle_cops(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    } else if (!strncmp(line, "+COPS", strlen("+COPS"))) {
-        /* there might be some random spaces in operator's name, we can not use sscanf to parse the result */
-        /* strtok will break the string, we need to create a copy */
-        size_t len = strlen(line);
-        char *line_copy = malloc(len + 1);
-        strcpy(line_copy, line);
-        /* +COPS: <mode>[, <format>[, <oper>]] */
-        char *str_ptr = NULL;
-        char *p[3];
-        uint8_t i = 0;
-        /* strtok will broke string by replacing delimiter with '\0' */
-        p[i] = strtok_r(line_copy, ",", &str_ptr);
-        while (p[i]) {
-            p[++i] = strtok_r(NULL, ",", &str_ptr);
-        }
-        if (i >= 3) {
-            int len = snprintf(dce->oper, MODEM_MAX_OPERATOR_LENGTH, "%s", p[2]);
-            if (len > 2) {
-                /* Strip "\r\n" */
-                strip_cr_lf_tail(dce->oper, len);
-                err = ESP_OK;
-            }
-        }
-        free(line_copy);
-    }
-    return err;
-}
-
-/**
- * @brief Handle response from AT+QPOWD=1
- */
-static esp_err_t bg96_handle_power_down(modem_dce_t *dce, const char *line)
-{
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
-        err = ESP_OK;
-    } else if (strstr(line, MODEM_RESULT_CODE_POWERDOWN)) {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    }
-    return err;
-}
-
-/**
- * @brief Get signal quality
- *
- * @param dce Modem DCE object
- * @param rssi received signal strength indication
- * @param ber bit error ratio
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_get_signal_quality(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber)
-{
-    modem_dte_t *dte = dce->dte;
-    bg96_modem_dce_t *bg96_dce = __containerof(dce, bg96_modem_dce_t, parent);
-    uint32_t *resource[2] = {rssi, ber};
-    bg96_dce->priv_resource = resource;
-    dce->handle_line = bg96_handle_csq;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CSQ\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "inquire signal quality failed", err);
-    ESP_LOGD(DCE_TAG, "inquire signal quality ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
-
-/**
- * @brief Get battery status
- *
- * @param dce Modem DCE object
- * @param bcs Battery charge status
- * @param bcl Battery connection level
- * @param voltage Battery voltage
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_get_battery_status(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage)
-{
-    modem_dte_t *dte = dce->dte;
-    bg96_modem_dce_t *bg96_dce = __containerof(dce, bg96_modem_dce_t, parent);
-    uint32_t *resource[3] = {bcs, bcl, voltage};
-    bg96_dce->priv_resource = resource;
-    dce->handle_line = bg96_handle_cbc;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CBC\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "inquire battery status failed", err);
-    ESP_LOGD(DCE_TAG, "inquire battery status ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
-
-/**
- * @brief Set Working Mode
- *
- * @param dce Modem DCE object
- * @param mode woking mode
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_set_working_mode(modem_dce_t *dce, modem_mode_t mode)
-{
-    modem_dte_t *dte = dce->dte;
-    switch (mode) {
-    case MODEM_COMMAND_MODE:
-        dce->handle_line = bg96_handle_exit_data_mode;
-        DCE_CHECK(dte->send_cmd(dte, "+++", MODEM_COMMAND_TIMEOUT_MODE_CHANGE) == ESP_OK, "send command failed", err);
-        DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "enter command mode failed", err);
-        ESP_LOGD(DCE_TAG, "enter command mode ok");
-        dce->mode = MODEM_COMMAND_MODE;
-        break;
-    case MODEM_PPP_MODE:
-        dce->handle_line = bg96_handle_atd_ppp;
-        DCE_CHECK(dte->send_cmd(dte, "ATD*99***1#\r", MODEM_COMMAND_TIMEOUT_MODE_CHANGE) == ESP_OK, "send command failed", err);
-        DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "enter ppp mode failed", err);
-        ESP_LOGD(DCE_TAG, "enter ppp mode ok");
-        dce->mode = MODEM_PPP_MODE;
-        break;
-    default:
-        ESP_LOGW(DCE_TAG, "unsupported working mode: %d", mode);
-        goto err;
-        break;
-    }
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
-
-/**
- * @brief Power down
- *
- * @param bg96_dce bg96 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_power_down(modem_dce_t *dce)
-{
-    modem_dte_t *dte = dce->dte;
-    dce->handle_line = bg96_handle_power_down;
-    DCE_CHECK(dte->send_cmd(dte, "AT+QPOWD=1\r", MODEM_COMMAND_TIMEOUT_POWEROFF) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "power down failed", err);
-    ESP_LOGD(DCE_TAG, "power down ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+ESP_MODEM_STATIC_POOL(s_dce_pool, bg96_modem_dce_t);
+#endif
 
 /**
- * @brief Get DCE module name
+ * @brief BG96 wording of the commands shared with the other models
  *
- * @param bg96_dce bg96 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
  */
-static esp_err_t bg96_get_module_name(bg96_modem_dce_t *bg96_dce)
-{
-    modem_dte_t *dte = bg96_dce->parent.dte;
-    bg96_dce->parent.handle_line = bg96_handle_cgmm;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CGMM\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(bg96_dce->parent.state == MODEM_STATE_SUCCESS, "get module name failed", err);
-    ESP_LOGD(DCE_TAG, "get module name ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
-
-/**
- * @brief Get DCE module IMEI number
- *
- * @param bg96_dce bg96 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_get_imei_number(bg96_modem_dce_t *bg96_dce)
-{
-    modem_dte_t *dte = bg96_dce->parent.dte;
-    bg96_dce->parent.handle_line = bg96_handle_cgsn;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CGSN\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(bg96_dce->parent.state == MODEM_STATE_SUCCESS, "get imei number failed", err);
-    ESP_LOGD(DCE_TAG, "get imei number ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
-
-/**
- * @brief Get DCE module IMSI number
- *
- * @param bg96_dce bg96 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_get_imsi_number(bg96_modem_dce_t *bg96_dce)
-{
-    modem_dte_t *dte = bg96_dce->parent.dte;
-    bg96_dce->parent.handle_line = bg96_handle_cimi;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CIMI\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(bg96_dce->parent.state == MODEM_STATE_SUCCESS, "get imsi number failed", err);
-    ESP_LOGD(DCE_TAG, "get imsi number ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
-
-/**
- * @brief Get Operator's name
- *
- * @param bg96_dce bg96 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t bg96_get_operator_name(bg96_modem_dce_t *bg96_dce)
-{
-    modem_dte_t *dte = bg96_dce->parent.dte;
-    bg96_dce->parent.handle_line = bg96_handle_cops;
-    DCE_CHECK(dte->send_cmd(dte, "AT+COPS?\r", MODEM_COMMAND_TIMEOUT_OPERATOR) == ESP_OK, "send command failed", err);
-    DCE_CHECK(bg96_dce->parent.state == MODEM_STATE_SUCCESS, "get network operator failed", err);
-    ESP_LOGD(DCE_TAG, "get network operator ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
-}
+static const esp_modem_dce_model_t bg96_model = {
+    .name = "bg96",
+    .commands = {
+        [ESP_MODEM_DCE_CMD_SIGNAL_QUALITY] = {"AT+CSQ\r", &esp_modem_format_csq, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_BATTERY_STATUS] = {"AT+CBC\r", &esp_modem_format_cbc, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_MODULE_NAME] = {"AT+CGMM\r", &esp_modem_format_name, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_IMEI] = {"AT+CGSN\r", &esp_modem_format_imei, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_IMSI] = {"AT+CIMI\r", &esp_modem_format_imsi, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_OPERATOR] = {"AT+COPS?\r", &esp_modem_format_cops, {NULL}, MODEM_COMMAND_TIMEOUT_OPERATOR},
+        [ESP_MODEM_DCE_CMD_NETWORK_STATUS] = {"AT+CREG?\r", &esp_modem_format_creg, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_COMMAND_MODE] = {"+++", NULL, {MODEM_RESULT_CODE_SUCCESS, MODEM_RESULT_CODE_NO_CARRIER}, MODEM_COMMAND_TIMEOUT_MODE_CHANGE},
+        [ESP_MODEM_DCE_CMD_PPP_MODE] = {"ATD*99***1#\r", NULL, {MODEM_RESULT_CODE_CONNECT}, MODEM_COMMAND_TIMEOUT_MODE_CHANGE},
+        [ESP_MODEM_DCE_CMD_POWER_DOWN] = {"AT+QPOWD=1\r", NULL, {MODEM_RESULT_CODE_POWERDOWN}, MODEM_COMMAND_TIMEOUT_POWEROFF},
+        [ESP_MODEM_DCE_CMD_RADIO_OFF] = {"AT+CFUN=0\r", NULL, {NULL}, MODEM_COMMAND_TIMEOUT_RADIO},
+        [ESP_MODEM_DCE_CMD_RADIO_ON] = {"AT+CFUN=1\r", NULL, {NULL}, MODEM_COMMAND_TIMEOUT_RADIO},
+        [ESP_MODEM_DCE_CMD_SLEEP_ON_DTR] = {"AT+QSCLK=1\r", NULL, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+    },
+};
 
 /**
  * @brief Deinitialize BG96 object
@@ -431,47 +83,67 @@ static esp_err_t bg96_deinit(modem_dce_t *dce)
     if (dce->dte) {
         dce->dte->dce = NULL;
     }
+    esp_modem_dce_unbind(dce);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_dce_pool, bg96_dce);
+#else
     free(bg96_dce);
+#endif
     return ESP_OK;
 }
 
 modem_dce_t *bg96_init(modem_dte_t *dte)
 {
     DCE_CHECK(dte, "DCE should bind with a DTE", err);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    bg96_modem_dce_t *bg96_dce = esp_modem_static_calloc(&s_dce_pool);
+    DCE_CHECK(bg96_dce, "no static slot for bg96_dce", err);
+#else
     /* malloc memory for bg96_dce object */
     bg96_modem_dce_t *bg96_dce = calloc(1, sizeof(bg96_modem_dce_t));
     DCE_CHECK(bg96_dce, "calloc bg96_dce failed", err);
+#endif
     /* Bind DTE with DCE */
     bg96_dce->parent.dte = dte;
     dte->dce = &(bg96_dce->parent);
     /* Bind methods */
+    DCE_CHECK(esp_modem_dce_bind(&(bg96_dce->parent), &bg96_model) == ESP_OK, "bind bg96 model failed", err_io);
     bg96_dce->parent.handle_line = NULL;
-    bg96_dce->parent.sync = esp_modem_dce_sync;
-    bg96_dce->parent.echo_mode = esp_modem_dce_echo;
-    bg96_dce->parent.store_profile = esp_modem_dce_store_profile;
-    bg96_dce->parent.set_flow_ctrl = esp_modem_dce_set_flow_ctrl;
-    bg96_dce->parent.define_pdp_context = esp_modem_dce_define_pdp_context;
-    bg96_dce->parent.hang_up = esp_modem_dce_hang_up;
-    bg96_dce->parent.get_signal_quality = bg96_get_signal_quality;
-    bg96_dce->parent.get_battery_status = bg96_get_battery_status;
-    bg96_dce->parent.set_working_mode = bg96_set_working_mode;
-    bg96_dce->parent.power_down = bg96_power_down;
     bg96_dce->parent.deinit = bg96_deinit;
     /* Sync between DTE and DCE */
     DCE_CHECK(esp_modem_dce_sync(&(bg96_dce->parent)) == ESP_OK, "sync failed", err_io);
     /* Close echo */
     DCE_CHECK(esp_modem_dce_echo(&(bg96_dce->parent), false) == ESP_OK, "close echo mode failed", err_io);
     /* Get Module name */
-    DCE_CHECK(bg96_get_module_name(bg96_dce) == ESP_OK, "get module name failed", err_io);
+    DCE_CHECK(esp_modem_dce_get_module_name(&(bg96_dce->parent)) == ESP_OK, "get module name failed", err_io);
     /* Get IMEI number */
-    DCE_CHECK(bg96_get_imei_number(bg96_dce) == ESP_OK, "get imei failed", err_io);
+    DCE_CHECK(esp_modem_dce_get_imei_number(&(bg96_dce->parent)) == ESP_OK, "get imei failed", err_io);
     /* Get IMSI number */
-    DCE_CHECK(bg96_get_imsi_number(bg96_dce) == ESP_OK, "get imsi failed", err_io);
+    DCE_CHECK(esp_modem_dce_get_imsi_number(&(bg96_dce->parent)) == ESP_OK, "get imsi failed", err_io);
     /* Get operator name */
-    DCE_CHECK(bg96_get_operator_name(bg96_dce) == ESP_OK, "get operator name failed", err_io);
+    DCE_CHECK(esp_modem_dce_get_operator_name(&(bg96_dce->parent)) == ESP_OK, "get operator name failed", err_io);
     return &(bg96_dce->parent);
 err_io:
+    dte->dce = NULL;
+    esp_modem_dce_unbind(&(bg96_dce->parent));
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_dce_pool, bg96_dce);
+#else
     free(bg96_dce);
+#endif
 err:
     return NULL;
 }
+
+static modem_dce_t *bg96_driver_init(modem_dte_t *dte, const void *config)
+{
+    return bg96_init(dte);
+}
+
+static const char *const bg96_models[] = {"BG96", NULL};
+
+const esp_modem_driver_t bg96_driver = {
+    .name = "bg96",
+    .models = bg96_models,
+    .init = bg96_driver_init,
+};
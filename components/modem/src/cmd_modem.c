@@ -1,11 +1,27 @@
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/event_groups.h"
 
 #include "mqtt_client.h"
 #include "esp_modem.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "sim800.h"
 #include "bg96.h"
+#include "esp_modem_link.h"
+#include "esp_modem_cache.h"
+#include "esp_modem_health.h"
+#include "esp_modem_script.h"
+#include "esp_modem_shutdown.h"
+#include "esp_modem_sleep.h"
+#include "esp_modem_supply.h"
+#include "esp_modem_stats.h"
+#include "esp_modem_capture.h"
+#include "esp_modem_pool.h"
 
 #include "esp_console.h"
 #include "argtable3/argtable3.h"
@@ -20,6 +36,22 @@ static const int GOT_DATA_BIT = BIT2;
 
 static const char *TAG = "modem_cmd";
 
+/**
+ * @brief One modem with its own UART, pins and DTE/DCE pair
+ *
+ */
+typedef struct
+{
+    esp_modem_dte_config_t dte_config; /*!< UART port and pins */
+    sim800_config_t sim800_config;     /*!< Power pins and instance index */
+    modem_dte_t *dte;                  /*!< DTE, NULL while stopped */
+    modem_dce_t *dce;                  /*!< DCE, NULL while stopped */
+} modem_instance_t;
+
+static modem_instance_t modems[CONFIG_EXAMPLE_MODEM_INSTANCES];
+static int selected_modem = 0;
+
+/* The selected modem, used by every command below */
 modem_dce_t *dce = NULL;
 modem_dte_t *dte = NULL;
 
@@ -28,14 +60,108 @@ static void register_stop();
 static void register_get_operator();
 static void register_at_command();
 static void register_cls();
+static void register_boot_time();
+static void register_reconfigure();
+static void register_baud();
+static void register_flow_ctrl();
+static void register_pin();
+static void register_modem_select();
+static void register_status();
+static void register_arbiter();
+#if CONFIG_EXAMPLE_MODEM_CACHE
+static void register_cache();
+#endif
+#if CONFIG_EXAMPLE_MODEM_HEALTH
+static void register_health();
+#endif
+#if CONFIG_EXAMPLE_MODEM_SLEEP
+static void register_sleep();
+#endif
+#if CONFIG_EXAMPLE_MODEM_SUPPLY
+static void register_supply();
+#endif
+#if CONFIG_EXAMPLE_MODEM_SCRIPT
+static void register_run();
+#endif
+#if CONFIG_EXAMPLE_MODEM_STATS
+static void register_modemstats();
+#endif
+#if CONFIG_EXAMPLE_MODEM_CAPTURE
+static void register_capture();
+#endif
+
+static void modem_instances_init()
+{
+    const esp_modem_dte_config_t dte_config = ESP_MODEM_DTE_DEFAULT_CONFIG();
+    const sim800_config_t sim800_config = SIM800_DEFAULT_CONFIG();
+    for (int i = 0; i < CONFIG_EXAMPLE_MODEM_INSTANCES; i++)
+    {
+        modems[i].dte_config = dte_config;
+#if CONFIG_EXAMPLE_UART_FLOW_CONTROL_HW
+        modems[i].dte_config.flow_control = MODEM_FLOW_CONTROL_HW;
+#endif
+        modems[i].sim800_config = sim800_config;
+        modems[i].sim800_config.instance = i;
+    }
+#if CONFIG_EXAMPLE_MODEM_INSTANCES > 1
+    modems[1].dte_config.port_num = UART_NUM_2;
+    modems[1].dte_config.tx_io_num = CONFIG_EXAMPLE_MODEM2_TX_PIN;
+    modems[1].dte_config.rx_io_num = CONFIG_EXAMPLE_MODEM2_RX_PIN;
+    modems[1].dte_config.rts_io_num = CONFIG_EXAMPLE_MODEM2_RTS_PIN;
+    modems[1].dte_config.cts_io_num = CONFIG_EXAMPLE_MODEM2_CTS_PIN;
+    modems[1].sim800_config.pwkey_io_num = CONFIG_EXAMPLE_MODEM2_PWKEY;
+    modems[1].sim800_config.rst_io_num = CONFIG_EXAMPLE_MODEM2_RST;
+    modems[1].sim800_config.power_io_num = CONFIG_EXAMPLE_MODEM2_POWER;
+#endif
+}
+
+/* Point the console at another modem */
+static void modem_select(int index)
+{
+    selected_modem = index;
+    dce = modems[index].dce;
+    dte = modems[index].dte;
+}
 
 void register_modem_commands()
 {
+    ESP_ERROR_CHECK(esp_modem_driver_register(&sim800_driver));
+    ESP_ERROR_CHECK(esp_modem_driver_register(&bg96_driver));
+    modem_instances_init();
     register_start();
     register_stop();
     register_get_operator();
     register_at_command();
     register_cls();
+    register_boot_time();
+    register_reconfigure();
+    register_baud();
+    register_flow_ctrl();
+    register_pin();
+    register_modem_select();
+    register_status();
+    register_arbiter();
+#if CONFIG_EXAMPLE_MODEM_CACHE
+    register_cache();
+#endif
+#if CONFIG_EXAMPLE_MODEM_HEALTH
+    register_health();
+#endif
+#if CONFIG_EXAMPLE_MODEM_SLEEP
+    register_sleep();
+#endif
+#if CONFIG_EXAMPLE_MODEM_SUPPLY
+    register_supply();
+#endif
+#if CONFIG_EXAMPLE_MODEM_SCRIPT
+    register_run();
+#endif
+#if CONFIG_EXAMPLE_MODEM_STATS
+    register_modemstats();
+#endif
+#if CONFIG_EXAMPLE_MODEM_CAPTURE
+    register_capture();
+#endif
 }
 
 static void modem_event_handler(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
@@ -70,6 +196,11 @@ static void modem_event_handler(void *event_handler_arg, esp_event_base_t event_
         xEventGroupSetBits(event_group, STOP_BIT);
         break;
 
+    case MODEM_EVENT_PPP_CLOSING:
+        ESP_LOGI(TAG, "Modem PPP Closing");
+        xEventGroupClearBits(event_group, CONNECT_BIT);
+        break;
+
     case MODEM_EVENT_UNKNOWN:
         ESP_LOGW(TAG, "Response received: %s", (char *)event_data);
         break;
@@ -125,32 +256,61 @@ static esp_err_t mqtt_event_handler(esp_mqtt_event_handle_t event)
 
 static int start_modem()
 {
-    sim800_power_on();
+    modem_instance_t *modem = &modems[selected_modem];
+    if (modem->dce != NULL)
+    {
+        printf("Modem %d already started\r\n", selected_modem);
+        return 0;
+    }
+    sim800_power_on(&modem->sim800_config);
 
     /* create dte object */
-    esp_modem_dte_config_t config = ESP_MODEM_DTE_DEFAULT_CONFIG();
-    dte = esp_modem_dte_init(&config);
+    modem->dte = esp_modem_dte_init(&modem->dte_config);
+    if (modem->dte == NULL)
+        goto err_dte;
 
     printf("data terminal read");
    
     /* Register event handler */
-    ESP_ERROR_CHECK(esp_modem_add_event_handler(dte, modem_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_modem_add_event_handler(modem->dte, modem_event_handler, NULL));
 
    
     /* create dce object */
 #if CONFIG_EXAMPLE_MODEM_DEVICE_SIM800
-    dce = sim800_init(dte);
+    modem->dce = sim800_init(modem->dte, &modem->sim800_config);
 
 #elif CONFIG_EXAMPLE_MODEM_DEVICE_BG96
-    dce = bg96_init(dte);
+    modem->dce = bg96_init(modem->dte);
 #else
-    dce = sim800_init(dte);
+    modem->dce = esp_modem_driver_init(modem->dte, &modem->sim800_config);
 #endif
-    if (dce == NULL)
+    if (modem->dce == NULL)
         goto err;
-    return 0;
-    ESP_ERROR_CHECK(dce->set_flow_ctrl(dce, MODEM_FLOW_CONTROL_NONE));
-    ESP_ERROR_CHECK(dce->store_profile(dce));
+#if CONFIG_EXAMPLE_MODEM_CACHE
+    const esp_modem_cache_config_t cache_config = ESP_MODEM_CACHE_DEFAULT_CONFIG();
+    if (esp_modem_cache_enable(modem->dce, &cache_config) != ESP_OK)
+        ESP_LOGW(TAG, "Query cache not enabled");
+#endif
+#if CONFIG_EXAMPLE_MODEM_HEALTH
+    const esp_modem_health_config_t health_config = ESP_MODEM_HEALTH_DEFAULT_CONFIG();
+    if (esp_modem_health_enable(modem->dce, &health_config) != ESP_OK)
+        ESP_LOGW(TAG, "Health monitor not enabled");
+#endif
+#if CONFIG_EXAMPLE_MODEM_SLEEP
+    /* Only the first modem has DTR wired */
+    if (selected_modem == 0)
+    {
+        const esp_modem_sleep_config_t sleep_config = ESP_MODEM_SLEEP_DEFAULT_CONFIG();
+        if (esp_modem_sleep_enable(modem->dce, &sleep_config) != ESP_OK)
+            ESP_LOGW(TAG, "Sleep manager not enabled");
+    }
+#endif
+#if CONFIG_EXAMPLE_MODEM_SUPPLY
+    const esp_modem_supply_config_t supply_config = ESP_MODEM_SUPPLY_DEFAULT_CONFIG();
+    if (esp_modem_supply_enable(modem->dce, &supply_config) != ESP_OK)
+        ESP_LOGW(TAG, "Supply governor not enabled");
+#endif
+    modem_select(selected_modem);
 
     /* Print Module ID, Operator, IMEI, IMSI */
     ESP_LOGI(TAG, "Module: %s", dce->name);
@@ -159,37 +319,95 @@ static int start_modem()
 
     return 0;
 err:
-    esp_modem_remove_event_handler(dte, modem_event_handler);
-    esp_modem_dte_deinit(dte);
-    dce = NULL;
-    dte = NULL;
+    esp_modem_remove_event_handler(modem->dte, modem_event_handler);
+    esp_modem_dte_deinit(modem->dte);
+err_dte:
+    modem->dce = NULL;
+    modem->dte = NULL;
+    modem_select(selected_modem);
     printf("Error starting modem");
     return 0;
 }
 
+/* Timings of the last "stop modem" */
+static esp_modem_shutdown_report_t last_shutdown;
+
 /* Power down Modem module and stop the DCE/DTE interface*/
 int stop_modem()
 {
+    modem_instance_t *modem = &modems[selected_modem];
 
-
-    if (dce != NULL)
+    if (modem->dce != NULL)
     {
-        modem_dte_t *dte = dce->dte;
-        ESP_ERROR_CHECK(dce->power_down(dce));
-        ESP_ERROR_CHECK(dce->deinit(dce));
-        dce = NULL;
+        /* Frees the DTE too */
+        esp_modem_shutdown(modem->dce, &last_shutdown);
+        modem->dce = NULL;
+        modem->dte = NULL;
     }
 
-    if (dte != NULL)
+    if (modem->dte != NULL)
     {
-        ESP_ERROR_CHECK(dte->deinit(dte));
-        dte = NULL;
+        ESP_ERROR_CHECK(modem->dte->deinit(modem->dte));
+        modem->dte = NULL;
     }
 
-    sim800_power_off();
+    sim800_power_off(&modem->sim800_config);
+    modem_select(selected_modem);
+    return 0;
+}
+
+/****************************************************************/
+/** @brief modem - list modems or select the one commands go to */
+static struct
+{
+    struct arg_int *index;
+    struct arg_end *end;
+} modem_select_args;
+
+static int modem_select_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&modem_select_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, modem_select_args.end, argv[0]);
+        return 1;
+    }
+    if (modem_select_args.index->count)
+    {
+        int index = modem_select_args.index->ival[0];
+        if (index < 0 || index >= CONFIG_EXAMPLE_MODEM_INSTANCES)
+        {
+            printf("Modem index out of range 0..%d\r\n", CONFIG_EXAMPLE_MODEM_INSTANCES - 1);
+            return 1;
+        }
+        modem_select(index);
+    }
+    for (int i = 0; i < CONFIG_EXAMPLE_MODEM_INSTANCES; i++)
+    {
+        modem_instance_t *modem = &modems[i];
+        printf("%c %d: UART%d tx %d rx %d, %s", i == selected_modem ? '*' : ' ', i, modem->dte_config.port_num,
+               modem->dte_config.tx_io_num, modem->dte_config.rx_io_num, modem->dce ? "started" : "stopped");
+        if (modem->dce)
+            printf(", %d baud, %s", modem->dte->baud_rate, modem->dce->oper);
+        printf("\r\n");
+    }
     return 0;
 }
 
+static void register_modem_select()
+{
+    modem_select_args.index = arg_int0(NULL, NULL, "<n>", "modem to select");
+    modem_select_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "modem",
+        .help = "List the modems, or select the one the other commands go to",
+        .hint = NULL,
+        .func = &modem_select_command,
+        .argtable = &modem_select_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
 static int get_operator()
 {
     printf("%s\r\n", dce->oper);
@@ -207,153 +425,1404 @@ static void register_get_operator()
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
 }
 
-static struct
-{
-    struct arg_str *suffix;
-    struct arg_end *end;
-} at_args;
-
-static int at_command(int argc, char **argv)
+/****************************************************************/
+/** @brief status - signal, battery and registration           */
+static int status()
 {
-    int nerrors = arg_parse(argc, argv, (void **)&at_args);
-    if (nerrors != 0)
+    uint32_t rssi = 0, ber = 0, bcs = 0, bcl = 0, voltage = 0, mode = 0, stat = 0;
+    if (dce == NULL)
     {
-        arg_print_errors(stderr, at_args.end, argv[0]);
+        printf("Modem not started\r\n");
         return 1;
     }
-    if (at_args.suffix->count)
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_INTERACTIVE, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK)
     {
-        const char *at_command = at_args.suffix->sval[0];
-        sim800_at(dce, at_command, 3000);
+        printf("Modem busy\r\n");
+        return 1;
     }
+    if (dce->get_signal_quality(dce, &rssi, &ber) == ESP_OK)
+        printf("Signal: rssi %d, ber %d\r\n", rssi, ber);
+    if (dce->get_battery_status(dce, &bcs, &bcl, &voltage) == ESP_OK)
+        printf("Battery: %d%%, %d mV\r\n", bcl, voltage);
+    if (dce->get_network_status(dce, &mode, &stat) == ESP_OK)
+        printf("Registration: %d\r\n", stat);
+    esp_modem_arbiter_release(dce->arbiter);
     return 0;
 }
 
-static void register_at_command()
+static void register_status()
 {
-    at_args.suffix = arg_str1(NULL, NULL, "<command>", "at command");
-    at_args.end = arg_end(2);
-
     const esp_console_cmd_t cmd = {
-        .command = "AT",
-        .help = "AT command based on the 3GPP standard",
-        .hint = "no spaces between commands.",
-        .func = &at_command,
+        .command = "status",
+        .help = "Print signal quality, battery and network registration",
+        .hint = "no arguments",
+        .func = &status,
     };
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
 }
 
 /****************************************************************/
-/** @brief ppp - enter/exit PPP mode                           */
-
-void init_ppp(modem_dce_t *dce)
+/** @brief arbiter - command channel fairness and deadlines    */
+static struct
 {
-    modem_dte_t *dte = dce->dte;
-
-    if (!event_group)
-        event_group = xEventGroupCreate();
+    struct arg_lit *reset;
+    struct arg_end *end;
+} arbiter_args;
 
-    esp_modem_setup_ppp(dte);
+static int arbiter_command(int argc, char **argv)
+{
+    esp_modem_arbiter_stats_t stats[ESP_MODEM_PRIORITY_MAX];
+    int nerrors = arg_parse(argc, argv, (void **)&arbiter_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, arbiter_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    esp_modem_arbiter_get_stats(dce->arbiter, stats);
+    printf("%-12s %8s %9s %9s %5s %7s %10s %10s\r\n", "priority", "granted", "immediate", "overtaken", "aged", "missed",
+           "avg wait", "max wait");
+    for (int i = 0; i < ESP_MODEM_PRIORITY_MAX; i++)
+    {
+        printf("%-12s %8u %9u %9u %5u %7u %7u us %7u us\r\n", esp_modem_arbiter_priority_name(i), stats[i].granted,
+               stats[i].immediate, stats[i].overtaken, stats[i].aged, stats[i].deadline_misses,
+               stats[i].granted ? (uint32_t)(stats[i].total_wait_us / stats[i].granted) : 0, stats[i].max_wait_us);
+    }
+    if (arbiter_args.reset->count)
+        esp_modem_arbiter_reset_stats(dce->arbiter);
+    return 0;
 }
 
-/* Exit PPP mode */
-void de_init_ppp(modem_dce_t *dce)
+static void register_arbiter()
 {
-    modem_dte_t *dte = dce->dte;
-    ESP_ERROR_CHECK(esp_modem_exit_ppp(dte));
-    xEventGroupWaitBits(event_group, STOP_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+    arbiter_args.reset = arg_lit0("r", "reset", "reset the counters after printing");
+    arbiter_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "arbiter",
+        .help = "Print how long each priority waited for the modem command channel",
+        .hint = NULL,
+        .func = &arbiter_command,
+        .argtable = &arbiter_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
 }
 
+#if CONFIG_EXAMPLE_MODEM_CACHE
 /****************************************************************/
-/** @brief CLS - Clear Screen Command                          */
-static int cls()
+/** @brief cache - query cache counters                        */
+static struct
 {
-    printf("\033[2J\n\n\033[H\n");
+    struct arg_str *action;
+    struct arg_end *end;
+} cache_args;
+
+static int cache_command(int argc, char **argv)
+{
+    esp_modem_cache_stats_t stats[ESP_MODEM_CACHE_MAX];
+    int nerrors = arg_parse(argc, argv, (void **)&cache_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, cache_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    if (cache_args.action->count)
+    {
+        const char *action = cache_args.action->sval[0];
+        if (!strcmp(action, "flush"))
+            esp_modem_cache_invalidate(dce, ESP_MODEM_CACHE_MAX);
+        else if (!strcmp(action, "reset"))
+            esp_modem_cache_reset_stats(dce);
+        else
+        {
+            printf("Unknown action %s\r\n", action);
+            return 1;
+        }
+    }
+    if (esp_modem_cache_get_stats(dce, stats) != ESP_OK)
+    {
+        printf("Cache not enabled\r\n");
+        return 1;
+    }
+    printf("%-16s %8s %8s %9s %8s %8s\r\n", "query", "hits", "misses", "coalesced", "invalid", "errors");
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++)
+    {
+        printf("%-16s %8u %8u %9u %8u %8u\r\n", esp_modem_cache_query_name(i), stats[i].hits, stats[i].misses,
+               stats[i].coalesced, stats[i].invalidations, stats[i].errors);
+    }
     return 0;
 }
 
-static void register_cls()
+static void register_cache()
 {
+    cache_args.action = arg_str0(NULL, NULL, "<flush|reset>", "drop cached answers, or reset the counters");
+    cache_args.end = arg_end(2);
     const esp_console_cmd_t cmd = {
-        .command = "cls",
-        .help = "Clear screen",
-        .hint = "no arguments",
-        .func = &cls,
+        .command = "cache",
+        .help = "Print the query cache counters, flush the cache or reset the counters",
+        .hint = NULL,
+        .func = &cache_command,
+        .argtable = &cache_args,
     };
     ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
 }
+#endif
 
-void start_mqtt_connection()
+#if CONFIG_EXAMPLE_MODEM_HEALTH
+/****************************************************************/
+/** @brief health - health monitor counters and recovery       */
+static struct
 {
+    struct arg_str *action;
+    struct arg_end *end;
+} health_args;
 
-    /* Wait for IP address */
-    xEventGroupWaitBits(event_group, CONNECT_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
-    /* Config MQTT */
-    esp_mqtt_client_config_t mqtt_config = {
-        .uri = BROKER_URL,
-        .event_handle = mqtt_event_handler,
-    };
-    esp_mqtt_client_handle_t mqtt_client = esp_mqtt_client_init(&mqtt_config);
-    esp_mqtt_client_start(mqtt_client);
-
-    xEventGroupWaitBits(event_group, GOT_DATA_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
-    esp_mqtt_client_destroy(mqtt_client);
+static int health_command(int argc, char **argv)
+{
+    esp_modem_health_stats_t stats;
+    int nerrors = arg_parse(argc, argv, (void **)&health_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, health_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    if (esp_modem_health_get_stats(dce, &stats) != ESP_OK)
+    {
+        printf("Health monitor not enabled\r\n");
+        return 1;
+    }
+    if (health_args.action->count)
+    {
+        const char *action = health_args.action->sval[0];
+        if (!strcmp(action, "recover"))
+        {
+            esp_modem_health_recover(dce);
+            printf("Recovery requested\r\n");
+            return 0;
+        }
+        else if (!strcmp(action, "reset"))
+            esp_modem_health_reset_stats(dce);
+        else
+        {
+            printf("Unknown action %s\r\n", action);
+            return 1;
+        }
+    }
+    uint32_t recovered = 0;
+    int64_t idle_ms = stats.last_line_us ? (esp_timer_get_time() - stats.last_line_us) / 1000 : -1;
+    printf("%s, last line %lld ms ago, %u command timeouts (%u in a row), %u AT probes, %u URCs\r\n",
+           stats.recovering ? "recovering" : "watching", idle_ms, stats.timeouts, stats.consecutive_timeouts,
+           stats.probes, stats.urcs);
+    printf("%-8s %9s\r\n", "step", "recovered");
+    for (int i = 0; i < ESP_MODEM_HEALTH_LEVEL_MAX; i++)
+    {
+        printf("%-8s %9u\r\n", esp_modem_health_level_name(i), stats.recovered[i]);
+        recovered += stats.recovered[i];
+    }
+    printf("%-8s %9u\r\n", "failed", stats.failures);
+    if (recovered)
+    {
+        printf("time to recover: last %u ms, mean %u ms, max %u ms\r\n", stats.last_mttr_ms,
+               (uint32_t)(stats.total_mttr_ms / recovered), stats.max_mttr_ms);
+    }
+    return 0;
 }
 
-void start_life()
+static void register_health()
 {
-    printf(
-        "                                                                                            `-----\n"
-        "                    -:---------`                                                      .-----.     \n"
-        "              `-----`         `-:::---:                                      `--------`           \n"
-        "          `-:-.         `              /---`                       `----:----.                    \n"
-        "  `.-------           ` ..          -  .  `-:-                `-::--`    `-..`                    \n"
-        "---`              `-.`-:-/:      `o+--+.o-:: -:    .-:-:------.        `..   ``                   \n"
-        "                `.. .:.   `::::-.  :o:-+-+ .s:`o //--:://---  `:.    ..  `-::--://::-..           \n"
-        "                  `/-           `-:: `/+-/: +`--- .-`      -y::`...    .:`------.``````           \n"
-        "                .::                `+/:+../:.:           /// .-/-::.-::.:--     `..--...----::----\n"
-        "            `:::`                   -...  .:-`           //:/+-`o`.:-::-                          \n"
-        "          :/-                                             / / .:+ +`                              \n"
-        "       `::`                                               +`/`/ +`+                               \n"
-        "  `-:::.                                                  --/-` `-                                \n"
-        "--.`                                                                                              \n");
+    health_args.action = arg_str0(NULL, NULL, "<recover|reset>", "recover the modem now, or reset the counters");
+    health_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "health",
+        .help = "Print the health monitor counters, force a recovery or reset the counters",
+        .hint = NULL,
+        .func = &health_command,
+        .argtable = &health_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
 }
+#endif
 
-static int start_test()
+#if CONFIG_EXAMPLE_MODEM_SLEEP
+/****************************************************************/
+/** @brief sleep - sleep manager counters                      */
+static struct
 {
-    for (int x = 0; x < 10; x++)
-    {
-        printf("%d: Pre start: %d\n", x, esp_get_free_heap_size());
-        start_modem();
+    struct arg_str *action;
+    struct arg_end *end;
+} sleep_args;
 
-        printf("%d: started: %d\n", x, esp_get_free_heap_size());
-        stop_modem();
-        printf("----------------------------\n");
+static int sleep_command(int argc, char **argv)
+{
+    esp_modem_sleep_stats_t stats;
+    const esp_modem_sleep_power_t power = ESP_MODEM_SLEEP_DEFAULT_POWER();
+    int nerrors = arg_parse(argc, argv, (void **)&sleep_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, sleep_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    if (sleep_args.action->count)
+    {
+        if (strcmp(sleep_args.action->sval[0], "reset"))
+        {
+            printf("Unknown action %s\r\n", sleep_args.action->sval[0]);
+            return 1;
+        }
+        esp_modem_sleep_reset_stats(dce);
+    }
+    if (esp_modem_sleep_get_stats(dce, &stats) != ESP_OK)
+    {
+        printf("Sleep manager not enabled\r\n");
+        return 1;
+    }
+    uint64_t total_us = stats.asleep_us + stats.awake_us;
+    printf("%s, %u sleeps, %u refused, %u wakes, %u URCs while asleep, %u%% of %llu s asleep\r\n",
+           stats.disabled ? "kept awake" : stats.asleep ? "asleep" : "awake", stats.sleeps, stats.refused, stats.wakes,
+           stats.urcs_asleep, total_us ? (uint32_t)(stats.asleep_us * 100 / total_us) : 0,
+           (unsigned long long)(total_us / 1000000));
+    printf("wake-up: last %u ms, max %u ms, budget %u ms, %u over, %u times slept again after being kept awake\r\n",
+           stats.last_wake_ms, stats.max_wake_ms, CONFIG_EXAMPLE_MODEM_SLEEP_LATENCY_BUDGET, stats.over_budget,
+           stats.rearms);
+    if (stats.disabled && stats.rearm_in_ms)
+    {
+        printf("kept awake for slow wake-ups, sleeping again in %u s or after \"sleep reset\"\r\n",
+               (stats.rearm_in_ms + 999) / 1000);
     }
+    else if (stats.disabled)
+    {
+        printf("kept awake for slow wake-ups until \"sleep reset\"\r\n");
+    }
+    printf("energy: %llu mJ, %llu mJ with the chip in light sleep, %llu mJ always awake\r\n",
+           esp_modem_sleep_energy_uj(&stats, &power, false) / 1000, esp_modem_sleep_energy_uj(&stats, &power, true) / 1000,
+           esp_modem_sleep_awake_energy_uj(&stats, &power) / 1000);
     return 0;
 }
 
-/****************************************************************/
-/** @brief start - start something                             */
+static void register_sleep()
+{
+    sleep_args.action = arg_str0(NULL, NULL, "<reset>", "reset the counters, and let a modem kept awake sleep again");
+    sleep_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "sleep",
+        .help = "Print the sleep manager counters and energy estimate, or reset them",
+        .hint = NULL,
+        .func = &sleep_command,
+        .argtable = &sleep_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+#endif
 
+#if CONFIG_EXAMPLE_MODEM_SUPPLY
+/****************************************************************/
+/** @brief supply - supply governor counters and policy        */
 static struct
 {
-    struct arg_str *suffix;
+    struct arg_int *throttle;
+    struct arg_int *pause;
+    struct arg_int *resume;
+    struct arg_int *over;
+    struct arg_int *hold;
+    struct arg_int *ppp_check;
+    struct arg_int *rate;
+    struct arg_int *burst;
+    struct arg_lit *reset;
     struct arg_end *end;
-} start_args;
+} supply_args;
 
-static int start_command(int argc, char **argv)
+static int supply_command(int argc, char **argv)
 {
-    int nerrors = arg_parse(argc, argv, (void **)&start_args);
+    esp_modem_supply_config_t config;
+    esp_modem_supply_stats_t stats;
+    int nerrors = arg_parse(argc, argv, (void **)&supply_args);
     if (nerrors != 0)
     {
-        arg_print_errors(stderr, start_args.end, argv[0]);
+        arg_print_errors(stderr, supply_args.end, argv[0]);
         return 1;
     }
-    if (start_args.suffix->count)
+    if (dce == NULL)
     {
-
-        if (strstr(start_args.suffix->sval[0], "modem"))
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    if (esp_modem_supply_get_config(dce, &config) != ESP_OK)
+    {
+        printf("Supply governor not enabled\r\n");
+        return 1;
+    }
+    struct arg_int *const limits[] = {supply_args.throttle, supply_args.pause, supply_args.resume, supply_args.over,
+                                      supply_args.hold, supply_args.ppp_check, supply_args.rate, supply_args.burst};
+    uint32_t *const fields[] = {&config.throttle_mv, &config.pause_mv, &config.resume_mv, &config.over_mv,
+                                &config.hold_ms, &config.ppp_check_ms, &config.uplink_rate, &config.uplink_burst};
+    bool changed = false;
+    for (int i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+    {
+        if (limits[i]->count)
+        {
+            *fields[i] = limits[i]->ival[0];
+            changed = true;
+        }
+    }
+    if (changed && esp_modem_supply_set_config(dce, &config) != ESP_OK)
+    {
+        printf("Thresholds must rise from pause to throttle to resume to over, and the PPP check cannot be 0\r\n");
+        return 1;
+    }
+    if (supply_args.reset->count)
+        esp_modem_supply_reset_stats(dce);
+    esp_modem_supply_get_stats(dce, &stats);
+    printf("%s, last %u mV, min %u mV, max %u mV in %u readings, %u UNDER-VOLTAGE, %u OVER-VOLTAGE\r\n",
+           esp_modem_supply_level_name(stats.level), stats.last_mv, stats.min_mv, stats.max_mv, stats.readings,
+           stats.under_urcs, stats.over_urcs);
+    printf("throttled %u times for %llu s, paused %u times for %llu s, %u resumed, %u PPP checks\r\n", stats.throttles,
+           (unsigned long long)(stats.throttled_us / 1000000), stats.pauses,
+           (unsigned long long)(stats.paused_us / 1000000), stats.resumes, stats.ppp_checks);
+    printf("uplink paced: %llu bytes, dropped %u frames (%llu bytes)\r\n", (unsigned long long)stats.paced_bytes,
+           stats.dropped_frames, (unsigned long long)stats.dropped_bytes);
+    printf("policy: pause <= %u mV, throttle <= %u mV or >= %u mV, resume >= %u mV for %u ms, PPP check every %u ms, "
+           "uplink %u bytes/s in %u byte bursts\r\n",
+           config.pause_mv, config.throttle_mv, config.over_mv, config.resume_mv, config.hold_ms, config.ppp_check_ms,
+           config.uplink_rate, config.uplink_burst);
+    return 0;
+}
+
+static void register_supply()
+{
+    supply_args.throttle = arg_int0(NULL, "throttle", "<mV>", "pace the uplink at or below");
+    supply_args.pause = arg_int0(NULL, "pause", "<mV>", "close PPP at or below");
+    supply_args.resume = arg_int0(NULL, "resume", "<mV>", "back to normal at or above");
+    supply_args.over = arg_int0(NULL, "over", "<mV>", "pace the uplink at or above");
+    supply_args.hold = arg_int0(NULL, "hold", "<ms>", "how long readings must allow resuming");
+    supply_args.ppp_check = arg_int0(NULL, "ppp-check", "<ms>", "close PPP this often for a reading while throttled");
+    supply_args.rate = arg_int0(NULL, "rate", "<bytes/s>", "uplink rate while throttled");
+    supply_args.burst = arg_int0(NULL, "burst", "<bytes>", "uplink burst while throttled");
+    supply_args.reset = arg_lit0("r", "reset", "reset the counters");
+    supply_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "supply",
+        .help = "Print the supply governor counters and policy, or change the policy",
+        .hint = NULL,
+        .func = &supply_command,
+        .argtable = &supply_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+#endif
+
+#if CONFIG_EXAMPLE_MODEM_SCRIPT
+/****************************************************************/
+/** @brief run - run an AT script from the FAT partition      */
+static struct
+{
+    struct arg_str *file;
+    struct arg_lit *quiet;
+    struct arg_end *end;
+} run_args;
+
+static int run_command(int argc, char **argv)
+{
+    char path[64];
+    int nerrors = arg_parse(argc, argv, (void **)&run_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, run_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    const char *file = run_args.file->sval[0];
+    if (file[0] == '/')
+        snprintf(path, sizeof(path), "%s", file);
+    else
+        snprintf(path, sizeof(path), "%s/%s", CONFIG_EXAMPLE_MODEM_SCRIPT_DIR, file);
+
+    esp_modem_script_report_t *report = malloc(sizeof(esp_modem_script_report_t));
+    if (report == NULL)
+    {
+        printf("Out of memory\r\n");
+        return 1;
+    }
+    esp_err_t err = esp_modem_script_run(dce, path, run_args.quiet->count == 0, report);
+    printf("%5s %-24s %5s %8s %5s %9s %9s\r\n", "line", "command", "runs", "attempts", "fail", "avg", "max");
+    for (int i = 0; i < report->count; i++)
+    {
+        esp_modem_script_step_report_t *step = &report->steps[i];
+        printf("%5d %-24s %5d %8d %5d %6u ms %6u ms\r\n", step->line, step->command, step->runs, step->attempts,
+               step->failures, step->runs ? step->total_ms / step->runs : 0, step->max_ms);
+    }
+    if (err == ESP_OK)
+        printf("%s done in %u ms\r\n", path, report->elapsed_ms);
+    else if (report->error_line)
+        printf("%s stopped at line %d after %u ms: %s\r\n", path, report->error_line, report->elapsed_ms, report->error);
+    else
+        printf("%s: %s\r\n", path, report->error);
+    free(report);
+    return err == ESP_OK ? 0 : 1;
+}
+
+static void register_run()
+{
+    run_args.file = arg_str1(NULL, NULL, "<file>", "script, relative to " CONFIG_EXAMPLE_MODEM_SCRIPT_DIR);
+    run_args.quiet = arg_lit0("q", "quiet", "do not print the modem answers");
+    run_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "run",
+        .help = "Run an AT script and print the time taken by each step",
+        .hint = NULL,
+        .func = &run_command,
+        .argtable = &run_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+#endif
+
+#if CONFIG_EXAMPLE_MODEM_STATS
+/****************************************************************/
+/** @brief modemstats - AT command latency percentiles         */
+static struct
+{
+    struct arg_lit *json;
+    struct arg_str *file;
+    struct arg_lit *reset;
+    struct arg_end *end;
+} modemstats_args;
+
+static int modemstats_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&modemstats_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, modemstats_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL || dce->stats == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    const char *device = dce->imei[0] ? dce->imei : "unknown";
+    if (modemstats_args.file->count)
+    {
+        const char *path = modemstats_args.file->sval[0];
+        FILE *fp = fopen(path, "w");
+        if (fp == NULL)
+        {
+            printf("Cannot open %s\r\n", path);
+            return 1;
+        }
+        esp_err_t err = esp_modem_stats_write_json(dce->stats, device, fp);
+        if (fclose(fp) != 0 && err == ESP_OK)
+            err = ESP_FAIL;
+        printf("%s %s\r\n", err == ESP_OK ? "Written to" : "Failed to write", path);
+        if (err != ESP_OK)
+            return 1;
+    }
+    else if (modemstats_args.json->count)
+    {
+        esp_modem_stats_write_json(dce->stats, device, stdout);
+    }
+    else
+    {
+        esp_modem_stats_verb_t *verb = esp_modem_pool_alloc(sizeof(esp_modem_stats_verb_t));
+        if (verb == NULL)
+        {
+            printf("Out of memory\r\n");
+            return 1;
+        }
+        printf("%-10s %6s %5s %5s | %-22s | %-22s %8s\r\n", "verb", "count", "error", "t/o",
+               "first line p50/95/99", "final p50/95/99 (ms)", "max");
+        for (int i = 0; esp_modem_stats_get(dce->stats, i, verb) == ESP_OK; i++)
+        {
+            printf("%-10s %6u %5u %5u | %6u %7u %7u | %6u %7u %7u %8u\r\n", verb->verb, verb->count, verb->errors,
+                   verb->timeouts, esp_modem_stats_percentile(&verb->first_line, 50),
+                   esp_modem_stats_percentile(&verb->first_line, 95), esp_modem_stats_percentile(&verb->first_line, 99),
+                   esp_modem_stats_percentile(&verb->final_result, 50), esp_modem_stats_percentile(&verb->final_result, 95),
+                   esp_modem_stats_percentile(&verb->final_result, 99), verb->final_result.max_ms);
+        }
+        esp_modem_pool_free(verb);
+    }
+    if (modemstats_args.reset->count)
+        esp_modem_stats_reset(dce->stats);
+    return 0;
+}
+
+static void register_modemstats()
+{
+    modemstats_args.json = arg_lit0("j", "json", "print as JSON");
+    modemstats_args.file = arg_str0("o", "output", "<file>", "write the JSON to a file, e.g. /data/stats.json");
+    modemstats_args.reset = arg_lit0("r", "reset", "reset the histograms afterwards");
+    modemstats_args.end = arg_end(4);
+    const esp_console_cmd_t cmd = {
+        .command = "modemstats",
+        .help = "Print AT command latencies per verb: send to first line and to final result",
+        .hint = NULL,
+        .func = &modemstats_command,
+        .argtable = &modemstats_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+#endif
+
+#if CONFIG_EXAMPLE_MODEM_CAPTURE
+/****************************************************************/
+/** @brief capture - UART traffic capture ring                 */
+static struct
+{
+    struct arg_str *action;
+    struct arg_int *count;
+    struct arg_str *file;
+    struct arg_end *end;
+} capture_args;
+
+static int capture_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&capture_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, capture_args.end, argv[0]);
+        return 1;
+    }
+    const char *action = capture_args.action->count ? capture_args.action->sval[0] : "";
+    esp_err_t err = ESP_OK;
+    if (!strcmp(action, "show"))
+    {
+        err = esp_modem_capture_print(stdout, capture_args.count->count ? capture_args.count->ival[0] : 20);
+    }
+    else if (!strcmp(action, "dump"))
+    {
+        const char *path = capture_args.file->count ? capture_args.file->sval[0] : CONFIG_EXAMPLE_MODEM_CAPTURE_DIR "/capture.cap";
+        err = esp_modem_capture_dump(path);
+        if (err == ESP_OK)
+            printf("Written to %s\r\n", path);
+    }
+    else if (!strcmp(action, "clear"))
+    {
+        esp_modem_capture_clear();
+    }
+    else if (!strcmp(action, "on") || !strcmp(action, "off"))
+    {
+        esp_modem_capture_enable(!strcmp(action, "on"));
+    }
+    else if (action[0])
+    {
+        printf("Unknown action %s\r\n", action);
+        return 1;
+    }
+    else
+    {
+        esp_modem_capture_stats_t stats;
+        esp_modem_capture_get_stats(&stats);
+        printf("ring %u/%u bytes, %u records, %u overwritten, %u truncated, %u faults, %u dumps\r\n", stats.used,
+               stats.size, stats.records, stats.overwritten, stats.truncated, stats.faults, stats.dumps);
+    }
+    if (err != ESP_OK)
+    {
+        printf("capture %s failed: %s\r\n", action, esp_err_to_name(err));
+        return 1;
+    }
+    return 0;
+}
+
+static void register_capture()
+{
+    capture_args.action = arg_str0(NULL, NULL, "<show|dump|clear|on|off>", "action, counters if none");
+    capture_args.count = arg_int0("n", "count", "<n>", "records to show, default 20");
+    capture_args.file = arg_str0("o", "output", "<file>", "dump file, default " CONFIG_EXAMPLE_MODEM_CAPTURE_DIR "/capture.cap");
+    capture_args.end = arg_end(4);
+    const esp_console_cmd_t cmd = {
+        .command = "capture",
+        .help = "Show, dump or clear the recent modem UART traffic",
+        .hint = NULL,
+        .func = &capture_command,
+        .argtable = &capture_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+#endif
+
+static struct
+{
+    struct arg_str *suffix;
+    struct arg_end *end;
+} at_args;
+
+static int at_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&at_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, at_args.end, argv[0]);
+        return 1;
+    }
+    if (at_args.suffix->count && dce != NULL)
+    {
+        const char *at_command = at_args.suffix->sval[0];
+        /* Typed commands overtake queued background queries */
+        if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_INTERACTIVE, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK)
+        {
+            printf("Modem busy\r\n");
+            return 1;
+        }
+        sim800_at(dce, at_command, 3000);
+        esp_modem_arbiter_release(dce->arbiter);
+    }
+    return 0;
+}
+
+static void register_at_command()
+{
+    at_args.suffix = arg_str1(NULL, NULL, "<command>", "at command");
+    at_args.end = arg_end(2);
+
+    const esp_console_cmd_t cmd = {
+        .command = "AT",
+        .help = "AT command based on the 3GPP standard",
+        .hint = "no spaces between commands.",
+        .func = &at_command,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+/****************************************************************/
+/** @brief ppp - enter/exit PPP mode                           */
+
+void init_ppp(modem_dce_t *dce)
+{
+    modem_dte_t *dte = dce->dte;
+
+    if (!event_group)
+        event_group = xEventGroupCreate();
+
+    esp_modem_setup_ppp(dte);
+}
+
+/* Exit PPP mode */
+void de_init_ppp(modem_dce_t *dce)
+{
+    modem_dte_t *dte = dce->dte;
+    ESP_ERROR_CHECK(esp_modem_exit_ppp(dte));
+    xEventGroupWaitBits(event_group, STOP_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+}
+
+/****************************************************************/
+/** @brief boottime - print the last modem boot timeline       */
+static int boot_time()
+{
+    int32_t timeline[SIM800_BOOT_PHASE_MAX];
+    sim800_get_boot_timeline(selected_modem, timeline);
+    for (int i = 0; i < SIM800_BOOT_PHASE_MAX; i++)
+    {
+        if (timeline[i] < 0)
+            printf("%-16s      -\r\n", sim800_boot_phase_name(i));
+        else
+            printf("%-16s %6d ms\r\n", sim800_boot_phase_name(i), timeline[i]);
+    }
+    return 0;
+}
+
+static void register_boot_time()
+{
+    const esp_console_cmd_t cmd = {
+        .command = "boottime",
+        .help = "Print the time from power on to each phase of the last modem boot",
+        .hint = "no arguments",
+        .func = &boot_time,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+/****************************************************************/
+/** @brief reconfigure - resend and store the modem profile    */
+static int reconfigure()
+{
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    return sim800_configure(dce, true) == ESP_OK ? 0 : 1;
+}
+
+static void register_reconfigure()
+{
+    const esp_console_cmd_t cmd = {
+        .command = "reconfigure",
+        .help = "Resend the full modem configuration and store it in the modem profile",
+        .hint = "no arguments",
+        .func = &reconfigure,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+/****************************************************************/
+/** @brief baud - show, negotiate or set the modem link rate   */
+static struct
+{
+    struct arg_str *rate;
+    struct arg_end *end;
+} baud_args;
+
+static int baud_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&baud_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, baud_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    esp_err_t ret = ESP_OK;
+    if (baud_args.rate->count)
+    {
+        if (!strcmp(baud_args.rate->sval[0], "auto"))
+            ret = sim800_negotiate_baud(dce, CONFIG_EXAMPLE_MODEM_BAUD_RATE_MAX);
+        else
+            ret = sim800_set_baud(dce, atoi(baud_args.rate->sval[0]));
+    }
+    printf("%d baud\r\n", dce->dte->baud_rate);
+    return ret == ESP_OK ? 0 : 1;
+}
+
+static void register_baud()
+{
+    baud_args.rate = arg_str0(NULL, NULL, "<rate|auto>", "new baud rate, or auto to negotiate the highest one");
+    baud_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "baud",
+        .help = "Show or change the baud rate of the modem link",
+        .hint = NULL,
+        .func = &baud_command,
+        .argtable = &baud_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+/****************************************************************/
+/** @brief flowctrl - show or change flow control on both ends */
+static struct
+{
+    struct arg_str *mode;
+    struct arg_end *end;
+} flow_ctrl_args;
+
+static int flow_ctrl_command(int argc, char **argv)
+{
+    static const char *const names[] = {"none", "sw", "hw"};
+    int nerrors = arg_parse(argc, argv, (void **)&flow_ctrl_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, flow_ctrl_args.end, argv[0]);
+        return 1;
+    }
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    esp_err_t ret = ESP_OK;
+    if (flow_ctrl_args.mode->count)
+    {
+        if (!strcmp(flow_ctrl_args.mode->sval[0], "hw"))
+            ret = esp_modem_set_flow_ctrl(dce->dte, MODEM_FLOW_CONTROL_HW);
+        else if (!strcmp(flow_ctrl_args.mode->sval[0], "none"))
+            ret = esp_modem_set_flow_ctrl(dce->dte, MODEM_FLOW_CONTROL_NONE);
+        else
+        {
+            printf("Unknown flow control: %s\r\n", flow_ctrl_args.mode->sval[0]);
+            return 1;
+        }
+    }
+    esp_modem_uart_stats_t stats;
+    esp_modem_get_uart_stats(dce->dte, &stats);
+    printf("flow control: %s\r\n", names[dce->dte->flow_ctrl]);
+    printf("fifo overflows: %d, buffer full: %d, pattern overflows: %d, bytes dropped: %d\r\n",
+           stats.fifo_overflows, stats.buffer_full, stats.pattern_overflows, stats.bytes_dropped);
+    return ret == ESP_OK ? 0 : 1;
+}
+
+static void register_flow_ctrl()
+{
+    flow_ctrl_args.mode = arg_str0(NULL, NULL, "<none|hw>", "new flow control");
+    flow_ctrl_args.end = arg_end(2);
+    const esp_console_cmd_t cmd = {
+        .command = "flowctrl",
+        .help = "Show or change flow control of the modem link, with the receive overrun counters",
+        .hint = NULL,
+        .func = &flow_ctrl_command,
+        .argtable = &flow_ctrl_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+/****************************************************************/
+/** @brief pin - show or change where the modem tasks run      */
+static struct
+{
+    struct arg_str *task;
+    struct arg_int *core;
+    struct arg_int *priority;
+    struct arg_end *end;
+} pin_args;
+
+/* Core as the Kconfig options write it, -1 for either */
+static int pin_core(BaseType_t core)
+{
+    return core == tskNO_AFFINITY ? -1 : core;
+}
+
+static void pin_print(const modem_instance_t *modem)
+{
+    const esp_modem_dte_config_t *config = &modem->dte_config;
+    printf("rx: core %d, priority %d\r\n", pin_core(config->rx_task_core), config->rx_task_priority);
+    if (config->event_task_priority)
+        printf("events: core %d, priority %d\r\n", pin_core(config->event_task_core), config->event_task_priority);
+    else
+        printf("events: dispatched by rx\r\n");
+    printf("link: core %d, priority %d\r\n", CONFIG_EXAMPLE_MODEM_LINK_TASK_CORE, CONFIG_EXAMPLE_MODEM_LINK_TASK_PRIORITY);
+    printf("console: core %d, priority %d\r\n", CONFIG_EXAMPLE_CONSOLE_TASK_CORE, uxTaskPriorityGet(NULL));
+}
+
+static int pin_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&pin_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, pin_args.end, argv[0]);
+        return 1;
+    }
+    modem_instance_t *modem = &modems[selected_modem];
+    if (pin_args.task->count)
+    {
+        const char *task = pin_args.task->sval[0];
+        if (!pin_args.core->count || !pin_args.priority->count)
+        {
+            printf("Give a core and a priority\r\n");
+            return 1;
+        }
+        int core = pin_args.core->ival[0];
+        int priority = pin_args.priority->ival[0];
+        if (core < -1 || core >= portNUM_PROCESSORS || priority < 0 || priority >= configMAX_PRIORITIES)
+        {
+            printf("Core -1..%d, priority 0..%d\r\n", portNUM_PROCESSORS - 1, configMAX_PRIORITIES - 1);
+            return 1;
+        }
+        if (!strcmp(task, "rx") && priority > 0)
+        {
+            modem->dte_config.rx_task_core = ESP_MODEM_TASK_CORE(core);
+            modem->dte_config.rx_task_priority = priority;
+        }
+        else if (!strcmp(task, "events"))
+        {
+            modem->dte_config.event_task_core = ESP_MODEM_TASK_CORE(core);
+            modem->dte_config.event_task_priority = priority;
+        }
+        else if (!strcmp(task, "console") && priority > 0)
+        {
+            /* This runs in the console task, which keeps the core it was created on */
+            if (core != CONFIG_EXAMPLE_CONSOLE_TASK_CORE)
+                printf("The console stays on core %d, its core is set in Kconfig\r\n", CONFIG_EXAMPLE_CONSOLE_TASK_CORE);
+            vTaskPrioritySet(NULL, priority);
+        }
+        else
+        {
+            printf("Unknown task or priority: %s %d\r\n", task, priority);
+            return 1;
+        }
+        if (modem->dte && strcmp(task, "console"))
+            printf("Modem %d takes it at the next start modem\r\n", selected_modem);
+    }
+    pin_print(modem);
+    return 0;
+}
+
+static void register_pin()
+{
+    pin_args.task = arg_str0(NULL, NULL, "<rx|events|console>", "task to place");
+    pin_args.core = arg_int0(NULL, NULL, "<core>", "core, -1 for either");
+    pin_args.priority = arg_int0(NULL, NULL, "<priority>", "priority, 0 dispatches events from rx");
+    pin_args.end = arg_end(4);
+    const esp_console_cmd_t cmd = {
+        .command = "pin",
+        .help = "Show or change the core and priority of the modem tasks of the selected modem",
+        .hint = NULL,
+        .func = &pin_command,
+        .argtable = &pin_args,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+/****************************************************************/
+/** @brief CLS - Clear Screen Command                          */
+static int cls()
+{
+    printf("\033[2J\n\n\033[H\n");
+    return 0;
+}
+
+static void register_cls()
+{
+    const esp_console_cmd_t cmd = {
+        .command = "cls",
+        .help = "Clear screen",
+        .hint = "no arguments",
+        .func = &cls,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+}
+
+void start_mqtt_connection()
+{
+
+    /* Wait for IP address */
+    xEventGroupWaitBits(event_group, CONNECT_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+    /* Config MQTT */
+    esp_mqtt_client_config_t mqtt_config = {
+        .uri = BROKER_URL,
+        .event_handle = mqtt_event_handler,
+    };
+    esp_mqtt_client_handle_t mqtt_client = esp_mqtt_client_init(&mqtt_config);
+    esp_mqtt_client_start(mqtt_client);
+
+    xEventGroupWaitBits(event_group, GOT_DATA_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+    esp_mqtt_client_destroy(mqtt_client);
+}
+
+void start_life()
+{
+    printf(
+        "                                                                                            `-----\n"
+        "                    -:---------`                                                      .-----.     \n"
+        "              `-----`         `-:::---:                                      `--------`           \n"
+        "          `-:-.         `              /---`                       `----:----.                    \n"
+        "  `.-------           ` ..          -  .  `-:-                `-::--`    `-..`                    \n"
+        "---`              `-.`-:-/:      `o+--+.o-:: -:    .-:-:------.        `..   ``                   \n"
+        "                `.. .:.   `::::-.  :o:-+-+ .s:`o //--:://---  `:.    ..  `-::--://::-..           \n"
+        "                  `/-           `-:: `/+-/: +`--- .-`      -y::`...    .:`------.``````           \n"
+        "                .::                `+/:+../:.:           /// .-/-::.-::.:--     `..--...----::----\n"
+        "            `:::`                   -...  .:-`           //:/+-`o`.:-::-                          \n"
+        "          :/-                                             / / .:+ +`                              \n"
+        "       `::`                                               +`/`/ +`+                               \n"
+        "  `-:::.                                                  --/-` `-                                \n"
+        "--.`                                                                                              \n");
+}
+
+#define START_TEST_CYCLES (10)
+
+/* Heap churn of start/stop: the first cycle may keep lazily allocated memory, the others must not */
+static int start_test()
+{
+    size_t initial = esp_get_free_heap_size(), settled = 0;
+    uint32_t shutdown_ms = 0, shutdown_max_ms = 0;
+    int failed = 0, unconfirmed = 0;
+    printf("Pre start: %d free, largest block %d\n", initial, heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+    for (int x = 0; x < START_TEST_CYCLES; x++)
+    {
+        size_t before = esp_get_free_heap_size();
+        start_modem();
+        if (modems[selected_modem].dce == NULL)
+            failed++;
+        printf("%d: started: %d\n", x, esp_get_free_heap_size());
+        memset(&last_shutdown, 0, sizeof(last_shutdown));
+        stop_modem();
+        size_t free_heap = esp_get_free_heap_size();
+        if (x == 0)
+            settled = free_heap;
+        printf("%d: stopped: %d, %d bytes below the first cycle, %d since the cycle began, largest block %d\n", x,
+               free_heap, (int)settled - (int)free_heap, (int)before - (int)free_heap,
+               heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+        printf("%d: shutdown %u ms (flush %u, quiesce %u, ppp %u, power down %u%s, teardown %u)\n", x,
+               last_shutdown.total_ms, last_shutdown.flush_ms, last_shutdown.quiesce_ms, last_shutdown.ppp_ms,
+               last_shutdown.power_down_ms, last_shutdown.confirmed ? "" : " unconfirmed", last_shutdown.teardown_ms);
+        shutdown_ms += last_shutdown.total_ms;
+        if (last_shutdown.total_ms > shutdown_max_ms)
+            shutdown_max_ms = last_shutdown.total_ms;
+        if (!last_shutdown.confirmed)
+            unconfirmed++;
+        printf("----------------------------\n");
+    }
+    size_t final = esp_get_free_heap_size();
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    printf("cycles: %d, failed: %d, static allocation on\n", START_TEST_CYCLES, failed);
+#else
+    printf("cycles: %d, failed: %d, static allocation off\n", START_TEST_CYCLES, failed);
+#endif
+    printf("first cycle kept %d bytes, later cycles leaked %d bytes, minimum free %d\n", (int)initial - (int)settled,
+           (int)settled - (int)final, heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+    printf("shutdown: mean %u ms, max %u ms, %d without the modem's confirmation\n", shutdown_ms / START_TEST_CYCLES,
+           shutdown_max_ms, unconfirmed);
+    printf("%s\n", !failed && !unconfirmed && final >= settled ? "PASS" : "FAIL");
+    return 0;
+}
+
+#define SOAK_TEST_ROUNDS (50)
+
+static int start_soak()
+{
+    sim800_soak_result_t result;
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    printf("Soak test at %d baud, flow control %d, %d rounds\n", dce->dte->baud_rate, dce->dte->flow_ctrl, SOAK_TEST_ROUNDS);
+    esp_err_t ret = sim800_soak_test(dce, SOAK_TEST_ROUNDS, &result);
+    printf("rounds: %d, failed: %d, mismatched: %d, bytes/round: %d\n",
+           result.rounds, result.failed, result.mismatched, result.expected);
+    printf("received: %d bytes in %d ms, overruns: %d, dropped: %d bytes\n",
+           result.bytes, result.elapsed_ms, result.overruns, result.bytes_dropped);
+    printf("%s\n", ret == ESP_OK ? "PASS" : "FAIL");
+    return ret == ESP_OK ? 0 : 1;
+}
+
+#define FLASH_STRESS_ROUNDS (200)
+#define FLASH_STRESS_CHUNK (4096)
+#define FLASH_STRESS_FILE_CHUNKS (16)
+#define FLASH_STRESS_PATH CONFIG_EXAMPLE_MODEM_CAPTURE_DIR "/stress.bin"
+#define FLASH_STRESS_DONE_BIT BIT0
+
+typedef struct
+{
+    volatile bool stop;
+    uint32_t bytes;
+    uint32_t errors;
+    int64_t longest_us; /* Slowest chunk, the cache is off for parts of it */
+    EventGroupHandle_t done;
+} flash_stress_t;
+
+/* Rewrite a file on the FAT partition chunk by chunk, each chunk synced so that it reaches flash */
+static void flash_stress_writer(void *param)
+{
+    flash_stress_t *stress = param;
+    uint8_t *chunk = malloc(FLASH_STRESS_CHUNK);
+    if (chunk)
+        memset(chunk, 0x55, FLASH_STRESS_CHUNK);
+    while (chunk && !stress->stop)
+    {
+        FILE *f = fopen(FLASH_STRESS_PATH, "wb");
+        if (f == NULL)
+        {
+            stress->errors++;
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        for (int i = 0; i < FLASH_STRESS_FILE_CHUNKS && !stress->stop; i++)
+        {
+            int64_t start = esp_timer_get_time();
+            if (fwrite(chunk, 1, FLASH_STRESS_CHUNK, f) != FLASH_STRESS_CHUNK || fflush(f) != 0 || fsync(fileno(f)) != 0)
+            {
+                stress->errors++;
+                break;
+            }
+            int64_t elapsed = esp_timer_get_time() - start;
+            if (elapsed > stress->longest_us)
+                stress->longest_us = elapsed;
+            stress->bytes += FLASH_STRESS_CHUNK;
+        }
+        fclose(f);
+    }
+    remove(FLASH_STRESS_PATH);
+    free(chunk);
+    xEventGroupSetBits(stress->done, FLASH_STRESS_DONE_BIT);
+    vTaskDelete(NULL);
+}
+
+/* Soak test while the FAT partition is written, bytes lost while the flash cache is off show as overruns */
+static int start_flash_stress()
+{
+    sim800_soak_result_t result;
+    esp_modem_uart_stats_t before, after;
+    flash_stress_t stress = {0};
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    stress.done = xEventGroupCreate();
+    if (stress.done == NULL)
+        return 1;
+    esp_modem_get_uart_stats(dce->dte, &before);
+    if (xTaskCreate(flash_stress_writer, "flash_stress", 3072, &stress, 1, NULL) != pdPASS)
+    {
+        vEventGroupDelete(stress.done);
+        return 1;
+    }
+    printf("Flash stress at %d baud, flow control %d, RX FIFO threshold %d, %d rounds\n", dce->dte->baud_rate,
+           dce->dte->flow_ctrl, CONFIG_EXAMPLE_UART_RXFIFO_FULL_THRESHOLD, FLASH_STRESS_ROUNDS);
+    esp_err_t ret = sim800_soak_test(dce, FLASH_STRESS_ROUNDS, &result);
+    stress.stop = true;
+    xEventGroupWaitBits(stress.done, FLASH_STRESS_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    vEventGroupDelete(stress.done);
+    esp_modem_get_uart_stats(dce->dte, &after);
+
+    printf("rounds: %d, failed: %d, mismatched: %d, received: %d bytes in %d ms\n",
+           result.rounds, result.failed, result.mismatched, result.bytes, result.elapsed_ms);
+    printf("written: %d bytes to %s, %d errors, slowest %d byte chunk %d ms\n", stress.bytes, FLASH_STRESS_PATH,
+           stress.errors, FLASH_STRESS_CHUNK, (int)(stress.longest_us / 1000));
+    printf("fifo overflows: %d, buffer full: %d, pattern overflows: %d, dropped: %d bytes\n",
+           after.fifo_overflows - before.fifo_overflows, after.buffer_full - before.buffer_full,
+           after.pattern_overflows - before.pattern_overflows, after.bytes_dropped - before.bytes_dropped);
+    ret = ret == ESP_OK && stress.bytes && !stress.errors ? ESP_OK : ESP_FAIL;
+    printf("%s\n", ret == ESP_OK ? "PASS" : "FAIL");
+    return ret == ESP_OK ? 0 : 1;
+}
+
+#define PIN_BENCH_ROUNDS (20)
+#define PIN_BENCH_EVENT_PRIORITY (5)
+/* Just above the lwIP tcpip thread */
+#define PIN_BENCH_HIGH_PRIORITY (19)
+
+/* Task layouts compared by start pinbench, those using core 1 are skipped on a single core */
+static const struct
+{
+    const char *name;
+    BaseType_t rx_core;
+    UBaseType_t rx_priority;
+    BaseType_t event_core;
+    UBaseType_t event_priority;
+} pin_bench_layouts[] = {
+    {"floating", tskNO_AFFINITY, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, tskNO_AFFINITY, 0},
+    {"rx 0", 0, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, tskNO_AFFINITY, 0},
+    {"rx 1", 1, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, tskNO_AFFINITY, 0},
+    {"rx 1, events 0", 1, CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY, 0, PIN_BENCH_EVENT_PRIORITY},
+    {"rx 1 high, events 0", 1, PIN_BENCH_HIGH_PRIORITY, 0, PIN_BENCH_EVENT_PRIORITY},
+};
+
+static bool pin_bench_fits(BaseType_t core)
+{
+    return core == tskNO_AFFINITY || core < portNUM_PROCESSORS;
+}
+
+static int pin_bench_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Round trip of AT+CLAC under each layout: the spread of the round times is the RX latency jitter */
+static int start_pin_bench()
+{
+    modem_instance_t *modem = &modems[selected_modem];
+    const esp_modem_dte_config_t saved = modem->dte_config;
+    bool was_started = modem->dce != NULL;
+    uint32_t round_us[PIN_BENCH_ROUNDS];
+    uint32_t expected = 0;
+    int failed = 0;
+
+    printf("%-20s %6s %7s %7s %7s %9s %8s %8s\n", "layout", "rounds", "p50 ms", "p99 ms", "max ms", "jitter ms",
+           "bytes/s", "overruns");
+    for (size_t l = 0; l < sizeof(pin_bench_layouts) / sizeof(pin_bench_layouts[0]); l++)
+    {
+        if (!pin_bench_fits(pin_bench_layouts[l].rx_core) || !pin_bench_fits(pin_bench_layouts[l].event_core))
+            continue;
+        stop_modem();
+        modem->dte_config.rx_task_core = pin_bench_layouts[l].rx_core;
+        modem->dte_config.rx_task_priority = pin_bench_layouts[l].rx_priority;
+        modem->dte_config.event_task_core = pin_bench_layouts[l].event_core;
+        modem->dte_config.event_task_priority = pin_bench_layouts[l].event_priority;
+        start_modem();
+        if (dce == NULL)
+        {
+            printf("%-20s start failed\n", pin_bench_layouts[l].name);
+            failed++;
+            continue;
+        }
+        sim800_soak_result_t result;
+        /* The first round also waits for the identity read in the background */
+        sim800_soak_test(dce, 1, &result);
+        uint32_t rounds = 0, bytes = 0, overruns = 0;
+        int64_t busy_us = 0;
+        for (int i = 0; i < PIN_BENCH_ROUNDS; i++)
+        {
+            int64_t start = esp_timer_get_time();
+            esp_err_t ret = sim800_soak_test(dce, 1, &result);
+            int64_t elapsed = esp_timer_get_time() - start;
+            overruns += result.overruns;
+            if (!expected)
+                expected = result.bytes;
+            if (ret != ESP_OK || result.bytes != expected)
+            {
+                failed++;
+                continue;
+            }
+            round_us[rounds++] = elapsed;
+            bytes += result.bytes;
+            busy_us += elapsed;
+        }
+        if (!rounds)
+        {
+            printf("%-20s no complete round\n", pin_bench_layouts[l].name);
+            continue;
+        }
+        qsort(round_us, rounds, sizeof(round_us[0]), pin_bench_compare);
+        uint32_t p50 = round_us[rounds / 2], p99 = round_us[rounds * 99 / 100];
+        printf("%-20s %6d %7.1f %7.1f %7.1f %9.1f %8d %8d\n", pin_bench_layouts[l].name, rounds, p50 / 1000.0,
+               p99 / 1000.0, round_us[rounds - 1] / 1000.0, (p99 - p50) / 1000.0,
+               (uint32_t)((uint64_t)bytes * 1000000 / busy_us), overruns);
+    }
+    stop_modem();
+    modem->dte_config = saved;
+    if (was_started)
+        start_modem();
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
+
+#define LINK_BENCH_BIT_RATE (115200)
+#define LINK_BENCH_SIZE (32 * 1024)
+
+/* Simulated modem link: takes as long as the UART would to clock the chunk out */
+static int link_bench_send(void *ctx, const uint8_t *data, size_t len)
+{
+    uint32_t bit_rate = *(const uint32_t *)ctx;
+    vTaskDelay(pdMS_TO_TICKS((uint64_t)len * 10 * 1000 / bit_rate));
+    return len;
+}
+
+static uint32_t link_bench_run(uint8_t *data)
+{
+    int64_t start = esp_timer_get_time();
+    if (esp_modem_link_send(data, LINK_BENCH_SIZE, 0) != ESP_OK)
+        return 0;
+    int64_t elapsed = esp_timer_get_time() - start;
+    return (uint32_t)((uint64_t)LINK_BENCH_SIZE * 10 * 1000000 / elapsed);
+}
+
+static int start_link_bench()
+{
+    static const uint32_t bit_rate = LINK_BENCH_BIT_RATE;
+    esp_modem_link_config_t config = {
+        .bit_rate = LINK_BENCH_BIT_RATE,
+        .send = link_bench_send,
+        .ctx = (void *)&bit_rate,
+    };
+    esp_modem_link_t *links[2] = {NULL, NULL};
+    uint8_t *data = calloc(1, LINK_BENCH_SIZE);
+    if (data == NULL)
+        return 1;
+
+    config.name = "sim0";
+    links[0] = esp_modem_link_add(&config);
+    printf("1 link : %d bit/s\n", link_bench_run(data));
+    config.name = "sim1";
+    links[1] = esp_modem_link_add(&config);
+    esp_modem_link_reset_stats();
+    printf("2 links: %d bit/s\n", link_bench_run(data));
+
+    esp_modem_link_stats_t stats[ESP_MODEM_LINK_MAX];
+    int count = esp_modem_link_get_stats(stats);
+    for (int i = 0; i < count; i++)
+        printf("  %s: %d chunks, %d bytes, busy %d ms\n", stats[i].name, stats[i].chunks,
+               (uint32_t)stats[i].bytes, (uint32_t)(stats[i].busy_us / 1000));
+
+    for (int i = 0; i < 2; i++)
+        if (links[i])
+            esp_modem_link_remove(links[i]);
+    free(data);
+    return 0;
+}
+
+#if CONFIG_EXAMPLE_MODEM_SLEEP
+#define SLEEP_BENCH_ROUNDS (6)
+/* Between two telemetry rounds, long enough for the modem to fall asleep */
+#define SLEEP_BENCH_INTERVAL_MS (2 * CONFIG_EXAMPLE_MODEM_SLEEP_IDLE)
+
+/* Telemetry rounds as the MQTT reporting sends them, the modem sleeping in between */
+static int start_sleep_bench()
+{
+    esp_modem_sleep_stats_t stats;
+    const esp_modem_sleep_power_t power = ESP_MODEM_SLEEP_DEFAULT_POWER();
+    int failed = 0;
+    int64_t longest_us = 0;
+    if (dce == NULL)
+    {
+        printf("Modem not started\r\n");
+        return 1;
+    }
+    if (esp_modem_sleep_get_stats(dce, &stats) != ESP_OK)
+    {
+        printf("Sleep manager not enabled\r\n");
+        return 1;
+    }
+    printf("Sleep bench: %d rounds, %d ms apart\n", SLEEP_BENCH_ROUNDS, SLEEP_BENCH_INTERVAL_MS);
+    esp_modem_sleep_reset_stats(dce);
+    for (int i = 0; i < SLEEP_BENCH_ROUNDS; i++)
+    {
+        uint32_t a, b, c;
+        int64_t start = esp_timer_get_time();
+        esp_modem_cache_invalidate(dce, ESP_MODEM_CACHE_MAX);
+        if (dce->get_signal_quality(dce, &a, &b) != ESP_OK || dce->get_battery_status(dce, &a, &b, &c) != ESP_OK ||
+            dce->get_network_status(dce, &a, &b) != ESP_OK)
+            failed++;
+        int64_t elapsed = esp_timer_get_time() - start;
+        if (elapsed > longest_us)
+            longest_us = elapsed;
+        printf("%d: %lld ms\n", i, elapsed / 1000);
+        vTaskDelay(pdMS_TO_TICKS(SLEEP_BENCH_INTERVAL_MS));
+    }
+    esp_modem_sleep_get_stats(dce, &stats);
+    uint64_t total_us = stats.asleep_us + stats.awake_us;
+    printf("rounds: %d, failed: %d, longest %lld ms; %u sleeps, %u refused, %u wakes, %u%% asleep\n",
+           SLEEP_BENCH_ROUNDS, failed, longest_us / 1000, stats.sleeps, stats.refused, stats.wakes,
+           total_us ? (uint32_t)(stats.asleep_us * 100 / total_us) : 0);
+    printf("wake-up: last %u ms, max %u ms, budget %u ms, %u over%s\n", stats.last_wake_ms, stats.max_wake_ms,
+           CONFIG_EXAMPLE_MODEM_SLEEP_LATENCY_BUDGET, stats.over_budget, stats.disabled ? ", sleep disabled" : "");
+    printf("energy per round: %llu uJ awake, %llu uJ modem sleep, %llu uJ modem and chip sleep\n",
+           esp_modem_sleep_awake_energy_uj(&stats, &power) / SLEEP_BENCH_ROUNDS,
+           esp_modem_sleep_energy_uj(&stats, &power, false) / SLEEP_BENCH_ROUNDS,
+           esp_modem_sleep_energy_uj(&stats, &power, true) / SLEEP_BENCH_ROUNDS);
+    bool ok = !failed && !stats.disabled && !stats.over_budget && stats.wakes + 1 >= SLEEP_BENCH_ROUNDS;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
+#endif
+
+/****************************************************************/
+/** @brief start - start something                             */
+
+static struct
+{
+    struct arg_str *suffix;
+    struct arg_end *end;
+} start_args;
+
+static int start_command(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&start_args);
+    if (nerrors != 0)
+    {
+        arg_print_errors(stderr, start_args.end, argv[0]);
+        return 1;
+    }
+    if (start_args.suffix->count)
+    {
+
+        if (strstr(start_args.suffix->sval[0], "modem"))
         {
             start_modem();
         }
@@ -377,6 +1846,33 @@ static int start_command(int argc, char **argv)
         {
             start_test();
         }
+
+        if (strstr(start_args.suffix->sval[0], "soak"))
+        {
+            start_soak();
+        }
+
+        if (strstr(start_args.suffix->sval[0], "linkbench"))
+        {
+            start_link_bench();
+        }
+
+        if (strstr(start_args.suffix->sval[0], "flash"))
+        {
+            start_flash_stress();
+        }
+
+        if (strstr(start_args.suffix->sval[0], "pinbench"))
+        {
+            start_pin_bench();
+        }
+#if CONFIG_EXAMPLE_MODEM_SLEEP
+
+        if (strstr(start_args.suffix->sval[0], "sleep"))
+        {
+            start_sleep_bench();
+        }
+#endif
     }
     return 0;
 }
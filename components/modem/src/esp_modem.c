@@ -22,6 +22,12 @@
 #include "lwip/dns.h"
 #include "tcpip_adapter.h"
 #include "esp_modem.h"
+#include "esp_modem_stats.h"
+#include "esp_modem_capture.h"
+#include "esp_modem_static.h"
+#include "esp_modem_pool.h"
+#include "esp_modem_supply.h"
+#include "esp_modem_ext.h"
 #include "esp_log.h"
 #include "sdkconfig.h"
 
@@ -31,6 +37,11 @@
 #define MIN_PATTERN_INTERVAL (10000)
 #define MIN_POST_IDLE (10)
 #define MIN_PRE_IDLE (10)
+#define ESP_MODEM_RX_TIMEOUT_THRESH (10)  /*!< Symbol times of silence before the FIFO is drained, as the driver sets it */
+#define ESP_MODEM_TXFIFO_EMPTY_THRESH (10) /*!< As the driver sets it */
+#define ESP_MODEM_PPP_CLOSE_TIMEOUT (6000) /*!< LCP Terminate-Request sent twice, 3 s apart, as lwIP does */
+#define ESP_MODEM_PPP_CLOSE_POLL_MS (10)
+#define ESP_MODEM_PPP_FLUSH_QUIET_MS (200) /*!< Uplink silence that counts as the sockets being done */
 
 /**
  * @brief Macro defined for error checking
@@ -75,12 +86,37 @@ typedef struct
     QueueHandle_t event_queue;              /*!< UART event queue handle */
     esp_event_loop_handle_t event_loop_hdl; /*!< Event loop handle */
     TaskHandle_t uart_event_task_hdl;       /*!< UART event task handle */
+    bool dispatch_events;                   /*!< The UART event task runs the event loop, it has no task of its own */
+    volatile bool stopping;                 /*!< Asks the UART event task to exit */
+    SemaphoreHandle_t exit_sem;             /*!< Given by the UART event task when it has exited */
     SemaphoreHandle_t process_sem;          /*!< Semaphore used for indicating processing status */
     struct netif pppif;                     /*!< PPP network interface */
     ppp_pcb *ppp;                           /*!< PPP control block */
+    esp_modem_uart_stats_t stats;           /*!< Receive overrun counters */
+    int tx_io_num;                          /*!< TXD pin */
+    int rx_io_num;                          /*!< RXD pin */
+    int rts_io_num;                         /*!< RTS pin */
+    int cts_io_num;                         /*!< CTS pin */
     modem_dte_t parent;                     /*!< DTE interface that should extend */
 } esp_modem_dte_t;
 
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+/**
+ * @brief A DTE with its line buffer, semaphore and UART event task, in one static slot
+ *
+ */
+typedef struct {
+    esp_modem_dte_t dte;                                                  /*!< First, the slot is freed through it */
+    uint8_t buffer[ESP_MODEM_LINE_BUFFER_SIZE];                           /*!< esp_dte->buffer */
+    StaticSemaphore_t process_sem;                                        /*!< esp_dte->process_sem */
+    StaticSemaphore_t exit_sem;                                           /*!< esp_dte->exit_sem */
+    StaticTask_t uart_event_task;                                         /*!< esp_dte->uart_event_task_hdl */
+    StackType_t uart_event_stack[CONFIG_EXAMPLE_UART_EVENT_TASK_STACK_SIZE]; /*!< Its stack */
+} esp_modem_dte_storage_t;
+
+ESP_MODEM_STATIC_POOL(s_dte_pool, esp_modem_dte_storage_t);
+#endif
+
 /**
  * @brief Handle one line in DTE
  *
@@ -89,7 +125,7 @@ typedef struct
  *      - ESP_OK on success
  *      - ESP_FAIL on error
  */
-static esp_err_t esp_dte_handle_line(esp_modem_dte_t *esp_dte)
+static ESP_MODEM_RX_ATTR esp_err_t esp_dte_handle_line(esp_modem_dte_t *esp_dte)
 {
     modem_dce_t *dce = esp_dte->parent.dce;
     MODEM_CHECK(dce, "DTE has not yet bind with DCE", err);
@@ -99,6 +135,12 @@ static esp_err_t esp_dte_handle_line(esp_modem_dte_t *esp_dte)
     /* Skip pure "\r\n" lines */
     if (strlen(line) > 2)
     {
+        if (dce->state == MODEM_STATE_PROCESSING)
+        {
+            esp_modem_stats_line(dce->stats, line);
+        }
+        /* Let the extensions and the DCE observe URCs whatever command is in progress */
+        esp_modem_ext_handle_urc(dce, line);
         MODEM_CHECK(dce->handle_line, "no handler for line", err_handle);
         MODEM_CHECK(dce->handle_line(dce, line) == ESP_OK, "handle line failed", err_handle);
     }
@@ -116,7 +158,7 @@ err:
  *
  * @param esp_dte ESP32 Modem DTE object
  */
-static void esp_handle_uart_pattern(esp_modem_dte_t *esp_dte)
+static ESP_MODEM_RX_ATTR void esp_handle_uart_pattern(esp_modem_dte_t *esp_dte)
 {
     int pos = uart_pattern_pop_pos(esp_dte->uart_port);
     int read_len = 0;
@@ -135,6 +177,7 @@ static void esp_handle_uart_pattern(esp_modem_dte_t *esp_dte)
         read_len = uart_read_bytes(esp_dte->uart_port, esp_dte->buffer, read_len, pdMS_TO_TICKS(10));
         if (read_len)
         {
+            esp_modem_capture_record(esp_dte->uart_port, ESP_MODEM_CAPTURE_RX, esp_dte->buffer, read_len);
             /* make sure the line is a standard string */
             esp_dte->buffer[read_len] = '\0';
             /* Send new line to handle */
@@ -147,7 +190,12 @@ static void esp_handle_uart_pattern(esp_modem_dte_t *esp_dte)
     }
     else
     {
+        size_t length = 0;
+        uart_get_buffered_data_len(esp_dte->uart_port, &length);
         ESP_LOGW(MODEM_TAG, "Pattern Queue Size too small");
+        esp_modem_capture_fault(esp_dte->uart_port, "pattern queue overflow");
+        esp_dte->stats.pattern_overflows++;
+        esp_dte->stats.bytes_dropped += length;
         uart_flush(esp_dte->uart_port);
     }
 }
@@ -157,19 +205,35 @@ static void esp_handle_uart_pattern(esp_modem_dte_t *esp_dte)
  *
  * @param esp_dte ESP32 Modem DTE object
  */
-static void esp_handle_uart_data(esp_modem_dte_t *esp_dte)
+static ESP_MODEM_RX_ATTR void esp_handle_uart_data(esp_modem_dte_t *esp_dte)
 {
     size_t length = 0;
     uart_get_buffered_data_len(esp_dte->uart_port, &length);
     length = MIN(ESP_MODEM_LINE_BUFFER_SIZE, length);
     length = uart_read_bytes(esp_dte->uart_port, esp_dte->buffer, length, portMAX_DELAY);
+    esp_dte->stats.bytes_received += length;
     /* pass input data to the lwIP core thread */
-    if (length)
+    if (length && esp_dte->ppp)
     {
+        esp_modem_capture_record(esp_dte->uart_port, ESP_MODEM_CAPTURE_RX, esp_dte->buffer, length);
         pppos_input_tcpip(esp_dte->ppp, esp_dte->buffer, length);
     }
 }
 
+/**
+ * @brief Throw away everything received so far, counting what is lost
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ */
+static void esp_modem_dte_drop_input(esp_modem_dte_t *esp_dte)
+{
+    size_t length = 0;
+    uart_get_buffered_data_len(esp_dte->uart_port, &length);
+    esp_dte->stats.bytes_dropped += length;
+    uart_flush_input(esp_dte->uart_port);
+    xQueueReset(esp_dte->event_queue);
+}
+
 /**
  * @brief UART Event Task Entry
  *
@@ -179,14 +243,16 @@ static void uart_event_task_entry(void *param)
 {
     esp_modem_dte_t *esp_dte = (esp_modem_dte_t *)param;
     uart_event_t event;
-    while (1)
+    while (!esp_dte->stopping)
     {
-        if (xQueueReceive(esp_dte->event_queue, &event, pdMS_TO_TICKS(100))) //originally pdMS_TO_TICKS(100)
+        /* No timeout, so that an idle modem lets the chip sleep: deinit and events posted
+           from other tasks wake the task with UART_EVENT_MAX */
+        if (xQueueReceive(esp_dte->event_queue, &event, portMAX_DELAY))
         {
             switch (event.type)
             {
             case UART_DATA:
-                if (esp_dte->parent.dce->mode == MODEM_PPP_MODE)
+                if (esp_dte->parent.dce && esp_dte->parent.dce->mode == MODEM_PPP_MODE)
                 {
                     esp_handle_uart_data(esp_dte);
                 }
@@ -204,13 +270,24 @@ static void uart_event_task_entry(void *param)
                 break;
             case UART_FIFO_OVF:
                 ESP_LOGW(MODEM_TAG, "HW FIFO Overflow");
-                uart_flush_input(esp_dte->uart_port);
-                xQueueReset(esp_dte->event_queue);
+                esp_modem_capture_fault(esp_dte->uart_port, "fifo overflow");
+                esp_dte->stats.fifo_overflows++;
+                esp_modem_dte_drop_input(esp_dte);
                 break;
             case UART_BUFFER_FULL:
+                esp_dte->stats.buffer_full++;
+                if (esp_dte->parent.flow_ctrl == MODEM_FLOW_CONTROL_HW)
+                {
+                    /* The driver stops reading the FIFO and RTS holds the modem off, nothing is lost */
+                    if (esp_dte->parent.dce && esp_dte->parent.dce->mode == MODEM_PPP_MODE)
+                    {
+                        esp_handle_uart_data(esp_dte);
+                    }
+                    break;
+                }
                 ESP_LOGW(MODEM_TAG, "Ring Buffer Full");
-                uart_flush_input(esp_dte->uart_port);
-                xQueueReset(esp_dte->event_queue);
+                esp_modem_capture_fault(esp_dte->uart_port, "rx buffer full");
+                esp_modem_dte_drop_input(esp_dte);
                 break;
             case UART_BREAK:
                 ESP_LOGW(MODEM_TAG, "Rx Break");
@@ -224,15 +301,26 @@ static void uart_event_task_entry(void *param)
             case UART_PATTERN_DET:
                 esp_handle_uart_pattern(esp_dte);
                 break;
+            case UART_EVENT_MAX:
+                /* Posted by esp_modem_dte_deinit() and esp_modem_post_event() to end the wait */
+                break;
             default:
                 ESP_LOGW(MODEM_TAG, "unknown uart event type: %d", event.type);
                 break;
             }
         }
-        /* Drive the event loop */
-        esp_event_loop_run(esp_dte->event_loop_hdl, pdMS_TO_TICKS(10));
+        /* Drive the event loop, unless it has a task of its own */
+        if (esp_dte->dispatch_events)
+        {
+            esp_event_loop_run(esp_dte->event_loop_hdl, pdMS_TO_TICKS(10));
+        }
+    }
+    xSemaphoreGive(esp_dte->exit_sem);
+    /* Deleted by esp_modem_dte_deinit(), so that a static task is off every list before its memory is reused */
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
-    vTaskDelete(NULL);
 }
 
 /**
@@ -253,14 +341,33 @@ static esp_err_t esp_modem_dte_send_cmd(modem_dte_t *dte, const char *command, u
     MODEM_CHECK(command, "command is NULL", err);
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
     /* Calculate timeout clock tick */
+    TickType_t start = xTaskGetTickCount();
+    TickType_t ticks = pdMS_TO_TICKS(timeout);
+    /* Drop a completion left behind by a previous command that timed out */
+    xSemaphoreTake(esp_dte->process_sem, 0);
     /* Reset runtime information */
     dce->state = MODEM_STATE_PROCESSING;
     /* Send command via UART */
+    esp_modem_capture_record(esp_dte->uart_port, ESP_MODEM_CAPTURE_TX, command, strlen(command));
     uart_write_bytes(esp_dte->uart_port, command, strlen(command));
     /* Check timeout */
     while (dce->state == MODEM_STATE_PROCESSING)
     {
-        xSemaphoreTake(esp_dte->process_sem, pdMS_TO_TICKS(1000));
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= ticks)
+        {
+            break;
+        }
+        xSemaphoreTake(esp_dte->process_sem, ticks - elapsed);
+    }
+    if (dce->state == MODEM_STATE_PROCESSING)
+    {
+        /* No final result code in time, late lines go to the default handler */
+        dce->state = MODEM_STATE_FAIL;
+        dce->handle_line = dce->handle_line_default;
+        ESP_LOGW(MODEM_TAG, "command timeout after %d ms", timeout);
+        esp_modem_capture_fault(esp_dte->uart_port, "command timeout");
+        goto err;
     }
 
     ret = ESP_OK;
@@ -281,6 +388,7 @@ static int esp_modem_dte_send_data(modem_dte_t *dte, const char *data, uint32_t
 {
     MODEM_CHECK(data, "data is NULL", err);
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    esp_modem_capture_record(esp_dte->uart_port, ESP_MODEM_CAPTURE_TX, data, length);
     return uart_write_bytes(esp_dte->uart_port, data, length);
 err:
     return -1;
@@ -307,23 +415,42 @@ static esp_err_t esp_modem_dte_send_wait(modem_dte_t *dte, const char *data, uin
     // We'd better disable pattern detection here for a moment in case prompt string contains the pattern character
     uart_disable_pattern_det_intr(esp_dte->uart_port);
     // uart_disable_rx_intr(esp_dte->uart_port);
+    esp_modem_capture_record(esp_dte->uart_port, ESP_MODEM_CAPTURE_TX, data, length);
     MODEM_CHECK(uart_write_bytes(esp_dte->uart_port, data, length) >= 0, "uart write bytes failed", err_write);
     uint32_t len = strlen(prompt);
-    uint8_t *buffer = calloc(len + 1, sizeof(uint8_t));
+    uint8_t *buffer = esp_modem_pool_calloc(len + 1);
+    MODEM_CHECK(buffer, "no memory for prompt", err_write);
     int res = uart_read_bytes(esp_dte->uart_port, buffer, len, pdMS_TO_TICKS(timeout));
+    if (res > 0)
+    {
+        esp_modem_capture_record(esp_dte->uart_port, ESP_MODEM_CAPTURE_RX, buffer, res);
+    }
     MODEM_CHECK(res >= len, "wait prompt [%s] timeout", err, prompt);
     MODEM_CHECK(!strncmp(prompt, (const char *)buffer, len), "get wrong prompt: %s", err, buffer);
-    free(buffer);
+    esp_modem_pool_free(buffer);
     uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE);
     return ESP_OK;
 err:
-    free(buffer);
+    esp_modem_pool_free(buffer);
 err_write:
     uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE);
 err_param:
     return ESP_FAIL;
 }
 
+/**
+ * @brief Stop passing input to PPP and split it into lines again
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ */
+static void esp_modem_dte_line_mode(esp_modem_dte_t *esp_dte)
+{
+    uart_disable_rx_intr(esp_dte->uart_port);
+    uart_flush(esp_dte->uart_port);
+    uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE);
+    uart_pattern_queue_reset(esp_dte->uart_port, CONFIG_EXAMPLE_UART_PATTERN_QUEUE_SIZE);
+}
+
 /**
  * @brief Change Modem's working mode
  *
@@ -347,10 +474,7 @@ static esp_err_t esp_modem_dte_change_mode(modem_dte_t *dte, modem_mode_t new_mo
         uart_enable_rx_intr(esp_dte->uart_port);
         break;
     case MODEM_COMMAND_MODE:
-        uart_disable_rx_intr(esp_dte->uart_port);
-        uart_flush(esp_dte->uart_port);
-        uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE);
-        uart_pattern_queue_reset(esp_dte->uart_port, CONFIG_EXAMPLE_UART_PATTERN_QUEUE_SIZE);
+        esp_modem_dte_line_mode(esp_dte);
         MODEM_CHECK(dce->set_working_mode(dce, new_mode) == ESP_OK, "set new working mode:%d failed", err, new_mode);
         break;
     default:
@@ -369,6 +493,84 @@ static esp_err_t esp_modem_dte_process_cmd_done(modem_dte_t *dte)
     return xSemaphoreGive(esp_dte->process_sem) == pdTRUE ? ESP_OK : ESP_FAIL;
 }
 
+/**
+ * @brief Change the UART baud rate
+ *
+ * Pending output is sent at the old rate first, input received meanwhile is dropped.
+ *
+ * @param dte Modem DTE object
+ * @param baud_rate new baud rate
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+static esp_err_t esp_modem_dte_set_baud_rate(modem_dte_t *dte, uint32_t baud_rate)
+{
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    MODEM_CHECK(uart_wait_tx_done(esp_dte->uart_port, pdMS_TO_TICKS(MODEM_COMMAND_TIMEOUT_DEFAULT)) == ESP_OK,
+                "wait tx done failed", err);
+    MODEM_CHECK(uart_set_baudrate(esp_dte->uart_port, baud_rate) == ESP_OK, "set baud rate failed", err);
+    uart_flush_input(esp_dte->uart_port);
+    dte->baud_rate = baud_rate;
+    ESP_LOGD(MODEM_TAG, "baud rate set to %d", baud_rate);
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Apply a flow control type to the UART
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ * @param flow_ctrl flow control type
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+static esp_err_t esp_modem_uart_set_flow_ctrl(esp_modem_dte_t *esp_dte, modem_flow_ctrl_t flow_ctrl)
+{
+    esp_err_t res;
+    uart_port_t uart_port = esp_dte->uart_port;
+    if (flow_ctrl == MODEM_FLOW_CONTROL_HW)
+    {
+        res = uart_set_pin(uart_port, esp_dte->tx_io_num, esp_dte->rx_io_num, esp_dte->rts_io_num, esp_dte->cts_io_num);
+    }
+    else
+    {
+        res = uart_set_pin(uart_port, esp_dte->tx_io_num, esp_dte->rx_io_num, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    MODEM_CHECK(res == ESP_OK, "config uart gpio failed", err);
+    /* RTS is released once the RX FIFO fills up to the threshold */
+    res = uart_set_hw_flow_ctrl(uart_port, flow_ctrl == MODEM_FLOW_CONTROL_HW ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
+                                CONFIG_EXAMPLE_UART_RTS_THRESHOLD);
+    res |= uart_set_sw_flow_ctrl(uart_port, flow_ctrl == MODEM_FLOW_CONTROL_SW, 8, CONFIG_EXAMPLE_UART_RTS_THRESHOLD);
+    MODEM_CHECK(res == ESP_OK, "config uart flow control failed", err);
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Change the flow control of the DTE side
+ *
+ * @param dte Modem DTE object
+ * @param flow_ctrl flow control type
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on error
+ */
+static esp_err_t esp_modem_dte_set_flow_ctrl(modem_dte_t *dte, modem_flow_ctrl_t flow_ctrl)
+{
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    MODEM_CHECK(uart_wait_tx_done(esp_dte->uart_port, pdMS_TO_TICKS(MODEM_COMMAND_TIMEOUT_DEFAULT)) == ESP_OK,
+                "wait tx done failed", err);
+    MODEM_CHECK(esp_modem_uart_set_flow_ctrl(esp_dte, flow_ctrl) == ESP_OK, "set flow control failed", err);
+    dte->flow_ctrl = flow_ctrl;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
 /**
  * @brief Deinitialize a Modem DTE object
  *
@@ -380,21 +582,30 @@ static esp_err_t esp_modem_dte_process_cmd_done(modem_dte_t *dte)
 esp_err_t esp_modem_dte_deinit(modem_dte_t *dte)
 {
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
-    /* Delete UART event task */
+    /* Let the UART event task finish the event or the dispatch it is in, then wake it to exit */
+    const uart_event_t wake = {.type = UART_EVENT_MAX};
+    esp_dte->stopping = true;
+    xQueueSend(esp_dte->event_queue, &wake, 0);
+    xSemaphoreTake(esp_dte->exit_sem, portMAX_DELAY);
     vTaskDelete(esp_dte->uart_event_task_hdl);
-    /* Delete semaphore */
+    /* Delete semaphores */
+    vSemaphoreDelete(esp_dte->exit_sem);
     vSemaphoreDelete(esp_dte->process_sem);
     /* Delete event loop */
     esp_event_loop_delete(esp_dte->event_loop_hdl);
     /* Uninstall UART Driver */
     uart_driver_delete(esp_dte->uart_port);
-    /* Free memory */
-    free(esp_dte->buffer);
     if (dte->dce)
     {
         dte->dce->dte = NULL;
     }
+    /* Free memory */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_dte_pool, esp_dte);
+#else
+    free(esp_dte->buffer);
     free(esp_dte);
+#endif
     esp_dte = NULL;
     return ESP_OK;
 }
@@ -402,21 +613,43 @@ esp_err_t esp_modem_dte_deinit(modem_dte_t *dte)
 modem_dte_t *esp_modem_dte_init(const esp_modem_dte_config_t *config)
 {
     esp_err_t res;
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    /* Take a static slot holding the object, its line buffer and its task */
+    esp_modem_dte_storage_t *storage = esp_modem_static_calloc(&s_dte_pool);
+    MODEM_CHECK(storage, "no static slot for esp_dte", err_dte_mem);
+    esp_modem_dte_t *esp_dte = &storage->dte;
+    esp_dte->buffer = storage->buffer;
+#else
     /* malloc memory for esp_dte object */
     esp_modem_dte_t *esp_dte = calloc(1, sizeof(esp_modem_dte_t));
     MODEM_CHECK(esp_dte, "calloc esp_dte failed", err_dte_mem);
     /* malloc memory to storing lines from modem dce */
     esp_dte->buffer = calloc(1, ESP_MODEM_LINE_BUFFER_SIZE);
     MODEM_CHECK(esp_dte->buffer, "calloc line memory failed", err_line_mem);
+#endif
+#if CONFIG_EXAMPLE_MODEM_CAPTURE
+    /* One ring for every DTE, only the first one allocates it */
+    if (esp_modem_capture_init(CONFIG_EXAMPLE_MODEM_CAPTURE_SIZE, CONFIG_EXAMPLE_MODEM_CAPTURE_DIR "/fault.cap") != ESP_OK)
+    {
+        ESP_LOGW(MODEM_TAG, "traffic capture not available");
+    }
+#endif
     /* Set attributes */
     esp_dte->uart_port = config->port_num;
     esp_dte->parent.flow_ctrl = config->flow_control;
+    esp_dte->parent.baud_rate = config->baud_rate;
+    esp_dte->tx_io_num = config->tx_io_num;
+    esp_dte->rx_io_num = config->rx_io_num;
+    esp_dte->rts_io_num = config->rts_io_num;
+    esp_dte->cts_io_num = config->cts_io_num;
     /* Bind methods */
     esp_dte->parent.send_cmd = esp_modem_dte_send_cmd;
     esp_dte->parent.send_data = esp_modem_dte_send_data;
     esp_dte->parent.send_wait = esp_modem_dte_send_wait;
     esp_dte->parent.change_mode = esp_modem_dte_change_mode;
     esp_dte->parent.process_cmd_done = esp_modem_dte_process_cmd_done;
+    esp_dte->parent.set_baud_rate = esp_modem_dte_set_baud_rate;
+    esp_dte->parent.set_flow_ctrl = esp_modem_dte_set_flow_ctrl;
     esp_dte->parent.deinit = esp_modem_dte_deinit;
     /* Config UART */
     uart_config_t uart_config = {
@@ -424,58 +657,85 @@ modem_dte_t *esp_modem_dte_init(const esp_modem_dte_config_t *config)
         .data_bits = config->data_bits,
         .parity = config->parity,
         .stop_bits = config->stop_bits,
-        .flow_ctrl = (config->flow_control == MODEM_FLOW_CONTROL_HW) ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE};
+        .flow_ctrl = (config->flow_control == MODEM_FLOW_CONTROL_HW) ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = CONFIG_EXAMPLE_UART_RTS_THRESHOLD};
     MODEM_CHECK(uart_param_config(esp_dte->uart_port, &uart_config) == ESP_OK, "config uart parameter failed", err_uart_config);
-    if (config->flow_control == MODEM_FLOW_CONTROL_HW)
-    {
-        res = uart_set_pin(esp_dte->uart_port, CONFIG_EXAMPLE_UART_MODEM_TX_PIN, CONFIG_EXAMPLE_UART_MODEM_RX_PIN,
-                           CONFIG_EXAMPLE_UART_MODEM_RTS_PIN, CONFIG_EXAMPLE_UART_MODEM_CTS_PIN);
-    }
-    else
-    {
-        res = uart_set_pin(esp_dte->uart_port, CONFIG_EXAMPLE_UART_MODEM_TX_PIN, CONFIG_EXAMPLE_UART_MODEM_RX_PIN,
-                           UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    }
-    MODEM_CHECK(res == ESP_OK, "config uart gpio failed", err_uart_config);
-    /* Set flow control threshold */
-    if (config->flow_control == MODEM_FLOW_CONTROL_HW)
-    {
-        res = uart_set_hw_flow_ctrl(esp_dte->uart_port, UART_HW_FLOWCTRL_CTS_RTS, UART_FIFO_LEN - 8);
-    }
-    else if (config->flow_control == MODEM_FLOW_CONTROL_SW)
-    {
-        res = uart_set_sw_flow_ctrl(esp_dte->uart_port, true, 8, UART_FIFO_LEN - 8);
-    }
+    /* Set pins and flow control threshold */
+    res = esp_modem_uart_set_flow_ctrl(esp_dte, config->flow_control);
     MODEM_CHECK(res == ESP_OK, "config uart flow control failed", err_uart_config);
     /* Install UART driver and get event queue used inside driver */
     res = uart_driver_install(esp_dte->uart_port, CONFIG_EXAMPLE_UART_RX_BUFFER_SIZE, CONFIG_EXAMPLE_UART_TX_BUFFER_SIZE,
                               CONFIG_EXAMPLE_UART_EVENT_QUEUE_SIZE, &(esp_dte->event_queue), 0);
     MODEM_CHECK(res == ESP_OK, "install uart driver failed", err_uart_config);
+    /* Drain the FIFO early: what is left above the threshold is all that holds modem bytes while
+       a flash write keeps the UART interrupt off */
+    uart_intr_config_t intr_config = {
+        .intr_enable_mask = UART_RXFIFO_FULL_INT_ENA_M | UART_RXFIFO_TOUT_INT_ENA_M | UART_FRM_ERR_INT_ENA_M |
+                            UART_RXFIFO_OVF_INT_ENA_M | UART_BRK_DET_INT_ENA_M | UART_PARITY_ERR_INT_ENA_M,
+        .rx_timeout_thresh = ESP_MODEM_RX_TIMEOUT_THRESH,
+        .txfifo_empty_intr_thresh = ESP_MODEM_TXFIFO_EMPTY_THRESH,
+        .rxfifo_full_thresh = CONFIG_EXAMPLE_UART_RXFIFO_FULL_THRESHOLD};
+    res = uart_intr_config(esp_dte->uart_port, &intr_config);
+    MODEM_CHECK(res == ESP_OK, "config uart interrupts failed", err_uart_pattern);
     /* Set pattern interrupt, used to detect the end of a line. */
     res = uart_enable_pattern_det_intr(esp_dte->uart_port, '\n', 1, MIN_PATTERN_INTERVAL, MIN_POST_IDLE, MIN_PRE_IDLE);
     /* Set pattern queue size */
     res |= uart_pattern_queue_reset(esp_dte->uart_port, CONFIG_EXAMPLE_UART_PATTERN_QUEUE_SIZE);
     MODEM_CHECK(res == ESP_OK, "config uart pattern failed", err_uart_pattern);
-    /* Create Event loop */
+    /* Create Event loop, dispatched by its own task or by the UART event task */
     esp_event_loop_args_t loop_args = {
         .queue_size = ESP_MODEM_EVENT_QUEUE_SIZE,
         .task_name = NULL};
+    if (config->event_task_priority)
+    {
+        loop_args.task_name = "modem_event";
+        loop_args.task_priority = config->event_task_priority;
+        loop_args.task_stack_size = CONFIG_EXAMPLE_MODEM_EVENT_TASK_STACK_SIZE;
+        loop_args.task_core_id = config->event_task_core;
+    }
+    esp_dte->dispatch_events = !config->event_task_priority;
     MODEM_CHECK(esp_event_loop_create(&loop_args, &esp_dte->event_loop_hdl) == ESP_OK, "create event loop failed", err_eloop);
     /* Create semaphore */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_dte->process_sem = xSemaphoreCreateBinaryStatic(&storage->process_sem);
+#else
     esp_dte->process_sem = xSemaphoreCreateBinary();
+#endif
     MODEM_CHECK(esp_dte->process_sem, "create process semaphore failed", err_sem);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_dte->exit_sem = xSemaphoreCreateBinaryStatic(&storage->exit_sem);
+#else
+    esp_dte->exit_sem = xSemaphoreCreateBinary();
+#endif
+    MODEM_CHECK(esp_dte->exit_sem, "create exit semaphore failed", err_exit_sem);
     /* Create UART Event task */
-    BaseType_t ret = xTaskCreate(uart_event_task_entry,                     //Task Entry
-                                 "uart_event",                              //Task Name
-                                 CONFIG_EXAMPLE_UART_EVENT_TASK_STACK_SIZE, //Task Stack Size(Bytes)
-                                 esp_dte,                                   //Task Parameter
-                                 CONFIG_EXAMPLE_UART_EVENT_TASK_PRIORITY,   //Task Priority
-                                 &(esp_dte->uart_event_task_hdl)            //Task Handler
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_dte->uart_event_task_hdl = xTaskCreateStaticPinnedToCore(uart_event_task_entry,                     //Task Entry
+                                                                 "uart_event",                              //Task Name
+                                                                 CONFIG_EXAMPLE_UART_EVENT_TASK_STACK_SIZE, //Task Stack Size(Bytes)
+                                                                 esp_dte,                                   //Task Parameter
+                                                                 config->rx_task_priority,                  //Task Priority
+                                                                 storage->uart_event_stack,                 //Task Stack
+                                                                 &storage->uart_event_task,                 //Task Control Block
+                                                                 config->rx_task_core                       //Task Core
+    );
+    BaseType_t ret = esp_dte->uart_event_task_hdl ? pdTRUE : pdFALSE;
+#else
+    BaseType_t ret = xTaskCreatePinnedToCore(uart_event_task_entry,                     //Task Entry
+                                             "uart_event",                              //Task Name
+                                             CONFIG_EXAMPLE_UART_EVENT_TASK_STACK_SIZE, //Task Stack Size(Bytes)
+                                             esp_dte,                                   //Task Parameter
+                                             config->rx_task_priority,                  //Task Priority
+                                             &(esp_dte->uart_event_task_hdl),           //Task Handler
+                                             config->rx_task_core                       //Task Core
     );
+#endif
     MODEM_CHECK(ret == pdTRUE, "create uart event task failed", err_tsk_create);
     return &(esp_dte->parent);
     /* Error handling */
 err_tsk_create:
+    vSemaphoreDelete(esp_dte->exit_sem);
+err_exit_sem:
     vSemaphoreDelete(esp_dte->process_sem);
 err_sem:
     esp_event_loop_delete(esp_dte->event_loop_hdl);
@@ -484,13 +744,52 @@ err_eloop:
 err_uart_pattern:
     uart_driver_delete(esp_dte->uart_port);
 err_uart_config:
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_dte_pool, storage);
+#else
     free(esp_dte->buffer);
 err_line_mem:
     free(esp_dte);
+#endif
 err_dte_mem:
     return NULL;
 }
 
+esp_err_t esp_modem_set_flow_ctrl(modem_dte_t *dte, modem_flow_ctrl_t flow_ctrl)
+{
+    modem_dce_t *dce = dte->dce;
+    modem_flow_ctrl_t previous = dte->flow_ctrl;
+    MODEM_CHECK(dce, "DTE has not yet bind with DCE", err);
+    MODEM_CHECK(dce->mode == MODEM_COMMAND_MODE, "flow control can only change in command mode", err);
+    if (flow_ctrl == previous)
+    {
+        return ESP_OK;
+    }
+    /* No other command may cross the link while its two ends disagree */
+    MODEM_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+                "command channel busy", err);
+    /* The modem answers before it starts watching RTS, so it goes first */
+    MODEM_CHECK(dce->set_flow_ctrl(dce, flow_ctrl) == ESP_OK, "set DCE flow control failed", err_release);
+    if (dte->set_flow_ctrl(dte, flow_ctrl) != ESP_OK)
+    {
+        dce->set_flow_ctrl(dce, previous);
+        goto err_release;
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+    ESP_LOGI(MODEM_TAG, "flow control set to %d", flow_ctrl);
+    return ESP_OK;
+err_release:
+    esp_modem_arbiter_release(dce->arbiter);
+err:
+    return ESP_FAIL;
+}
+
+void esp_modem_get_uart_stats(modem_dte_t *dte, esp_modem_uart_stats_t *stats)
+{
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    *stats = esp_dte->stats;
+}
+
 esp_err_t esp_modem_add_event_handler(modem_dte_t *dte, esp_event_handler_t handler, void *handler_args)
 {
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
@@ -503,6 +802,27 @@ esp_err_t esp_modem_remove_event_handler(modem_dte_t *dte, esp_event_handler_t h
     return esp_event_handler_unregister_with(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, ESP_EVENT_ANY_ID, handler);
 }
 
+/**
+ * @brief Post an event from a task other than the UART event task
+ *
+ * When the UART event task runs the event loop, it is also woken, since it waits for
+ * UART events with no timeout.
+ *
+ * @param esp_dte ESP32 Modem DTE object
+ * @param event_id event
+ * @param event_data data copied with the event, may be NULL
+ * @param event_data_size size of the data
+ */
+static void esp_modem_post_event(esp_modem_dte_t *esp_dte, int32_t event_id, void *event_data, size_t event_data_size)
+{
+    esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, event_id, event_data, event_data_size, 0);
+    if (esp_dte->dispatch_events)
+    {
+        const uart_event_t wake = {.type = UART_EVENT_MAX};
+        xQueueSend(esp_dte->event_queue, &wake, 0);
+    }
+}
+
 /**
  * @brief PPP status callback which is called on PPP status change (up, down, …) by lwIP core thread
  *
@@ -533,7 +853,7 @@ static void on_ppp_status_changed(ppp_pcb *pcb, int err_code, void *ctx)
         {
             ipinfo.ns2 = (*dest_ip).u_addr.ip4;
         }
-        esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, MODEM_EVENT_PPP_CONNECT, &ipinfo, sizeof(ipinfo), 0);
+        esp_modem_post_event(esp_dte, MODEM_EVENT_PPP_CONNECT, &ipinfo, sizeof(ipinfo));
         break;
     case PPPERR_PARAM:
         ESP_LOGE(MODEM_TAG, "Invalid parameter");
@@ -549,12 +869,16 @@ static void on_ppp_status_changed(ppp_pcb *pcb, int err_code, void *ctx)
         break;
 
     case PPPERR_USER: /* User interrupt */
-        esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, MODEM_EVENT_PPP_STOP, NULL, 0, 0);
-        /* Free the PPP control block */
-        pppapi_free(esp_dte->ppp);
+        esp_modem_post_event(esp_dte, MODEM_EVENT_PPP_STOP, NULL, 0);
+        /* Free the PPP control block, a new one may already be in esp_dte->ppp */
+        if (esp_dte->ppp == pcb)
+        {
+            esp_dte->ppp = NULL;
+        }
+        pppapi_free(pcb);
         break;
     case PPPERR_CONNECT: /* Connection lost */
-        esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, MODEM_EVENT_PPP_DISCONNECT, NULL, 0, 0);
+        esp_modem_post_event(esp_dte, MODEM_EVENT_PPP_DISCONNECT, NULL, 0);
         break;
     case PPPERR_AUTHFAIL:
         ESP_LOGE(MODEM_TAG, "Failed authentication challenge");
@@ -635,7 +959,18 @@ static void on_ppp_notify_phase(ppp_pcb *pcb, u8_t phase, void *ctx)
 static uint32_t pppos_low_level_output(ppp_pcb *pcb, uint8_t *data, uint32_t len, void *ctx)
 {
     modem_dte_t *dte = (modem_dte_t *)ctx;
-    return dte->send_data(dte, (const char *)data, len);
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    /* On a weak supply a frame over the rate is dropped, so that the modem transmits in short bursts */
+    if (!esp_modem_supply_uplink(dte->dce ? dte->dce->supply : NULL, data, len))
+    {
+        return 0;
+    }
+    int sent = dte->send_data(dte, (const char *)data, len);
+    if (sent > 0)
+    {
+        esp_dte->stats.bytes_sent += sent;
+    }
+    return sent;
 }
 
 esp_err_t esp_modem_setup_ppp(modem_dte_t *dte)
@@ -658,6 +993,9 @@ esp_err_t esp_modem_setup_ppp(modem_dte_t *dte)
     MODEM_CHECK(pppapi_set_default(esp_dte->ppp) == ERR_OK, "set default route failed", err);
     /* Ask the peer for up to 2 DNS server addresses */
     ppp_set_usepeerdns(esp_dte->ppp, 1);
+    /* Probe an idle session with LCP echo, the health monitor judges the silence, not lwIP */
+    esp_dte->ppp->settings.lcp_echo_interval = CONFIG_EXAMPLE_MODEM_PPP_LCP_ECHO;
+    esp_dte->ppp->settings.lcp_echo_fails = 0;
     /* Auth configuration */
 #if PAP_SUPPORT
     pppapi_set_auth(esp_dte->ppp, PPPAUTHTYPE_PAP, CONFIG_EXAMPLE_MODEM_PPP_AUTH_USERNAME, CONFIG_EXAMPLE_MODEM_PPP_AUTH_PASSWORD);
@@ -668,12 +1006,41 @@ esp_err_t esp_modem_setup_ppp(modem_dte_t *dte)
 #endif
     /* Initiate PPP negotiation, without waiting */
     MODEM_CHECK(pppapi_connect(esp_dte->ppp, 0) == ERR_OK, "initiate ppp negotiation failed", err);
-    esp_event_post_to(esp_dte->event_loop_hdl, ESP_MODEM_EVENT, MODEM_EVENT_PPP_START, NULL, 0, 0);
+    esp_modem_post_event(esp_dte, MODEM_EVENT_PPP_START, NULL, 0);
     return ESP_OK;
 err:
     return ESP_FAIL;
 }
 
+esp_err_t esp_modem_flush_ppp(modem_dte_t *dte, uint32_t timeout_ms)
+{
+    modem_dce_t *dce = dte->dce;
+    MODEM_CHECK(dce, "DTE has not yet bind with DCE", err);
+    MODEM_CHECK(dce->mode == MODEM_PPP_MODE, "not in ppp mode", err);
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    esp_modem_post_event(esp_dte, MODEM_EVENT_PPP_CLOSING, NULL, 0);
+    TickType_t start = xTaskGetTickCount();
+    TickType_t quiet_since = start;
+    uint32_t sent = esp_dte->stats.bytes_sent;
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(timeout_ms))
+    {
+        vTaskDelay(pdMS_TO_TICKS(ESP_MODEM_PPP_CLOSE_POLL_MS));
+        if (esp_dte->stats.bytes_sent != sent)
+        {
+            sent = esp_dte->stats.bytes_sent;
+            quiet_since = xTaskGetTickCount();
+        }
+        else if (xTaskGetTickCount() - quiet_since >= pdMS_TO_TICKS(ESP_MODEM_PPP_FLUSH_QUIET_MS) &&
+                 uart_wait_tx_done(esp_dte->uart_port, 0) == ESP_OK)
+        {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+err:
+    return ESP_FAIL;
+}
+
 esp_err_t esp_modem_exit_ppp(modem_dte_t *dte)
 {
     modem_dce_t *dce = dte->dce;
@@ -681,6 +1048,18 @@ esp_err_t esp_modem_exit_ppp(modem_dte_t *dte)
     esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
     /* Shutdown of PPP protocols */
     MODEM_CHECK(pppapi_close(esp_dte->ppp, 0) == ERR_OK, "close ppp connection failed", err);
+    /* The peer's Terminate-Ack ends the session, "+++" before it would cut the link under PPP */
+    TickType_t start = xTaskGetTickCount();
+    while (esp_dte->ppp && xTaskGetTickCount() - start < pdMS_TO_TICKS(ESP_MODEM_PPP_CLOSE_TIMEOUT))
+    {
+        vTaskDelay(pdMS_TO_TICKS(ESP_MODEM_PPP_CLOSE_POLL_MS));
+    }
+    if (esp_dte->ppp)
+    {
+        ESP_LOGW(MODEM_TAG, "no Terminate-Ack in %d ms", ESP_MODEM_PPP_CLOSE_TIMEOUT);
+    }
+    /* Frames still queued go out before the escape, which needs silence around it */
+    uart_wait_tx_done(esp_dte->uart_port, pdMS_TO_TICKS(MODEM_COMMAND_TIMEOUT_DEFAULT));
     /* Enter command mode */
     MODEM_CHECK(dte->change_mode(dte, MODEM_COMMAND_MODE) == ESP_OK, "enter command mode failed", err);
     /* Hang up */
@@ -689,3 +1068,22 @@ esp_err_t esp_modem_exit_ppp(modem_dte_t *dte)
 err:
     return ESP_FAIL;
 }
+
+esp_err_t esp_modem_drop_ppp(modem_dte_t *dte)
+{
+    modem_dce_t *dce = dte->dce;
+    MODEM_CHECK(dce, "DTE has not yet bind with DCE", err);
+    MODEM_CHECK(dce->mode == MODEM_PPP_MODE, "not in ppp mode", err);
+    esp_modem_dte_t *esp_dte = __containerof(dte, esp_modem_dte_t, parent);
+    /* Lines are parsed again from here on, whatever the modem does with "+++" */
+    esp_modem_dte_line_mode(esp_dte);
+    dce->mode = MODEM_COMMAND_MODE;
+    /* Nothing is sent to a peer that cannot answer, the session just ends */
+    if (esp_dte->ppp)
+    {
+        MODEM_CHECK(pppapi_close(esp_dte->ppp, 1) == ERR_OK, "close ppp connection failed", err);
+    }
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
@@ -0,0 +1,278 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem_arbiter.h"
+#include "esp_modem_static.h"
+
+static const char *ARBITER_TAG = "esp-modem-arbiter";
+
+#define ESP_MODEM_ARBITER_IDLE_POLL_MS (10)
+
+/**
+ * @brief A task waiting for the channel, lives on the stack of that task
+ *
+ */
+typedef struct esp_modem_arbiter_waiter {
+    TaskHandle_t task;                     /*!< Task to notify */
+    uint8_t priority;                      /*!< esp_modem_priority_t */
+    uint8_t bypassed;                      /*!< Times overtaken */
+    bool granted;                          /*!< Set by the releasing task */
+    int64_t since;                         /*!< esp_timer time it started waiting */
+    struct esp_modem_arbiter_waiter *next; /*!< Next in arrival order */
+} esp_modem_arbiter_waiter_t;
+
+struct esp_modem_arbiter {
+    SemaphoreHandle_t lock;              /*!< Protects everything below */
+    TaskHandle_t owner;                  /*!< Task owning the channel, NULL if free */
+    uint32_t depth;                      /*!< Nested acquisitions of the owner */
+    uint8_t max_bypass;                  /*!< Overtakes before a waiter is served next */
+    esp_modem_arbiter_waiter_t *waiters; /*!< Waiters in arrival order */
+    esp_modem_arbiter_stats_t stats[ESP_MODEM_PRIORITY_MAX];
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StaticSemaphore_t lock_buffer;       /*!< Memory of lock */
+#endif
+};
+
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+ESP_MODEM_STATIC_POOL(s_arbiter_pool, esp_modem_arbiter_t);
+#endif
+
+static const char *const esp_modem_arbiter_priority_names[ESP_MODEM_PRIORITY_MAX] = {
+    "background",
+    "normal",
+    "interactive",
+    "recovery",
+};
+
+const char *esp_modem_arbiter_priority_name(esp_modem_priority_t priority)
+{
+    return priority < ESP_MODEM_PRIORITY_MAX ? esp_modem_arbiter_priority_names[priority] : "unknown";
+}
+
+esp_modem_arbiter_t *esp_modem_arbiter_create(uint8_t max_bypass)
+{
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_arbiter_t *arbiter = esp_modem_static_calloc(&s_arbiter_pool);
+    if (!arbiter) {
+        return NULL;
+    }
+    arbiter->lock = xSemaphoreCreateMutexStatic(&arbiter->lock_buffer);
+#else
+    esp_modem_arbiter_t *arbiter = calloc(1, sizeof(esp_modem_arbiter_t));
+    if (!arbiter) {
+        return NULL;
+    }
+    arbiter->lock = xSemaphoreCreateMutex();
+    if (!arbiter->lock) {
+        free(arbiter);
+        return NULL;
+    }
+#endif
+    arbiter->max_bypass = max_bypass ? max_bypass : 1;
+    return arbiter;
+}
+
+esp_err_t esp_modem_arbiter_wait_idle(esp_modem_arbiter_t *arbiter, uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (1) {
+        xSemaphoreTake(arbiter->lock, portMAX_DELAY);
+        bool idle = !arbiter->owner && !arbiter->waiters;
+        xSemaphoreGive(arbiter->lock);
+        if (idle) {
+            return ESP_OK;
+        }
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(ESP_MODEM_ARBITER_IDLE_POLL_MS));
+    }
+}
+
+esp_err_t esp_modem_arbiter_delete(esp_modem_arbiter_t *arbiter)
+{
+    if (!arbiter) {
+        return ESP_OK;
+    }
+    if (esp_modem_arbiter_wait_idle(arbiter, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        /* A waiter sleeps on its own stack, linked from here: freeing would leave it a dangling list */
+        ESP_LOGE(ARBITER_TAG, "arbiter still in use, not deleted");
+        return ESP_ERR_INVALID_STATE;
+    }
+    vSemaphoreDelete(arbiter->lock);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_arbiter_pool, arbiter);
+#else
+    free(arbiter);
+#endif
+    return ESP_OK;
+}
+
+static void esp_modem_arbiter_account(esp_modem_arbiter_stats_t *stats, int64_t wait_us)
+{
+    stats->granted++;
+    stats->total_wait_us += wait_us;
+    if (wait_us > stats->max_wait_us) {
+        stats->max_wait_us = wait_us;
+    }
+}
+
+static void esp_modem_arbiter_unlink(esp_modem_arbiter_t *arbiter, esp_modem_arbiter_waiter_t *waiter)
+{
+    for (esp_modem_arbiter_waiter_t **p = &arbiter->waiters; *p; p = &(*p)->next) {
+        if (*p == waiter) {
+            *p = waiter->next;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Pick the next owner: a waiter overtaken too often, otherwise the oldest of the highest priority
+ */
+static esp_modem_arbiter_waiter_t *esp_modem_arbiter_next(esp_modem_arbiter_t *arbiter)
+{
+    esp_modem_arbiter_waiter_t *best = NULL;
+    bool aged = false;
+    for (esp_modem_arbiter_waiter_t *w = arbiter->waiters; w; w = w->next) {
+        if (w->bypassed >= arbiter->max_bypass) {
+            best = w;
+            aged = true;
+            break;
+        }
+        if (!best || w->priority > best->priority) {
+            best = w;
+        }
+    }
+    if (!best) {
+        return NULL;
+    }
+    /* Everyone who came earlier with a lower priority has just been overtaken */
+    for (esp_modem_arbiter_waiter_t *w = arbiter->waiters; w != best; w = w->next) {
+        if (w->priority < best->priority) {
+            w->bypassed++;
+            arbiter->stats[w->priority].overtaken++;
+        }
+    }
+    if (aged) {
+        arbiter->stats[best->priority].aged++;
+    }
+    esp_modem_arbiter_unlink(arbiter, best);
+    return best;
+}
+
+esp_err_t esp_modem_arbiter_acquire(esp_modem_arbiter_t *arbiter, esp_modem_priority_t priority, uint32_t timeout_ms)
+{
+    if (!arbiter) {
+        return ESP_OK;
+    }
+    if (priority >= ESP_MODEM_PRIORITY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    esp_modem_arbiter_waiter_t waiter = {
+        .task = self,
+        .priority = priority,
+    };
+
+    xSemaphoreTake(arbiter->lock, portMAX_DELAY);
+    if (arbiter->owner == self) {
+        arbiter->depth++;
+        xSemaphoreGive(arbiter->lock);
+        return ESP_OK;
+    }
+    if (!arbiter->owner) {
+        arbiter->owner = self;
+        arbiter->depth = 1;
+        arbiter->stats[priority].immediate++;
+        esp_modem_arbiter_account(&arbiter->stats[priority], 0);
+        xSemaphoreGive(arbiter->lock);
+        return ESP_OK;
+    }
+    waiter.since = esp_timer_get_time();
+    esp_modem_arbiter_waiter_t **tail = &arbiter->waiters;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = &waiter;
+    xSemaphoreGive(arbiter->lock);
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t ticks = (timeout_ms == ESP_MODEM_ARBITER_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    while (1) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        /* A notification left over from a grant that raced a timeout only causes one more pass */
+        ulTaskNotifyTake(pdTRUE, (ticks == portMAX_DELAY) ? portMAX_DELAY : (elapsed < ticks ? ticks - elapsed : 0));
+        xSemaphoreTake(arbiter->lock, portMAX_DELAY);
+        if (waiter.granted) {
+            xSemaphoreGive(arbiter->lock);
+            return ESP_OK;
+        }
+        if (ticks != portMAX_DELAY && xTaskGetTickCount() - start >= ticks) {
+            esp_modem_arbiter_unlink(arbiter, &waiter);
+            arbiter->stats[priority].deadline_misses++;
+            xSemaphoreGive(arbiter->lock);
+            ESP_LOGW(ARBITER_TAG, "%s caller gave up after %d ms", esp_modem_arbiter_priority_names[priority], timeout_ms);
+            return ESP_ERR_TIMEOUT;
+        }
+        xSemaphoreGive(arbiter->lock);
+    }
+}
+
+esp_err_t esp_modem_arbiter_release(esp_modem_arbiter_t *arbiter)
+{
+    if (!arbiter) {
+        return ESP_OK;
+    }
+    xSemaphoreTake(arbiter->lock, portMAX_DELAY);
+    if (arbiter->owner != xTaskGetCurrentTaskHandle()) {
+        xSemaphoreGive(arbiter->lock);
+        ESP_LOGE(ARBITER_TAG, "release by a task not owning the channel");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (--arbiter->depth == 0) {
+        esp_modem_arbiter_waiter_t *next = esp_modem_arbiter_next(arbiter);
+        arbiter->owner = NULL;
+        if (next) {
+            arbiter->owner = next->task;
+            arbiter->depth = 1;
+            next->granted = true;
+            esp_modem_arbiter_account(&arbiter->stats[next->priority], esp_timer_get_time() - next->since);
+            xTaskNotifyGive(next->task);
+        }
+    }
+    xSemaphoreGive(arbiter->lock);
+    return ESP_OK;
+}
+
+void esp_modem_arbiter_get_stats(esp_modem_arbiter_t *arbiter, esp_modem_arbiter_stats_t *stats)
+{
+    xSemaphoreTake(arbiter->lock, portMAX_DELAY);
+    memcpy(stats, arbiter->stats, sizeof(arbiter->stats));
+    xSemaphoreGive(arbiter->lock);
+}
+
+void esp_modem_arbiter_reset_stats(esp_modem_arbiter_t *arbiter)
+{
+    xSemaphoreTake(arbiter->lock, portMAX_DELAY);
+    memset(arbiter->stats, 0, sizeof(arbiter->stats));
+    xSemaphoreGive(arbiter->lock);
+}
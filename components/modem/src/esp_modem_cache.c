@@ -0,0 +1,335 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem_cache.h"
+#include "esp_modem_ext.h"
+#include "esp_modem_static.h"
+
+static const char *CACHE_TAG = "esp-modem-cache";
+#define CACHE_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(a))                                                                       \
+        {                                                                               \
+            ESP_LOGE(CACHE_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                              \
+        }                                                                               \
+    } while (0)
+
+#define ESP_MODEM_CACHE_VALUES_MAX (3)
+
+/**
+ * @brief One cached query
+ *
+ */
+typedef struct {
+    uint32_t values[ESP_MODEM_CACHE_VALUES_MAX]; /*!< Answer of the last command */
+    esp_err_t err;                               /*!< Result of the last command */
+    int64_t fetched;                             /*!< esp_timer time of the last answer */
+    bool valid;                                  /*!< Answer usable until its TTL runs out */
+    bool pending;                                /*!< A caller is asking the modem */
+    uint32_t generation;                         /*!< Bumped by every invalidation, a fetch it overtook is not kept */
+    SemaphoreHandle_t fetch;                     /*!< Held by the caller asking the modem, others wait on it */
+    esp_modem_cache_stats_t stats;               /*!< Counters */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StaticSemaphore_t fetch_buffer;              /*!< Memory of fetch */
+#endif
+} esp_modem_cache_entry_t;
+
+/**
+ * @brief Cache of a DCE, with the methods it wraps
+ *
+ */
+struct esp_modem_cache {
+    esp_modem_cache_config_t config;
+    SemaphoreHandle_t lock;                      /*!< Protects the entries */
+    esp_modem_cache_entry_t entries[ESP_MODEM_CACHE_MAX];
+    esp_err_t (*get_signal_quality)(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber);
+    esp_err_t (*get_battery_status)(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage);
+    esp_err_t (*get_network_status)(modem_dce_t *dce, uint32_t *mode, uint32_t *stat);
+    esp_modem_ext_t ext;                         /*!< Link into the DCE */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StaticSemaphore_t lock_buffer;               /*!< Memory of lock */
+#endif
+};
+
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+ESP_MODEM_STATIC_POOL(s_cache_pool, esp_modem_cache_t);
+#endif
+
+static const char *const esp_modem_cache_query_names[ESP_MODEM_CACHE_MAX] = {
+    "signal quality",
+    "battery status",
+    "network status",
+};
+
+/**
+ * @brief URCs telling that a cached answer is out of date
+ *
+ */
+static const struct {
+    const char *prefix;
+    esp_modem_cache_query_t query;
+} esp_modem_cache_urcs[] = {
+    {"+CSQN:", ESP_MODEM_CACHE_SIGNAL_QUALITY},
+    {"+CREG: ", ESP_MODEM_CACHE_NETWORK_STATUS},
+    {"UNDER-VOLTAGE", ESP_MODEM_CACHE_BATTERY_STATUS},
+    {"OVER-VOLTAGE", ESP_MODEM_CACHE_BATTERY_STATUS},
+};
+
+const char *esp_modem_cache_query_name(esp_modem_cache_query_t query)
+{
+    return query < ESP_MODEM_CACHE_MAX ? esp_modem_cache_query_names[query] : "unknown";
+}
+
+/**
+ * @brief Ask the modem through the wrapped getter
+ */
+static esp_err_t esp_modem_cache_fetch(modem_dce_t *dce, esp_modem_cache_query_t query, uint32_t *values)
+{
+    esp_modem_cache_t *cache = dce->cache;
+    switch (query) {
+    case ESP_MODEM_CACHE_SIGNAL_QUALITY:
+        return cache->get_signal_quality(dce, &values[0], &values[1]);
+    case ESP_MODEM_CACHE_BATTERY_STATUS:
+        return cache->get_battery_status(dce, &values[0], &values[1], &values[2]);
+    case ESP_MODEM_CACHE_NETWORK_STATUS:
+        return cache->get_network_status(dce, &values[0], &values[1]);
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+/**
+ * @brief Serve a query from the cache, or ask the modem once for every concurrent caller
+ */
+static esp_err_t esp_modem_cache_get(modem_dce_t *dce, esp_modem_cache_query_t query, uint32_t *values)
+{
+    esp_modem_cache_t *cache = dce->cache;
+    esp_modem_cache_entry_t *entry = &cache->entries[query];
+    uint32_t fetched[ESP_MODEM_CACHE_VALUES_MAX] = {0};
+    uint32_t generation;
+    esp_err_t err;
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    if (entry->valid && esp_timer_get_time() - entry->fetched < cache->config.ttl_ms[query] * 1000LL) {
+        entry->stats.hits++;
+        memcpy(values, entry->values, sizeof(entry->values));
+        xSemaphoreGive(cache->lock);
+        return ESP_OK;
+    }
+    if (entry->pending) {
+        /* Someone is already asking, take their answer */
+        entry->stats.coalesced++;
+        xSemaphoreGive(cache->lock);
+        xSemaphoreTake(entry->fetch, portMAX_DELAY);
+        xSemaphoreGive(entry->fetch);
+        xSemaphoreTake(cache->lock, portMAX_DELAY);
+        memcpy(values, entry->values, sizeof(entry->values));
+        err = entry->err;
+        xSemaphoreGive(cache->lock);
+        return err;
+    }
+    entry->stats.misses++;
+    entry->pending = true;
+    generation = entry->generation;
+    /* Free whenever nothing is pending, so this never blocks */
+    xSemaphoreTake(entry->fetch, portMAX_DELAY);
+    xSemaphoreGive(cache->lock);
+
+    err = esp_modem_cache_fetch(dce, query, fetched);
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    entry->pending = false;
+    entry->err = err;
+    if (err == ESP_OK) {
+        memcpy(entry->values, fetched, sizeof(entry->values));
+        entry->fetched = esp_timer_get_time();
+        /* A URC during the command may have made the answer stale already */
+        entry->valid = entry->generation == generation;
+    } else {
+        entry->stats.errors++;
+        entry->valid = false;
+    }
+    xSemaphoreGive(cache->lock);
+    xSemaphoreGive(entry->fetch);
+    memcpy(values, fetched, sizeof(fetched));
+    return err;
+}
+
+static esp_err_t esp_modem_cache_get_signal_quality(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber)
+{
+    uint32_t values[ESP_MODEM_CACHE_VALUES_MAX];
+    esp_err_t err = esp_modem_cache_get(dce, ESP_MODEM_CACHE_SIGNAL_QUALITY, values);
+    *rssi = values[0];
+    *ber = values[1];
+    return err;
+}
+
+static esp_err_t esp_modem_cache_get_battery_status(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage)
+{
+    uint32_t values[ESP_MODEM_CACHE_VALUES_MAX];
+    esp_err_t err = esp_modem_cache_get(dce, ESP_MODEM_CACHE_BATTERY_STATUS, values);
+    *bcs = values[0];
+    *bcl = values[1];
+    *voltage = values[2];
+    return err;
+}
+
+static esp_err_t esp_modem_cache_get_network_status(modem_dce_t *dce, uint32_t *mode, uint32_t *stat)
+{
+    uint32_t values[ESP_MODEM_CACHE_VALUES_MAX];
+    esp_err_t err = esp_modem_cache_get(dce, ESP_MODEM_CACHE_NETWORK_STATUS, values);
+    *mode = values[0];
+    *stat = values[1];
+    return err;
+}
+
+/**
+ * @brief Drop entries a URC makes stale
+ */
+static void esp_modem_cache_handle_urc(modem_dce_t *dce, const char *line)
+{
+    for (int i = 0; i < sizeof(esp_modem_cache_urcs) / sizeof(esp_modem_cache_urcs[0]); i++) {
+        if (!strncmp(line, esp_modem_cache_urcs[i].prefix, strlen(esp_modem_cache_urcs[i].prefix))) {
+            esp_modem_cache_invalidate(dce, esp_modem_cache_urcs[i].query);
+            break;
+        }
+    }
+}
+
+static void esp_modem_cache_detach(modem_dce_t *dce)
+{
+    esp_modem_cache_t *cache = dce->cache;
+    dce->get_signal_quality = cache->get_signal_quality;
+    dce->get_battery_status = cache->get_battery_status;
+    dce->get_network_status = cache->get_network_status;
+    dce->cache = NULL;
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        vSemaphoreDelete(cache->entries[i].fetch);
+    }
+    vSemaphoreDelete(cache->lock);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_cache_pool, cache);
+#else
+    free(cache);
+#endif
+}
+
+esp_err_t esp_modem_cache_enable(modem_dce_t *dce, const esp_modem_cache_config_t *config)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    CACHE_CHECK(dce && config, "invalid argument", err_arg);
+    CACHE_CHECK(!dce->cache, "cache already enabled", err_state);
+    CACHE_CHECK(dce->get_signal_quality && dce->get_battery_status && dce->get_network_status && dce->deinit,
+                "DCE lacks the cached methods", err_arg);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_cache_t *cache = esp_modem_static_calloc(&s_cache_pool);
+    CACHE_CHECK(cache, "no static slot for cache", err);
+    cache->config = *config;
+    cache->lock = xSemaphoreCreateMutexStatic(&cache->lock_buffer);
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        cache->entries[i].fetch = xSemaphoreCreateMutexStatic(&cache->entries[i].fetch_buffer);
+    }
+#else
+    esp_modem_cache_t *cache = calloc(1, sizeof(esp_modem_cache_t));
+    CACHE_CHECK(cache, "calloc cache failed", err);
+    cache->config = *config;
+    cache->lock = xSemaphoreCreateMutex();
+    CACHE_CHECK(cache->lock, "create cache lock failed", err_lock);
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        cache->entries[i].fetch = xSemaphoreCreateMutex();
+        CACHE_CHECK(cache->entries[i].fetch, "create fetch lock failed", err_fetch);
+    }
+#endif
+    cache->get_signal_quality = dce->get_signal_quality;
+    cache->get_battery_status = dce->get_battery_status;
+    cache->get_network_status = dce->get_network_status;
+    cache->ext.handle_urc = esp_modem_cache_handle_urc;
+    cache->ext.detach = esp_modem_cache_detach;
+    dce->cache = cache;
+    dce->get_signal_quality = esp_modem_cache_get_signal_quality;
+    dce->get_battery_status = esp_modem_cache_get_battery_status;
+    dce->get_network_status = esp_modem_cache_get_network_status;
+    esp_modem_ext_attach(dce, &cache->ext);
+    return ESP_OK;
+#if !CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+err_fetch:
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        if (cache->entries[i].fetch) {
+            vSemaphoreDelete(cache->entries[i].fetch);
+        }
+    }
+    vSemaphoreDelete(cache->lock);
+err_lock:
+    free(cache);
+#endif
+err:
+    return ret;
+err_state:
+    return ESP_ERR_INVALID_STATE;
+err_arg:
+    return ESP_ERR_INVALID_ARG;
+}
+
+void esp_modem_cache_invalidate(modem_dce_t *dce, esp_modem_cache_query_t query)
+{
+    esp_modem_cache_t *cache = dce->cache;
+    if (!cache) {
+        return;
+    }
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        if (query == ESP_MODEM_CACHE_MAX || query == i) {
+            if (cache->entries[i].valid || cache->entries[i].pending) {
+                cache->entries[i].stats.invalidations++;
+            }
+            cache->entries[i].valid = false;
+            cache->entries[i].generation++;
+        }
+    }
+    xSemaphoreGive(cache->lock);
+}
+
+esp_err_t esp_modem_cache_get_stats(modem_dce_t *dce, esp_modem_cache_stats_t *stats)
+{
+    esp_modem_cache_t *cache = dce->cache;
+    if (!cache) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        stats[i] = cache->entries[i].stats;
+    }
+    xSemaphoreGive(cache->lock);
+    return ESP_OK;
+}
+
+void esp_modem_cache_reset_stats(modem_dce_t *dce)
+{
+    esp_modem_cache_t *cache = dce->cache;
+    if (!cache) {
+        return;
+    }
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_CACHE_MAX; i++) {
+        memset(&cache->entries[i].stats, 0, sizeof(cache->entries[i].stats));
+    }
+    xSemaphoreGive(cache->lock);
+}
@@ -0,0 +1,282 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "esp_modem_capture.h"
+
+static const char *CAPTURE_TAG = "esp-modem-capture";
+
+/* Records longer than this part of the ring are cut, so one PPP burst cannot wipe the dialogue before it */
+#define CAPTURE_MAX_RECORD(size) ((size) / 4)
+
+static struct {
+    portMUX_TYPE lock;       /*!< Protects everything below, held only for copies */
+    uint8_t *ring;           /*!< NULL until initialized */
+    size_t size;             /*!< Ring size */
+    size_t head;             /*!< Where the next record goes */
+    size_t tail;             /*!< Oldest record */
+    size_t used;             /*!< Bytes between tail and head */
+    bool enabled;            /*!< Recording */
+    const char *fault_path;  /*!< Dump file for faults, NULL if none */
+    TaskHandle_t dumper;     /*!< Writes fault dumps */
+    int64_t last_dump_us;    /*!< esp_timer time of the last fault dump */
+    esp_modem_capture_stats_t stats;
+} capture = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+/**
+ * @brief Snapshot of the ring, oldest record first
+ *
+ */
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    uint32_t records;
+    uint32_t overwritten;
+} esp_modem_capture_snapshot_t;
+
+static void esp_modem_capture_put(size_t offset, const void *src, size_t length)
+{
+    size_t first = MIN(length, capture.size - offset);
+    memcpy(capture.ring + offset, src, first);
+    memcpy(capture.ring, (const uint8_t *)src + first, length - first);
+}
+
+static void esp_modem_capture_get(size_t offset, void *dst, size_t length)
+{
+    size_t first = MIN(length, capture.size - offset);
+    memcpy(dst, capture.ring + offset, first);
+    memcpy((uint8_t *)dst + first, capture.ring, length - first);
+}
+
+void esp_modem_capture_record(uint8_t port, esp_modem_capture_dir_t dir, const void *data, size_t length)
+{
+    if (!capture.ring || !capture.enabled || !length) {
+        return;
+    }
+    esp_modem_capture_record_header_t header = {
+        .time_us = (uint32_t)esp_timer_get_time(),
+        .length = length,
+        .dir = dir,
+        .port = port,
+    };
+    if (length > CAPTURE_MAX_RECORD(capture.size) - sizeof(header)) {
+        header.length = CAPTURE_MAX_RECORD(capture.size) - sizeof(header);
+        header.dir |= ESP_MODEM_CAPTURE_TRUNCATED;
+    }
+    size_t total = sizeof(header) + header.length;
+    portENTER_CRITICAL(&capture.lock);
+    while (capture.size - capture.used < total) {
+        esp_modem_capture_record_header_t oldest;
+        esp_modem_capture_get(capture.tail, &oldest, sizeof(oldest));
+        size_t oldest_total = sizeof(oldest) + oldest.length;
+        capture.tail = (capture.tail + oldest_total) % capture.size;
+        capture.used -= oldest_total;
+        capture.stats.records--;
+        capture.stats.overwritten++;
+    }
+    esp_modem_capture_put(capture.head, &header, sizeof(header));
+    esp_modem_capture_put((capture.head + sizeof(header)) % capture.size, data, header.length);
+    capture.head = (capture.head + total) % capture.size;
+    capture.used += total;
+    capture.stats.records++;
+    if (header.dir & ESP_MODEM_CAPTURE_TRUNCATED) {
+        capture.stats.truncated++;
+    }
+    portEXIT_CRITICAL(&capture.lock);
+}
+
+static esp_err_t esp_modem_capture_snapshot(esp_modem_capture_snapshot_t *snapshot)
+{
+    if (!capture.ring) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    snapshot->data = malloc(capture.size);
+    if (!snapshot->data) {
+        return ESP_ERR_NO_MEM;
+    }
+    portENTER_CRITICAL(&capture.lock);
+    esp_modem_capture_get(capture.tail, snapshot->data, capture.used);
+    snapshot->length = capture.used;
+    snapshot->records = capture.stats.records;
+    snapshot->overwritten = capture.stats.overwritten;
+    portEXIT_CRITICAL(&capture.lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_modem_capture_dump(const char *path)
+{
+    esp_modem_capture_snapshot_t snapshot;
+    esp_err_t err = esp_modem_capture_snapshot(&snapshot);
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_modem_capture_file_header_t header = {
+        .magic = ESP_MODEM_CAPTURE_MAGIC,
+        .version = ESP_MODEM_CAPTURE_VERSION,
+        .header_size = sizeof(esp_modem_capture_record_header_t),
+        .records = snapshot.records,
+        .overwritten = snapshot.overwritten,
+    };
+    err = ESP_FAIL;
+    FILE *fp = fopen(path, "wb");
+    if (fp) {
+        bool written = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                       fwrite(snapshot.data, 1, snapshot.length, fp) == snapshot.length;
+        if (fclose(fp) == 0 && written) {
+            err = ESP_OK;
+        }
+    }
+    free(snapshot.data);
+    if (err == ESP_OK) {
+        portENTER_CRITICAL(&capture.lock);
+        capture.stats.dumps++;
+        portEXIT_CRITICAL(&capture.lock);
+        ESP_LOGI(CAPTURE_TAG, "%u records written to %s", header.records, path);
+    } else {
+        ESP_LOGE(CAPTURE_TAG, "cannot write %s", path);
+    }
+    return err;
+}
+
+static void esp_modem_capture_print_bytes(FILE *fp, const uint8_t *data, size_t length)
+{
+    size_t shown = MIN(length, 64);
+    for (size_t i = 0; i < shown; i++) {
+        if (data[i] == '\r') {
+            fputs("\\r", fp);
+        } else if (data[i] == '\n') {
+            fputs("\\n", fp);
+        } else if (isprint(data[i]) && data[i] != '\\') {
+            fputc(data[i], fp);
+        } else {
+            fprintf(fp, "\\x%02x", data[i]);
+        }
+    }
+    if (shown < length) {
+        fprintf(fp, "... (%u bytes)", length);
+    }
+}
+
+esp_err_t esp_modem_capture_print(FILE *fp, size_t count)
+{
+    static const char *const dir_names[] = { "rx", "tx", "note" };
+    esp_modem_capture_snapshot_t snapshot;
+    esp_err_t err = esp_modem_capture_snapshot(&snapshot);
+    if (err != ESP_OK) {
+        return err;
+    }
+    size_t skip = snapshot.records > count ? snapshot.records - count : 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < snapshot.records; i++) {
+        esp_modem_capture_record_header_t header;
+        memcpy(&header, snapshot.data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (i >= skip) {
+            uint8_t dir = header.dir & ~ESP_MODEM_CAPTURE_TRUNCATED;
+            fprintf(fp, "%4u.%06u uart%u %-4s ", header.time_us / 1000000, header.time_us % 1000000, header.port,
+                    dir <= ESP_MODEM_CAPTURE_NOTE ? dir_names[dir] : "?");
+            esp_modem_capture_print_bytes(fp, snapshot.data + offset, header.length);
+            fputs(header.dir & ESP_MODEM_CAPTURE_TRUNCATED ? " [truncated]\r\n" : "\r\n", fp);
+        }
+        offset += header.length;
+    }
+    free(snapshot.data);
+    return ESP_OK;
+}
+
+void esp_modem_capture_fault(uint8_t port, const char *reason)
+{
+    if (!capture.ring) {
+        return;
+    }
+    esp_modem_capture_record(port, ESP_MODEM_CAPTURE_NOTE, reason, strlen(reason));
+    int64_t now = esp_timer_get_time();
+    bool dump = false;
+    portENTER_CRITICAL(&capture.lock);
+    capture.stats.faults++;
+    if (capture.fault_path && (!capture.last_dump_us ||
+                               now - capture.last_dump_us >= CONFIG_EXAMPLE_MODEM_CAPTURE_FAULT_INTERVAL * 1000000LL)) {
+        capture.last_dump_us = now;
+        dump = true;
+    }
+    portEXIT_CRITICAL(&capture.lock);
+    /* The caller may be the UART event task, so the file is written elsewhere */
+    if (dump) {
+        xTaskNotifyGive(capture.dumper);
+    }
+}
+
+static void esp_modem_capture_dumper_task(void *param)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        esp_modem_capture_dump(capture.fault_path);
+    }
+}
+
+esp_err_t esp_modem_capture_init(size_t size, const char *fault_path)
+{
+    if (capture.ring) {
+        return ESP_OK;
+    }
+    uint8_t *ring = malloc(size);
+    if (!ring) {
+        ESP_LOGE(CAPTURE_TAG, "no memory for a %u byte capture ring", size);
+        return ESP_ERR_NO_MEM;
+    }
+    if (fault_path && xTaskCreate(esp_modem_capture_dumper_task, "capture", 3072, NULL, tskIDLE_PRIORITY + 1,
+                                  &capture.dumper) != pdPASS) {
+        free(ring);
+        return ESP_ERR_NO_MEM;
+    }
+    capture.size = size;
+    capture.stats.size = size;
+    capture.fault_path = fault_path;
+    capture.enabled = true;
+    capture.ring = ring;
+    return ESP_OK;
+}
+
+void esp_modem_capture_enable(bool enable)
+{
+    capture.enabled = enable;
+}
+
+void esp_modem_capture_clear(void)
+{
+    portENTER_CRITICAL(&capture.lock);
+    capture.head = 0;
+    capture.tail = 0;
+    capture.used = 0;
+    memset(&capture.stats, 0, sizeof(capture.stats));
+    capture.stats.size = capture.size;
+    portEXIT_CRITICAL(&capture.lock);
+}
+
+void esp_modem_capture_get_stats(esp_modem_capture_stats_t *stats)
+{
+    portENTER_CRITICAL(&capture.lock);
+    *stats = capture.stats;
+    stats->used = capture.used;
+    portEXIT_CRITICAL(&capture.lock);
+}
@@ -13,7 +13,11 @@
 // limitations under the License.
 #include <string.h>
 #include "esp_log.h"
+#include "sdkconfig.h"
 #include "esp_modem_dce_service.h"
+#include "esp_modem_stats.h"
+#include "esp_modem_health.h"
+#include "esp_modem_sleep.h"
 
 /**
  * @brief Macro defined for error checking
@@ -43,10 +47,8 @@ esp_err_t esp_modem_dce_handle_response_default(modem_dce_t *dce, const char *li
 
 esp_err_t esp_modem_dce_sync(modem_dce_t *dce)
 {
-    modem_dte_t *dte = dce->dte;
-    dce->handle_line = esp_modem_dce_handle_response_default;
-    DCE_CHECK(dte->send_cmd(dte, "AT\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "sync failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, "AT\r", MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                    esp_modem_dce_handle_response_default, NULL) == ESP_OK, "sync failed", err);
     ESP_LOGD(DCE_TAG, "sync ok");
     return ESP_OK;
 err:
@@ -55,15 +57,13 @@ err:
 
 esp_err_t esp_modem_dce_echo(modem_dce_t *dce, bool on)
 {
-    modem_dte_t *dte = dce->dte;
-    dce->handle_line = esp_modem_dce_handle_response_default;
     if (on) {
-        DCE_CHECK(dte->send_cmd(dte, "ATE1\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-        DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "enable echo failed", err);
+        DCE_CHECK(esp_modem_dce_command(dce, "ATE1\r", MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                        esp_modem_dce_handle_response_default, NULL) == ESP_OK, "enable echo failed", err);
         ESP_LOGD(DCE_TAG, "enable echo ok");
     } else {
-        DCE_CHECK(dte->send_cmd(dte, "ATE0\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-        DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "disable echo failed", err);
+        DCE_CHECK(esp_modem_dce_command(dce, "ATE0\r", MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                        esp_modem_dce_handle_response_default, NULL) == ESP_OK, "disable echo failed", err);
         ESP_LOGD(DCE_TAG, "disable echo ok");
     }
     return ESP_OK;
@@ -73,10 +73,8 @@ err:
 
 esp_err_t esp_modem_dce_store_profile(modem_dce_t *dce)
 {
-    modem_dte_t *dte = dce->dte;
-    dce->handle_line = esp_modem_dce_handle_response_default;
-    DCE_CHECK(dte->send_cmd(dte, "AT&W\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "save settings failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, "AT&W\r", MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                    esp_modem_dce_handle_response_default, NULL) == ESP_OK, "save settings failed", err);
     ESP_LOGD(DCE_TAG, "save settings ok");
     return ESP_OK;
 err:
@@ -85,13 +83,11 @@ err:
 
 esp_err_t esp_modem_dce_set_flow_ctrl(modem_dce_t *dce, modem_flow_ctrl_t flow_ctrl)
 {
-    modem_dte_t *dte = dce->dte;
     char command[16];
-    int len = snprintf(command, sizeof(command), "AT+IFC=%d,%d\r", dte->flow_ctrl, flow_ctrl);
+    int len = snprintf(command, sizeof(command), "AT+IFC=%d,%d\r", flow_ctrl, flow_ctrl);
     DCE_CHECK(len < sizeof(command), "command too long: %s", err, command);
-    dce->handle_line = esp_modem_dce_handle_response_default;
-    DCE_CHECK(dte->send_cmd(dte, command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "set flow control failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, command, MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                    esp_modem_dce_handle_response_default, NULL) == ESP_OK, "set flow control failed", err);
     ESP_LOGD(DCE_TAG, "set flow control ok");
     return ESP_OK;
 err:
@@ -100,13 +96,11 @@ err:
 
 esp_err_t esp_modem_dce_define_pdp_context(modem_dce_t *dce, uint32_t cid, const char *type, const char *apn)
 {
-    modem_dte_t *dte = dce->dte;
     char command[128];
     int len = snprintf(command, sizeof(command), "AT+CGDCONT=%d,\"%s\",\"%s\"\r", cid, type, apn);
     DCE_CHECK(len < sizeof(command), "command too long: %s", err, command);
-    dce->handle_line = esp_modem_dce_handle_response_default;
-    DCE_CHECK(dte->send_cmd(dte, command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "define pdp context failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, command, MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                    esp_modem_dce_handle_response_default, NULL) == ESP_OK, "define pdp context failed", err);
     ESP_LOGD(DCE_TAG, "define pdp context ok");
     return ESP_OK;
 err:
@@ -115,12 +109,294 @@ err:
 
 esp_err_t esp_modem_dce_hang_up(modem_dce_t *dce)
 {
-    modem_dte_t *dte = dce->dte;
-    dce->handle_line = esp_modem_dce_handle_response_default;
-    DCE_CHECK(dte->send_cmd(dte, "ATH\r", MODEM_COMMAND_TIMEOUT_HANG_UP) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "hang up failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, "ATH\r", MODEM_COMMAND_TIMEOUT_HANG_UP,
+                                    esp_modem_dce_handle_response_default, NULL) == ESP_OK, "hang up failed", err);
     ESP_LOGD(DCE_TAG, "hang up ok");
     return ESP_OK;
 err:
     return ESP_FAIL;
 }
+
+/**
+ * @brief What each table command is called in logs
+ *
+ */
+static const char *const esp_modem_dce_command_names[ESP_MODEM_DCE_CMD_MAX] = {
+    "inquire signal quality",
+    "inquire battery status",
+    "get module name",
+    "get imei number",
+    "get imsi number",
+    "get network operator",
+    "inquire network status",
+    "enter command mode",
+    "enter ppp mode",
+    "power down",
+    "radio off",
+    "radio on",
+    "sleep on DTR",
+};
+
+static bool esp_modem_dce_is_success(const esp_modem_dce_command_t *command, const char *line)
+{
+    if (!command->success[0]) {
+        return strstr(line, MODEM_RESULT_CODE_SUCCESS);
+    }
+    for (int i = 0; i < sizeof(command->success) / sizeof(command->success[0]) && command->success[i]; i++) {
+        if (strstr(line, command->success[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static const esp_modem_field_t esp_modem_csq_fields[] = {
+    ESP_MODEM_INT(esp_modem_csq_t, rssi),
+    ESP_MODEM_INT(esp_modem_csq_t, ber),
+};
+const esp_modem_format_t esp_modem_format_csq = ESP_MODEM_FORMAT("+CSQ: ", esp_modem_csq_fields);
+
+static const esp_modem_field_t esp_modem_cbc_fields[] = {
+    ESP_MODEM_INT(esp_modem_cbc_t, bcs),
+    ESP_MODEM_INT(esp_modem_cbc_t, bcl),
+    ESP_MODEM_INT(esp_modem_cbc_t, voltage),
+};
+const esp_modem_format_t esp_modem_format_cbc = ESP_MODEM_FORMAT("+CBC: ", esp_modem_cbc_fields);
+
+static const esp_modem_field_t esp_modem_creg_fields[] = {
+    ESP_MODEM_INT(esp_modem_creg_t, n),
+    ESP_MODEM_INT(esp_modem_creg_t, stat),
+};
+const esp_modem_format_t esp_modem_format_creg = ESP_MODEM_FORMAT("+CREG: ", esp_modem_creg_fields);
+
+/* There might be spaces and commas in the operator name, it is always quoted */
+static const esp_modem_field_t esp_modem_cops_fields[] = {
+    ESP_MODEM_INT(esp_modem_cops_t, mode),
+    ESP_MODEM_INT_OPT(esp_modem_cops_t, format),
+    ESP_MODEM_STRING_OPT(esp_modem_cops_t, oper),
+};
+const esp_modem_format_t esp_modem_format_cops = ESP_MODEM_FORMAT("+COPS: ", esp_modem_cops_fields);
+
+static const esp_modem_field_t esp_modem_name_fields[] = {ESP_MODEM_BUFFER(ESP_MODEM_FIELD_TEXT, MODEM_MAX_NAME_LENGTH)};
+const esp_modem_format_t esp_modem_format_name = ESP_MODEM_FORMAT(NULL, esp_modem_name_fields);
+
+static const esp_modem_field_t esp_modem_imei_fields[] = {ESP_MODEM_BUFFER(ESP_MODEM_FIELD_STRING, MODEM_IMEI_LENGTH + 1)};
+const esp_modem_format_t esp_modem_format_imei = ESP_MODEM_FORMAT(NULL, esp_modem_imei_fields);
+
+static const esp_modem_field_t esp_modem_imsi_fields[] = {ESP_MODEM_BUFFER(ESP_MODEM_FIELD_STRING, MODEM_IMSI_LENGTH + 1)};
+const esp_modem_format_t esp_modem_format_imsi = ESP_MODEM_FORMAT(NULL, esp_modem_imsi_fields);
+
+esp_err_t esp_modem_dce_handle_command_line(modem_dce_t *dce, const char *line)
+{
+    esp_err_t err = ESP_FAIL;
+    esp_modem_dce_result_t *result = dce->priv_resource;
+    if (esp_modem_dce_is_success(result->command, line)) {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
+    } else if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+    } else if (result->command->format) {
+        esp_modem_parse_error_t error;
+        err = esp_modem_parse(result->command->format, line, result->out, &error);
+        if (err == ESP_ERR_INVALID_RESPONSE || err == ESP_ERR_INVALID_SIZE) {
+            ESP_LOGW(DCE_TAG, "bad field %d at column %d: %s", error.field, error.column, line);
+        }
+        err = (err == ESP_OK) ? ESP_OK : ESP_FAIL;
+    }
+    return err;
+}
+
+esp_err_t esp_modem_dce_execute(modem_dce_t *dce, esp_modem_dce_cmd_id_t id, void *out)
+{
+    esp_modem_dce_result_t result;
+    DCE_CHECK(dce->model && id < ESP_MODEM_DCE_CMD_MAX, "no command table", err);
+    const esp_modem_dce_command_t *command = &dce->model->commands[id];
+    if (!command->command) {
+        ESP_LOGW(DCE_TAG, "%s: %s not supported", dce->model->name, esp_modem_dce_command_names[id]);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    DCE_CHECK(out || !command->format, "no room for the answer", err);
+    result.command = command;
+    result.out = out;
+    DCE_CHECK(esp_modem_dce_command(dce, command->command, command->timeout,
+                                    command->handle_line ? command->handle_line : esp_modem_dce_handle_command_line,
+                                    &result) == ESP_OK, "%s failed", err, esp_modem_dce_command_names[id]);
+    ESP_LOGD(DCE_TAG, "%s ok", esp_modem_dce_command_names[id]);
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t esp_modem_dce_command(modem_dce_t *dce, const char *command, uint32_t timeout,
+                                esp_err_t (*handle_line)(modem_dce_t *dce, const char *line), void *resource)
+{
+    modem_dte_t *dte = dce->dte;
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_NORMAL, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    if (dce->mode == MODEM_POWER_OFF_MODE) {
+        /* Nothing would answer, fail now rather than after the timeout */
+        esp_modem_arbiter_release(dce->arbiter);
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_modem_sleep_command_begin(dce->sleep);
+    dce->priv_resource = resource;
+    dce->handle_line = handle_line;
+    esp_modem_stats_begin(dce->stats);
+    if (dte->send_cmd(dte, command, timeout) == ESP_OK) {
+        ret = (dce->state == MODEM_STATE_SUCCESS) ? ESP_OK : ESP_FAIL;
+    }
+    esp_modem_stats_end(dce->stats, command, ret == ESP_OK ? ESP_MODEM_STATS_OK :
+                        ret == ESP_FAIL ? ESP_MODEM_STATS_ERROR : ESP_MODEM_STATS_TIMEOUT);
+    esp_modem_health_command(dce->health, ret);
+    esp_modem_sleep_command_end(dce->sleep);
+    esp_modem_arbiter_release(dce->arbiter);
+err:
+    return ret;
+}
+
+bool esp_modem_dce_abort(modem_dce_t *dce)
+{
+    if (dce->state != MODEM_STATE_PROCESSING) {
+        return false;
+    }
+    esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+    return true;
+}
+
+esp_err_t esp_modem_dce_bind(modem_dce_t *dce, const esp_modem_dce_model_t *model)
+{
+    dce->arbiter = esp_modem_arbiter_create(CONFIG_EXAMPLE_MODEM_ARBITER_MAX_BYPASS);
+    DCE_CHECK(dce->arbiter, "create command arbiter failed", err);
+#if CONFIG_EXAMPLE_MODEM_STATS
+    dce->stats = esp_modem_stats_create(CONFIG_EXAMPLE_MODEM_STATS_VERBS);
+    DCE_CHECK(dce->stats, "create command statistics failed", err_stats);
+#endif
+    dce->model = model;
+    portMUX_TYPE ext_lock = portMUX_INITIALIZER_UNLOCKED;
+    dce->ext.lock = ext_lock;
+    dce->sync = esp_modem_dce_sync;
+    dce->echo_mode = esp_modem_dce_echo;
+    dce->store_profile = esp_modem_dce_store_profile;
+    dce->set_flow_ctrl = esp_modem_dce_set_flow_ctrl;
+    dce->define_pdp_context = esp_modem_dce_define_pdp_context;
+    dce->hang_up = esp_modem_dce_hang_up;
+    dce->get_signal_quality = esp_modem_dce_get_signal_quality;
+    dce->get_battery_status = esp_modem_dce_get_battery_status;
+    dce->get_network_status = esp_modem_dce_get_network_status;
+    dce->set_working_mode = esp_modem_dce_set_working_mode;
+    dce->power_down = esp_modem_dce_power_down;
+    dce->set_radio = esp_modem_dce_set_radio;
+    return ESP_OK;
+#if CONFIG_EXAMPLE_MODEM_STATS
+err_stats:
+    esp_modem_arbiter_delete(dce->arbiter);
+    dce->arbiter = NULL;
+#endif
+err:
+    return ESP_ERR_NO_MEM;
+}
+
+void esp_modem_dce_unbind(modem_dce_t *dce)
+{
+    esp_modem_stats_delete(dce->stats);
+    dce->stats = NULL;
+    /* Left allocated if a caller still waits on it, a leak rather than a crash */
+    esp_modem_arbiter_delete(dce->arbiter);
+    dce->arbiter = NULL;
+}
+
+esp_err_t esp_modem_dce_get_signal_quality(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber)
+{
+    esp_modem_csq_t csq;
+    DCE_CHECK(esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_SIGNAL_QUALITY, &csq) == ESP_OK, "get signal quality failed", err);
+    *rssi = csq.rssi;
+    *ber = csq.ber;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t esp_modem_dce_get_battery_status(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage)
+{
+    esp_modem_cbc_t cbc;
+    DCE_CHECK(esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_BATTERY_STATUS, &cbc) == ESP_OK, "get battery status failed", err);
+    *bcs = cbc.bcs;
+    *bcl = cbc.bcl;
+    *voltage = cbc.voltage;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t esp_modem_dce_get_network_status(modem_dce_t *dce, uint32_t *mode, uint32_t *stat)
+{
+    esp_modem_creg_t creg = {0};
+    DCE_CHECK(esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_NETWORK_STATUS, &creg) == ESP_OK, "get network status failed", err);
+    *mode = creg.n;
+    *stat = creg.stat;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t esp_modem_dce_get_module_name(modem_dce_t *dce)
+{
+    return esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_MODULE_NAME, dce->name);
+}
+
+esp_err_t esp_modem_dce_get_imei_number(modem_dce_t *dce)
+{
+    return esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_IMEI, dce->imei);
+}
+
+esp_err_t esp_modem_dce_get_imsi_number(modem_dce_t *dce)
+{
+    return esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_IMSI, dce->imsi);
+}
+
+esp_err_t esp_modem_dce_get_operator_name(modem_dce_t *dce)
+{
+    esp_modem_cops_t cops = {0};
+    DCE_CHECK(esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_OPERATOR, &cops) == ESP_OK, "get operator name failed", err);
+    /* Not registered, "+COPS: 0" carries no operator */
+    if (cops.oper[0]) {
+        strcpy(dce->oper, cops.oper);
+    }
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t esp_modem_dce_set_working_mode(modem_dce_t *dce, modem_mode_t mode)
+{
+    switch (mode) {
+    case MODEM_COMMAND_MODE:
+        DCE_CHECK(esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_COMMAND_MODE, NULL) == ESP_OK, "set working mode failed", err);
+        break;
+    case MODEM_PPP_MODE:
+        DCE_CHECK(esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_PPP_MODE, NULL) == ESP_OK, "set working mode failed", err);
+        break;
+    default:
+        ESP_LOGW(DCE_TAG, "unsupported working mode: %d", mode);
+        goto err;
+    }
+    dce->mode = mode;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t esp_modem_dce_power_down(modem_dce_t *dce)
+{
+    return esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_POWER_DOWN, NULL);
+}
+
+esp_err_t esp_modem_dce_set_radio(modem_dce_t *dce, bool on)
+{
+    return esp_modem_dce_execute(dce, on ? ESP_MODEM_DCE_CMD_RADIO_ON : ESP_MODEM_DCE_CMD_RADIO_OFF, NULL);
+}
+
+esp_err_t esp_modem_dce_sleep_on_dtr(modem_dce_t *dce)
+{
+    return esp_modem_dce_execute(dce, ESP_MODEM_DCE_CMD_SLEEP_ON_DTR, NULL);
+}
@@ -0,0 +1,180 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem_dce_service.h"
+#include "esp_modem_driver.h"
+#include "sdkconfig.h"
+
+static const char *DRIVER_TAG = "esp-modem-driver";
+#define DRIVER_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(a))                                                                        \
+        {                                                                                \
+            ESP_LOGE(DRIVER_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                               \
+        }                                                                                \
+    } while (0)
+
+static const esp_modem_driver_t *s_drivers[ESP_MODEM_DRIVER_MAX];
+
+/**
+ * @brief Rates tried when the modem does not answer at the DTE rate, e.g. still running at a negotiated rate
+ *
+ */
+static const uint32_t esp_modem_probe_rates[] = {460800, 230400, 115200};
+
+esp_err_t esp_modem_driver_register(const esp_modem_driver_t *driver)
+{
+    for (int i = 0; i < ESP_MODEM_DRIVER_MAX; i++)
+    {
+        if (s_drivers[i] == driver)
+        {
+            return ESP_OK;
+        }
+        if (!s_drivers[i])
+        {
+            s_drivers[i] = driver;
+            return ESP_OK;
+        }
+    }
+    ESP_LOGE(DRIVER_TAG, "no room for driver %s", driver->name);
+    return ESP_ERR_NO_MEM;
+}
+
+const esp_modem_driver_t *esp_modem_driver_find(const char *model)
+{
+    for (int i = 0; i < ESP_MODEM_DRIVER_MAX && s_drivers[i]; i++)
+    {
+        for (const char *const *pattern = s_drivers[i]->models; *pattern; pattern++)
+        {
+            if (strstr(model, *pattern))
+            {
+                return s_drivers[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Handle response from AT+CGMM or ATI, keeping the first information line in dce->name
+ *
+ * A boot URC such as "+CPIN: READY" can come in before the answer, so a line naming a
+ * known model replaces one that does not.
+ */
+static esp_err_t esp_modem_probe_handle_model(modem_dce_t *dce, const char *line)
+{
+    esp_err_t err = ESP_FAIL;
+    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
+    {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
+    }
+    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+    }
+    else if (!dce->name[0] || (!esp_modem_driver_find(dce->name) && esp_modem_driver_find(line)))
+    {
+        err = esp_modem_parse(&esp_modem_format_name, line, dce->name, NULL) == ESP_OK ? ESP_OK : ESP_FAIL;
+    }
+    else
+    {
+        err = ESP_OK;
+    }
+    return err;
+}
+
+/**
+ * @brief Ask the model with one command
+ */
+static esp_err_t esp_modem_probe_model(modem_dce_t *dce, const char *command)
+{
+    dce->name[0] = '\0';
+    DRIVER_CHECK(esp_modem_dce_command(dce, command, MODEM_COMMAND_TIMEOUT_DEFAULT, esp_modem_probe_handle_model, NULL) == ESP_OK &&
+                 dce->name[0], "get model failed", err);
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Sync with the modem, trying the usual rates if it does not answer at the DTE rate
+ */
+static esp_err_t esp_modem_probe_sync(modem_dce_t *dce)
+{
+    modem_dte_t *dte = dce->dte;
+    const uint32_t dte_rate = dte->baud_rate;
+    const int rates = sizeof(esp_modem_probe_rates) / sizeof(esp_modem_probe_rates[0]);
+    int64_t deadline = esp_timer_get_time() + CONFIG_EXAMPLE_MODEM_BOOT_TIMEOUT * 1000LL;
+
+    for (int attempt = 1; esp_timer_get_time() < deadline; attempt++)
+    {
+        if (esp_modem_dce_sync(dce) == ESP_OK)
+        {
+            return ESP_OK;
+        }
+        /* Every other try stays at the DTE rate, so a modem that is still booting is not missed */
+        dte->set_baud_rate(dte, (attempt % 2) ? esp_modem_probe_rates[(attempt / 2) % rates] : dte_rate);
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_EXAMPLE_MODEM_SYNC_INTERVAL));
+    }
+    dte->set_baud_rate(dte, dte_rate);
+    return ESP_ERR_TIMEOUT;
+}
+
+esp_err_t esp_modem_probe(modem_dte_t *dte, char *model, size_t length)
+{
+    esp_err_t ret = ESP_FAIL;
+    modem_dce_t probe = {0};
+    DRIVER_CHECK(dte && !dte->dce, "DTE missing or already bound", err);
+    probe.dte = dte;
+    probe.mode = MODEM_COMMAND_MODE;
+    probe.handle_line_default = esp_modem_dce_handle_response_default;
+    probe.handle_line = esp_modem_dce_handle_response_default;
+    dte->dce = &probe;
+
+    ret = esp_modem_probe_sync(&probe);
+    DRIVER_CHECK(ret == ESP_OK, "modem not answering", err_unbind);
+    ret = ESP_FAIL;
+    DRIVER_CHECK(esp_modem_dce_echo(&probe, false) == ESP_OK, "close echo mode failed", err_unbind);
+    if (esp_modem_probe_model(&probe, "AT+CGMM\r") != ESP_OK)
+    {
+        DRIVER_CHECK(esp_modem_probe_model(&probe, "ATI\r") == ESP_OK, "modem model unknown", err_unbind);
+    }
+    snprintf(model, length, "%s", probe.name);
+    ret = ESP_OK;
+err_unbind:
+    dte->dce = NULL;
+err:
+    return ret;
+}
+
+modem_dce_t *esp_modem_driver_init(modem_dte_t *dte, const void *config)
+{
+    char model[MODEM_MAX_NAME_LENGTH];
+    int64_t start = esp_timer_get_time();
+    DRIVER_CHECK(esp_modem_probe(dte, model, sizeof(model)) == ESP_OK, "probe failed", err);
+    const esp_modem_driver_t *driver = esp_modem_driver_find(model);
+    DRIVER_CHECK(driver, "no driver for %s", err, model);
+    ESP_LOGI(DRIVER_TAG, "%s detected in %d ms, using %s driver", model,
+             (int)((esp_timer_get_time() - start) / 1000), driver->name);
+    return driver->init(dte, config);
+err:
+    return NULL;
+}
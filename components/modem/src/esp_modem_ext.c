@@ -0,0 +1,150 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "esp_log.h"
+#include "esp_modem_ext.h"
+
+static const char *EXT_TAG = "esp-modem-ext";
+#define EXT_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                \
+    {                                                                                 \
+        if (!(a))                                                                     \
+        {                                                                             \
+            ESP_LOGE(EXT_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                            \
+        }                                                                             \
+    } while (0)
+
+/**
+ * @brief Detach every extension, newest first, then let the model tear down
+ */
+static esp_err_t esp_modem_ext_deinit(modem_dce_t *dce)
+{
+    esp_modem_ext_t *ext;
+    while ((ext = dce->ext.head) != NULL) {
+        esp_modem_ext_detach(dce, ext);
+        ext->detach(dce);
+    }
+    return dce->deinit(dce);
+}
+
+esp_err_t esp_modem_ext_attach(modem_dce_t *dce, esp_modem_ext_t *ext)
+{
+    EXT_CHECK(dce && ext && ext->detach && dce->deinit, "invalid argument", err);
+    portENTER_CRITICAL(&dce->ext.lock);
+    if (!dce->ext.head) {
+        dce->ext.deinit = dce->deinit;
+        dce->deinit = esp_modem_ext_deinit;
+    }
+    ext->next = dce->ext.head;
+    dce->ext.head = ext;
+    portEXIT_CRITICAL(&dce->ext.lock);
+    return ESP_OK;
+err:
+    return ESP_ERR_INVALID_ARG;
+}
+
+void esp_modem_ext_detach(modem_dce_t *dce, esp_modem_ext_t *ext)
+{
+    portENTER_CRITICAL(&dce->ext.lock);
+    for (esp_modem_ext_t **link = &dce->ext.head; *link; link = &(*link)->next) {
+        if (*link == ext) {
+            *link = ext->next;
+            break;
+        }
+    }
+    if (!dce->ext.head && dce->deinit == esp_modem_ext_deinit) {
+        dce->deinit = dce->ext.deinit;
+    }
+    portEXIT_CRITICAL(&dce->ext.lock);
+    /* The UART task may still be in ext, let it leave before the caller frees it */
+    while (dce->ext.busy) {
+        vTaskDelay(1);
+    }
+}
+
+ESP_MODEM_RX_ATTR void esp_modem_ext_handle_urc(modem_dce_t *dce, const char *line)
+{
+    portENTER_CRITICAL(&dce->ext.lock);
+    esp_modem_ext_t *ext = dce->ext.head;
+    dce->ext.busy = true;
+    portEXIT_CRITICAL(&dce->ext.lock);
+    for (; ext; ext = ext->next) {
+        if (ext->handle_urc) {
+            ext->handle_urc(dce, line);
+        }
+    }
+    dce->ext.busy = false;
+    if (dce->handle_urc) {
+        dce->handle_urc(dce, line);
+    }
+}
+
+esp_err_t esp_modem_ext_task_init(esp_modem_ext_task_t *task)
+{
+    task->handle = NULL;
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    task->events = xEventGroupCreateStatic(&task->events_buffer);
+#else
+    task->events = xEventGroupCreate();
+#endif
+    EXT_CHECK(task->events, "create event group failed", err);
+    return ESP_OK;
+err:
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_modem_ext_task_start(esp_modem_ext_task_t *task, TaskFunction_t entry, const char *name,
+                                   uint32_t stack_size, UBaseType_t priority, void *arg, StackType_t *stack)
+{
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    task->handle = xTaskCreateStatic(entry, name, stack_size, arg, priority, stack, &task->task_buffer);
+#else
+    if (xTaskCreate(entry, name, stack_size, arg, priority, &task->handle) != pdTRUE) {
+        task->handle = NULL;
+    }
+#endif
+    EXT_CHECK(task->handle, "create %s task failed", err, name);
+    return ESP_OK;
+err:
+    return ESP_ERR_NO_MEM;
+}
+
+bool esp_modem_ext_task_stopping(esp_modem_ext_task_t *task)
+{
+    return xEventGroupGetBits(task->events) & ESP_MODEM_EXT_TASK_STOP_BIT;
+}
+
+void esp_modem_ext_task_stop(esp_modem_ext_task_t *task)
+{
+    xEventGroupSetBits(task->events, ESP_MODEM_EXT_TASK_STOP_BIT);
+}
+
+void esp_modem_ext_task_exit(esp_modem_ext_task_t *task)
+{
+    xEventGroupSetBits(task->events, ESP_MODEM_EXT_TASK_EXITED_BIT);
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void esp_modem_ext_task_join(esp_modem_ext_task_t *task)
+{
+    if (task->handle) {
+        xEventGroupSetBits(task->events, ESP_MODEM_EXT_TASK_STOP_BIT);
+        xEventGroupWaitBits(task->events, ESP_MODEM_EXT_TASK_EXITED_BIT, pdFALSE, pdFALSE, portMAX_DELAY);
+        vTaskDelete(task->handle);
+        task->handle = NULL;
+    }
+    vEventGroupDelete(task->events);
+}
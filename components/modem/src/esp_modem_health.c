@@ -0,0 +1,476 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem.h"
+#include "esp_modem_arbiter.h"
+#include "esp_modem_cache.h"
+#include "esp_modem_dce_service.h"
+#include "esp_modem_health.h"
+#include "esp_modem_ext.h"
+#include "esp_modem_sleep.h"
+#include "esp_modem_static.h"
+
+static const char *HEALTH_TAG = "esp-modem-health";
+#define HEALTH_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(a))                                                                        \
+        {                                                                                \
+            ESP_LOGE(HEALTH_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                               \
+        }                                                                                \
+    } while (0)
+
+#define ESP_MODEM_HEALTH_TASK_STACK_SIZE (4096)
+#define ESP_MODEM_HEALTH_TASK_PRIORITY (3)
+#define ESP_MODEM_HEALTH_REGISTRATION_POLL_MS (1000)
+
+/**
+ * @brief Monitor task event bits
+ *
+ */
+#define ESP_MODEM_HEALTH_RECOVER_BIT BIT0 /*!< Recover now */
+
+/**
+ * @brief Health monitor of a DCE
+ *
+ */
+struct esp_modem_health {
+    esp_modem_health_config_t config;
+    modem_dce_t *dce;
+    portMUX_TYPE lock;                           /*!< Protects stats */
+    esp_modem_health_stats_t stats;
+    bool restore_ppp;                            /*!< A recovery out of PPP failed, the next one still brings PPP back */
+    uint32_t ppp_bytes;                          /*!< PPP bytes received at the last check */
+    int64_t ppp_changed_us;                      /*!< esp_timer time ppp_bytes last moved */
+    esp_modem_ext_task_t task;                   /*!< Monitor */
+    esp_modem_ext_t ext;                         /*!< Link into the DCE */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StackType_t task_stack[ESP_MODEM_HEALTH_TASK_STACK_SIZE]; /*!< Its stack */
+#endif
+};
+
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+ESP_MODEM_STATIC_POOL(s_health_pool, esp_modem_health_t);
+#endif
+
+static const char *const esp_modem_health_level_names[ESP_MODEM_HEALTH_LEVEL_MAX] = {
+    "sync",
+    "radio",
+    "reset",
+    "power",
+};
+
+const char *esp_modem_health_level_name(esp_modem_health_level_t level)
+{
+    return level < ESP_MODEM_HEALTH_LEVEL_MAX ? esp_modem_health_level_names[level] : "unknown";
+}
+
+void esp_modem_health_command(esp_modem_health_t *health, esp_err_t result)
+{
+    if (!health) {
+        return;
+    }
+    portENTER_CRITICAL(&health->lock);
+    if (result == ESP_ERR_TIMEOUT) {
+        health->stats.timeouts++;
+        health->stats.consecutive_timeouts++;
+    } else {
+        health->stats.consecutive_timeouts = 0;
+    }
+    portEXIT_CRITICAL(&health->lock);
+}
+
+/**
+ * @brief Any line proves the modem is alive
+ */
+static ESP_MODEM_RX_ATTR void esp_modem_health_handle_urc(modem_dce_t *dce, const char *line)
+{
+    esp_modem_health_t *health = dce->health;
+    portENTER_CRITICAL(&health->lock);
+    health->stats.last_line_us = esp_timer_get_time();
+    if (dce->state != MODEM_STATE_PROCESSING) {
+        health->stats.urcs++;
+    }
+    portEXIT_CRITICAL(&health->lock);
+}
+
+/**
+ * @brief Start watching PPP traffic from now on
+ */
+static void esp_modem_health_rearm(esp_modem_health_t *health)
+{
+    esp_modem_uart_stats_t uart_stats;
+    esp_modem_get_uart_stats(health->dce->dte, &uart_stats);
+    health->ppp_bytes = uart_stats.bytes_received;
+    health->ppp_changed_us = esp_timer_get_time();
+    portENTER_CRITICAL(&health->lock);
+    health->stats.consecutive_timeouts = 0;
+    health->stats.last_line_us = health->ppp_changed_us;
+    portEXIT_CRITICAL(&health->lock);
+}
+
+/**
+ * @brief Look at the modem once
+ *
+ * @return Why the modem needs a recovery, NULL if it does not
+ */
+static const char *esp_modem_health_check(esp_modem_health_t *health)
+{
+    modem_dce_t *dce = health->dce;
+    int64_t now = esp_timer_get_time();
+
+    if (dce->mode == MODEM_POWER_OFF_MODE) {
+        return NULL;
+    }
+    if (esp_modem_sleep_is_asleep(dce)) {
+        /* Quiet on purpose, and the next command finds out whether it still answers */
+        return NULL;
+    }
+    if (dce->mode == MODEM_PPP_MODE) {
+        esp_modem_uart_stats_t uart_stats;
+        if (!health->config.ppp_silence_ms) {
+            return NULL;
+        }
+        esp_modem_get_uart_stats(dce->dte, &uart_stats);
+        if (uart_stats.bytes_received != health->ppp_bytes) {
+            health->ppp_bytes = uart_stats.bytes_received;
+            health->ppp_changed_us = now;
+            return NULL;
+        }
+        return now - health->ppp_changed_us >= health->config.ppp_silence_ms * 1000LL ? "no PPP data" : NULL;
+    }
+
+    portENTER_CRITICAL(&health->lock);
+    uint32_t consecutive_timeouts = health->stats.consecutive_timeouts;
+    int64_t last_line_us = health->stats.last_line_us;
+    portEXIT_CRITICAL(&health->lock);
+    if (consecutive_timeouts >= health->config.max_timeouts) {
+        return "command timeouts";
+    }
+    if (health->restore_ppp) {
+        /* Still short of the PPP session a failed recovery dropped */
+        return now - last_line_us >= health->config.silence_ms * 1000LL ? "PPP not restored" : NULL;
+    }
+    if (now - last_line_us < health->config.silence_ms * 1000LL) {
+        return NULL;
+    }
+    /* Quiet for a while, ask if it is still there unless someone else is already talking to it */
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        return NULL;
+    }
+    portENTER_CRITICAL(&health->lock);
+    health->stats.probes++;
+    portEXIT_CRITICAL(&health->lock);
+    esp_err_t err = dce->sync(dce);
+    esp_modem_arbiter_release(dce->arbiter);
+    return err == ESP_OK ? NULL : "no answer to AT";
+}
+
+/**
+ * @brief Wait until the modem is registered again, the way the model does at start
+ */
+static esp_err_t esp_modem_health_wait_registered(modem_dce_t *dce)
+{
+    int64_t deadline = esp_timer_get_time() + CONFIG_EXAMPLE_MODEM_REGISTRATION_TIMEOUT * 1000LL;
+    uint32_t mode = 0, stat = 0;
+    do {
+        esp_modem_cache_invalidate(dce, ESP_MODEM_CACHE_NETWORK_STATUS);
+        if (dce->get_network_status(dce, &mode, &stat) == ESP_OK && (stat == 1 || stat == 5)) {
+            return ESP_OK;
+        }
+        vTaskDelay(pdMS_TO_TICKS(ESP_MODEM_HEALTH_REGISTRATION_POLL_MS));
+    } while (esp_timer_get_time() < deadline);
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Whether the model has what a recovery step needs
+ */
+static bool esp_modem_health_has_step(modem_dce_t *dce, esp_modem_health_level_t level)
+{
+    switch (level) {
+    case ESP_MODEM_HEALTH_SYNC:
+        return true;
+    case ESP_MODEM_HEALTH_RADIO:
+        return dce->set_radio;
+    case ESP_MODEM_HEALTH_RESET:
+        return dce->hard_reset;
+    case ESP_MODEM_HEALTH_POWER:
+        return dce->power_cycle;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Take one recovery step and check whether the modem is back
+ *
+ * @param health health monitor
+ * @param level step to take
+ * @param ppp bring the PPP session back as well
+ * @return esp_err_t
+ *      - ESP_OK if the modem answers again, in PPP mode if asked
+ *      - ESP_FAIL otherwise
+ */
+static esp_err_t esp_modem_health_step(esp_modem_health_t *health, esp_modem_health_level_t level, bool ppp)
+{
+    modem_dce_t *dce = health->dce;
+    uint32_t attempts = health->config.sync_attempts ? health->config.sync_attempts : 1;
+    esp_err_t ret = ESP_FAIL;
+
+    switch (level) {
+    case ESP_MODEM_HEALTH_SYNC:
+        if (ppp) {
+            /* The modem may still be in data mode, or may have dropped it already */
+            dce->set_working_mode(dce, MODEM_COMMAND_MODE);
+        }
+        break;
+    case ESP_MODEM_HEALTH_RADIO:
+        /* Only helps a modem that still answers */
+        HEALTH_CHECK(dce->sync(dce) == ESP_OK, "no answer, radio step skipped", err);
+        dce->set_radio(dce, false);
+        HEALTH_CHECK(dce->set_radio(dce, true) == ESP_OK, "radio on failed", err);
+        break;
+    case ESP_MODEM_HEALTH_RESET:
+        HEALTH_CHECK(dce->hard_reset(dce) == ESP_OK, "hard reset failed", err);
+        break;
+    case ESP_MODEM_HEALTH_POWER:
+        HEALTH_CHECK(dce->power_cycle(dce) == ESP_OK, "power cycle failed", err);
+        break;
+    default:
+        goto err;
+    }
+    /* Whatever was cached predates the trouble */
+    esp_modem_cache_invalidate(dce, ESP_MODEM_CACHE_MAX);
+    while (attempts-- && ret != ESP_OK) {
+        ret = dce->sync(dce);
+    }
+    HEALTH_CHECK(ret == ESP_OK, "no answer after %s", err, esp_modem_health_level_name(level));
+    if (ppp) {
+        HEALTH_CHECK(esp_modem_health_wait_registered(dce) == ESP_OK, "not registered after %s", err,
+                     esp_modem_health_level_name(level));
+        HEALTH_CHECK(esp_modem_setup_ppp(dce->dte) == ESP_OK, "PPP not restored after %s", err,
+                     esp_modem_health_level_name(level));
+    }
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Escalate until the modem is back in the mode it was in
+ *
+ * @param health health monitor
+ * @param reason what was found wrong, for the log
+ */
+static void esp_modem_health_recover_now(esp_modem_health_t *health, const char *reason)
+{
+    modem_dce_t *dce = health->dce;
+    int64_t since = esp_timer_get_time();
+    esp_modem_health_level_t level;
+
+    ESP_LOGW(HEALTH_TAG, "modem unresponsive (%s), recovering", reason);
+    portENTER_CRITICAL(&health->lock);
+    health->stats.recovering = true;
+    portEXIT_CRITICAL(&health->lock);
+    /* A command left waiting on a dead modem, say AT+COPS? with its 75 s, would hold the channel that long */
+    if (esp_modem_dce_abort(dce)) {
+        ESP_LOGW(HEALTH_TAG, "command in flight failed");
+    }
+    /* Whoever is waiting for the channel waits until the modem is back */
+    esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, ESP_MODEM_ARBITER_WAIT_FOREVER);
+    bool ppp = health->restore_ppp || dce->mode == MODEM_PPP_MODE;
+    if (dce->mode == MODEM_PPP_MODE) {
+        esp_modem_drop_ppp(dce->dte);
+    }
+    for (level = ESP_MODEM_HEALTH_SYNC; level < ESP_MODEM_HEALTH_LEVEL_MAX; level++) {
+        if (esp_modem_ext_task_stopping(&health->task)) {
+            break;
+        }
+        if (!esp_modem_health_has_step(dce, level)) {
+            continue;
+        }
+        ESP_LOGI(HEALTH_TAG, "recovery step: %s", esp_modem_health_level_name(level));
+        if (esp_modem_health_step(health, level, ppp) == ESP_OK) {
+            break;
+        }
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+
+    uint32_t mttr_ms = (esp_timer_get_time() - since) / 1000;
+    health->restore_ppp = ppp && level == ESP_MODEM_HEALTH_LEVEL_MAX;
+    esp_modem_health_rearm(health);
+    portENTER_CRITICAL(&health->lock);
+    health->stats.recovering = false;
+    if (level < ESP_MODEM_HEALTH_LEVEL_MAX) {
+        health->stats.recovered[level]++;
+        health->stats.last_mttr_ms = mttr_ms;
+        health->stats.total_mttr_ms += mttr_ms;
+        if (mttr_ms > health->stats.max_mttr_ms) {
+            health->stats.max_mttr_ms = mttr_ms;
+        }
+    } else {
+        health->stats.failures++;
+    }
+    portEXIT_CRITICAL(&health->lock);
+    if (level < ESP_MODEM_HEALTH_LEVEL_MAX) {
+        ESP_LOGI(HEALTH_TAG, "modem recovered by %s in %u ms", esp_modem_health_level_name(level), mttr_ms);
+    } else {
+        ESP_LOGE(HEALTH_TAG, "modem not recovered after %u ms, trying again later", mttr_ms);
+    }
+}
+
+/**
+ * @brief Check the modem periodically and recover it when needed
+ *
+ * @param param health monitor
+ */
+static void esp_modem_health_task_entry(void *param)
+{
+    esp_modem_health_t *health = (esp_modem_health_t *)param;
+    const EventBits_t wait_bits = ESP_MODEM_HEALTH_RECOVER_BIT | ESP_MODEM_EXT_TASK_STOP_BIT;
+
+    while (1) {
+        EventBits_t bits = xEventGroupWaitBits(health->task.events, wait_bits, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(health->config.check_interval_ms));
+        if (bits & ESP_MODEM_EXT_TASK_STOP_BIT) {
+            break;
+        }
+        const char *reason = (bits & ESP_MODEM_HEALTH_RECOVER_BIT) ? "requested" : esp_modem_health_check(health);
+        if (reason) {
+            esp_modem_health_recover_now(health, reason);
+        }
+    }
+    esp_modem_ext_task_exit(&health->task);
+}
+
+static void esp_modem_health_detach(modem_dce_t *dce)
+{
+    esp_modem_health_t *health = dce->health;
+    /* A recovery in progress ends with its current step */
+    esp_modem_ext_task_join(&health->task);
+    dce->health = NULL;
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_health_pool, health);
+#else
+    free(health);
+#endif
+}
+
+esp_err_t esp_modem_health_enable(modem_dce_t *dce, const esp_modem_health_config_t *config)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    HEALTH_CHECK(dce && config && config->check_interval_ms, "invalid argument", err_arg);
+    HEALTH_CHECK(!dce->health, "health monitor already enabled", err_state);
+    /* Without LCP echo an idle session is as quiet as a dead one */
+    HEALTH_CHECK(!config->ppp_silence_ms || CONFIG_EXAMPLE_MODEM_PPP_LCP_ECHO, "PPP silence needs LCP echo", err_arg);
+    HEALTH_CHECK(dce->sync && dce->set_working_mode && dce->get_network_status && dce->deinit,
+                 "DCE lacks the methods recovery needs", err_arg);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_health_t *health = esp_modem_static_calloc(&s_health_pool);
+    HEALTH_CHECK(health, "no static slot for health monitor", err);
+    StackType_t *stack = health->task_stack;
+#else
+    esp_modem_health_t *health = calloc(1, sizeof(esp_modem_health_t));
+    HEALTH_CHECK(health, "calloc health monitor failed", err);
+    StackType_t *stack = NULL;
+#endif
+    HEALTH_CHECK(esp_modem_ext_task_init(&health->task) == ESP_OK, "health task not set up", err_events);
+    health->config = *config;
+    health->dce = dce;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    health->lock = lock;
+    health->ext.handle_urc = esp_modem_health_handle_urc;
+    health->ext.detach = esp_modem_health_detach;
+    esp_modem_health_rearm(health);
+    dce->health = health;
+    esp_modem_ext_attach(dce, &health->ext);
+    HEALTH_CHECK(esp_modem_ext_task_start(&health->task, esp_modem_health_task_entry, "modem_health",
+                                          ESP_MODEM_HEALTH_TASK_STACK_SIZE, ESP_MODEM_HEALTH_TASK_PRIORITY, health,
+                                          stack) == ESP_OK, "health task not started", err_task);
+    return ESP_OK;
+err_task:
+    esp_modem_ext_detach(dce, &health->ext);
+    dce->health = NULL;
+    esp_modem_ext_task_join(&health->task);
+err_events:
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_health_pool, health);
+#else
+    free(health);
+#endif
+err:
+    return ret;
+err_state:
+    return ESP_ERR_INVALID_STATE;
+err_arg:
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_modem_health_recover(modem_dce_t *dce)
+{
+    esp_modem_health_t *health = dce->health;
+    if (!health) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xEventGroupSetBits(health->task.events, ESP_MODEM_HEALTH_RECOVER_BIT);
+    return ESP_OK;
+}
+
+esp_err_t esp_modem_health_stop(modem_dce_t *dce)
+{
+    esp_modem_health_t *health = dce->health;
+    if (!health) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_modem_ext_task_stop(&health->task);
+    return ESP_OK;
+}
+
+esp_err_t esp_modem_health_get_stats(modem_dce_t *dce, esp_modem_health_stats_t *stats)
+{
+    esp_modem_health_t *health = dce->health;
+    if (!health) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    portENTER_CRITICAL(&health->lock);
+    *stats = health->stats;
+    portEXIT_CRITICAL(&health->lock);
+    return ESP_OK;
+}
+
+void esp_modem_health_reset_stats(modem_dce_t *dce)
+{
+    esp_modem_health_t *health = dce->health;
+    if (!health) {
+        return;
+    }
+    portENTER_CRITICAL(&health->lock);
+    health->stats.timeouts = 0;
+    health->stats.probes = 0;
+    health->stats.urcs = 0;
+    memset(health->stats.recovered, 0, sizeof(health->stats.recovered));
+    health->stats.failures = 0;
+    health->stats.last_mttr_ms = 0;
+    health->stats.max_mttr_ms = 0;
+    health->stats.total_mttr_ms = 0;
+    portEXIT_CRITICAL(&health->lock);
+}
@@ -0,0 +1,329 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem_link.h"
+#include "sdkconfig.h"
+
+#define ESP_MODEM_LINK_CHUNK_SIZE_DEFAULT (1024)
+#define ESP_MODEM_LINK_QUEUE_SIZE (8)
+#define ESP_MODEM_LINK_TASK_STACK_SIZE (2048)
+#define ESP_MODEM_LINK_TASK_PRIORITY CONFIG_EXAMPLE_MODEM_LINK_TASK_PRIORITY
+#if CONFIG_EXAMPLE_MODEM_LINK_TASK_CORE < 0
+#define ESP_MODEM_LINK_TASK_CORE tskNO_AFFINITY
+#else
+#define ESP_MODEM_LINK_TASK_CORE CONFIG_EXAMPLE_MODEM_LINK_TASK_CORE
+#endif
+
+static const char *LINK_TAG = "esp-modem-link";
+#define LINK_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                 \
+    {                                                                                  \
+        if (!(a))                                                                      \
+        {                                                                              \
+            ESP_LOGE(LINK_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                             \
+        }                                                                              \
+    } while (0)
+
+/**
+ * @brief Piece of a transfer handed to one link
+ *
+ */
+typedef struct
+{
+    const uint8_t *data;     /*!< Start of the chunk, NULL asks the sender task to exit */
+    size_t len;              /*!< Length of the chunk */
+    QueueHandle_t done;      /*!< Where the chunk goes back once sent, owned by the transfer */
+    esp_modem_link_t *link;  /*!< Link that handled the chunk */
+    bool ok;                 /*!< Chunk sent completely */
+} esp_modem_link_chunk_t;
+
+/**
+ * @brief Outbound link
+ *
+ */
+struct esp_modem_link
+{
+    esp_modem_link_config_t config; /*!< Link description */
+    bool used;                      /*!< Slot in use */
+    QueueHandle_t queue;            /*!< Chunks waiting for the sender task */
+    SemaphoreHandle_t exited;       /*!< Given by the sender task when it exits */
+    size_t queued;                  /*!< Bytes queued and not sent yet */
+    esp_modem_link_stats_t stats;   /*!< Counters */
+};
+
+static esp_modem_link_t s_links[ESP_MODEM_LINK_MAX];
+static SemaphoreHandle_t s_lock = NULL;
+
+static bool esp_modem_link_is_up(esp_modem_link_t *link)
+{
+    return link->used && (!link->config.is_up || link->config.is_up(link->config.ctx));
+}
+
+/**
+ * @brief Send the chunks queued on one link
+ *
+ * @param param link
+ */
+static void esp_modem_link_task_entry(void *param)
+{
+    esp_modem_link_t *link = (esp_modem_link_t *)param;
+    esp_modem_link_chunk_t chunk;
+    while (xQueueReceive(link->queue, &chunk, portMAX_DELAY) == pdTRUE)
+    {
+        if (!chunk.data)
+        {
+            break;
+        }
+        int64_t start = esp_timer_get_time();
+        int sent = link->config.send(link->config.ctx, chunk.data, chunk.len);
+        int64_t elapsed = esp_timer_get_time() - start;
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        link->queued -= chunk.len;
+        link->stats.busy_us += elapsed;
+        chunk.ok = (sent == chunk.len);
+        if (chunk.ok)
+        {
+            link->stats.chunks++;
+            link->stats.bytes += chunk.len;
+        }
+        else
+        {
+            link->stats.errors++;
+        }
+        xSemaphoreGive(s_lock);
+
+        chunk.link = link;
+        xQueueSend(chunk.done, &chunk, portMAX_DELAY);
+    }
+    xSemaphoreGive(link->exited);
+    vTaskDelete(NULL);
+}
+
+esp_modem_link_t *esp_modem_link_add(const esp_modem_link_config_t *config)
+{
+    esp_modem_link_t *link = NULL;
+    LINK_CHECK(config && config->send && config->bit_rate, "invalid link config", err);
+    if (!s_lock)
+    {
+        s_lock = xSemaphoreCreateMutex();
+        LINK_CHECK(s_lock, "create lock failed", err);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_LINK_MAX; i++)
+    {
+        if (!s_links[i].used)
+        {
+            link = &s_links[i];
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    LINK_CHECK(link, "no room for link %s", err, config->name);
+
+    memset(link, 0, sizeof(*link));
+    link->config = *config;
+    link->stats.name = config->name;
+    link->queue = xQueueCreate(ESP_MODEM_LINK_QUEUE_SIZE, sizeof(esp_modem_link_chunk_t));
+    LINK_CHECK(link->queue, "create link queue failed", err_queue);
+    link->exited = xSemaphoreCreateBinary();
+    LINK_CHECK(link->exited, "create link semaphore failed", err_sem);
+    BaseType_t ret = xTaskCreatePinnedToCore(esp_modem_link_task_entry, "modem_link", ESP_MODEM_LINK_TASK_STACK_SIZE,
+                                             link, ESP_MODEM_LINK_TASK_PRIORITY, NULL, ESP_MODEM_LINK_TASK_CORE);
+    LINK_CHECK(ret == pdTRUE, "create link task failed", err_task);
+    /* Only visible to the scheduler once it can send */
+    link->used = true;
+    ESP_LOGI(LINK_TAG, "link %s added, %d bit/s", config->name, config->bit_rate);
+    return link;
+err_task:
+    vSemaphoreDelete(link->exited);
+err_sem:
+    vQueueDelete(link->queue);
+err_queue:
+    memset(link, 0, sizeof(*link));
+err:
+    return NULL;
+}
+
+esp_err_t esp_modem_link_remove(esp_modem_link_t *link)
+{
+    esp_modem_link_chunk_t stop = {0};
+    LINK_CHECK(link >= s_links && link < s_links + ESP_MODEM_LINK_MAX && link->used, "unknown link", err);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    link->used = false;
+    xSemaphoreGive(s_lock);
+    /* Chunks already queued are still sent, then the task exits */
+    xQueueSend(link->queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(link->exited, portMAX_DELAY);
+    vSemaphoreDelete(link->exited);
+    vQueueDelete(link->queue);
+    ESP_LOGI(LINK_TAG, "link %s removed", link->config.name);
+    memset(link, 0, sizeof(*link));
+    return ESP_OK;
+err:
+    return ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief Pick the link expected to have a chunk out first, and account the chunk to it
+ *
+ * @param len chunk length
+ * @param exclude link that just failed this chunk, NULL for none
+ * @return esp_modem_link_t* chosen link, NULL if none is up
+ */
+static esp_modem_link_t *esp_modem_link_pick(size_t len, esp_modem_link_t *exclude)
+{
+    esp_modem_link_t *best = NULL;
+    uint64_t best_finish = UINT64_MAX;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_LINK_MAX; i++)
+    {
+        esp_modem_link_t *link = &s_links[i];
+        if (link == exclude || !esp_modem_link_is_up(link))
+        {
+            continue;
+        }
+        /* Time to drain what is queued plus this chunk, in microseconds */
+        uint64_t finish = (uint64_t)(link->queued + len) * 10 * 1000000 / link->config.bit_rate;
+        if (finish < best_finish)
+        {
+            best_finish = finish;
+            best = link;
+        }
+    }
+    if (best)
+    {
+        best->queued += len;
+    }
+    xSemaphoreGive(s_lock);
+    return best;
+}
+
+esp_err_t esp_modem_link_send(const uint8_t *data, size_t len, size_t chunk_size)
+{
+    esp_err_t ret = ESP_OK;
+    size_t offset = 0;
+    int in_flight = 0;
+    esp_modem_link_chunk_t chunk;
+
+    if (!chunk_size)
+    {
+        chunk_size = ESP_MODEM_LINK_CHUNK_SIZE_DEFAULT;
+    }
+    LINK_CHECK(s_lock, "no link added", err);
+    /* Enough room for every chunk that can be in flight on all links */
+    QueueHandle_t done = xQueueCreate(ESP_MODEM_LINK_MAX * ESP_MODEM_LINK_QUEUE_SIZE, sizeof(esp_modem_link_chunk_t));
+    LINK_CHECK(done, "create transfer queue failed", err);
+
+    while (offset < len || in_flight)
+    {
+        /* Hand out chunks while links have room, then wait for one to come back */
+        if (offset < len && in_flight < ESP_MODEM_LINK_MAX * ESP_MODEM_LINK_QUEUE_SIZE)
+        {
+            chunk.data = data + offset;
+            chunk.len = len - offset < chunk_size ? len - offset : chunk_size;
+            chunk.done = done;
+            chunk.link = esp_modem_link_pick(chunk.len, NULL);
+            if (!chunk.link)
+            {
+                ret = ESP_ERR_NOT_FOUND;
+                break;
+            }
+            if (xQueueSend(chunk.link->queue, &chunk, 0) == pdTRUE)
+            {
+                offset += chunk.len;
+                in_flight++;
+                continue;
+            }
+            /* That link is full, undo the accounting and wait for progress */
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            chunk.link->queued -= chunk.len;
+            xSemaphoreGive(s_lock);
+            if (!in_flight)
+            {
+                vTaskDelay(1);
+                continue;
+            }
+        }
+        xQueueReceive(done, &chunk, portMAX_DELAY);
+        in_flight--;
+        if (!chunk.ok)
+        {
+            /* Give the chunk to another link */
+            esp_modem_link_t *failed = chunk.link;
+            chunk.link = esp_modem_link_pick(chunk.len, failed);
+            if (!chunk.link)
+            {
+                ESP_LOGE(LINK_TAG, "chunk of %d bytes lost, no other link up", chunk.len);
+                ret = ESP_FAIL;
+                continue;
+            }
+            xQueueSend(chunk.link->queue, &chunk, portMAX_DELAY);
+            in_flight++;
+        }
+    }
+    /* Let chunks still out come back before the queue goes away */
+    while (in_flight)
+    {
+        xQueueReceive(done, &chunk, portMAX_DELAY);
+        in_flight--;
+    }
+    vQueueDelete(done);
+    return ret;
+err:
+    return ESP_FAIL;
+}
+
+int esp_modem_link_get_stats(esp_modem_link_stats_t *stats)
+{
+    int count = 0;
+    if (!s_lock)
+    {
+        return 0;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_LINK_MAX; i++)
+    {
+        if (s_links[i].used)
+        {
+            stats[count] = s_links[i].stats;
+            stats[count].up = esp_modem_link_is_up(&s_links[i]);
+            count++;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return count;
+}
+
+void esp_modem_link_reset_stats(void)
+{
+    if (!s_lock)
+    {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < ESP_MODEM_LINK_MAX; i++)
+    {
+        memset(&s_links[i].stats, 0, sizeof(s_links[i].stats));
+        s_links[i].stats.name = s_links[i].config.name;
+    }
+    xSemaphoreGive(s_lock);
+}
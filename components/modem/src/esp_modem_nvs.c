@@ -0,0 +1,128 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "esp_modem_nvs.h"
+
+#define ESP_MODEM_NVS_MAX_STR_LENGTH (64)
+
+static const char *NVS_TAG = "esp-modem-nvs";
+
+/**
+ * @brief Open the namespace of a modem instance, the first one keeps the plain namespace name
+ */
+static esp_err_t esp_modem_nvs_open(uint8_t instance, nvs_open_mode open_mode, nvs_handle *handle)
+{
+    char name[16]; /* NVS names are limited to 15 characters */
+    if (instance)
+        snprintf(name, sizeof(name), "%s%d", ESP_MODEM_NVS_NAMESPACE, instance);
+    else
+        snprintf(name, sizeof(name), "%s", ESP_MODEM_NVS_NAMESPACE);
+    return nvs_open(name, open_mode, handle);
+}
+
+esp_err_t esp_modem_nvs_get_u32(uint8_t instance, const char *key, uint32_t *value)
+{
+    nvs_handle handle;
+    esp_err_t err = esp_modem_nvs_open(instance, NVS_READONLY, &handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_get_u32(handle, key, value);
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t esp_modem_nvs_set_u32(uint8_t instance, const char *key, uint32_t value)
+{
+    uint32_t stored = 0;
+    if (esp_modem_nvs_get_u32(instance, key, &stored) == ESP_OK && stored == value)
+    {
+        return ESP_OK;
+    }
+    nvs_handle handle;
+    esp_err_t err = esp_modem_nvs_open(instance, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(NVS_TAG, "open namespace failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_set_u32(handle, key, value);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t esp_modem_nvs_get_str(uint8_t instance, const char *key, char *value, size_t length)
+{
+    nvs_handle handle;
+    esp_err_t err = esp_modem_nvs_open(instance, NVS_READONLY, &handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_get_str(handle, key, value, &length);
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t esp_modem_nvs_set_str(uint8_t instance, const char *key, const char *value)
+{
+    char stored[ESP_MODEM_NVS_MAX_STR_LENGTH];
+    if (esp_modem_nvs_get_str(instance, key, stored, sizeof(stored)) == ESP_OK && !strcmp(stored, value))
+    {
+        return ESP_OK;
+    }
+    nvs_handle handle;
+    esp_err_t err = esp_modem_nvs_open(instance, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(NVS_TAG, "open namespace failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = nvs_set_str(handle, key, value);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t esp_modem_nvs_erase(uint8_t instance, const char *key)
+{
+    nvs_handle handle;
+    esp_err_t err = esp_modem_nvs_open(instance, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_erase_key(handle, key);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    else if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        err = ESP_OK;
+    }
+    nvs_close(handle);
+    return err;
+}
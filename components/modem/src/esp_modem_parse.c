@@ -0,0 +1,175 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <string.h>
+#include "esp_modem_parse.h"
+
+static inline bool esp_modem_parse_is_end(char c)
+{
+    return c == '\0' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief Parse a decimal integer at p, stopping at the first character that is not part of it
+ */
+static esp_err_t esp_modem_parse_int(const char **p, void *member, size_t size)
+{
+    const char *s = *p;
+    bool negative = false;
+    int32_t value = 0;
+    while (*s == ' ') {
+        s++;
+    }
+    if (*s == '-' || *s == '+') {
+        negative = (*s == '-');
+        s++;
+    }
+    if (*s < '0' || *s > '9') {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    while (*s >= '0' && *s <= '9') {
+        if (value > (INT32_MAX - (*s - '0')) / 10) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        value = value * 10 + (*s - '0');
+        s++;
+    }
+    if (negative) {
+        value = -value;
+    }
+    switch (size) {
+    case sizeof(int8_t):
+        *(int8_t *)member = value;
+        break;
+    case sizeof(int16_t):
+        *(int16_t *)member = value;
+        break;
+    case sizeof(int32_t):
+        *(int32_t *)member = value;
+        break;
+    default:
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *p = s;
+    return ESP_OK;
+}
+
+/**
+ * @brief Copy characters up to the end of the line or a stop character into a member
+ */
+static esp_err_t esp_modem_parse_copy(const char **p, char *member, size_t size, char stop)
+{
+    const char *s = *p;
+    size_t len = 0;
+    while (!esp_modem_parse_is_end(s[len]) && s[len] != stop) {
+        len++;
+    }
+    if (member) {
+        if (len >= size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(member, s, len);
+        member[len] = '\0';
+    }
+    *p = s + len;
+    return ESP_OK;
+}
+
+static esp_err_t esp_modem_parse_string(const char **p, char *member, size_t size)
+{
+    const char *s = *p;
+    while (*s == ' ') {
+        s++;
+    }
+    if (*s != '"') {
+        *p = s;
+        return esp_modem_parse_copy(p, member, size, ',');
+    }
+    s++;
+    esp_err_t err = esp_modem_parse_copy(&s, member, size, '"');
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (*s != '"') {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    *p = s + 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_modem_parse(const esp_modem_format_t *format, const char *line, void *out, esp_modem_parse_error_t *error)
+{
+    esp_err_t err = ESP_OK;
+    const char *p = line;
+    uint8_t i = 0;
+    if (format->prefix) {
+        size_t len = strlen(format->prefix);
+        if (strncmp(line, format->prefix, len)) {
+            err = ESP_ERR_NOT_FOUND;
+            goto out;
+        }
+        p += len;
+    }
+    for (i = 0; i < format->count; i++) {
+        const esp_modem_field_t *field = &format->fields[i];
+        void *member = field->type == ESP_MODEM_FIELD_SKIP ? NULL : (uint8_t *)out + field->offset;
+        if (i && *p == ',') {
+            p++;
+        } else if (i || esp_modem_parse_is_end(*p)) {
+            /* No separator, the line ended here */
+            if (!field->optional) {
+                err = ESP_ERR_INVALID_RESPONSE;
+            }
+            goto out;
+        }
+        /* An empty field, e.g. "1,,2", counts as missing */
+        if (*p == ',' || esp_modem_parse_is_end(*p)) {
+            if (!field->optional) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                goto out;
+            }
+            continue;
+        }
+        switch (field->type) {
+        case ESP_MODEM_FIELD_INT:
+            err = esp_modem_parse_int(&p, member, field->size);
+            break;
+        case ESP_MODEM_FIELD_STRING:
+            err = esp_modem_parse_string(&p, member, field->size);
+            break;
+        case ESP_MODEM_FIELD_TEXT:
+            err = esp_modem_parse_copy(&p, member, field->size, '\0');
+            break;
+        default:
+            err = esp_modem_parse_string(&p, NULL, 0);
+            break;
+        }
+        if (err != ESP_OK) {
+            goto out;
+        }
+        /* Trailing spaces are allowed before the separator, anything else is not */
+        while (*p == ' ') {
+            p++;
+        }
+        if (*p != ',' && !esp_modem_parse_is_end(*p)) {
+            err = ESP_ERR_INVALID_RESPONSE;
+            goto out;
+        }
+    }
+out:
+    if (error) {
+        error->field = i;
+        error->column = p - line;
+    }
+    return err;
+}
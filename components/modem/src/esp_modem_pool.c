@@ -0,0 +1,152 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_modem_pool.h"
+#include "sdkconfig.h"
+
+/* Blocks are whole words, so that each one is aligned and can hold the free list link */
+#define POOL_WORDS(size) (((size) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+typedef struct {
+    const char *name;
+    uint32_t *memory;
+    size_t block_words;
+    size_t blocks;
+    size_t unused;         /*!< Blocks from here on were never handed out, so need no free list */
+    void *free_list;       /*!< Blocks given back, linked through their first word */
+    size_t in_use;
+    size_t high_water;
+    uint32_t allocations;
+    uint32_t exhausted;
+} esp_modem_pool_t;
+
+static uint32_t s_small_memory[POOL_WORDS(CONFIG_EXAMPLE_MODEM_POOL_SMALL_SIZE) * CONFIG_EXAMPLE_MODEM_POOL_SMALL_BLOCKS];
+static uint32_t s_scratch_memory[POOL_WORDS(CONFIG_EXAMPLE_MODEM_POOL_SCRATCH_SIZE) * CONFIG_EXAMPLE_MODEM_POOL_SCRATCH_BLOCKS];
+
+/* Smallest blocks first, a request takes the first pool it fits in */
+static esp_modem_pool_t s_pools[] = {
+    {"small", s_small_memory, POOL_WORDS(CONFIG_EXAMPLE_MODEM_POOL_SMALL_SIZE), CONFIG_EXAMPLE_MODEM_POOL_SMALL_BLOCKS},
+    {"scratch", s_scratch_memory, POOL_WORDS(CONFIG_EXAMPLE_MODEM_POOL_SCRATCH_SIZE), CONFIG_EXAMPLE_MODEM_POOL_SCRATCH_BLOCKS},
+};
+
+#define POOL_COUNT (sizeof(s_pools) / sizeof(s_pools[0]))
+
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_oversize;
+
+static void *esp_modem_pool_take(esp_modem_pool_t *pool)
+{
+    void *block = NULL;
+    if (pool->free_list) {
+        block = pool->free_list;
+        memcpy(&pool->free_list, block, sizeof(void *));
+    } else if (pool->unused < pool->blocks) {
+        block = pool->memory + pool->unused++ * pool->block_words;
+    }
+    if (block) {
+        pool->allocations++;
+        if (++pool->in_use > pool->high_water) {
+            pool->high_water = pool->in_use;
+        }
+    } else {
+        pool->exhausted++;
+    }
+    return block;
+}
+
+void *esp_modem_pool_alloc(size_t size)
+{
+    void *block = NULL;
+    bool fits = false;
+    portENTER_CRITICAL(&s_pool_lock);
+    for (size_t i = 0; i < POOL_COUNT; i++) {
+        if (size <= s_pools[i].block_words * sizeof(uint32_t)) {
+            block = esp_modem_pool_take(&s_pools[i]);
+            fits = true;
+            break;
+        }
+    }
+    if (!fits) {
+        s_oversize++;
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+    return block ? block : malloc(size);
+}
+
+void *esp_modem_pool_calloc(size_t size)
+{
+    void *ptr = esp_modem_pool_alloc(size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void esp_modem_pool_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    for (size_t i = 0; i < POOL_COUNT; i++) {
+        esp_modem_pool_t *pool = &s_pools[i];
+        if ((uint32_t *)ptr >= pool->memory && (uint32_t *)ptr < pool->memory + pool->blocks * pool->block_words) {
+            portENTER_CRITICAL(&s_pool_lock);
+            memcpy(ptr, &pool->free_list, sizeof(void *));
+            pool->free_list = ptr;
+            pool->in_use--;
+            portEXIT_CRITICAL(&s_pool_lock);
+            return;
+        }
+    }
+    free(ptr);
+}
+
+esp_err_t esp_modem_pool_get_stats(size_t index, esp_modem_pool_stats_t *stats)
+{
+    if (index >= POOL_COUNT) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_modem_pool_t *pool = &s_pools[index];
+    portENTER_CRITICAL(&s_pool_lock);
+    stats->name = pool->name;
+    stats->block_size = pool->block_words * sizeof(uint32_t);
+    stats->blocks = pool->blocks;
+    stats->in_use = pool->in_use;
+    stats->high_water = pool->high_water;
+    stats->allocations = pool->allocations;
+    stats->exhausted = pool->exhausted;
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ESP_OK;
+}
+
+uint32_t esp_modem_pool_get_oversize(void)
+{
+    return s_oversize;
+}
+
+void esp_modem_pool_report(void)
+{
+    esp_modem_pool_stats_t stats;
+    printf("%-8s %6s %6s %6s %10s %11s %9s\r\n", "pool", "block", "blocks", "in use", "high water", "allocations",
+           "exhausted");
+    for (size_t i = 0; esp_modem_pool_get_stats(i, &stats) == ESP_OK; i++) {
+        printf("%-8s %6u %6u %6u %10u %11u %9u\r\n", stats.name, stats.block_size, stats.blocks, stats.in_use,
+               stats.high_water, stats.allocations, stats.exhausted);
+    }
+    printf("larger than every block: %u\r\n", esp_modem_pool_get_oversize());
+}
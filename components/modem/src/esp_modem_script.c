@@ -0,0 +1,583 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem_dce_service.h"
+#include "esp_modem_script.h"
+#include "sdkconfig.h"
+
+static const char *SCRIPT_TAG = "esp-modem-script";
+
+#define ESP_MODEM_SCRIPT_LINE_LENGTH (256)
+#define ESP_MODEM_SCRIPT_VARS (16)
+#define ESP_MODEM_SCRIPT_NAME_LENGTH (16)
+#define ESP_MODEM_SCRIPT_VALUE_LENGTH (64)
+#define ESP_MODEM_SCRIPT_TIMEOUT_DEFAULT (3000)    /*!< Step timeout when none is given, as for typed commands */
+#define ESP_MODEM_SCRIPT_MAX_STATEMENTS (2000)     /*!< Statements run before a loop is taken for a runaway */
+
+typedef struct {
+    char name[ESP_MODEM_SCRIPT_NAME_LENGTH];
+    char value[ESP_MODEM_SCRIPT_VALUE_LENGTH];
+} esp_modem_script_var_t;
+
+/**
+ * @brief A script being run
+ *
+ */
+typedef struct {
+    modem_dce_t *dce;
+    char **lines;                                   /*!< Trimmed lines, in the file buffer */
+    int count;                                      /*!< Number of lines */
+    bool echo;                                      /*!< Print what the modem answers */
+    bool held;                                      /*!< The command channel is ours */
+    esp_modem_script_var_t vars[ESP_MODEM_SCRIPT_VARS];
+    esp_modem_script_report_t *report;
+} esp_modem_script_t;
+
+/**
+ * @brief The send step in progress, reachable from dce->priv_resource
+ *
+ */
+typedef struct {
+    const char *expect;                             /*!< Text to wait for, NULL for OK */
+    int field;                                      /*!< Value after expect to capture */
+    bool matched;                                   /*!< expect was seen */
+    bool echo;                                      /*!< Print the lines */
+    char captured[ESP_MODEM_SCRIPT_VALUE_LENGTH];   /*!< Captured value */
+} esp_modem_script_step_t;
+
+static const char *const esp_modem_script_keywords[] = {
+    "set", "send", "if", "goto", "wait", "echo", "fail", "end", NULL
+};
+
+static const char *const esp_modem_script_send_options[] = {
+    "expect", "timeout", "retry", "capture", "field", "onfail", NULL
+};
+
+static const char *const esp_modem_script_finals[] = {
+    MODEM_RESULT_CODE_SUCCESS, MODEM_RESULT_CODE_ERROR, "+CME ERROR", "+CMS ERROR", MODEM_RESULT_CODE_CONNECT,
+    MODEM_RESULT_CODE_NO_CARRIER, MODEM_RESULT_CODE_NO_DIALTONE, MODEM_RESULT_CODE_BUSY, MODEM_RESULT_CODE_NO_ANSWER, NULL
+};
+
+static esp_err_t esp_modem_script_error(esp_modem_script_t *script, int line, esp_err_t err, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vsnprintf(script->report->error, sizeof(script->report->error), format, args);
+    va_end(args);
+    script->report->error_line = line;
+    ESP_LOGW(SCRIPT_TAG, "line %d: %s", line, script->report->error);
+    return err;
+}
+
+static bool esp_modem_script_is_one_of(const char *word, size_t len, const char *const *list)
+{
+    for (; *list; list++) {
+        if (strlen(*list) == len && !strncmp(word, *list, len)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Split off the next word, a quoted word keeps its spaces and loses its quotes
+ */
+static char *esp_modem_script_next_word(char **p)
+{
+    char *s = *p;
+    char *word;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (*s == '"') {
+        word = ++s;
+        while (*s && *s != '"') {
+            s++;
+        }
+    } else {
+        word = s;
+        while (*s && *s != ' ' && *s != '\t') {
+            s++;
+        }
+    }
+    if (*s) {
+        *s++ = '\0';
+    }
+    *p = s;
+    return word;
+}
+
+static const char *esp_modem_script_get(esp_modem_script_t *script, const char *name, size_t len)
+{
+    for (int i = 0; i < ESP_MODEM_SCRIPT_VARS; i++) {
+        if (script->vars[i].name[0] && strlen(script->vars[i].name) == len && !strncmp(script->vars[i].name, name, len)) {
+            return script->vars[i].value;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t esp_modem_script_set(esp_modem_script_t *script, const char *name, const char *value)
+{
+    esp_modem_script_var_t *free_var = NULL;
+    if (!*name || strlen(name) >= ESP_MODEM_SCRIPT_NAME_LENGTH || strlen(value) >= ESP_MODEM_SCRIPT_VALUE_LENGTH) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (int i = 0; i < ESP_MODEM_SCRIPT_VARS; i++) {
+        if (!strcmp(script->vars[i].name, name)) {
+            strcpy(script->vars[i].value, value);
+            return ESP_OK;
+        }
+        if (!free_var && !script->vars[i].name[0]) {
+            free_var = &script->vars[i];
+        }
+    }
+    if (!free_var) {
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(free_var->name, name);
+    strcpy(free_var->value, value);
+    return ESP_OK;
+}
+
+/**
+ * @brief Replace $name and ${name} by the value of the variable
+ */
+static esp_err_t esp_modem_script_expand(esp_modem_script_t *script, const char *in, char *out, size_t size)
+{
+    size_t n = 0;
+    while (*in) {
+        const char *value = NULL;
+        size_t len = 0;
+        if (*in == '$') {
+            const char *name = in + 1;
+            if (*name == '{') {
+                const char *end = strchr(++name, '}');
+                if (!end) {
+                    return ESP_ERR_INVALID_ARG;
+                }
+                len = end - name;
+                in = end + 1;
+            } else {
+                while (isalnum((unsigned char)name[len]) || name[len] == '_') {
+                    len++;
+                }
+                in = name + len;
+            }
+            if (!len) {
+                /* A lone '$' is just a character */
+                value = "$";
+                len = 1;
+            } else if (!(value = esp_modem_script_get(script, name, len))) {
+                return ESP_ERR_NOT_FOUND;
+            } else {
+                len = strlen(value);
+            }
+        } else {
+            value = in++;
+            len = 1;
+        }
+        if (n + len >= size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(out + n, value, len);
+        n += len;
+    }
+    out[n] = '\0';
+    return ESP_OK;
+}
+
+static esp_err_t esp_modem_script_jump(esp_modem_script_t *script, int line, const char *label, int *pc)
+{
+    for (int i = 0; i < script->count; i++) {
+        if (script->lines[i][0] == ':' && !strcmp(script->lines[i] + 1, label)) {
+            *pc = i + 1;
+            return ESP_OK;
+        }
+    }
+    return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "no label %s", label);
+}
+
+static bool esp_modem_script_is_final(const char *line)
+{
+    for (const char *const *final = esp_modem_script_finals; *final; final++) {
+        size_t len = strlen(*final);
+        if (!strncmp(line, *final, len) && strchr(":\r\n ", line[len])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Copy the field-th value after the expected text, without quotes
+ */
+static void esp_modem_script_capture(esp_modem_script_step_t *step, const char *p)
+{
+    size_t n = 0;
+    for (int i = 0; i < step->field; i++) {
+        p = strchr(p, ',');
+        if (!p) {
+            return;
+        }
+        p++;
+    }
+    while (*p == ' ') {
+        p++;
+    }
+    char stop = ',';
+    if (*p == '"') {
+        stop = '"';
+        p++;
+    }
+    while (*p && *p != stop && *p != '\r' && *p != '\n' && n < sizeof(step->captured) - 1) {
+        step->captured[n++] = *p++;
+    }
+    step->captured[n] = '\0';
+}
+
+static esp_err_t esp_modem_script_handle_line(modem_dce_t *dce, const char *line)
+{
+    esp_modem_script_step_t *step = dce->priv_resource;
+    const char *match;
+    if (step->echo) {
+        printf("  %s", line);
+    }
+    if (step->expect && !step->matched && (match = strstr(line, step->expect))) {
+        step->matched = true;
+        esp_modem_script_capture(step, match + strlen(step->expect));
+    }
+    if (!esp_modem_script_is_final(line)) {
+        return ESP_OK;
+    }
+    bool passed = step->expect ? step->matched : !strncmp(line, MODEM_RESULT_CODE_SUCCESS, strlen(MODEM_RESULT_CODE_SUCCESS));
+    return esp_modem_process_command_done(dce, passed ? MODEM_STATE_SUCCESS : MODEM_STATE_FAIL);
+}
+
+/**
+ * @brief Timing entry of a line, created on its first run while there is room
+ */
+static esp_modem_script_step_report_t *esp_modem_script_step_report(esp_modem_script_t *script, int line, const char *command)
+{
+    esp_modem_script_report_t *report = script->report;
+    for (int i = 0; i < report->count; i++) {
+        if (report->steps[i].line == line) {
+            return &report->steps[i];
+        }
+    }
+    if (report->count >= ESP_MODEM_SCRIPT_MAX_REPORT) {
+        return NULL;
+    }
+    esp_modem_script_step_report_t *step = &report->steps[report->count++];
+    step->line = line;
+    snprintf(step->command, sizeof(step->command), "%s", command);
+    return step;
+}
+
+static esp_err_t esp_modem_script_send(esp_modem_script_t *script, int line, char *args, int *pc)
+{
+    esp_modem_script_step_t step = {0};
+    const char *capture = NULL;
+    const char *onfail = NULL;
+    uint32_t timeout = ESP_MODEM_SCRIPT_TIMEOUT_DEFAULT;
+    int retry = 0;
+    char command[ESP_MODEM_SCRIPT_LINE_LENGTH + 2];
+    char *p = args;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    /* The command runs up to the first option, so it can hold spaces and quotes */
+    char *command_start = p;
+    char *options = NULL;
+    for (char *s = p; *s; s++) {
+        char *eq;
+        if (*s == ' ' && (eq = strchr(s + 1, '=')) && esp_modem_script_is_one_of(s + 1, eq - s - 1, esp_modem_script_send_options)) {
+            *s = '\0';
+            options = s + 1;
+            break;
+        }
+    }
+    if (!*command_start) {
+        return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "send without a command");
+    }
+    for (p = options; p && *p;) {
+        char *key = p;
+        char *eq = strchr(key, '=');
+        if (!eq) {
+            return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "bad option %s", key);
+        }
+        *eq = '\0';
+        p = eq + 1;
+        char *value = esp_modem_script_next_word(&p);
+        if (!strcmp(key, "expect")) {
+            step.expect = value;
+        } else if (!strcmp(key, "timeout")) {
+            timeout = atoi(value);
+        } else if (!strcmp(key, "retry")) {
+            retry = atoi(value);
+        } else if (!strcmp(key, "capture")) {
+            capture = value;
+        } else if (!strcmp(key, "field")) {
+            step.field = atoi(value);
+        } else if (!strcmp(key, "onfail")) {
+            onfail = value;
+        } else {
+            return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "unknown option %s", key);
+        }
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+    }
+    snprintf(command, sizeof(command), "%s\r", command_start);
+    step.echo = script->echo;
+
+    esp_modem_script_step_report_t *report = esp_modem_script_step_report(script, line, command_start);
+    esp_err_t err = ESP_FAIL;
+    int64_t start = esp_timer_get_time();
+    for (int attempt = 0; attempt <= retry && err != ESP_OK; attempt++) {
+        step.matched = false;
+        step.captured[0] = '\0';
+        err = esp_modem_dce_command(script->dce, command, timeout, esp_modem_script_handle_line, &step);
+        if (report) {
+            report->attempts++;
+        }
+    }
+    uint32_t elapsed = (esp_timer_get_time() - start) / 1000;
+    if (report) {
+        report->runs++;
+        report->total_ms += elapsed;
+        if (elapsed > report->max_ms) {
+            report->max_ms = elapsed;
+        }
+        if (err != ESP_OK) {
+            report->failures++;
+        }
+    }
+    if (err == ESP_OK) {
+        if (capture && esp_modem_script_set(script, capture, step.captured) != ESP_OK) {
+            return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "cannot store %s", capture);
+        }
+        return ESP_OK;
+    }
+    if (onfail) {
+        return esp_modem_script_jump(script, line, onfail, pc);
+    }
+    return esp_modem_script_error(script, line, ESP_FAIL, "%s %s", command_start,
+                                  err == ESP_ERR_TIMEOUT ? "timed out" : "failed");
+}
+
+static esp_err_t esp_modem_script_compare(const char *a, const char *op, const char *b, bool *result)
+{
+    char *end;
+    long x = strtol(a, &end, 10);
+    bool numeric = *a && !*end;
+    long y = strtol(b, &end, 10);
+    numeric = numeric && *b && !*end;
+
+    if (!strcmp(op, "contains")) {
+        *result = strstr(a, b) != NULL;
+    } else if (!strcmp(op, "==")) {
+        *result = numeric ? x == y : !strcmp(a, b);
+    } else if (!strcmp(op, "!=")) {
+        *result = numeric ? x != y : strcmp(a, b) != 0;
+    } else if (!numeric) {
+        return ESP_ERR_INVALID_ARG;
+    } else if (!strcmp(op, "<")) {
+        *result = x < y;
+    } else if (!strcmp(op, "<=")) {
+        *result = x <= y;
+    } else if (!strcmp(op, ">")) {
+        *result = x > y;
+    } else if (!strcmp(op, ">=")) {
+        *result = x >= y;
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Run one statement, moving pc on jumps
+ */
+static esp_err_t esp_modem_script_statement(esp_modem_script_t *script, int line, char *text, int *pc)
+{
+    char *p = text;
+    char *keyword = esp_modem_script_next_word(&p);
+
+    if (!strcmp(keyword, "send")) {
+        return esp_modem_script_send(script, line, p, pc);
+    } else if (!strcmp(keyword, "set")) {
+        char *name = esp_modem_script_next_word(&p);
+        char *value = esp_modem_script_next_word(&p);
+        if (esp_modem_script_set(script, name, value) != ESP_OK) {
+            return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "cannot store %s", name);
+        }
+    } else if (!strcmp(keyword, "if")) {
+        char *a = esp_modem_script_next_word(&p);
+        char *op = esp_modem_script_next_word(&p);
+        char *b = esp_modem_script_next_word(&p);
+        char *go = esp_modem_script_next_word(&p);
+        char *label = esp_modem_script_next_word(&p);
+        bool result = false;
+        if (strcmp(go, "goto") || !*label || esp_modem_script_compare(a, op, b, &result) != ESP_OK) {
+            return esp_modem_script_error(script, line, ESP_ERR_INVALID_ARG, "bad condition");
+        }
+        if (result) {
+            return esp_modem_script_jump(script, line, label, pc);
+        }
+    } else if (!strcmp(keyword, "goto")) {
+        return esp_modem_script_jump(script, line, esp_modem_script_next_word(&p), pc);
+    } else if (!strcmp(keyword, "wait")) {
+        /* Let queued commands through while the script sleeps */
+        esp_modem_arbiter_release(script->dce->arbiter);
+        script->held = false;
+        vTaskDelay(pdMS_TO_TICKS(atoi(esp_modem_script_next_word(&p))));
+        if (esp_modem_arbiter_acquire(script->dce->arbiter, ESP_MODEM_PRIORITY_INTERACTIVE,
+                                      CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+            return esp_modem_script_error(script, line, ESP_FAIL, "command channel busy");
+        }
+        script->held = true;
+    } else if (!strcmp(keyword, "echo")) {
+        printf("%s\r\n", p);
+    } else if (!strcmp(keyword, "fail")) {
+        return esp_modem_script_error(script, line, ESP_FAIL, "%s", p);
+    } else if (!strcmp(keyword, "end")) {
+        *pc = script->count;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Split the file into trimmed lines and check every statement starts with a keyword
+ */
+static esp_err_t esp_modem_script_load(esp_modem_script_t *script, char *text)
+{
+    int count = 1;
+    for (char *s = text; *s; s++) {
+        count += (*s == '\n');
+    }
+    script->lines = calloc(count, sizeof(char *));
+    if (!script->lines) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (char *s = text; s; script->count++) {
+        char *next = strchr(s, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        size_t len = strlen(s);
+        while (len && isspace((unsigned char)s[len - 1])) {
+            s[--len] = '\0';
+        }
+        while (isspace((unsigned char)*s)) {
+            s++;
+        }
+        script->lines[script->count] = s;
+        if (*s && *s != '#' && *s != ':') {
+            size_t word = strcspn(s, " \t");
+            if (!esp_modem_script_is_one_of(s, word, esp_modem_script_keywords)) {
+                return esp_modem_script_error(script, script->count + 1, ESP_ERR_INVALID_ARG, "unknown statement %.*s",
+                                              (int)word, s);
+            }
+        }
+        s = next;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_modem_script_run(modem_dce_t *dce, const char *path, bool echo, esp_modem_script_report_t *report)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    esp_modem_script_t *script = NULL;
+    char *text = NULL;
+    int64_t start = esp_timer_get_time();
+
+    memset(report, 0, sizeof(*report));
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        snprintf(report->error, sizeof(report->error), "cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0 || size > CONFIG_EXAMPLE_MODEM_SCRIPT_MAX_SIZE) {
+        snprintf(report->error, sizeof(report->error), "larger than %d bytes", CONFIG_EXAMPLE_MODEM_SCRIPT_MAX_SIZE);
+        ret = ESP_ERR_INVALID_SIZE;
+        goto err_file;
+    }
+    ret = ESP_ERR_NO_MEM;
+    text = malloc(size + 1);
+    script = calloc(1, sizeof(esp_modem_script_t));
+    if (!text || !script) {
+        snprintf(report->error, sizeof(report->error), "out of memory");
+        goto err_mem;
+    }
+    text[fread(text, 1, size, file)] = '\0';
+    script->dce = dce;
+    script->echo = echo;
+    script->report = report;
+    ret = esp_modem_script_load(script, text);
+    if (ret != ESP_OK) {
+        goto err_mem;
+    }
+
+    ret = esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_INTERACTIVE, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT);
+    if (ret != ESP_OK) {
+        snprintf(report->error, sizeof(report->error), "command channel busy");
+        ret = ESP_FAIL;
+        goto err_mem;
+    }
+    script->held = true;
+    char line[ESP_MODEM_SCRIPT_LINE_LENGTH];
+    uint32_t executed = 0;
+    for (int pc = 0; pc < script->count && ret == ESP_OK;) {
+        int number = ++pc;
+        const char *raw = script->lines[number - 1];
+        if (!*raw || *raw == '#' || *raw == ':') {
+            continue;
+        }
+        if (++executed > ESP_MODEM_SCRIPT_MAX_STATEMENTS) {
+            ret = esp_modem_script_error(script, number, ESP_FAIL, "more than %d statements run", ESP_MODEM_SCRIPT_MAX_STATEMENTS);
+            break;
+        }
+        esp_err_t err = esp_modem_script_expand(script, raw, line, sizeof(line));
+        if (err != ESP_OK) {
+            ret = esp_modem_script_error(script, number, ESP_ERR_INVALID_ARG,
+                                         err == ESP_ERR_NOT_FOUND ? "undefined variable" : "line too long");
+            break;
+        }
+        ret = esp_modem_script_statement(script, number, line, &pc);
+    }
+    if (script->held) {
+        esp_modem_arbiter_release(dce->arbiter);
+    }
+err_mem:
+    free(script ? script->lines : NULL);
+    free(script);
+    free(text);
+err_file:
+    fclose(file);
+    report->elapsed_ms = (esp_timer_get_time() - start) / 1000;
+    return ret;
+}
@@ -0,0 +1,98 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem.h"
+#include "esp_modem_arbiter.h"
+#include "esp_modem_dce_service.h"
+#include "esp_modem_health.h"
+#include "esp_modem_shutdown.h"
+
+static const char *SHUTDOWN_TAG = "esp-modem-shutdown";
+
+/* How often the command in flight is failed again while someone else holds the channel */
+#define ESP_MODEM_SHUTDOWN_ABORT_INTERVAL_MS (100)
+
+/**
+ * @brief Milliseconds since the mark, then move the mark to now
+ */
+static uint32_t esp_modem_shutdown_lap(int64_t *mark_us)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t ms = (now - *mark_us) / 1000;
+    *mark_us = now;
+    return ms;
+}
+
+esp_err_t esp_modem_shutdown(modem_dce_t *dce, esp_modem_shutdown_report_t *report)
+{
+    esp_modem_shutdown_report_t result;
+    modem_dte_t *dte = dce->dte;
+    int64_t start = esp_timer_get_time(), mark = start;
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+
+    memset(&result, 0, sizeof(result));
+    /* No recovery may bring the modem back meanwhile, the monitor exits on its own while the rest goes on */
+    esp_modem_health_stop(dce);
+    /* Sockets close and their last data goes out while the link is still up */
+    if (dce->mode == MODEM_PPP_MODE && esp_modem_flush_ppp(dte, CONFIG_EXAMPLE_MODEM_SHUTDOWN_FLUSH) != ESP_OK) {
+        ESP_LOGW(SHUTDOWN_TAG, "uplink still busy after %d ms", CONFIG_EXAMPLE_MODEM_SHUTDOWN_FLUSH);
+    }
+    result.flush_ms = esp_modem_shutdown_lap(&mark);
+    /* Whoever holds the channel, a background query or a recovery step, gets its commands failed until it lets go */
+    esp_modem_dce_abort(dce);
+    while (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, ESP_MODEM_SHUTDOWN_ABORT_INTERVAL_MS) != ESP_OK) {
+        esp_modem_dce_abort(dce);
+    }
+    result.quiesce_ms = esp_modem_shutdown_lap(&mark);
+
+    if (dce->mode == MODEM_PPP_MODE) {
+        result.ppp = true;
+        if (esp_modem_exit_ppp(dte) != ESP_OK) {
+            ESP_LOGW(SHUTDOWN_TAG, "PPP not closed cleanly");
+            if (dce->mode == MODEM_PPP_MODE) {
+                esp_modem_drop_ppp(dte);
+            }
+        }
+    }
+    result.ppp_ms = esp_modem_shutdown_lap(&mark);
+
+    if (dce->power_down(dce) == ESP_OK) {
+        result.confirmed = true;
+        ret = ESP_OK;
+    } else {
+        ESP_LOGW(SHUTDOWN_TAG, "power down not confirmed");
+    }
+    /* Commands queued behind this one fail at once instead of waiting for an answer */
+    dce->mode = MODEM_POWER_OFF_MODE;
+    esp_modem_arbiter_release(dce->arbiter);
+    result.power_down_ms = esp_modem_shutdown_lap(&mark);
+
+    /* Those callers still hold or wait for the arbiter, which goes with the DCE */
+    if (esp_modem_arbiter_wait_idle(dce->arbiter, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        ESP_LOGW(SHUTDOWN_TAG, "command channel still in use");
+    }
+
+    dce->deinit(dce);
+    dte->deinit(dte);
+    result.teardown_ms = esp_modem_shutdown_lap(&mark);
+    result.total_ms = (mark - start) / 1000;
+    ESP_LOGI(SHUTDOWN_TAG, "modem down in %u ms: flush %u, quiesce %u, ppp %u, power down %u, teardown %u",
+             result.total_ms, result.flush_ms, result.quiesce_ms, result.ppp_ms, result.power_down_ms, result.teardown_ms);
+    if (report) {
+        *report = result;
+    }
+    return ret;
+}
@@ -0,0 +1,505 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem.h"
+#include "esp_modem_arbiter.h"
+#include "esp_modem_dce_service.h"
+#include "esp_modem_sleep.h"
+#include "esp_modem_ext.h"
+#include "esp_modem_static.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#endif
+
+static const char *SLEEP_TAG = "esp-modem-sleep";
+#define SLEEP_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(a))                                                                       \
+        {                                                                               \
+            ESP_LOGE(SLEEP_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                              \
+        }                                                                               \
+    } while (0)
+
+#define ESP_MODEM_SLEEP_TASK_STACK_SIZE (3072)
+#define ESP_MODEM_SLEEP_TASK_PRIORITY (2)
+#define ESP_MODEM_SLEEP_WAKE_PROBES (3)      /*!< AT probes after DTR low before a wake-up counts as failed */
+#define ESP_MODEM_SLEEP_MAX_OVER_BUDGET (3)  /*!< Wake-ups over the budget in a row that keep the modem awake */
+#define ESP_MODEM_SLEEP_MAX_REARM_SHIFT (4)  /*!< The time kept awake doubles up to 16 times rearm_ms */
+
+/**
+ * @brief Manager task event bits
+ *
+ */
+#define ESP_MODEM_SLEEP_ACTIVITY_BIT BIT0 /*!< A command ran, the idle time starts again */
+#define ESP_MODEM_SLEEP_RI_BIT BIT1       /*!< RI woke the chip */
+
+/**
+ * @brief Sleep manager of a DCE
+ *
+ */
+struct esp_modem_sleep {
+    esp_modem_sleep_config_t config;
+    modem_dce_t *dce;
+    portMUX_TYPE lock;                           /*!< Protects stats and the time accounting */
+    esp_modem_sleep_stats_t stats;
+    volatile bool asleep;                        /*!< Changed only with the command channel held */
+    uint32_t consecutive_over_budget;            /*!< Wake-ups over the budget since the last one within */
+    uint32_t rearm_shift;                        /*!< Doublings of rearm_ms, cleared by a wake-up within the budget */
+    int64_t disabled_us;                         /*!< esp_timer time the modem was last kept awake */
+    int64_t since_us;                            /*!< esp_timer time the modem last fell asleep or woke */
+    int64_t last_command_us;                     /*!< esp_timer time the last command ended */
+    esp_modem_ext_task_t task;                   /*!< Manager */
+    esp_modem_ext_t ext;                         /*!< Link into the DCE */
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t pm_lock;                /*!< No light sleep while the modem is awake */
+#endif
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StackType_t task_stack[ESP_MODEM_SLEEP_TASK_STACK_SIZE]; /*!< Its stack */
+#endif
+};
+
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+ESP_MODEM_STATIC_POOL(s_sleep_pool, esp_modem_sleep_t);
+#endif
+
+/**
+ * @brief Close the current stretch of sleep or wakefulness and start the other one
+ */
+static void esp_modem_sleep_account(esp_modem_sleep_t *sleep, bool asleep)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&sleep->lock);
+    if (sleep->stats.asleep) {
+        sleep->stats.asleep_us += now - sleep->since_us;
+    } else {
+        sleep->stats.awake_us += now - sleep->since_us;
+    }
+    sleep->since_us = now;
+    sleep->stats.asleep = asleep;
+    if (asleep) {
+        sleep->stats.sleeps++;
+    }
+    portEXIT_CRITICAL(&sleep->lock);
+}
+
+void esp_modem_sleep_command_begin(esp_modem_sleep_t *sleep)
+{
+    if (!sleep || !sleep->asleep) {
+        return;
+    }
+    modem_dce_t *dce = sleep->dce;
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = ESP_FAIL;
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_acquire(sleep->pm_lock);
+#endif
+    gpio_set_level(sleep->config.dtr_io_num, 0);
+    /* Before the probe, which comes back through here */
+    sleep->asleep = false;
+    esp_modem_sleep_account(sleep, false);
+    vTaskDelay(pdMS_TO_TICKS(sleep->config.settle_ms));
+    for (int i = 0; i < ESP_MODEM_SLEEP_WAKE_PROBES && err != ESP_OK; i++) {
+        err = dce->sync(dce);
+    }
+    uint32_t wake_ms = (esp_timer_get_time() - start) / 1000;
+    bool over = err != ESP_OK || wake_ms > sleep->config.latency_budget_ms;
+
+    portENTER_CRITICAL(&sleep->lock);
+    sleep->stats.wakes++;
+    sleep->stats.last_wake_ms = wake_ms;
+    if (wake_ms > sleep->stats.max_wake_ms) {
+        sleep->stats.max_wake_ms = wake_ms;
+    }
+    if (over) {
+        sleep->stats.over_budget++;
+        sleep->consecutive_over_budget++;
+        if (sleep->consecutive_over_budget >= ESP_MODEM_SLEEP_MAX_OVER_BUDGET && !sleep->stats.disabled) {
+            sleep->stats.disabled = true;
+            sleep->disabled_us = esp_timer_get_time();
+        }
+    } else {
+        sleep->consecutive_over_budget = 0;
+        sleep->rearm_shift = 0;
+    }
+    bool disabled = sleep->stats.disabled;
+    portEXIT_CRITICAL(&sleep->lock);
+    if (err != ESP_OK) {
+        ESP_LOGW(SLEEP_TAG, "no answer %u ms after DTR low", wake_ms);
+    } else if (over) {
+        ESP_LOGW(SLEEP_TAG, "wake-up took %u ms, over the %u ms budget", wake_ms, sleep->config.latency_budget_ms);
+    }
+    if (over && disabled) {
+        ESP_LOGW(SLEEP_TAG, "%d wake-ups over the budget in a row, modem kept awake", ESP_MODEM_SLEEP_MAX_OVER_BUDGET);
+    }
+}
+
+/**
+ * @brief Time until a modem kept awake may sleep again, called with the lock held
+ *
+ * @return microseconds, 0 if due, -1 if only a reset lets it sleep again
+ */
+static int64_t esp_modem_sleep_rearm_in_us(esp_modem_sleep_t *sleep, int64_t now)
+{
+    if (!sleep->config.rearm_ms) {
+        return -1;
+    }
+    int64_t backoff_us = (int64_t)sleep->config.rearm_ms * 1000 << sleep->rearm_shift;
+    int64_t left_us = sleep->disabled_us + backoff_us - now;
+    return left_us > 0 ? left_us : 0;
+}
+
+/**
+ * @brief Let a modem kept awake sleep again once its time is up, the next slow wake-ups keep it awake longer
+ */
+static void esp_modem_sleep_rearm(esp_modem_sleep_t *sleep)
+{
+    bool rearmed = false;
+    portENTER_CRITICAL(&sleep->lock);
+    if (sleep->stats.disabled && esp_modem_sleep_rearm_in_us(sleep, esp_timer_get_time()) == 0) {
+        sleep->stats.disabled = false;
+        sleep->stats.rearms++;
+        sleep->consecutive_over_budget = 0;
+        if (sleep->rearm_shift < ESP_MODEM_SLEEP_MAX_REARM_SHIFT) {
+            sleep->rearm_shift++;
+        }
+        rearmed = true;
+    }
+    portEXIT_CRITICAL(&sleep->lock);
+    if (rearmed) {
+        ESP_LOGI(SLEEP_TAG, "trying to sleep again");
+    }
+}
+
+void esp_modem_sleep_command_end(esp_modem_sleep_t *sleep)
+{
+    if (!sleep) {
+        return;
+    }
+    sleep->last_command_us = esp_timer_get_time();
+    xEventGroupSetBits(sleep->task.events, ESP_MODEM_SLEEP_ACTIVITY_BIT);
+}
+
+/**
+ * @brief Count what the modem sends while it should sleep
+ */
+static ESP_MODEM_RX_ATTR void esp_modem_sleep_handle_urc(modem_dce_t *dce, const char *line)
+{
+    esp_modem_sleep_t *sleep = dce->sleep;
+    if (sleep->asleep) {
+        portENTER_CRITICAL(&sleep->lock);
+        sleep->stats.urcs_asleep++;
+        portEXIT_CRITICAL(&sleep->lock);
+    }
+}
+
+/**
+ * @brief Put the modem to sleep if the channel is still idle once it is ours
+ */
+static void esp_modem_sleep_try(esp_modem_sleep_t *sleep)
+{
+    modem_dce_t *dce = sleep->dce;
+    if (dce->mode != MODEM_COMMAND_MODE) {
+        return;
+    }
+    /* Anyone else goes first, and whatever they send restarts the idle time */
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        return;
+    }
+    if (dce->mode == MODEM_COMMAND_MODE && !sleep->asleep && !sleep->stats.disabled &&
+            esp_timer_get_time() - sleep->last_command_us >= sleep->config.idle_ms * 1000LL) {
+        /* Sent every time, a reset in between forgets it */
+        if (esp_modem_dce_sleep_on_dtr(dce) == ESP_OK) {
+            gpio_set_level(sleep->config.dtr_io_num, 1);
+            sleep->asleep = true;
+            esp_modem_sleep_account(sleep, true);
+#if CONFIG_PM_ENABLE
+            esp_pm_lock_release(sleep->pm_lock);
+#endif
+            ESP_LOGD(SLEEP_TAG, "modem asleep");
+        } else {
+            portENTER_CRITICAL(&sleep->lock);
+            sleep->stats.refused++;
+            portEXIT_CRITICAL(&sleep->lock);
+        }
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+}
+
+#if CONFIG_PM_ENABLE
+/**
+ * @brief RI went low, the modem has something to say
+ */
+static void IRAM_ATTR esp_modem_sleep_ri_isr(void *arg)
+{
+    esp_modem_sleep_t *sleep = (esp_modem_sleep_t *)arg;
+    BaseType_t woken = pdFALSE;
+    /* RI stays low for the whole RING, the task enables the interrupt again */
+    gpio_intr_disable(sleep->config.ri_io_num);
+    xEventGroupSetBitsFromISR(sleep->task.events, ESP_MODEM_SLEEP_RI_BIT, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/**
+ * @brief Keep the chip awake long enough to read the URC behind RI
+ */
+static void esp_modem_sleep_ri_wake(esp_modem_sleep_t *sleep)
+{
+    esp_pm_lock_acquire(sleep->pm_lock);
+    xEventGroupWaitBits(sleep->task.events, ESP_MODEM_EXT_TASK_STOP_BIT, pdFALSE, pdFALSE,
+                        pdMS_TO_TICKS(sleep->config.idle_ms));
+    esp_pm_lock_release(sleep->pm_lock);
+    gpio_intr_enable(sleep->config.ri_io_num);
+}
+#endif
+
+/**
+ * @brief Wait for the channel to go idle and put the modem to sleep
+ *
+ * @param param sleep manager
+ */
+static void esp_modem_sleep_task_entry(void *param)
+{
+    esp_modem_sleep_t *sleep = (esp_modem_sleep_t *)param;
+    const EventBits_t wait_bits = ESP_MODEM_SLEEP_ACTIVITY_BIT | ESP_MODEM_SLEEP_RI_BIT | ESP_MODEM_EXT_TASK_STOP_BIT;
+
+    while (1) {
+        /* Nothing to time while the modem sleeps, the next command wakes us */
+        TickType_t ticks = sleep->asleep ? portMAX_DELAY : pdMS_TO_TICKS(sleep->config.idle_ms);
+        if (!sleep->asleep && sleep->stats.disabled) {
+            portENTER_CRITICAL(&sleep->lock);
+            int64_t rearm_us = esp_modem_sleep_rearm_in_us(sleep, esp_timer_get_time());
+            portEXIT_CRITICAL(&sleep->lock);
+            /* Then the idle time runs as usual */
+            ticks = rearm_us < 0 ? portMAX_DELAY : pdMS_TO_TICKS(rearm_us / 1000) + 1;
+        }
+        EventBits_t bits = xEventGroupWaitBits(sleep->task.events, wait_bits, pdTRUE, pdFALSE, ticks);
+        if (bits & ESP_MODEM_EXT_TASK_STOP_BIT) {
+            break;
+        }
+#if CONFIG_PM_ENABLE
+        if (bits & ESP_MODEM_SLEEP_RI_BIT) {
+            esp_modem_sleep_ri_wake(sleep);
+        }
+#endif
+        if (!bits && sleep->stats.disabled) {
+            esp_modem_sleep_rearm(sleep);
+        } else if (!bits) {
+            esp_modem_sleep_try(sleep);
+        }
+    }
+    esp_modem_ext_task_exit(&sleep->task);
+}
+
+/**
+ * @brief Set up the pins, and the power management lock held while the modem is awake
+ */
+static esp_err_t esp_modem_sleep_setup_io(esp_modem_sleep_t *sleep)
+{
+    gpio_config_t io_conf = {0};
+    io_conf.mode = GPIO_MODE_OUTPUT;
+    io_conf.pin_bit_mask = 1ULL << sleep->config.dtr_io_num;
+    SLEEP_CHECK(gpio_config(&io_conf) == ESP_OK, "config DTR pin failed", err);
+    gpio_set_level(sleep->config.dtr_io_num, 0);
+#if CONFIG_PM_ENABLE
+    SLEEP_CHECK(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "modem", &sleep->pm_lock) == ESP_OK,
+                "create power management lock failed", err);
+    esp_pm_lock_acquire(sleep->pm_lock);
+    if (sleep->config.ri_io_num >= 0) {
+        io_conf.mode = GPIO_MODE_INPUT;
+        io_conf.pin_bit_mask = 1ULL << sleep->config.ri_io_num;
+        io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+        io_conf.intr_type = GPIO_INTR_NEGEDGE;
+        SLEEP_CHECK(gpio_config(&io_conf) == ESP_OK, "config RI pin failed", err_ri);
+        /* Someone else may have installed the service already */
+        gpio_install_isr_service(0);
+        SLEEP_CHECK(gpio_isr_handler_add(sleep->config.ri_io_num, esp_modem_sleep_ri_isr, sleep) == ESP_OK,
+                    "add RI handler failed", err_ri);
+        gpio_wakeup_enable(sleep->config.ri_io_num, GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+    }
+#endif
+    return ESP_OK;
+#if CONFIG_PM_ENABLE
+err_ri:
+    esp_pm_lock_release(sleep->pm_lock);
+    esp_pm_lock_delete(sleep->pm_lock);
+#endif
+err:
+    return ESP_FAIL;
+}
+
+static void esp_modem_sleep_release_io(esp_modem_sleep_t *sleep)
+{
+#if CONFIG_PM_ENABLE
+    if (sleep->config.ri_io_num >= 0) {
+        gpio_wakeup_disable(sleep->config.ri_io_num);
+        gpio_isr_handler_remove(sleep->config.ri_io_num);
+    }
+    if (sleep->asleep) {
+        esp_pm_lock_acquire(sleep->pm_lock);
+    }
+    esp_pm_lock_release(sleep->pm_lock);
+    esp_pm_lock_delete(sleep->pm_lock);
+#endif
+    /* Awake, as a modem started again expects */
+    gpio_set_level(sleep->config.dtr_io_num, 0);
+}
+
+static void esp_modem_sleep_detach(modem_dce_t *dce)
+{
+    esp_modem_sleep_t *sleep = dce->sleep;
+    esp_modem_ext_task_join(&sleep->task);
+    esp_modem_sleep_release_io(sleep);
+    dce->sleep = NULL;
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_sleep_pool, sleep);
+#else
+    free(sleep);
+#endif
+}
+
+esp_err_t esp_modem_sleep_enable(modem_dce_t *dce, const esp_modem_sleep_config_t *config)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    SLEEP_CHECK(dce && config && config->dtr_io_num >= 0 && config->idle_ms, "invalid argument", err_arg);
+    SLEEP_CHECK(config->settle_ms < config->latency_budget_ms, "%u ms budget leaves no time after the %u ms settle",
+                err_arg, config->latency_budget_ms, config->settle_ms);
+    SLEEP_CHECK(!dce->sleep, "sleep manager already enabled", err_state);
+    SLEEP_CHECK(dce->sync && dce->deinit, "DCE lacks the methods waking needs", err_arg);
+    SLEEP_CHECK(dce->model && dce->model->commands[ESP_MODEM_DCE_CMD_SLEEP_ON_DTR].command,
+                "model cannot sleep on DTR", err_support);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_sleep_t *sleep = esp_modem_static_calloc(&s_sleep_pool);
+    SLEEP_CHECK(sleep, "no static slot for sleep manager", err);
+    StackType_t *stack = sleep->task_stack;
+#else
+    esp_modem_sleep_t *sleep = calloc(1, sizeof(esp_modem_sleep_t));
+    SLEEP_CHECK(sleep, "calloc sleep manager failed", err);
+    StackType_t *stack = NULL;
+#endif
+    SLEEP_CHECK(esp_modem_ext_task_init(&sleep->task) == ESP_OK, "sleep task not set up", err_events);
+    sleep->config = *config;
+    sleep->dce = dce;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    sleep->lock = lock;
+    sleep->since_us = sleep->last_command_us = esp_timer_get_time();
+    ret = ESP_FAIL;
+    SLEEP_CHECK(esp_modem_sleep_setup_io(sleep) == ESP_OK, "sleep pins not set up", err_io);
+    sleep->ext.handle_urc = esp_modem_sleep_handle_urc;
+    sleep->ext.detach = esp_modem_sleep_detach;
+    dce->sleep = sleep;
+    esp_modem_ext_attach(dce, &sleep->ext);
+    ret = ESP_ERR_NO_MEM;
+    SLEEP_CHECK(esp_modem_ext_task_start(&sleep->task, esp_modem_sleep_task_entry, "modem_sleep",
+                                         ESP_MODEM_SLEEP_TASK_STACK_SIZE, ESP_MODEM_SLEEP_TASK_PRIORITY, sleep,
+                                         stack) == ESP_OK, "sleep task not started", err_task);
+    return ESP_OK;
+err_task:
+    esp_modem_ext_detach(dce, &sleep->ext);
+    dce->sleep = NULL;
+    esp_modem_sleep_release_io(sleep);
+err_io:
+    esp_modem_ext_task_join(&sleep->task);
+err_events:
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_sleep_pool, sleep);
+#else
+    free(sleep);
+#endif
+err:
+    return ret;
+err_state:
+    return ESP_ERR_INVALID_STATE;
+err_support:
+    return ESP_ERR_NOT_SUPPORTED;
+err_arg:
+    return ESP_ERR_INVALID_ARG;
+}
+
+bool esp_modem_sleep_is_asleep(modem_dce_t *dce)
+{
+    return dce->sleep && dce->sleep->asleep;
+}
+
+esp_err_t esp_modem_sleep_get_stats(modem_dce_t *dce, esp_modem_sleep_stats_t *stats)
+{
+    esp_modem_sleep_t *sleep = dce->sleep;
+    if (!sleep) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&sleep->lock);
+    *stats = sleep->stats;
+    if (stats->asleep) {
+        stats->asleep_us += now - sleep->since_us;
+    } else {
+        stats->awake_us += now - sleep->since_us;
+    }
+    if (stats->disabled) {
+        int64_t rearm_us = esp_modem_sleep_rearm_in_us(sleep, now);
+        /* Due but not yet picked up by the task counts as 1 ms */
+        stats->rearm_in_ms = rearm_us < 0 ? 0 : rearm_us / 1000 + 1;
+    }
+    portEXIT_CRITICAL(&sleep->lock);
+    return ESP_OK;
+}
+
+void esp_modem_sleep_reset_stats(modem_dce_t *dce)
+{
+    esp_modem_sleep_t *sleep = dce->sleep;
+    if (!sleep) {
+        return;
+    }
+    portENTER_CRITICAL(&sleep->lock);
+    bool asleep = sleep->stats.asleep;
+    memset(&sleep->stats, 0, sizeof(sleep->stats));
+    sleep->stats.asleep = asleep;
+    sleep->since_us = esp_timer_get_time();
+    sleep->consecutive_over_budget = 0;
+    sleep->rearm_shift = 0;
+    portEXIT_CRITICAL(&sleep->lock);
+    /* A modem kept awake goes back to sleep after the idle time */
+    xEventGroupSetBits(sleep->task.events, ESP_MODEM_SLEEP_ACTIVITY_BIT);
+}
+
+uint64_t esp_modem_sleep_energy_uj(const esp_modem_sleep_stats_t *stats, const esp_modem_sleep_power_t *power,
+                                   bool chip_sleep)
+{
+    /* Microampere times microsecond times millivolt is 1e-15 joule */
+    double modem = (double)stats->asleep_us * power->modem_sleep_ua + (double)stats->awake_us * power->modem_idle_ua;
+    double chip = (double)stats->asleep_us * (chip_sleep ? power->chip_sleep_ua : power->chip_awake_ua) +
+                  (double)stats->awake_us * power->chip_awake_ua;
+    return (uint64_t)((modem * power->modem_mv + chip * power->chip_mv) / 1e9);
+}
+
+uint64_t esp_modem_sleep_awake_energy_uj(const esp_modem_sleep_stats_t *stats, const esp_modem_sleep_power_t *power)
+{
+    esp_modem_sleep_stats_t awake = *stats;
+    awake.awake_us += awake.asleep_us;
+    awake.asleep_us = 0;
+    return esp_modem_sleep_energy_uj(&awake, power, false);
+}
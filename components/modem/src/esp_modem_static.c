@@ -0,0 +1,49 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <string.h>
+#include "esp_log.h"
+#include "esp_modem_static.h"
+
+static const char *STATIC_TAG = "esp-modem-static";
+
+void *esp_modem_static_calloc(esp_modem_static_pool_t *pool)
+{
+    void *object = NULL;
+    portENTER_CRITICAL(&pool->lock);
+    for (size_t i = 0; i < pool->count; i++) {
+        if (!(pool->used & (1U << i))) {
+            pool->used |= 1U << i;
+            object = (uint8_t *)pool->slots + i * pool->size;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&pool->lock);
+    if (!object) {
+        ESP_LOGE(STATIC_TAG, "all %d static slots of %d bytes in use", pool->count, pool->size);
+        return NULL;
+    }
+    memset(object, 0, pool->size);
+    return object;
+}
+
+void esp_modem_static_free(esp_modem_static_pool_t *pool, void *object)
+{
+    if (!object) {
+        return;
+    }
+    size_t i = ((uint8_t *)object - (uint8_t *)pool->slots) / pool->size;
+    portENTER_CRITICAL(&pool->lock);
+    pool->used &= ~(1U << i);
+    portEXIT_CRITICAL(&pool->lock);
+}
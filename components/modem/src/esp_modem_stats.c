@@ -0,0 +1,363 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_modem_stats.h"
+#include "esp_modem_static.h"
+#include "esp_modem_pool.h"
+
+struct esp_modem_stats {
+    SemaphoreHandle_t lock;         /*!< Protects everything below */
+    int64_t start_us;               /*!< esp_timer time the running command was sent, 0 if none */
+    int64_t first_us;               /*!< esp_timer time of its first line, 0 if none yet */
+    size_t verbs;                   /*!< Entries with their own verb */
+    size_t used;                    /*!< Of those, in use */
+    uint32_t sequence;              /*!< Commands recorded, stamps last_command */
+    esp_modem_stats_verb_t *other;  /*!< Entry for verbs that did not fit */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StaticSemaphore_t lock_buffer;  /*!< Memory of lock */
+#endif
+    esp_modem_stats_verb_t entries[]; /*!< verbs entries, then other */
+};
+
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION && CONFIG_EXAMPLE_MODEM_STATS
+/**
+ * @brief Statistics with room for the configured verbs, in one static slot
+ *
+ */
+typedef struct {
+    esp_modem_stats_t stats;                                                /*!< First, the slot is freed through it */
+    esp_modem_stats_verb_t entries[CONFIG_EXAMPLE_MODEM_STATS_VERBS + 1];   /*!< Room for stats.entries */
+} esp_modem_stats_storage_t;
+
+ESP_MODEM_STATIC_POOL(s_stats_pool, esp_modem_stats_storage_t);
+#endif
+
+esp_modem_stats_t *esp_modem_stats_create(size_t verbs)
+{
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION && CONFIG_EXAMPLE_MODEM_STATS
+    if (verbs > CONFIG_EXAMPLE_MODEM_STATS_VERBS) {
+        return NULL;
+    }
+    esp_modem_stats_t *stats = esp_modem_static_calloc(&s_stats_pool);
+    if (!stats) {
+        return NULL;
+    }
+    stats->lock = xSemaphoreCreateMutexStatic(&stats->lock_buffer);
+#else
+    esp_modem_stats_t *stats = calloc(1, sizeof(esp_modem_stats_t) + (verbs + 1) * sizeof(esp_modem_stats_verb_t));
+    if (!stats) {
+        return NULL;
+    }
+    stats->lock = xSemaphoreCreateMutex();
+    if (!stats->lock) {
+        free(stats);
+        return NULL;
+    }
+#endif
+    stats->verbs = verbs;
+    stats->other = &stats->entries[verbs];
+    strcpy(stats->other->verb, "other");
+    return stats;
+}
+
+void esp_modem_stats_delete(esp_modem_stats_t *stats)
+{
+    if (stats) {
+        vSemaphoreDelete(stats->lock);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION && CONFIG_EXAMPLE_MODEM_STATS
+        esp_modem_static_free(&s_stats_pool, stats);
+#else
+        free(stats);
+#endif
+    }
+}
+
+/**
+ * @brief Bucket of a latency: exact below 4 ms, then 4 buckets per power of two
+ */
+static size_t esp_modem_stats_bucket(uint32_t ms)
+{
+    if (ms < 4) {
+        return ms;
+    }
+    int octave = 31 - __builtin_clz(ms);
+    size_t bucket = 4 * (octave - 1) + ((ms >> (octave - 2)) & 3);
+    return bucket < ESP_MODEM_STATS_BUCKETS ? bucket : ESP_MODEM_STATS_BUCKETS - 1;
+}
+
+uint32_t esp_modem_stats_bucket_limit(size_t bucket)
+{
+    if (bucket < 4) {
+        return bucket + 1;
+    }
+    return (uint32_t)(5 + bucket % 4) << (bucket / 4 - 1);
+}
+
+static void esp_modem_stats_record(esp_modem_stats_histogram_t *histogram, uint32_t ms)
+{
+    size_t bucket = esp_modem_stats_bucket(ms);
+    if (histogram->buckets[bucket] == UINT16_MAX) {
+        for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+            histogram->buckets[i] = (histogram->buckets[i] + 1) / 2;
+        }
+    }
+    histogram->buckets[bucket]++;
+    histogram->samples++;
+    histogram->total_ms += ms;
+    if (ms > histogram->max_ms) {
+        histogram->max_ms = ms;
+    }
+}
+
+uint32_t esp_modem_stats_percentile(const esp_modem_stats_histogram_t *histogram, uint32_t percent)
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+        total += histogram->buckets[i];
+    }
+    if (!total) {
+        return 0;
+    }
+    uint32_t rank = (total * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint32_t ms = esp_modem_stats_bucket_limit(i) - 1;
+            return ms < histogram->max_ms ? ms : histogram->max_ms;
+        }
+    }
+    return histogram->max_ms;
+}
+
+/**
+ * @brief Name of a command: "+COPS" for "AT+COPS?", "&W" for "AT&W", "D" for "ATD*99#", "AT" for "AT"
+ */
+static void esp_modem_stats_verb(const char *command, char *verb)
+{
+    size_t n = 0;
+    if (toupper((unsigned char)command[0]) != 'A' || toupper((unsigned char)command[1]) != 'T') {
+        strcpy(verb, "other");
+        return;
+    }
+    const char *p = command + 2;
+    if (*p && strchr("+#$%^", *p)) {
+        verb[n++] = *p++;
+        while (isalnum((unsigned char)*p) && n < ESP_MODEM_STATS_VERB_LENGTH - 1) {
+            verb[n++] = toupper((unsigned char)*p++);
+        }
+    } else if (*p == '&' && isalpha((unsigned char)p[1])) {
+        verb[n++] = '&';
+        verb[n++] = toupper((unsigned char)p[1]);
+    } else if (isalpha((unsigned char)*p)) {
+        verb[n++] = toupper((unsigned char)*p);
+    }
+    verb[n] = '\0';
+    if (!n) {
+        strcpy(verb, "AT");
+    }
+}
+
+/**
+ * @brief Add a histogram to another, halving the counts as often as the sum needs
+ */
+static void esp_modem_stats_merge(esp_modem_stats_histogram_t *into, const esp_modem_stats_histogram_t *from)
+{
+    uint32_t sums[ESP_MODEM_STATS_BUCKETS];
+    uint32_t top = 0;
+    for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+        sums[i] = into->buckets[i] + from->buckets[i];
+        if (sums[i] > top) {
+            top = sums[i];
+        }
+    }
+    for (; top > UINT16_MAX; top = (top + 1) / 2) {
+        for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+            sums[i] = (sums[i] + 1) / 2;
+        }
+    }
+    for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+        into->buckets[i] = sums[i];
+    }
+    into->samples += from->samples;
+    into->total_ms += from->total_ms;
+    if (from->max_ms > into->max_ms) {
+        into->max_ms = from->max_ms;
+    }
+}
+
+/**
+ * @brief Entry of a verb, made room for in a full table by folding the least used verb into "other"
+ *
+ * Among verbs sent as often, the one sent least recently goes, so that the verbs of the
+ * boot, sent once, make way for the telemetry that keeps coming.
+ */
+static esp_modem_stats_verb_t *esp_modem_stats_find(esp_modem_stats_t *stats, const char *verb)
+{
+    for (size_t i = 0; i < stats->used; i++) {
+        if (!strcmp(stats->entries[i].verb, verb)) {
+            return &stats->entries[i];
+        }
+    }
+    if (!stats->verbs || !strcmp(verb, "other")) {
+        return stats->other;
+    }
+    esp_modem_stats_verb_t *entry;
+    if (stats->used < stats->verbs) {
+        entry = &stats->entries[stats->used++];
+    } else {
+        entry = &stats->entries[0];
+        for (size_t i = 1; i < stats->used; i++) {
+            esp_modem_stats_verb_t *candidate = &stats->entries[i];
+            if (candidate->count < entry->count ||
+                (candidate->count == entry->count && candidate->last_command < entry->last_command)) {
+                entry = candidate;
+            }
+        }
+        stats->other->count += entry->count;
+        stats->other->errors += entry->errors;
+        stats->other->timeouts += entry->timeouts;
+        esp_modem_stats_merge(&stats->other->first_line, &entry->first_line);
+        esp_modem_stats_merge(&stats->other->final_result, &entry->final_result);
+        memset(entry, 0, sizeof(*entry));
+    }
+    strcpy(entry->verb, verb);
+    return entry;
+}
+
+void esp_modem_stats_begin(esp_modem_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    xSemaphoreTake(stats->lock, portMAX_DELAY);
+    stats->start_us = esp_timer_get_time();
+    stats->first_us = 0;
+    xSemaphoreGive(stats->lock);
+}
+
+void esp_modem_stats_line(esp_modem_stats_t *stats, const char *line)
+{
+    if (!stats) {
+        return;
+    }
+    /* With echo on the modem repeats the command first, that is not an answer */
+    if (toupper((unsigned char)line[0]) == 'A' && toupper((unsigned char)line[1]) == 'T') {
+        return;
+    }
+    xSemaphoreTake(stats->lock, portMAX_DELAY);
+    if (stats->start_us && !stats->first_us) {
+        stats->first_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(stats->lock);
+}
+
+void esp_modem_stats_end(esp_modem_stats_t *stats, const char *command, esp_modem_stats_result_t result)
+{
+    if (!stats) {
+        return;
+    }
+    char name[ESP_MODEM_STATS_VERB_LENGTH];
+    esp_modem_stats_verb(command, name);
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(stats->lock, portMAX_DELAY);
+    esp_modem_stats_verb_t *entry = esp_modem_stats_find(stats, name);
+    entry->count++;
+    entry->last_command = ++stats->sequence;
+    if (stats->first_us) {
+        esp_modem_stats_record(&entry->first_line, (stats->first_us - stats->start_us) / 1000);
+    }
+    switch (result) {
+    case ESP_MODEM_STATS_OK:
+        esp_modem_stats_record(&entry->final_result, (now - stats->start_us) / 1000);
+        break;
+    case ESP_MODEM_STATS_ERROR:
+        entry->errors++;
+        esp_modem_stats_record(&entry->final_result, (now - stats->start_us) / 1000);
+        break;
+    case ESP_MODEM_STATS_TIMEOUT:
+        entry->timeouts++;
+        break;
+    }
+    stats->start_us = 0;
+    stats->first_us = 0;
+    xSemaphoreGive(stats->lock);
+}
+
+esp_err_t esp_modem_stats_get(esp_modem_stats_t *stats, size_t index, esp_modem_stats_verb_t *verb)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(stats->lock, portMAX_DELAY);
+    if (index < stats->used) {
+        *verb = stats->entries[index];
+        err = ESP_OK;
+    } else if (index == stats->used && stats->other->count) {
+        *verb = *stats->other;
+        err = ESP_OK;
+    }
+    xSemaphoreGive(stats->lock);
+    return err;
+}
+
+void esp_modem_stats_reset(esp_modem_stats_t *stats)
+{
+    xSemaphoreTake(stats->lock, portMAX_DELAY);
+    memset(stats->entries, 0, (stats->verbs + 1) * sizeof(esp_modem_stats_verb_t));
+    strcpy(stats->other->verb, "other");
+    stats->used = 0;
+    xSemaphoreGive(stats->lock);
+}
+
+static void esp_modem_stats_write_histogram(FILE *fp, const char *name, const esp_modem_stats_histogram_t *histogram)
+{
+    fprintf(fp, "\"%s\":{\"samples\":%u,\"p50\":%u,\"p95\":%u,\"p99\":%u,\"max\":%u,\"mean\":%u,\"buckets\":[",
+            name, histogram->samples, esp_modem_stats_percentile(histogram, 50), esp_modem_stats_percentile(histogram, 95),
+            esp_modem_stats_percentile(histogram, 99), histogram->max_ms,
+            histogram->samples ? (uint32_t)(histogram->total_ms / histogram->samples) : 0);
+    const char *separator = "";
+    for (size_t i = 0; i < ESP_MODEM_STATS_BUCKETS; i++) {
+        if (histogram->buckets[i]) {
+            fprintf(fp, "%s[%u,%u]", separator, esp_modem_stats_bucket_limit(i), histogram->buckets[i]);
+            separator = ",";
+        }
+    }
+    fputs("]}", fp);
+}
+
+esp_err_t esp_modem_stats_write_json(esp_modem_stats_t *stats, const char *device, FILE *fp)
+{
+    esp_modem_stats_verb_t *entry = esp_modem_pool_alloc(sizeof(esp_modem_stats_verb_t));
+    if (!entry) {
+        return ESP_ERR_NO_MEM;
+    }
+    fprintf(fp, "{\"device\":\"%s\",\"uptime_ms\":%llu,\"unit\":\"ms\",\"verbs\":[",
+            device, (unsigned long long)(esp_timer_get_time() / 1000));
+    /* One entry at a time, so the command channel is never blocked by a slow console */
+    for (size_t i = 0; esp_modem_stats_get(stats, i, entry) == ESP_OK; i++) {
+        fprintf(fp, "%s{\"verb\":\"%s\",\"count\":%u,\"errors\":%u,\"timeouts\":%u,",
+                i ? "," : "", entry->verb, entry->count, entry->errors, entry->timeouts);
+        esp_modem_stats_write_histogram(fp, "first_line", &entry->first_line);
+        fputc(',', fp);
+        esp_modem_stats_write_histogram(fp, "final_result", &entry->final_result);
+        fputc('}', fp);
+    }
+    fputs("]}\n", fp);
+    esp_modem_pool_free(entry);
+    return ferror(fp) ? ESP_FAIL : ESP_OK;
+}
@@ -0,0 +1,615 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_modem.h"
+#include "esp_modem_arbiter.h"
+#include "esp_modem_cache.h"
+#include "esp_modem_supply.h"
+#include "esp_modem_static.h"
+#include "esp_modem_ext.h"
+
+static const char *SUPPLY_TAG = "esp-modem-supply";
+#define SUPPLY_CHECK(a, str, goto_tag, ...)                                              \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(a))                                                                        \
+        {                                                                                \
+            ESP_LOGE(SUPPLY_TAG, "%s(%d): " str, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+            goto goto_tag;                                                               \
+        }                                                                                \
+    } while (0)
+
+#define ESP_MODEM_SUPPLY_TASK_STACK_SIZE (3072)
+#define ESP_MODEM_SUPPLY_TASK_PRIORITY (2)
+#define ESP_MODEM_SUPPLY_PPP_FLAG (0x7e) /*!< Ends every PPP frame on the wire */
+#define ESP_MODEM_SUPPLY_PPP_ESCAPE (0x7d) /*!< The next byte is XORed with 0x20 */
+
+/**
+ * @brief Governor task event bits
+ *
+ */
+#define ESP_MODEM_SUPPLY_ALARM_BIT BIT0 /*!< A voltage URC came in, or the policy changed */
+
+/**
+ * @brief Supply governor of a DCE
+ *
+ */
+struct esp_modem_supply {
+    esp_modem_supply_config_t config;           /*!< Policy, changed at runtime under lock */
+    modem_dce_t *dce;
+    portMUX_TYPE lock;                          /*!< Protects config, stats, alarm and the uplink pacing */
+    esp_modem_supply_stats_t stats;
+    esp_modem_supply_level_t alarm;             /*!< Highest level the URCs asked for since the task looked */
+    int64_t since_us;                           /*!< esp_timer time the level last changed */
+    int64_t good_since_us;                      /*!< First of the readings in a row that allow resuming, 0 if none */
+    int64_t last_reading_us;                    /*!< esp_timer time of the last AT+CBC attempt */
+    int64_t uplink_tat_us;                      /*!< When the paced uplink will have caught up with its rate */
+    bool uplink_mid_frame;                      /*!< The last uplink chunk sent did not end a frame */
+    bool uplink_ip_frame;                       /*!< The uplink frame being sent carries IP */
+    bool resume_ppp;                            /*!< The governor closed a PPP session it has to open again */
+    esp_modem_ext_task_t task;                  /*!< Governor */
+    esp_modem_ext_t ext;                        /*!< Link into the DCE */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StackType_t task_stack[ESP_MODEM_SUPPLY_TASK_STACK_SIZE]; /*!< Its stack */
+#endif
+};
+
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+ESP_MODEM_STATIC_POOL(s_supply_pool, esp_modem_supply_t);
+#endif
+
+static const char *const esp_modem_supply_level_names[ESP_MODEM_SUPPLY_LEVEL_MAX] = {
+    [ESP_MODEM_SUPPLY_NORMAL] = "normal",
+    [ESP_MODEM_SUPPLY_THROTTLE] = "throttle",
+    [ESP_MODEM_SUPPLY_PAUSE] = "pause",
+};
+
+const char *esp_modem_supply_level_name(esp_modem_supply_level_t level)
+{
+    return level < ESP_MODEM_SUPPLY_LEVEL_MAX ? esp_modem_supply_level_names[level] : "unknown";
+}
+
+/**
+ * @brief Thresholds in order, and a way out of a throttle that began in PPP mode
+ */
+static bool esp_modem_supply_config_valid(const esp_modem_supply_config_t *config)
+{
+    return config->pause_mv < config->throttle_mv && config->throttle_mv < config->resume_mv &&
+           config->resume_mv < config->over_mv && config->poll_ms && config->alarm_poll_ms &&
+           config->ppp_check_ms && config->uplink_rate && config->uplink_burst;
+}
+
+/**
+ * @brief Move to another level, closing the time accounting of the one left
+ */
+static void esp_modem_supply_set_level(esp_modem_supply_t *supply, esp_modem_supply_level_t level, const char *why)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&supply->lock);
+    esp_modem_supply_level_t old = supply->stats.level;
+    if (level == old) {
+        portEXIT_CRITICAL(&supply->lock);
+        return;
+    }
+    if (old == ESP_MODEM_SUPPLY_THROTTLE) {
+        supply->stats.throttled_us += now - supply->since_us;
+    } else if (old == ESP_MODEM_SUPPLY_PAUSE) {
+        supply->stats.paused_us += now - supply->since_us;
+    }
+    supply->since_us = now;
+    supply->stats.level = level;
+    if (level == ESP_MODEM_SUPPLY_THROTTLE) {
+        supply->stats.throttles++;
+    } else if (level == ESP_MODEM_SUPPLY_PAUSE) {
+        supply->stats.pauses++;
+    }
+    if (old == ESP_MODEM_SUPPLY_NORMAL) {
+        /* Pacing starts with a whole burst to spend */
+        supply->uplink_tat_us = now;
+    }
+    portEXIT_CRITICAL(&supply->lock);
+    if (level > old) {
+        ESP_LOGW(SUPPLY_TAG, "%s -> %s (%s)", esp_modem_supply_level_name(old), esp_modem_supply_level_name(level), why);
+    } else {
+        ESP_LOGI(SUPPLY_TAG, "%s -> %s (%s)", esp_modem_supply_level_name(old), esp_modem_supply_level_name(level), why);
+    }
+}
+
+static esp_modem_supply_level_t esp_modem_supply_get_level_of(esp_modem_supply_t *supply)
+{
+    portENTER_CRITICAL(&supply->lock);
+    esp_modem_supply_level_t level = supply->stats.level;
+    portEXIT_CRITICAL(&supply->lock);
+    return level;
+}
+
+/**
+ * @brief Raise the level at once for a bad reading, lower it only after hold_ms of good ones
+ */
+static void esp_modem_supply_judge(esp_modem_supply_t *supply, uint32_t mv)
+{
+    esp_modem_supply_config_t config;
+    int64_t now = esp_timer_get_time();
+    char why[16];
+
+    portENTER_CRITICAL(&supply->lock);
+    config = supply->config;
+    esp_modem_supply_level_t level = supply->stats.level;
+    portEXIT_CRITICAL(&supply->lock);
+    snprintf(why, sizeof(why), "%u mV", mv);
+
+    esp_modem_supply_level_t wanted = ESP_MODEM_SUPPLY_NORMAL;
+    if (mv <= config.pause_mv) {
+        wanted = ESP_MODEM_SUPPLY_PAUSE;
+    } else if (mv <= config.throttle_mv || mv >= config.over_mv) {
+        wanted = ESP_MODEM_SUPPLY_THROTTLE;
+    }
+    if (wanted > level) {
+        supply->good_since_us = 0;
+        esp_modem_supply_set_level(supply, wanted, why);
+    } else if (level != ESP_MODEM_SUPPLY_NORMAL && mv >= config.resume_mv && mv < config.over_mv) {
+        if (!supply->good_since_us) {
+            supply->good_since_us = now;
+        }
+        if (now - supply->good_since_us >= config.hold_ms * 1000LL) {
+            supply->good_since_us = 0;
+            esp_modem_supply_set_level(supply, ESP_MODEM_SUPPLY_NORMAL, why);
+        }
+    } else {
+        /* Between the thresholds nothing changes, and the hold starts over */
+        supply->good_since_us = 0;
+    }
+}
+
+/**
+ * @brief Read the supply with AT+CBC, in command mode only
+ */
+static esp_err_t esp_modem_supply_read(esp_modem_supply_t *supply, uint32_t *mv)
+{
+    modem_dce_t *dce = supply->dce;
+    uint32_t bcs, bcl;
+    esp_err_t err = ESP_FAIL;
+
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (dce->mode == MODEM_COMMAND_MODE) {
+        /* A cached answer may predate the dip */
+        esp_modem_cache_invalidate(dce, ESP_MODEM_CACHE_BATTERY_STATUS);
+        err = dce->get_battery_status(dce, &bcs, &bcl, mv);
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+    supply->last_reading_us = esp_timer_get_time();
+    if (err == ESP_OK) {
+        portENTER_CRITICAL(&supply->lock);
+        supply->stats.readings++;
+        supply->stats.last_mv = *mv;
+        if (!supply->stats.min_mv || *mv < supply->stats.min_mv) {
+            supply->stats.min_mv = *mv;
+        }
+        if (*mv > supply->stats.max_mv) {
+            supply->stats.max_mv = *mv;
+        }
+        portEXIT_CRITICAL(&supply->lock);
+    }
+    return err;
+}
+
+/**
+ * @brief Close PPP, the modem sends nothing but what the close itself needs
+ */
+static void esp_modem_supply_pause_ppp(esp_modem_supply_t *supply)
+{
+    modem_dce_t *dce = supply->dce;
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        return;
+    }
+    if (dce->mode == MODEM_PPP_MODE) {
+        ESP_LOGW(SUPPLY_TAG, "closing PPP until the supply recovers");
+        if (esp_modem_exit_ppp(dce->dte) != ESP_OK) {
+            ESP_LOGW(SUPPLY_TAG, "PPP not closed cleanly");
+        }
+        /* Opened again on resume, unless the health monitor has to step in first */
+        supply->resume_ppp = dce->mode != MODEM_PPP_MODE;
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+}
+
+/**
+ * @brief Open the PPP session the governor closed
+ */
+static esp_err_t esp_modem_supply_open_ppp(esp_modem_supply_t *supply)
+{
+    modem_dce_t *dce = supply->dce;
+    if (dce->mode != MODEM_COMMAND_MODE || !supply->resume_ppp) {
+        return ESP_OK;
+    }
+    SUPPLY_CHECK(esp_modem_setup_ppp(dce->dte) == ESP_OK, "PPP not opened again", err);
+    supply->resume_ppp = false;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+static void esp_modem_supply_resume_ppp(esp_modem_supply_t *supply)
+{
+    modem_dce_t *dce = supply->dce;
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        return;
+    }
+    if (esp_modem_supply_open_ppp(supply) == ESP_OK && !supply->resume_ppp) {
+        portENTER_CRITICAL(&supply->lock);
+        supply->stats.resumes++;
+        portEXIT_CRITICAL(&supply->lock);
+        ESP_LOGI(SUPPLY_TAG, "PPP opened again");
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+}
+
+/**
+ * @brief Leave PPP for a reading and go back unless the supply calls for a pause
+ *
+ * Every socket over PPP is dropped and the address may change, so it is only done while
+ * throttled, when a reading is what ends throttling or calls for a pause.
+ */
+static void esp_modem_supply_ppp_check(esp_modem_supply_t *supply)
+{
+    modem_dce_t *dce = supply->dce;
+    uint32_t mv;
+
+    if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK) {
+        return;
+    }
+    if (dce->mode == MODEM_PPP_MODE) {
+        portENTER_CRITICAL(&supply->lock);
+        supply->stats.ppp_checks++;
+        portEXIT_CRITICAL(&supply->lock);
+        ESP_LOGI(SUPPLY_TAG, "closing PPP for a supply reading");
+        if (esp_modem_exit_ppp(dce->dte) == ESP_OK) {
+            supply->resume_ppp = true;
+            if (esp_modem_supply_read(supply, &mv) == ESP_OK) {
+                esp_modem_supply_judge(supply, mv);
+            }
+            if (esp_modem_supply_get_level_of(supply) != ESP_MODEM_SUPPLY_PAUSE) {
+                esp_modem_supply_open_ppp(supply);
+            }
+        } else {
+            ESP_LOGW(SUPPLY_TAG, "PPP not closed cleanly");
+        }
+        /* Tried either way, the next check is ppp_check_ms away */
+        supply->last_reading_us = esp_timer_get_time();
+    }
+    esp_modem_arbiter_release(dce->arbiter);
+}
+
+/**
+ * @brief Take in the URCs and a reading, then bring the link in line with the level
+ */
+static void esp_modem_supply_run(esp_modem_supply_t *supply)
+{
+    modem_dce_t *dce = supply->dce;
+    uint32_t mv;
+
+    portENTER_CRITICAL(&supply->lock);
+    esp_modem_supply_level_t alarm = supply->alarm;
+    esp_modem_supply_level_t level = supply->stats.level;
+    uint32_t ppp_check_ms = supply->config.ppp_check_ms;
+    supply->alarm = ESP_MODEM_SUPPLY_NORMAL;
+    portEXIT_CRITICAL(&supply->lock);
+    if (alarm > level) {
+        supply->good_since_us = 0;
+        esp_modem_supply_set_level(supply, alarm, alarm == ESP_MODEM_SUPPLY_PAUSE ? "power down notice" : "voltage warning");
+    }
+
+    if (dce->mode == MODEM_COMMAND_MODE) {
+        if (esp_modem_supply_read(supply, &mv) == ESP_OK) {
+            esp_modem_supply_judge(supply, mv);
+        }
+    } else if (dce->mode == MODEM_PPP_MODE && esp_modem_supply_get_level_of(supply) == ESP_MODEM_SUPPLY_THROTTLE &&
+               esp_timer_get_time() - supply->last_reading_us >= ppp_check_ms * 1000LL) {
+        esp_modem_supply_ppp_check(supply);
+    }
+
+    level = esp_modem_supply_get_level_of(supply);
+    if (level == ESP_MODEM_SUPPLY_PAUSE && dce->mode == MODEM_PPP_MODE) {
+        /* Ours to close, or opened by someone else while paused */
+        esp_modem_supply_pause_ppp(supply);
+    } else if (level == ESP_MODEM_SUPPLY_NORMAL && supply->resume_ppp) {
+        esp_modem_supply_resume_ppp(supply);
+    }
+}
+
+/**
+ * @brief Time until the next reading or PPP check
+ */
+static TickType_t esp_modem_supply_wait_ticks(esp_modem_supply_t *supply)
+{
+    portENTER_CRITICAL(&supply->lock);
+    esp_modem_supply_config_t config = supply->config;
+    esp_modem_supply_level_t level = supply->stats.level;
+    portEXIT_CRITICAL(&supply->lock);
+
+    int64_t ms = level == ESP_MODEM_SUPPLY_NORMAL ? config.poll_ms : config.alarm_poll_ms;
+    if (supply->dce->mode == MODEM_PPP_MODE && level == ESP_MODEM_SUPPLY_THROTTLE) {
+        int64_t due_ms = (supply->last_reading_us - esp_timer_get_time()) / 1000 + config.ppp_check_ms;
+        if (due_ms < ms) {
+            ms = due_ms > 0 ? due_ms : 0;
+        }
+    }
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+    return ticks ? ticks : 1;
+}
+
+/**
+ * @brief Read the supply and act on it until told to stop
+ *
+ * @param param supply governor
+ */
+static void esp_modem_supply_task_entry(void *param)
+{
+    esp_modem_supply_t *supply = (esp_modem_supply_t *)param;
+    const EventBits_t wait_bits = ESP_MODEM_SUPPLY_ALARM_BIT | ESP_MODEM_EXT_TASK_STOP_BIT;
+
+    while (1) {
+        EventBits_t bits = xEventGroupWaitBits(supply->task.events, wait_bits, pdTRUE, pdFALSE,
+                                               esp_modem_supply_wait_ticks(supply));
+        if (bits & ESP_MODEM_EXT_TASK_STOP_BIT) {
+            break;
+        }
+        esp_modem_supply_run(supply);
+    }
+    esp_modem_ext_task_exit(&supply->task);
+}
+
+/**
+ * @brief Pick out the voltage alarms of the SIM800
+ */
+static ESP_MODEM_RX_ATTR void esp_modem_supply_handle_urc(modem_dce_t *dce, const char *line)
+{
+    esp_modem_supply_t *supply = dce->supply;
+    bool under = !strncmp(line, "UNDER-VOLTAGE", strlen("UNDER-VOLTAGE"));
+    if (under || !strncmp(line, "OVER-VOLTAGE", strlen("OVER-VOLTAGE"))) {
+        /* "... WARNNING" as the SIM800 spells it, or "... POWER DOWN" right before it goes */
+        esp_modem_supply_level_t level = strstr(line, "POWER DOWN") ? ESP_MODEM_SUPPLY_PAUSE : ESP_MODEM_SUPPLY_THROTTLE;
+        portENTER_CRITICAL(&supply->lock);
+        if (under) {
+            supply->stats.under_urcs++;
+        } else {
+            supply->stats.over_urcs++;
+        }
+        if (level > supply->alarm) {
+            supply->alarm = level;
+        }
+        portEXIT_CRITICAL(&supply->lock);
+        xEventGroupSetBits(supply->task.events, ESP_MODEM_SUPPLY_ALARM_BIT);
+    }
+}
+
+/**
+ * @brief Whether the frame starting in a chunk carries IP, which is all the governor holds back
+ *
+ * LCP, IPCP and the authentication frames keep the session alive, and dropping them would
+ * close it. A frame too short to tell is taken for one of those.
+ */
+static bool esp_modem_supply_frame_is_ip(const uint8_t *data, size_t len)
+{
+    uint8_t head[4];
+    size_t n = 0;
+    bool escaped = false;
+
+    for (size_t i = 0; i < len && n < sizeof(head); i++) {
+        if (data[i] == ESP_MODEM_SUPPLY_PPP_FLAG) {
+            if (n) {
+                break;
+            }
+            /* Opening flags */
+            continue;
+        }
+        if (data[i] == ESP_MODEM_SUPPLY_PPP_ESCAPE) {
+            escaped = true;
+            continue;
+        }
+        head[n++] = escaped ? data[i] ^ 0x20 : data[i];
+        escaped = false;
+    }
+    /* Address and control, unless compressed away */
+    size_t at = n >= 2 && head[0] == 0xff && head[1] == 0x03 ? 2 : 0;
+    if (n < at + 1) {
+        return false;
+    }
+    /* The protocol field is one byte if its first is odd */
+    uint16_t protocol = head[at];
+    if (!(protocol & 1)) {
+        if (n < at + 2) {
+            return false;
+        }
+        protocol = (protocol << 8) | head[at + 1];
+    }
+    /* IPv4, Van Jacobson compressed and uncompressed TCP/IP, IPv6 */
+    return protocol == 0x0021 || protocol == 0x002d || protocol == 0x002f || protocol == 0x0057;
+}
+
+bool esp_modem_supply_uplink(esp_modem_supply_t *supply, const uint8_t *data, size_t len)
+{
+    if (!supply || !len) {
+        return true;
+    }
+    int64_t now = esp_timer_get_time();
+    bool ip = esp_modem_supply_frame_is_ip(data, len);
+    bool send = true;
+    portENTER_CRITICAL(&supply->lock);
+    if (!supply->uplink_mid_frame) {
+        supply->uplink_ip_frame = ip;
+    }
+    if (supply->stats.level != ESP_MODEM_SUPPLY_NORMAL) {
+        uint32_t rate = supply->config.uplink_rate;
+        int64_t burst_us = supply->config.uplink_burst * 1000000LL / rate;
+        if (supply->uplink_tat_us < now) {
+            supply->uplink_tat_us = now;
+        }
+        /* Within the burst the frame goes, past it a new IP frame is dropped and TCP backs off;
+         * the rest of a frame already on the wire goes too, or the bytes before it are wasted.
+         * Control frames always go, their bytes count against the IP frames after them */
+        if (!supply->uplink_mid_frame && supply->uplink_ip_frame && supply->uplink_tat_us - burst_us > now) {
+            send = false;
+            supply->stats.dropped_frames++;
+            supply->stats.dropped_bytes += len;
+        } else {
+            supply->uplink_tat_us += len * 1000000LL / rate;
+            supply->stats.paced_bytes += len;
+        }
+    }
+    /* lwIP gives up on a frame whose chunk was refused */
+    supply->uplink_mid_frame = send && data[len - 1] != ESP_MODEM_SUPPLY_PPP_FLAG;
+    portEXIT_CRITICAL(&supply->lock);
+    return send;
+}
+
+static void esp_modem_supply_detach(modem_dce_t *dce)
+{
+    esp_modem_supply_t *supply = dce->supply;
+    esp_modem_ext_task_join(&supply->task);
+    dce->supply = NULL;
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_supply_pool, supply);
+#else
+    free(supply);
+#endif
+}
+
+esp_err_t esp_modem_supply_enable(modem_dce_t *dce, const esp_modem_supply_config_t *config)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    SUPPLY_CHECK(dce && config, "invalid argument", err_arg);
+    SUPPLY_CHECK(esp_modem_supply_config_valid(config), "thresholds out of order or no PPP check: pause %u, throttle %u, resume %u, over %u mV, check %u ms",
+                 err_arg, config->pause_mv, config->throttle_mv, config->resume_mv, config->over_mv, config->ppp_check_ms);
+    SUPPLY_CHECK(!dce->supply, "supply governor already enabled", err_state);
+    SUPPLY_CHECK(dce->get_battery_status && dce->deinit, "DCE lacks the methods the governor needs", err_arg);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_supply_t *supply = esp_modem_static_calloc(&s_supply_pool);
+    SUPPLY_CHECK(supply, "no static slot for supply governor", err);
+    StackType_t *stack = supply->task_stack;
+#else
+    esp_modem_supply_t *supply = calloc(1, sizeof(esp_modem_supply_t));
+    SUPPLY_CHECK(supply, "calloc supply governor failed", err);
+    StackType_t *stack = NULL;
+#endif
+    SUPPLY_CHECK(esp_modem_ext_task_init(&supply->task) == ESP_OK, "supply task not set up", err_events);
+    supply->config = *config;
+    supply->dce = dce;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    supply->lock = lock;
+    supply->since_us = supply->last_reading_us = esp_timer_get_time();
+    supply->ext.handle_urc = esp_modem_supply_handle_urc;
+    supply->ext.detach = esp_modem_supply_detach;
+    dce->supply = supply;
+    esp_modem_ext_attach(dce, &supply->ext);
+    SUPPLY_CHECK(esp_modem_ext_task_start(&supply->task, esp_modem_supply_task_entry, "modem_supply",
+                                          ESP_MODEM_SUPPLY_TASK_STACK_SIZE, ESP_MODEM_SUPPLY_TASK_PRIORITY, supply,
+                                          stack) == ESP_OK, "supply task not started", err_task);
+    /* A first reading now rather than after poll_ms */
+    xEventGroupSetBits(supply->task.events, ESP_MODEM_SUPPLY_ALARM_BIT);
+    return ESP_OK;
+err_task:
+    esp_modem_ext_detach(dce, &supply->ext);
+    dce->supply = NULL;
+    esp_modem_ext_task_join(&supply->task);
+err_events:
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_supply_pool, supply);
+#else
+    free(supply);
+#endif
+err:
+    return ret;
+err_state:
+    return ESP_ERR_INVALID_STATE;
+err_arg:
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_modem_supply_set_config(modem_dce_t *dce, const esp_modem_supply_config_t *config)
+{
+    esp_modem_supply_t *supply = dce->supply;
+    SUPPLY_CHECK(supply, "supply governor not enabled", err_state);
+    SUPPLY_CHECK(esp_modem_supply_config_valid(config), "thresholds out of order or no PPP check: pause %u, throttle %u, resume %u, over %u mV, check %u ms",
+                 err_arg, config->pause_mv, config->throttle_mv, config->resume_mv, config->over_mv, config->ppp_check_ms);
+    portENTER_CRITICAL(&supply->lock);
+    supply->config = *config;
+    portEXIT_CRITICAL(&supply->lock);
+    /* Judged again at once against the new thresholds */
+    xEventGroupSetBits(supply->task.events, ESP_MODEM_SUPPLY_ALARM_BIT);
+    return ESP_OK;
+err_state:
+    return ESP_ERR_INVALID_STATE;
+err_arg:
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_modem_supply_get_config(modem_dce_t *dce, esp_modem_supply_config_t *config)
+{
+    esp_modem_supply_t *supply = dce->supply;
+    if (!supply) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    portENTER_CRITICAL(&supply->lock);
+    *config = supply->config;
+    portEXIT_CRITICAL(&supply->lock);
+    return ESP_OK;
+}
+
+esp_modem_supply_level_t esp_modem_supply_get_level(modem_dce_t *dce)
+{
+    return dce->supply ? esp_modem_supply_get_level_of(dce->supply) : ESP_MODEM_SUPPLY_NORMAL;
+}
+
+esp_err_t esp_modem_supply_get_stats(modem_dce_t *dce, esp_modem_supply_stats_t *stats)
+{
+    esp_modem_supply_t *supply = dce->supply;
+    if (!supply) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&supply->lock);
+    *stats = supply->stats;
+    if (stats->level == ESP_MODEM_SUPPLY_THROTTLE) {
+        stats->throttled_us += now - supply->since_us;
+    } else if (stats->level == ESP_MODEM_SUPPLY_PAUSE) {
+        stats->paused_us += now - supply->since_us;
+    }
+    portEXIT_CRITICAL(&supply->lock);
+    return ESP_OK;
+}
+
+void esp_modem_supply_reset_stats(modem_dce_t *dce)
+{
+    esp_modem_supply_t *supply = dce->supply;
+    if (!supply) {
+        return;
+    }
+    portENTER_CRITICAL(&supply->lock);
+    esp_modem_supply_stats_t kept = supply->stats;
+    memset(&supply->stats, 0, sizeof(supply->stats));
+    supply->stats.level = kept.level;
+    supply->stats.last_mv = kept.last_mv;
+    supply->since_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&supply->lock);
+}
@@ -17,25 +17,69 @@
 #include "esp_modem_dce_service.h"
 #include "sim800.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_modem_nvs.h"
+#include "esp_modem_driver.h"
+#include "esp_modem_static.h"
+#include "esp_modem_ext.h"
+#include "esp32/rom/crc.h"
+#include "freertos/event_groups.h"
+#include "sdkconfig.h"
 
 #define MODEM_RESULT_CODE_POWERDOWN "POWER DOWN"
 
-#define SIM800_PWKEY CONFIG_EXAMPLE_UART_MODEM_PWKEY
-#define set_sim800_pwkey() gpio_set_level(SIM800_PWKEY, 1)
-#define clear_sim800_pwkey() gpio_set_level(SIM800_PWKEY, 0)
+#define set_sim800_pwkey(config) gpio_set_level((config)->pwkey_io_num, 1)
+#define clear_sim800_pwkey(config) gpio_set_level((config)->pwkey_io_num, 0)
 
-#define SIM800_RST CONFIG_EXAMPLE_UART_MODEM_RST
-#define set_sim800_rst() gpio_set_level(SIM800_RST, 1)
-#define clear_sim800_rst() gpio_set_level(SIM800_RST, 0)
+#define set_sim800_rst(config) gpio_set_level((config)->rst_io_num, 1)
+#define clear_sim800_rst(config) gpio_set_level((config)->rst_io_num, 0)
 
-#define SIM800_POWER 23
-#define set_sim800_pwrsrc() gpio_set_level(SIM800_POWER, 1)
-#define clear_sim800_pwrsrc() gpio_set_level(SIM800_POWER, 0)
+#define set_sim800_pwrsrc(config) gpio_set_level((config)->power_io_num, 1)
+#define clear_sim800_pwrsrc(config) gpio_set_level((config)->power_io_num, 0)
+
+#define SIM800_NVS_KEY_CONFIG_HASH "cfg_hash"
+
+/**
+ * @brief Boot event bits, set from URCs as soon as they arrive
+ *
+ */
+#define SIM800_BOOT_RDY_BIT BIT0
+#define SIM800_BOOT_CALL_READY_BIT BIT1 /*!< SIM ready, or given up waiting for it */
+#define SIM800_BOOT_REGISTERED_BIT BIT2
+
+/**
+ * @brief Identity worker event bits
+ *
+ */
+#define SIM800_IDENTITY_REFRESH_BIT BIT4  /*!< Query everything again */
+#define SIM800_IDENTITY_OPERATOR_BIT BIT5 /*!< Operator changed or needs a query */
+
+#define SIM800_IDENTITY_TASK_STACK_SIZE (3072)
+#define SIM800_IDENTITY_TASK_PRIORITY (2)
+#define SIM800_IDENTITY_RETRY_MS (5000) /*!< Retry of a request that found PPP up or the channel busy */
+#define SIM800_CALL_READY_TIMEOUT_MS (15000) /*!< Longest the SIM queries wait for "Call Ready" */
+
+#define SIM800_ICCID_LENGTH (20)
+
+#define SIM800_COMMAND_LINE_LENGTH (128) /*!< Longest line sim800_at() and sim800_send_raw() send, with the terminator */
+
+#define SIM800_NVS_KEY_NAME "name"
+#define SIM800_NVS_KEY_IMEI "imei"
+#define SIM800_NVS_KEY_IMSI "imsi"
+#define SIM800_NVS_KEY_OPERATOR "oper"
+#define SIM800_NVS_KEY_ICCID "iccid"
+#define SIM800_NVS_KEY_BAUD "baud"
+
+/**
+ * @brief Baud rate negotiation
+ *
+ */
+#define SIM800_BAUD_SETTLE_MS (100) /*!< Time the modem needs to switch its UART after AT+IPR */
+#define SIM800_BAUD_PROBE_ROUNDS (20) /*!< Round trips of the integrity and throughput test */
 
 static esp_err_t sim800_handle_cfun(modem_dce_t *dce, const char *line);
 static esp_err_t sim800_print_buffer(modem_dce_t *dce, const char *buffer);
 static esp_err_t sim800_handle_cclk(modem_dce_t *dce, const char *buffer);
-static esp_err_t sim800_handle_creg(modem_dce_t *dce, const char *buffer);
 /**
  * @brief Macro defined for error checking
  *
@@ -57,12 +101,198 @@ static const char *DCE_TAG = "sim800";
  */
 typedef struct
 {
-    void *priv_resource; /*!< Private resource */
     size_t command_timeout;
+    esp_modem_ext_task_t identity; /*!< Identity worker, its events carry the boot URCs too */
+    char iccid[SIM800_ICCID_LENGTH + 1]; /*!< SIM card the cached identity belongs to */
+    sim800_config_t config;        /*!< Pins and instance index */
+    uint32_t boot_baud_rate;       /*!< DTE rate at sim800_init(), the one the modem autobauds at after a reset */
     modem_dce_t parent; /*!< DCE parent class */
 } sim800_modem_dce_t;
 
-static const char *const sim800_urc_responses[] = {
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+/**
+ * @brief A SIM800 DCE with the stack of its identity worker, in one static slot
+ *
+ */
+typedef struct
+{
+    sim800_modem_dce_t dce;                                    /*!< First, the slot is freed through it */
+    StackType_t identity_stack[SIM800_IDENTITY_TASK_STACK_SIZE]; /*!< Its stack */
+} sim800_storage_t;
+
+ESP_MODEM_STATIC_POOL(s_dce_pool, sim800_storage_t);
+#endif
+
+/**
+ * @brief Power state of one modem, kept across sim800_init()/deinit so the boot timeline outlives the DCE
+ *
+ */
+typedef struct
+{
+    sim800_config_t config;                   /*!< Pins of the modem */
+    esp_timer_handle_t pwkey_timer;           /*!< Ends the PWKEY pulse */
+    int64_t power_on_time;                    /*!< esp_timer time of sim800_power_on(), 0 if never powered */
+    int32_t timeline[SIM800_BOOT_PHASE_MAX];  /*!< ms since power on, -1 if not reached */
+} sim800_power_t;
+
+static sim800_power_t s_power[CONFIG_EXAMPLE_MODEM_INSTANCES];
+
+static const char *const sim800_boot_phase_names[SIM800_BOOT_PHASE_MAX] = {
+    "power on",
+    "pwkey released",
+    "RDY",
+    "sync",
+    "+CFUN: 1",
+    "configured",
+    "Call Ready",
+    "registered",
+};
+
+/**
+ * @brief Record the first time a boot phase is reached
+ */
+static void sim800_boot_mark(uint8_t instance, sim800_boot_phase_t phase)
+{
+    sim800_power_t *power = &s_power[instance];
+    if (power->timeline[phase] < 0)
+    {
+        power->timeline[phase] = (int32_t)((esp_timer_get_time() - power->power_on_time) / 1000);
+        ESP_LOGI(DCE_TAG, "modem %d boot: %s after %d ms", instance, sim800_boot_phase_names[phase], power->timeline[phase]);
+    }
+}
+
+/**
+ * @brief Start a new boot timeline from now
+ */
+static void sim800_boot_restart(uint8_t instance)
+{
+    sim800_power_t *power = &s_power[instance];
+    for (int i = 0; i < SIM800_BOOT_PHASE_MAX; i++)
+    {
+        power->timeline[i] = -1;
+    }
+    power->power_on_time = esp_timer_get_time();
+    sim800_boot_mark(instance, SIM800_BOOT_PHASE_POWER_ON);
+}
+
+void sim800_get_boot_timeline(uint8_t instance, int32_t timeline[SIM800_BOOT_PHASE_MAX])
+{
+    for (int i = 0; i < SIM800_BOOT_PHASE_MAX; i++)
+    {
+        timeline[i] = (instance < CONFIG_EXAMPLE_MODEM_INSTANCES && s_power[instance].power_on_time) ? s_power[instance].timeline[i] : -1;
+    }
+}
+
+const char *sim800_boot_phase_name(sim800_boot_phase_t phase)
+{
+    return phase < SIM800_BOOT_PHASE_MAX ? sim800_boot_phase_names[phase] : "unknown";
+}
+
+/**
+ * @brief *PSUTTZ: <year>,<month>,<day>,<hour>,<min>,<sec>,"<timezone>",<dst>
+ *
+ */
+typedef struct {
+    int32_t year;
+    int32_t month;
+    int32_t day;
+    int32_t hour;
+    int32_t min;
+    int32_t sec;
+    char timezone[8];
+    int32_t dst;
+} sim800_psuttz_t;
+
+static const esp_modem_field_t sim800_psuttz_fields[] = {
+    ESP_MODEM_INT(sim800_psuttz_t, year),
+    ESP_MODEM_INT(sim800_psuttz_t, month),
+    ESP_MODEM_INT(sim800_psuttz_t, day),
+    ESP_MODEM_INT(sim800_psuttz_t, hour),
+    ESP_MODEM_INT(sim800_psuttz_t, min),
+    ESP_MODEM_INT(sim800_psuttz_t, sec),
+    ESP_MODEM_STRING(sim800_psuttz_t, timezone),
+    ESP_MODEM_INT(sim800_psuttz_t, dst),
+};
+static const esp_modem_format_t sim800_format_psuttz = ESP_MODEM_FORMAT("*PSUTTZ: ", sim800_psuttz_fields);
+
+/* The +CREG URC only carries <stat> */
+static const esp_modem_field_t sim800_creg_urc_fields[] = {ESP_MODEM_INT(esp_modem_creg_t, stat)};
+static const esp_modem_format_t sim800_format_creg_urc = ESP_MODEM_FORMAT("+CREG: ", sim800_creg_urc_fields);
+
+static const esp_modem_field_t sim800_int_fields[] = {ESP_MODEM_BUFFER(ESP_MODEM_FIELD_INT, sizeof(int32_t))};
+static const esp_modem_format_t sim800_format_cfun = ESP_MODEM_FORMAT("+CFUN: ", sim800_int_fields);
+static const esp_modem_format_t sim800_format_cmee = ESP_MODEM_FORMAT("+CMEE: ", sim800_int_fields);
+
+static const esp_modem_field_t sim800_iccid_fields[] = {ESP_MODEM_BUFFER(ESP_MODEM_FIELD_STRING, SIM800_ICCID_LENGTH + 1)};
+static const esp_modem_format_t sim800_format_iccid = ESP_MODEM_FORMAT(NULL, sim800_iccid_fields);
+
+/**
+ * @brief Parse a +CREG line, either the "+CREG: <n>,<stat>" answer or the "+CREG: <stat>" URC
+ */
+static esp_err_t sim800_parse_creg(const char *line, esp_modem_creg_t *creg)
+{
+    esp_modem_parse_error_t error;
+    esp_err_t err = esp_modem_parse(&esp_modem_format_creg, line, creg, &error);
+    if (err == ESP_ERR_INVALID_RESPONSE && error.field == 1)
+    {
+        err = esp_modem_parse(&sim800_format_creg_urc, line, creg, NULL);
+    }
+    return err;
+}
+
+/**
+ * @brief Watch for boot and identity URCs, whichever handler owns the current command
+ */
+static ESP_MODEM_RX_ATTR esp_err_t sim800_handle_urc(modem_dce_t *dce, const char *line)
+{
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    esp_modem_creg_t creg = {0};
+    esp_modem_cops_t cops = {0};
+
+    if (!strncmp(line, "RDY", strlen("RDY")))
+    {
+        sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_RDY);
+        xEventGroupSetBits(sim800_dce->identity.events, SIM800_BOOT_RDY_BIT);
+    }
+    else if (!strncmp(line, "+CFUN: 1", strlen("+CFUN: 1")))
+    {
+        sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_CFUN);
+    }
+    else if (!strncmp(line, "Call Ready", strlen("Call Ready")))
+    {
+        sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_CALL_READY);
+        xEventGroupSetBits(sim800_dce->identity.events, SIM800_BOOT_CALL_READY_BIT);
+    }
+    /* URC is "+CREG: <stat>", the AT+CREG? response is "+CREG: <n>,<stat>" */
+    else if (sim800_parse_creg(line, &creg) == ESP_OK)
+    {
+        if (creg.stat == 1 || creg.stat == 5)
+        {
+            sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_REGISTERED);
+            /* The operator may have changed while we were not registered */
+            if (!(xEventGroupGetBits(sim800_dce->identity.events) & SIM800_BOOT_REGISTERED_BIT))
+            {
+                xEventGroupSetBits(sim800_dce->identity.events, SIM800_BOOT_REGISTERED_BIT | SIM800_IDENTITY_OPERATOR_BIT);
+            }
+        }
+        else
+        {
+            xEventGroupClearBits(sim800_dce->identity.events, SIM800_BOOT_REGISTERED_BIT);
+        }
+    }
+    else if (esp_modem_parse(&esp_modem_format_cops, line, &cops, NULL) == ESP_OK)
+    {
+        if (cops.oper[0] && strcmp(cops.oper, dce->oper))
+        {
+            /* Persisted by the identity worker, never from the UART task */
+            strcpy(dce->oper, cops.oper);
+            xEventGroupSetBits(sim800_dce->identity.events, SIM800_IDENTITY_OPERATOR_BIT);
+        }
+    }
+    return ESP_OK;
+}
+
+static const char *const ESP_MODEM_RX_DATA_ATTR sim800_urc_responses[] = {
     "+CFUN: ",
     "+CREG: ",
     "*PSUTTZ: ",       /* AT+CLTS time */
@@ -90,7 +320,7 @@ static const char *const sim800_urc_responses[] = {
 
 esp_err_t (*sim800_urc_responses_fn[])(modem_dce_t *dce, const char *buffer) = {
     sim800_handle_cfun,
-    sim800_handle_creg,
+    sim800_print_buffer, /* registration tracked by sim800_handle_urc */
     sim800_handle_cclk,
     sim800_print_buffer, /* AT+CLTS time */
     sim800_print_buffer, /* AT+CLTS timezone */
@@ -116,13 +346,13 @@ esp_err_t (*sim800_urc_responses_fn[])(modem_dce_t *dce, const char *buffer) = {
     sim800_print_buffer,
     sim800_print_buffer};
 
-esp_err_t sim800_handle_response_default(modem_dce_t *dce, const char *line)
+ESP_MODEM_RX_ATTR esp_err_t sim800_handle_response_default(modem_dce_t *dce, const char *line)
 {
     esp_err_t err = ESP_FAIL;
 
     for (int i = 0; sim800_urc_responses[i] != NULL; i++)
     {
-        if (!strncmp(line, sim800_urc_responses[i], strlen(sim800_urc_responses[i] + 2)))
+        if (!strncmp(line, sim800_urc_responses[i], strlen(sim800_urc_responses[i])))
         {
             sim800_urc_responses_fn[i](dce, line);
             return ESP_OK;
@@ -194,79 +424,69 @@ static esp_err_t sim800_print_buffer(modem_dce_t *dce, const char *buffer)
 esp_err_t sim800_at(modem_dce_t *dce, const char *at_command, uint16_t timeout)
 {
     DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
-    modem_dte_t *dte = dce->dte;
-    char send_cmd[50] = "AT";
-    strcat(send_cmd, at_command);
-    strcat(send_cmd, "\r");
+    char send_cmd[SIM800_COMMAND_LINE_LENGTH];
+    int length = snprintf(send_cmd, sizeof(send_cmd), "AT%s\r", at_command);
+    DCE_CHECK(length > 0 && length < sizeof(send_cmd), "command too long", err);
 
     if (timeout == 0)
         timeout = MODEM_COMMAND_TIMEOUT_DEFAULT;
-    dce->handle_line = sim800_handle_at_response;
-    DCE_CHECK(dte->send_cmd(dte, send_cmd, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "AT command failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, send_cmd, timeout, sim800_handle_at_response, NULL) == ESP_OK, "AT command failed", err);
     return ESP_OK;
 err:
-    dce->handle_line = dce->handle_line_default;
     return ESP_FAIL;
 }
 
 esp_err_t sim800_send_raw(modem_dce_t *dce, const char *line, uint16_t timeout)
 {
     DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
-    modem_dte_t *dte = dce->dte;
-    char send_line[128] = "";
-    strcat(send_line, line);
-    strcat(send_line, "\r\n\x1A");
+    char send_line[SIM800_COMMAND_LINE_LENGTH];
+    int length = snprintf(send_line, sizeof(send_line), "%s\r\n\x1A", line);
+    DCE_CHECK(length > 0 && length < sizeof(send_line), "line too long", err);
     printf("\r\n");
     if (timeout == 0)
         timeout = MODEM_COMMAND_TIMEOUT_DEFAULT;
-    dce->handle_line = sim800_handle_at_response;
-    DCE_CHECK(dte->send_cmd(dte, send_line, timeout * 2) == ESP_OK, "send line timeout", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "line command failed", err);
+    DCE_CHECK(esp_modem_dce_command(dce, send_line, timeout * 2, sim800_handle_at_response, NULL) == ESP_OK, "line command failed", err);
     return ESP_OK;
 err:
     return ESP_FAIL;
 }
 
 /**
- * @brief Handle response from AT+CCLK
+ * @brief Handle the *PSUTTZ network time URC
  */
-esp_err_t sim800_handle_cclk(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_handle_cclk(modem_dce_t *dce, const char *line)
 {
-    esp_err_t err = ESP_FAIL;
-    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-
+    sim800_psuttz_t psuttz;
     struct tm tm;
     printf("\033[1mTime set to: %s\033[0m", line);
-    memset(&tm, 0, sizeof(struct tm));
-    at_simple_scanf(line, "*PSUTTZ: %d,%d,%d,%d,%d,%d,\"%*d\",%d",
-                    &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
-                    &tm.tm_hour, &tm.tm_min, &tm.tm_sec,&tm.tm_isdst);
+    if (esp_modem_parse(&sim800_format_psuttz, line, &psuttz, NULL) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
 
     /* Most modems report some starting date way in the past when they have
      * no date/time estimation. */
-    if (tm.tm_year < 14)
+    if (psuttz.year < 14)
     {
-        return err;
+        return ESP_FAIL;
     }
 
     /* Adjust values and perform conversion. */
-    tm.tm_year += 2000 - 1900;
-    tm.tm_mon -= 1;
+    memset(&tm, 0, sizeof(struct tm));
+    tm.tm_year = psuttz.year + 2000 - 1900;
+    tm.tm_mon = psuttz.month - 1;
+    tm.tm_mday = psuttz.day;
+    tm.tm_hour = psuttz.hour;
+    tm.tm_min = psuttz.min;
+    tm.tm_sec = psuttz.sec;
+    tm.tm_isdst = psuttz.dst;
     time_t unix_time = mktime(&tm);
     if (unix_time == -1)
     {
-        return err;
+        return ESP_FAIL;
     }
     printf("\033Unix Time: %ld\033[0m\n", unix_time);
-    /* All good. Return the result. */
-    err = ESP_OK;
-    
-    struct timespec *ts = sim800_dce->priv_resource;
-    ts->tv_sec = unix_time;
-    ts->tv_nsec = 0;
-
-    return err;
+    return ESP_OK;
 }
 
 /**
@@ -275,13 +495,10 @@ esp_err_t sim800_handle_cclk(modem_dce_t *dce, const char *line)
 static esp_err_t sim800_handle_cfun(modem_dce_t *dce, const char *line)
 {
     esp_err_t err = ESP_FAIL;
-    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-    if (!strncmp(line, "+CFUN", strlen("+CFUN")))
+    int32_t fun = 5;
+    /* +CFUN: <stat>*/
+    if (esp_modem_parse(&sim800_format_cfun, line, &fun, NULL) == ESP_OK)
     {
-        /* store value of rssi and ber */
-        uint32_t fun = 5;
-        /* +CFUN: <stat>*/
-        sscanf(line, "%*s%d", &fun);
         switch (fun)
         {
         case 0:
@@ -309,37 +526,104 @@ static esp_err_t sim800_handle_cfun(modem_dce_t *dce, const char *line)
 }
 
 /**
- * @brief Handle response from AT+CSQ
+ * @brief Handle response from AT+CREG?, the URC form only carries the status
  */
-static esp_err_t sim800_handle_csq(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_handle_creg(modem_dce_t *dce, const char *line)
 {
-    esp_err_t err = ESP_FAIL;
-    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
-    {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    esp_modem_dce_result_t *result = dce->priv_resource;
+    if (!strchr(line, ',') && esp_modem_parse(&sim800_format_creg_urc, line, result->out, NULL) == ESP_OK)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+        printf("\033[1m%s\033[0m", line);
+        return ESP_OK;
     }
-    else if (!strncmp(line, "+CSQ", strlen("+CSQ")))
+    /* +CREG: <n>,<stat> */
+    return esp_modem_dce_handle_command_line(dce, line);
+}
+
+/**
+ * @brief SIM800 wording of the commands shared with the other models
+ *
+ */
+static const esp_modem_dce_model_t sim800_model = {
+    .name = "sim800",
+    .commands = {
+        [ESP_MODEM_DCE_CMD_SIGNAL_QUALITY] = {"AT+CSQ\r", &esp_modem_format_csq, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_BATTERY_STATUS] = {"AT+CBC\r", &esp_modem_format_cbc, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_MODULE_NAME] = {"AT+CGMM\r", &esp_modem_format_name, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_IMEI] = {"AT+CGSN\r", &esp_modem_format_imei, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_IMSI] = {"AT+CIMI\r", &esp_modem_format_imsi, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+        [ESP_MODEM_DCE_CMD_OPERATOR] = {"AT+COPS?\r", &esp_modem_format_cops, {NULL}, MODEM_COMMAND_TIMEOUT_OPERATOR},
+        [ESP_MODEM_DCE_CMD_NETWORK_STATUS] = {"AT+CREG?\r", &esp_modem_format_creg, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT, sim800_handle_creg},
+        [ESP_MODEM_DCE_CMD_COMMAND_MODE] = {"+++", NULL, {MODEM_RESULT_CODE_SUCCESS, MODEM_RESULT_CODE_NO_CARRIER}, MODEM_COMMAND_TIMEOUT_MODE_CHANGE},
+        [ESP_MODEM_DCE_CMD_PPP_MODE] = {"ATD*99#\r", NULL, {MODEM_RESULT_CODE_CONNECT}, MODEM_COMMAND_TIMEOUT_MODE_CHANGE},
+        [ESP_MODEM_DCE_CMD_POWER_DOWN] = {"AT+CPOWD=1\r", NULL, {MODEM_RESULT_CODE_POWERDOWN}, MODEM_COMMAND_TIMEOUT_POWEROFF},
+        [ESP_MODEM_DCE_CMD_RADIO_OFF] = {"AT+CFUN=0\r", NULL, {NULL}, MODEM_COMMAND_TIMEOUT_RADIO},
+        [ESP_MODEM_DCE_CMD_RADIO_ON] = {"AT+CFUN=1\r", NULL, {NULL}, MODEM_COMMAND_TIMEOUT_RADIO},
+        [ESP_MODEM_DCE_CMD_SLEEP_ON_DTR] = {"AT+CSCLK=1\r", NULL, {NULL}, MODEM_COMMAND_TIMEOUT_DEFAULT},
+    },
+};
+
+/**
+ * @brief Deinitialize SIM800 object
+ *
+ * @param dce Modem DCE object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL on fail
+ */
+static esp_err_t sim800_deinit(modem_dce_t *dce)
+{
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    if (dce->dte)
     {
-        /* store value of rssi and ber */
-        uint32_t **csq = sim800_dce->priv_resource;
-        /* +CSQ: <rssi>,<ber> */
-        sscanf(line, "%*s%d,%d", csq[0], csq[1]);
-        err = ESP_OK;
+        dce->dte->dce = NULL;
     }
-    return err;
+    /* The worker finishes its current query before exiting */
+    esp_modem_ext_task_join(&sim800_dce->identity);
+    esp_modem_dce_unbind(dce);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_dce_pool, sim800_dce);
+#else
+    free(sim800_dce);
+#endif
+    return ESP_OK;
 }
 
 /**
- * @brief Handle response from AT+CBC
+ * @brief Settings kept in the modem's NVRAM profile by AT&W
+ *
+ */
+static const char *const sim800_profile_strings[] = {
+    "+IPR=0",
+    "+CMEE = 2",
+    "+CLTS=1",
+    "Q0",
+    NULL};
+
+/**
+ * @brief Settings lost on power off, sent on every start
+ *
+ */
+static const char *const sim800_runtime_strings[] = {
+    "+CMER=2,0,0,2,1",
+    "+CFUN=1",
+    "+CREG=1",
+    NULL};
+
+/**
+ * @brief Cheap query proving the profile is still stored (AT&F would reset CMEE to 0)
+ *
+ */
+#define SIM800_PROFILE_CHECK_COMMAND "AT+CMEE?\r"
+#define SIM800_PROFILE_CHECK_CMEE (2)
+
+/**
+ * @brief Handle response from AT+CMEE?
  */
-static esp_err_t sim800_handle_cbc(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_handle_profile_check(modem_dce_t *dce, const char *line)
 {
     esp_err_t err = ESP_FAIL;
+    int32_t cmee = 0;
     sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
     if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
     {
@@ -349,115 +633,203 @@ static esp_err_t sim800_handle_cbc(modem_dce_t *dce, const char *line)
     {
         err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
     }
-    else if (!strncmp(line, "+CBC", strlen("+CBC")))
+    else if (esp_modem_parse(&sim800_format_cmee, line, &cmee, NULL) == ESP_OK)
     {
-        /* store value of bcs, bcl, voltage */
-        uint32_t **cbc = sim800_dce->priv_resource;
-        /* +CBC: <bcs>,<bcl>,<voltage> */
-        sscanf(line, "%*s%d,%d,%d", cbc[0], cbc[1], cbc[2]);
+        bool *match = sim800_dce->parent.priv_resource;
+        *match = (cmee == SIM800_PROFILE_CHECK_CMEE);
         err = ESP_OK;
     }
     return err;
 }
 
 /**
- * @brief Handle response from +++
+ * @brief Fingerprint of everything the stored profile depends on
  */
-static esp_err_t sim800_handle_exit_data_mode(modem_dce_t *dce, const char *line)
+static uint32_t sim800_config_fingerprint(modem_dce_t *dce)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
+    uint32_t crc = 0;
+    for (const char *const *command = sim800_profile_strings; *command; command++)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    }
-    else if (strstr(line, MODEM_RESULT_CODE_NO_CARRIER))
-    {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
-    {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+        crc = crc32_le(crc, (const uint8_t *)*command, strlen(*command) + 1);
     }
-    return err;
+    /* The profile always autobauds, the negotiated rate is applied on top at runtime */
+    uint32_t flow_ctrl = dce->dte->flow_ctrl;
+    crc = crc32_le(crc, (const uint8_t *)&flow_ctrl, sizeof(flow_ctrl));
+    crc = crc32_le(crc, (const uint8_t *)CONFIG_EXAMPLE_MODEM_APN, strlen(CONFIG_EXAMPLE_MODEM_APN));
+    return crc;
 }
 
 /**
- * @brief Handle response from ATD*99#
+ * @brief Check the modem still holds the profile matching the stored fingerprint
  */
-static esp_err_t sim800_handle_atd_ppp(modem_dce_t *dce, const char *line)
+static bool sim800_profile_is_current(sim800_modem_dce_t *sim800_dce, uint32_t fingerprint)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_CONNECT))
-    {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    uint32_t stored = 0;
+    bool match = false;
+    if (esp_modem_nvs_get_u32(sim800_dce->config.instance, SIM800_NVS_KEY_CONFIG_HASH, &stored) != ESP_OK || stored != fingerprint)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+        return false;
     }
-    return err;
+    DCE_CHECK(esp_modem_dce_command(&(sim800_dce->parent), SIM800_PROFILE_CHECK_COMMAND, MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                    sim800_handle_profile_check, &match) == ESP_OK, "profile check failed", err);
+    return match;
+err:
+    return false;
 }
 
-/**
- * @brief Handle response from AT+CGMM
- */
-static esp_err_t sim800_handle_cgmm(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_configure_locked(modem_dce_t *dce, bool force)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    esp_err_t ret = ESP_OK;
+    uint32_t fingerprint = sim800_config_fingerprint(dce);
+
+    if (!force && sim800_profile_is_current(sim800_dce, fingerprint))
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
+        ESP_LOGI(DCE_TAG, "modem profile %08x up to date, skipping configuration", fingerprint);
     }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    else
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+        for (const char *const *command = sim800_profile_strings; *command; command++)
+        {
+            if (sim800_at(dce, *command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_FAIL)
+            {
+                printf("Setup AT commands failed: %s\n", *command);
+                ret = ESP_FAIL;
+            }
+        }
+        /* AT+IFC follows whatever the DTE was set up with */
+        if (dce->set_flow_ctrl(dce, dce->dte->flow_ctrl) != ESP_OK)
+        {
+            ret = ESP_FAIL;
+        }
+        /* Only remember profiles that were stored completely */
+        if (ret == ESP_OK && sim800_at(dce, "&W", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK)
+        {
+            esp_modem_nvs_set_u32(sim800_dce->config.instance, SIM800_NVS_KEY_CONFIG_HASH, fingerprint);
+            ESP_LOGI(DCE_TAG, "modem profile %08x stored", fingerprint);
+        }
+        else
+        {
+            esp_modem_nvs_erase(sim800_dce->config.instance, SIM800_NVS_KEY_CONFIG_HASH);
+            ret = ESP_FAIL;
+        }
     }
-    else
+
+    for (const char *const *command = sim800_runtime_strings; *command; command++)
     {
-        int len = snprintf(dce->name, MODEM_MAX_NAME_LENGTH, "%s", line);
-        if (len > 2)
+        if (sim800_at(dce, *command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_FAIL)
         {
-            /* Strip "\r\n" */
-            strip_cr_lf_tail(dce->name, len);
-            err = ESP_OK;
+            printf("Setup AT commands failed: %s\n", *command);
+            ret = ESP_FAIL;
         }
     }
-    return err;
+    return ret;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t sim800_configure(modem_dce_t *dce, bool force)
+{
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    esp_err_t ret = sim800_configure_locked(dce, force);
+    esp_modem_arbiter_release(dce->arbiter);
+    return ret;
+err:
+    return ESP_FAIL;
 }
 
 /**
- * @brief Handle response from AT+CGSN
+ * @brief Wait until the modem answers
+ *
+ * Autobauding modems stay silent until they see "AT", so probe while waiting for "RDY".
+ *
+ * @param sim800_dce sim800 object
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_ERR_TIMEOUT if the modem did not answer within the boot timeout
  */
-static esp_err_t sim800_handle_cgsn(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_wait_ready(sim800_modem_dce_t *sim800_dce)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
-    {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
-    }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
-    {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
-    }
-    else
+    int64_t deadline = esp_timer_get_time() + CONFIG_EXAMPLE_MODEM_BOOT_TIMEOUT * 1000LL;
+    EventBits_t bits = 0;
+    modem_dte_t *dte = sim800_dce->parent.dte;
+    /* A modem that was not power cycled still runs at the negotiated rate */
+    uint32_t rates[2] = {dte->baud_rate, 0};
+    int rate = 0;
+    esp_modem_nvs_get_u32(sim800_dce->config.instance, SIM800_NVS_KEY_BAUD, &rates[1]);
+
+    while (esp_timer_get_time() < deadline)
     {
-        int len = snprintf(dce->imei, MODEM_IMEI_LENGTH + 1, "%s", line);
-        if (len > 2)
+        bits = xEventGroupWaitBits(sim800_dce->identity.events, SIM800_BOOT_RDY_BIT, pdFALSE, pdFALSE,
+                                   pdMS_TO_TICKS(CONFIG_EXAMPLE_MODEM_SYNC_INTERVAL));
+        if (esp_modem_dce_sync(&(sim800_dce->parent)) == ESP_OK)
+        {
+            sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_SYNC);
+            return ESP_OK;
+        }
+        if (rates[1] && rates[1] != rates[0])
+        {
+            rate = !rate;
+            dte->set_baud_rate(dte, rates[rate]);
+        }
+        if (bits & SIM800_BOOT_RDY_BIT)
         {
-            /* Strip "\r\n" */
-            strip_cr_lf_tail(dce->imei, len);
-            err = ESP_OK;
+            /* Modem reported ready, give it a moment before the next probe */
+            vTaskDelay(pdMS_TO_TICKS(100));
         }
     }
-    return err;
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Wait for network registration, querying once in case it happened before +CREG URCs were enabled
+ *
+ * @param sim800_dce sim800 object
+ * @return esp_err_t
+ *      - ESP_OK when registered (home or roaming)
+ *      - ESP_ERR_TIMEOUT otherwise
+ */
+static esp_err_t sim800_wait_registered(sim800_modem_dce_t *sim800_dce)
+{
+    uint32_t stat = 0, mode = 0;
+    esp_modem_dce_get_network_status(&(sim800_dce->parent), &mode, &stat);
+    if (stat == 1 || stat == 5)
+    {
+        sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_REGISTERED);
+        return ESP_OK;
+    }
+    EventBits_t bits = xEventGroupWaitBits(sim800_dce->identity.events, SIM800_BOOT_REGISTERED_BIT, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(CONFIG_EXAMPLE_MODEM_REGISTRATION_TIMEOUT));
+    return (bits & SIM800_BOOT_REGISTERED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
 }
 
 /**
- * @brief Handle response from AT+CIMI
+ * @brief Rates accepted by AT+IPR above the autobaud range, in increasing order
+ *
+ */
+static const uint32_t sim800_baud_rates[] = {115200, 230400, 460800};
+
+/**
+ * @brief Result of a baud rate probe
+ *
+ */
+typedef struct {
+    char line[MODEM_IMEI_LENGTH + 1]; /*!< Response of the last round trip */
+    uint32_t bytes;                   /*!< Bytes received */
+} sim800_baud_probe_t;
+
+/**
+ * @brief Handle response from AT+CGSN during a baud rate probe
  */
-static esp_err_t sim800_handle_cimi(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_handle_baud_probe(modem_dce_t *dce, const char *line)
 {
     esp_err_t err = ESP_FAIL;
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    sim800_baud_probe_t *probe = sim800_dce->parent.priv_resource;
+    probe->bytes += strlen(line);
     if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
     {
         err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
@@ -466,442 +838,676 @@ static esp_err_t sim800_handle_cimi(modem_dce_t *dce, const char *line)
     {
         err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
     }
+    else if (esp_modem_parse(&esp_modem_format_imei, line, probe->line, NULL) == ESP_OK)
+    {
+        err = ESP_OK;
+    }
     else
     {
-        int len = snprintf(dce->imsi, MODEM_IMSI_LENGTH + 1, "%s", line);
-        if (len > 2)
+        /* A garbled line must not compare equal to the reference */
+        probe->line[0] = '\0';
+    }
+    return err;
+}
+
+/**
+ * @brief Check the link by reading the IMEI back repeatedly
+ *
+ * The first round trip gives the reference, every other one must match it byte for byte.
+ *
+ * @param sim800_dce sim800 object
+ * @param reference expected IMEI, or empty to take it from the first round trip
+ * @param throughput set to the effective throughput in bit/s
+ * @return esp_err_t
+ *      - ESP_OK if every round trip matched
+ *      - ESP_FAIL on error
+ */
+static esp_err_t sim800_probe_link(sim800_modem_dce_t *sim800_dce, char *reference, uint32_t *throughput)
+{
+    static const char command[] = "AT+CGSN\r";
+    sim800_baud_probe_t probe = {0};
+    uint32_t sent = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < SIM800_BAUD_PROBE_ROUNDS; i++)
+    {
+        probe.line[0] = '\0';
+        DCE_CHECK(esp_modem_dce_command(&(sim800_dce->parent), command, MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                        sim800_handle_baud_probe, &probe) == ESP_OK, "probe failed", err);
+        if (!reference[0])
         {
-            /* Strip "\r\n" */
-            strip_cr_lf_tail(dce->imsi, len);
-            err = ESP_OK;
+            strcpy(reference, probe.line);
         }
+        DCE_CHECK(!strcmp(reference, probe.line), "probe response corrupted", err);
+        sent += strlen(command);
     }
-    return err;
+    int64_t elapsed = esp_timer_get_time() - start;
+    /* 10 bits per byte on the wire with 8N1 */
+    *throughput = elapsed > 0 ? (uint32_t)((sent + probe.bytes) * 10 * 1000000LL / elapsed) : 0;
+    return ESP_OK;
+err:
+    return ESP_FAIL;
 }
 
 /**
- * @brief Handle response from AT+CREG?
+ * @brief Move both ends of the link to a new baud rate
+ *
+ * @param sim800_dce sim800 object
+ * @param baud_rate new baud rate
+ * @return esp_err_t
+ *      - ESP_OK on success
+ *      - ESP_FAIL if the modem refused the rate, both ends are then unchanged
  */
-static esp_err_t sim800_handle_creg(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_switch_baud(sim800_modem_dce_t *sim800_dce, uint32_t baud_rate)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
+    modem_dte_t *dte = sim800_dce->parent.dte;
+    char command[32];
+    snprintf(command, sizeof(command), "+IPR=%d", baud_rate);
+    /* The OK still comes at the old rate */
+    DCE_CHECK(sim800_at(&(sim800_dce->parent), command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "set modem baud rate failed", err);
+    vTaskDelay(pdMS_TO_TICKS(SIM800_BAUD_SETTLE_MS));
+    return dte->set_baud_rate(dte, baud_rate);
+err:
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Try a baud rate, going back to the current one if the link does not hold
+ *
+ * @param sim800_dce sim800 object
+ * @param baud_rate baud rate to try
+ * @param reference expected probe response
+ * @return esp_err_t
+ *      - ESP_OK if the link works at the new rate
+ *      - ESP_FAIL if it was rolled back
+ *      - ESP_ERR_INVALID_STATE if the link could not be restored either
+ */
+static esp_err_t sim800_try_baud(sim800_modem_dce_t *sim800_dce, uint32_t baud_rate, char *reference)
+{
+    modem_dte_t *dte = sim800_dce->parent.dte;
+    uint32_t previous = dte->baud_rate;
+    uint32_t throughput = 0;
+
+    if (sim800_switch_baud(sim800_dce, baud_rate) != ESP_OK)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
+        return ESP_FAIL;
     }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    if (sim800_probe_link(sim800_dce, reference, &throughput) == ESP_OK)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+        ESP_LOGI(DCE_TAG, "%d baud: link ok, %d bit/s effective", baud_rate, throughput);
+        return ESP_OK;
+    }
+    ESP_LOGW(DCE_TAG, "%d baud: link unreliable, back to %d", baud_rate, previous);
+    /* Ask at the new rate first, the modem may still understand a short command */
+    if (sim800_switch_baud(sim800_dce, previous) != ESP_OK)
+    {
+        dte->set_baud_rate(dte, previous);
     }
-    else if (!strncmp(line, "+CREG", strlen("+CREG")))
+    if (esp_modem_dce_sync(&(sim800_dce->parent)) != ESP_OK)
     {
-        sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-        /* +CREG: <n>,<stat> */
-        uint32_t **resource = sim800_dce->priv_resource;
-        if(strlen(line)>10)
+        ESP_LOGE(DCE_TAG, "link lost, power cycle the modem to get back to autobaud");
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_FAIL;
+}
+
+static esp_err_t sim800_negotiate_baud_locked(modem_dce_t *dce, uint32_t max_baud_rate)
+{
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    DCE_CHECK(dce->mode == MODEM_COMMAND_MODE, "baud rate can only change in command mode", err);
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    modem_dte_t *dte = dce->dte;
+    char reference[MODEM_IMEI_LENGTH + 1] = "";
+    uint32_t throughput = 0;
+
+    /* Baseline at the rate that is known to work */
+    DCE_CHECK(sim800_probe_link(sim800_dce, reference, &throughput) == ESP_OK, "link check failed", err);
+    ESP_LOGI(DCE_TAG, "%d baud: link ok, %d bit/s effective", dte->baud_rate, throughput);
+
+    for (int i = 0; i < sizeof(sim800_baud_rates) / sizeof(sim800_baud_rates[0]); i++)
+    {
+        uint32_t baud_rate = sim800_baud_rates[i];
+        if (baud_rate <= dte->baud_rate || baud_rate > max_baud_rate)
         {
-            sscanf(line, "%*s%d,%d%*s", resource[0], resource[1]);
+            continue;
         }
-        else // The URC switches mode with stat !!!
+        esp_err_t ret = sim800_try_baud(sim800_dce, baud_rate, reference);
+        if (ret == ESP_ERR_INVALID_STATE)
         {
-           sscanf(line, "%*s%d", resource[1]);
-           printf("\033[1m%s\033[0m", line); 
+            esp_modem_nvs_erase(sim800_dce->config.instance, SIM800_NVS_KEY_BAUD);
+            return ESP_FAIL;
+        }
+        if (ret != ESP_OK)
+        {
+            break;
         }
-        err = ESP_OK;
     }
-    return err;
+    esp_modem_nvs_set_u32(sim800_dce->config.instance, SIM800_NVS_KEY_BAUD, dte->baud_rate);
+    ESP_LOGI(DCE_TAG, "baud rate negotiated: %d", dte->baud_rate);
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t sim800_negotiate_baud(modem_dce_t *dce, uint32_t max_baud_rate)
+{
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    esp_err_t ret = sim800_negotiate_baud_locked(dce, max_baud_rate);
+    esp_modem_arbiter_release(dce->arbiter);
+    return ret;
+err:
+    return ESP_FAIL;
+}
+
+static esp_err_t sim800_set_baud_locked(modem_dce_t *dce, uint32_t baud_rate)
+{
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    DCE_CHECK(dce->mode == MODEM_COMMAND_MODE, "baud rate can only change in command mode", err);
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    char reference[MODEM_IMEI_LENGTH + 1] = "";
+    uint32_t throughput = 0;
+
+    if (baud_rate == dce->dte->baud_rate)
+    {
+        return ESP_OK;
+    }
+    DCE_CHECK(sim800_probe_link(sim800_dce, reference, &throughput) == ESP_OK, "link check failed", err);
+    DCE_CHECK(sim800_try_baud(sim800_dce, baud_rate, reference) == ESP_OK, "baud rate not usable", err);
+    esp_modem_nvs_set_u32(sim800_dce->config.instance, SIM800_NVS_KEY_BAUD, baud_rate);
+    return ESP_OK;
+err:
+    return ESP_FAIL;
+}
+
+esp_err_t sim800_set_baud(modem_dce_t *dce, uint32_t baud_rate)
+{
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    esp_err_t ret = sim800_set_baud_locked(dce, baud_rate);
+    esp_modem_arbiter_release(dce->arbiter);
+    return ret;
+err:
+    return ESP_FAIL;
 }
 
 /**
- * @brief Handle response from AT+COPS?
+ * @brief Go straight to the rate negotiated on a previous start, renegotiating if it no longer works
  */
-static esp_err_t sim800_handle_cops(modem_dce_t *dce, const char *line)
+static void sim800_restore_baud(sim800_modem_dce_t *sim800_dce)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
+    uint32_t baud_rate = 0;
+    modem_dte_t *dte = sim800_dce->parent.dte;
+    if (esp_modem_nvs_get_u32(sim800_dce->config.instance, SIM800_NVS_KEY_BAUD, &baud_rate) != ESP_OK)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
+        sim800_negotiate_baud(&(sim800_dce->parent), CONFIG_EXAMPLE_MODEM_BAUD_RATE_MAX);
     }
-    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    else if (baud_rate > CONFIG_EXAMPLE_MODEM_BAUD_RATE_MAX || baud_rate == dte->baud_rate)
     {
-        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+        return;
     }
-    else if (!strncmp(line, "+COPS", strlen("+COPS")))
-    {
-        /* there might be some random spaces in operator's name, we can not use sscanf to parse the result */
-        /* strtok will break the string, we need to create a copy */
-        size_t len = strlen(line);
-        char *line_copy = malloc(len + 1);
-        strcpy(line_copy, line);
-        /* +COPS: <mode>[, <format>[, <oper>]] */
-        char *str_ptr = NULL;
-        char *p[3];
-        uint8_t i = 0;
-        /* strtok will broke string by replacing delimiter with '\0' */
-        p[i] = strtok_r(line_copy, ",", &str_ptr);
-        while (p[i])
-        {
-            p[++i] = strtok_r(NULL, ",", &str_ptr);
-        }
-        if (i >= 3)
-        {
-            int len = snprintf(dce->oper, MODEM_MAX_OPERATOR_LENGTH, "%s", p[2]);
-            if (len > 2)
-            {
-                /* Strip "\r\n" */
-                strip_cr_lf_tail(dce->oper, len);
-                err = ESP_OK;
-            }
-        }
-        free(line_copy);
+    else if (sim800_set_baud(&(sim800_dce->parent), baud_rate) != ESP_OK)
+    {
+        sim800_negotiate_baud(&(sim800_dce->parent), CONFIG_EXAMPLE_MODEM_BAUD_RATE_MAX);
     }
-    return err;
 }
 
 /**
- * @brief Handle response from AT+CPOWD=1
+ * @brief Handle response from AT+CLAC during a soak test, counting what arrives
  */
-static esp_err_t sim800_handle_power_down(modem_dce_t *dce, const char *line)
+static esp_err_t sim800_handle_soak(modem_dce_t *dce, const char *line)
 {
-    esp_err_t err = ESP_FAIL;
-    if (strstr(line, MODEM_RESULT_CODE_POWERDOWN))
+    esp_err_t err = ESP_OK;
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    uint32_t *bytes = sim800_dce->parent.priv_resource;
+    if (!strncmp(line, MODEM_RESULT_CODE_SUCCESS, strlen(MODEM_RESULT_CODE_SUCCESS)))
     {
         err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
     }
+    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+    }
+    else
+    {
+        *bytes += strlen(line);
+    }
     return err;
 }
 
-/**
- * @brief Get signal quality
- *
- * @param dce Modem DCE object
- * @param rssi received signal strength indication
- * @param ber bit error ratio
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t sim800_get_signal_quality(modem_dce_t *dce, uint32_t *rssi, uint32_t *ber)
+static esp_err_t sim800_soak_test_locked(modem_dce_t *dce, uint32_t rounds, sim800_soak_result_t *result)
 {
+    DCE_CHECK(dce && result, "invalid argument", err);
     modem_dte_t *dte = dce->dte;
-    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-    uint32_t *resource[2] = {rssi, ber};
-    sim800_dce->priv_resource = resource;
-    dce->handle_line = sim800_handle_csq;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CSQ\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "inquire signal quality failed", err);
-    ESP_LOGD(DCE_TAG, "inquire signal quality ok");
-    return ESP_OK;
+    esp_modem_uart_stats_t before, after;
+    uint32_t bytes = 0;
+    int64_t start = esp_timer_get_time();
+
+    memset(result, 0, sizeof(*result));
+    esp_modem_get_uart_stats(dte, &before);
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        bytes = 0;
+        /* AT+CLAC lists every command, a few kB in one burst */
+        if (esp_modem_dce_command(dce, "AT+CLAC\r", MODEM_COMMAND_TIMEOUT_MODE_CHANGE, sim800_handle_soak, &bytes) != ESP_OK)
+        {
+            result->failed++;
+            continue;
+        }
+        /* Every round must bring exactly as many bytes as the first complete one */
+        if (!result->expected)
+            result->expected = bytes;
+        else if (bytes != result->expected)
+            result->mismatched++;
+        result->bytes += bytes;
+        result->rounds++;
+    }
+    esp_modem_get_uart_stats(dte, &after);
+    result->elapsed_ms = (esp_timer_get_time() - start) / 1000;
+    result->overruns = (after.fifo_overflows - before.fifo_overflows) +
+                       (after.pattern_overflows - before.pattern_overflows);
+    result->bytes_dropped = after.bytes_dropped - before.bytes_dropped;
+    return (result->failed || result->mismatched || result->bytes_dropped) ? ESP_FAIL : ESP_OK;
 err:
     return ESP_FAIL;
 }
 
-/**
- * @brief Get battery status
- *
- * @param dce Modem DCE object
- * @param bcs Battery charge status
- * @param bcl Battery connection level
- * @param voltage Battery voltage
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
- */
-static esp_err_t sim800_get_battery_status(modem_dce_t *dce, uint32_t *bcs, uint32_t *bcl, uint32_t *voltage)
+esp_err_t sim800_soak_test(modem_dce_t *dce, uint32_t rounds, sim800_soak_result_t *result)
 {
-    modem_dte_t *dte = dce->dte;
-    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-    uint32_t *resource[3] = {bcs, bcl, voltage};
-    sim800_dce->priv_resource = resource;
-    dce->handle_line = sim800_handle_cbc;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CBC\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "inquire battery status failed", err);
-    ESP_LOGD(DCE_TAG, "inquire battery status ok");
-    return ESP_OK;
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_NORMAL, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    esp_err_t ret = sim800_soak_test_locked(dce, rounds, result);
+    esp_modem_arbiter_release(dce->arbiter);
+    return ret;
 err:
     return ESP_FAIL;
 }
 
 /**
- * @brief Set Working Mode
- *
- * @param dce Modem DCE object
- * @param mode woking mode
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
+ * @brief Handle response from AT+CCID
  */
-static esp_err_t sim800_set_working_mode(modem_dce_t *dce, modem_mode_t mode)
+static esp_err_t sim800_handle_ccid(modem_dce_t *dce, const char *line)
 {
-    modem_dte_t *dte = dce->dte;
-    switch (mode)
-    {
-    case MODEM_COMMAND_MODE:
-        dce->handle_line = sim800_handle_exit_data_mode;
-        DCE_CHECK(dte->send_cmd(dte, "+++", MODEM_COMMAND_TIMEOUT_MODE_CHANGE) == ESP_OK, "send command failed", err);
-        DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "enter command mode failed", err);
-        ESP_LOGD(DCE_TAG, "enter command mode ok");
-        dce->mode = MODEM_COMMAND_MODE;
-        break;
-    case MODEM_PPP_MODE:
-        dce->handle_line = sim800_handle_atd_ppp;
-        DCE_CHECK(dte->send_cmd(dte, "ATD*99#\r", MODEM_COMMAND_TIMEOUT_MODE_CHANGE) == ESP_OK, "send command failed", err);
-        DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "enter ppp mode failed", err);
-        ESP_LOGD(DCE_TAG, "enter ppp mode ok");
-        dce->mode = MODEM_PPP_MODE;
-        break;
-    default:
-        ESP_LOGW(DCE_TAG, "unsupported working mode: %d", mode);
-        goto err;
-        break;
+    esp_err_t err = ESP_FAIL;
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    if (strstr(line, MODEM_RESULT_CODE_SUCCESS))
+    {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_SUCCESS);
     }
-    return ESP_OK;
-err:
-    return ESP_FAIL;
+    else if (strstr(line, MODEM_RESULT_CODE_ERROR))
+    {
+        err = esp_modem_process_command_done(dce, MODEM_STATE_FAIL);
+    }
+    else if (esp_modem_parse(&sim800_format_iccid, line, sim800_dce->parent.priv_resource, NULL) == ESP_OK)
+    {
+        err = ESP_OK;
+    }
+    return err;
 }
 
 /**
- * @brief Power down
+ * @brief Get SIM card ICCID
  *
  * @param sim800_dce sim800 object
+ * @param iccid buffer of SIM800_ICCID_LENGTH + 1 bytes
  * @return esp_err_t
  *      - ESP_OK on success
  *      - ESP_FAIL on error
  */
-static esp_err_t sim800_power_down(modem_dce_t *dce)
+static esp_err_t sim800_get_iccid(sim800_modem_dce_t *sim800_dce, char *iccid)
 {
-    modem_dte_t *dte = dce->dte;
-    dce->handle_line = sim800_handle_power_down;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CPOWD=1\r", MODEM_COMMAND_TIMEOUT_POWEROFF) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "power down failed", err);
-    ESP_LOGD(DCE_TAG, "power down ok");
+    DCE_CHECK(esp_modem_dce_command(&(sim800_dce->parent), "AT+CCID\r", MODEM_COMMAND_TIMEOUT_DEFAULT,
+                                    sim800_handle_ccid, iccid) == ESP_OK, "get iccid failed", err);
+    ESP_LOGD(DCE_TAG, "get iccid ok");
     return ESP_OK;
 err:
     return ESP_FAIL;
 }
 
 /**
- * @brief Get DCE module name
- *
- * @param sim800_dce sim800 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
+ * @brief Serve the identity from NVS until the modem has been queried
  */
-static esp_err_t sim800_get_module_name(sim800_modem_dce_t *sim800_dce)
+static void sim800_load_identity(sim800_modem_dce_t *sim800_dce)
 {
-    modem_dte_t *dte = sim800_dce->parent.dte;
-    sim800_dce->parent.handle_line = sim800_handle_cgmm;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CGMM\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(sim800_dce->parent.state == MODEM_STATE_SUCCESS, "get module name failed", err);
-    ESP_LOGD(DCE_TAG, "get module name ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
+    modem_dce_t *dce = &(sim800_dce->parent);
+    esp_modem_nvs_get_str(sim800_dce->config.instance, SIM800_NVS_KEY_NAME, dce->name, sizeof(dce->name));
+    esp_modem_nvs_get_str(sim800_dce->config.instance, SIM800_NVS_KEY_IMEI, dce->imei, sizeof(dce->imei));
+    esp_modem_nvs_get_str(sim800_dce->config.instance, SIM800_NVS_KEY_IMSI, dce->imsi, sizeof(dce->imsi));
+    esp_modem_nvs_get_str(sim800_dce->config.instance, SIM800_NVS_KEY_OPERATOR, dce->oper, sizeof(dce->oper));
+    esp_modem_nvs_get_str(sim800_dce->config.instance, SIM800_NVS_KEY_ICCID, sim800_dce->iccid, sizeof(sim800_dce->iccid));
 }
 
 /**
- * @brief Get DCE module IMEI number
+ * @brief Query the modem identity and persist whatever changed
+ */
+static void sim800_refresh_identity_now(sim800_modem_dce_t *sim800_dce)
+{
+    modem_dce_t *dce = &(sim800_dce->parent);
+    char iccid[SIM800_ICCID_LENGTH + 1] = "";
+
+    if (sim800_get_iccid(sim800_dce, iccid) == ESP_OK && strcmp(iccid, sim800_dce->iccid))
+    {
+        if (!sim800_dce->iccid[0])
+        {
+            /* Nothing stored yet, whatever is cached came with this SIM */
+            ESP_LOGI(DCE_TAG, "SIM first seen (%s)", iccid);
+        }
+        else
+        {
+            ESP_LOGI(DCE_TAG, "SIM changed (%s), dropping cached IMSI and operator", iccid);
+            dce->imsi[0] = '\0';
+            dce->oper[0] = '\0';
+            esp_modem_nvs_erase(sim800_dce->config.instance, SIM800_NVS_KEY_IMSI);
+            esp_modem_nvs_erase(sim800_dce->config.instance, SIM800_NVS_KEY_OPERATOR);
+        }
+        strcpy(sim800_dce->iccid, iccid);
+        esp_modem_nvs_set_str(sim800_dce->config.instance, SIM800_NVS_KEY_ICCID, iccid);
+    }
+    if (esp_modem_dce_get_module_name(dce) == ESP_OK)
+        esp_modem_nvs_set_str(sim800_dce->config.instance, SIM800_NVS_KEY_NAME, dce->name);
+    if (esp_modem_dce_get_imei_number(dce) == ESP_OK)
+        esp_modem_nvs_set_str(sim800_dce->config.instance, SIM800_NVS_KEY_IMEI, dce->imei);
+    if (esp_modem_dce_get_imsi_number(dce) == ESP_OK)
+        esp_modem_nvs_set_str(sim800_dce->config.instance, SIM800_NVS_KEY_IMSI, dce->imsi);
+    else
+        ESP_LOGW(DCE_TAG, "get imsi failed. Check SIM Card.");
+}
+
+/**
+ * @brief Take a modem that just booted to where sim800_init() leaves it
  *
  * @param sim800_dce sim800 object
  * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
+ *      - ESP_OK on success, registered or not
+ *      - ESP_FAIL if the modem did not answer
  */
-static esp_err_t sim800_get_imei_number(sim800_modem_dce_t *sim800_dce)
+static esp_err_t sim800_bring_up(sim800_modem_dce_t *sim800_dce)
 {
-    modem_dte_t *dte = sim800_dce->parent.dte;
-    sim800_dce->parent.handle_line = sim800_handle_cgsn;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CGSN\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(sim800_dce->parent.state == MODEM_STATE_SUCCESS, "get imei number failed", err);
-    ESP_LOGD(DCE_TAG, "get imei number ok");
+    /* Sync between DTE and DCE as soon as the modem is up */
+    DCE_CHECK(sim800_wait_ready(sim800_dce) == ESP_OK, "sync failed", err);
+
+    /* Close echo */
+    DCE_CHECK(esp_modem_dce_echo(&(sim800_dce->parent), false) == ESP_OK, "close echo mode failed", err);
+
+    /* Initialize modem, skipping the stored profile if it is already in place */
+    sim800_configure(&(sim800_dce->parent), false);
+    sim800_boot_mark(sim800_dce->config.instance, SIM800_BOOT_PHASE_CONFIGURED);
+
+    /* The modem autobauds at the DTE default rate, step up before anything heavy goes over the link */
+    sim800_restore_baud(sim800_dce);
+
+    if (sim800_wait_registered(sim800_dce) != ESP_OK)
+        ESP_LOGW(DCE_TAG, "not registered after %d ms, continuing", CONFIG_EXAMPLE_MODEM_REGISTRATION_TIMEOUT);
     return ESP_OK;
 err:
     return ESP_FAIL;
 }
 
 /**
- * @brief Get DCE module IMSI number
- *
- * @param sim800_dce sim800 object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on error
+ * @brief Forget the boot URCs of the last start and go back to the autobaud rate
  */
-static esp_err_t sim800_get_imsi_number(sim800_modem_dce_t *sim800_dce)
+static void sim800_reboot_prepare(sim800_modem_dce_t *sim800_dce)
 {
     modem_dte_t *dte = sim800_dce->parent.dte;
-    sim800_dce->parent.handle_line = sim800_handle_cimi;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CIMI\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(sim800_dce->parent.state == MODEM_STATE_SUCCESS, "get imsi number failed", err);
-    ESP_LOGD(DCE_TAG, "get imsi number ok");
-    return ESP_OK;
-err:
-    return ESP_FAIL;
+    xEventGroupClearBits(sim800_dce->identity.events, SIM800_BOOT_RDY_BIT | SIM800_BOOT_CALL_READY_BIT |
+                                                          SIM800_BOOT_REGISTERED_BIT);
+    if (dte->baud_rate != sim800_dce->boot_baud_rate)
+    {
+        dte->set_baud_rate(dte, sim800_dce->boot_baud_rate);
+    }
 }
 
 /**
- * @brief Get Network
+ * @brief Pulse the reset pin, then bring the modem up again
  *
  * @param dce Modem DCE object
- * @param rssi received signal strength indication
- * @param ber bit error ratio
  * @return esp_err_t
  *      - ESP_OK on success
- *      - ESP_FAIL on error
+ *      - ESP_FAIL if the modem did not come back
  */
-static esp_err_t sim800_get_network_status(modem_dce_t *dce, uint32_t *mode, uint32_t *stat)
+static esp_err_t sim800_hard_reset(modem_dce_t *dce)
 {
-    modem_dte_t *dte = dce->dte;
     sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-    uint32_t *ret[] = {mode, stat};
-    sim800_dce->priv_resource = ret;
-    dce->handle_line = sim800_handle_creg;
-    DCE_CHECK(dte->send_cmd(dte, "AT+CREG?\r", MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_OK, "send command failed", err);
-    DCE_CHECK(dce->state == MODEM_STATE_SUCCESS, "Network Registration failed", err);
-    ESP_LOGD(DCE_TAG, "inquire signal quality ok");
-    return ESP_OK;
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    ESP_LOGW(DCE_TAG, "Reset modem %d ...", sim800_dce->config.instance);
+    sim800_reboot_prepare(sim800_dce);
+    clear_sim800_rst(&sim800_dce->config);
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_EXAMPLE_MODEM_RST_PULSE_MS));
+    set_sim800_rst(&sim800_dce->config);
+    sim800_boot_restart(sim800_dce->config.instance);
+    esp_err_t ret = sim800_bring_up(sim800_dce);
+    esp_modem_arbiter_release(dce->arbiter);
+    return ret;
 err:
-
     return ESP_FAIL;
 }
 
 /**
- * @brief Get Operator's name
+ * @brief Switch the supply off and on, then bring the modem up again
  *
- * @param sim800_dce sim800 object
+ * @param dce Modem DCE object
  * @return esp_err_t
  *      - ESP_OK on success
- *      - ESP_FAIL on error
+ *      - ESP_FAIL if the modem did not come back
  */
-static esp_err_t sim800_get_operator_name(sim800_modem_dce_t *sim800_dce)
+static esp_err_t sim800_power_cycle(modem_dce_t *dce)
 {
-    modem_dte_t *dte = sim800_dce->parent.dte;
-    sim800_dce->parent.handle_line = sim800_handle_cops;
-    DCE_CHECK(dte->send_cmd(dte, "AT+COPS?\r", MODEM_COMMAND_TIMEOUT_OPERATOR) == ESP_OK, "send command failed", err);
-    DCE_CHECK(sim800_dce->parent.state == MODEM_STATE_SUCCESS, "get network operator failed", err);
-    ESP_LOGD(DCE_TAG, "get network operator ok");
-    return ESP_OK;
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    DCE_CHECK(esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_RECOVERY, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) == ESP_OK,
+              "command channel busy", err);
+    sim800_reboot_prepare(sim800_dce);
+    sim800_power_off(&sim800_dce->config);
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_EXAMPLE_MODEM_POWER_OFF_MS));
+    sim800_power_on(&sim800_dce->config);
+    esp_err_t ret = sim800_bring_up(sim800_dce);
+    esp_modem_arbiter_release(dce->arbiter);
+    return ret;
 err:
     return ESP_FAIL;
 }
 
 /**
- * @brief Deinitialize SIM800 object
+ * @brief Keep the cached identity fresh without blocking the startup path
  *
- * @param dce Modem DCE object
- * @return esp_err_t
- *      - ESP_OK on success
- *      - ESP_FAIL on fail
+ * @param param sim800 object
  */
-static esp_err_t sim800_deinit(modem_dce_t *dce)
+static void sim800_identity_task_entry(void *param)
 {
-    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
-    if (dce->dte)
+    sim800_modem_dce_t *sim800_dce = (sim800_modem_dce_t *)param;
+    modem_dce_t *dce = &(sim800_dce->parent);
+    const EventBits_t wait_bits = SIM800_IDENTITY_REFRESH_BIT | SIM800_IDENTITY_OPERATOR_BIT | ESP_MODEM_EXT_TASK_STOP_BIT;
+    EventBits_t pending = 0;
+
+    while (1)
     {
-        dce->dte->dce = NULL;
+        /* A request put off is retried until the modem is back in command mode */
+        TickType_t ticks = pending ? pdMS_TO_TICKS(SIM800_IDENTITY_RETRY_MS) : portMAX_DELAY;
+        EventBits_t bits = xEventGroupWaitBits(sim800_dce->identity.events, wait_bits, pdTRUE, pdFALSE, ticks);
+        if (bits & ESP_MODEM_EXT_TASK_STOP_BIT)
+        {
+            break;
+        }
+        pending |= bits & (SIM800_IDENTITY_REFRESH_BIT | SIM800_IDENTITY_OPERATOR_BIT);
+        /* ICCID and IMSI need the SIM: wait for "Call Ready", which a modem that was already up never sends */
+        if ((pending & SIM800_IDENTITY_REFRESH_BIT) && !(bits & SIM800_BOOT_CALL_READY_BIT))
+        {
+            bits = xEventGroupWaitBits(sim800_dce->identity.events, SIM800_BOOT_CALL_READY_BIT | ESP_MODEM_EXT_TASK_STOP_BIT,
+                                       pdFALSE, pdFALSE, pdMS_TO_TICKS(SIM800_CALL_READY_TIMEOUT_MS));
+            if (bits & ESP_MODEM_EXT_TASK_STOP_BIT)
+            {
+                break;
+            }
+            if (!(bits & SIM800_BOOT_CALL_READY_BIT))
+            {
+                ESP_LOGW(DCE_TAG, "no Call Ready after %d ms, querying the SIM anyway", SIM800_CALL_READY_TIMEOUT_MS);
+                xEventGroupSetBits(sim800_dce->identity.events, SIM800_BOOT_CALL_READY_BIT);
+            }
+        }
+        /* Nothing can be asked while the modem is carrying PPP */
+        if (!pending || dce->mode != MODEM_COMMAND_MODE)
+        {
+            continue;
+        }
+        /* Console and recovery commands go first, the refresh waits for a free channel */
+        if (esp_modem_arbiter_acquire(dce->arbiter, ESP_MODEM_PRIORITY_BACKGROUND, CONFIG_EXAMPLE_MODEM_ARBITER_TIMEOUT) != ESP_OK)
+        {
+            continue;
+        }
+        bits = pending;
+        pending = 0;
+        if (bits & SIM800_IDENTITY_REFRESH_BIT)
+        {
+            sim800_refresh_identity_now(sim800_dce);
+        }
+        /* An operator URC already updated dce->oper, otherwise ask for it */
+        if ((bits & SIM800_IDENTITY_REFRESH_BIT) || !dce->oper[0])
+        {
+            esp_modem_dce_get_operator_name(dce);
+        }
+        esp_modem_arbiter_release(dce->arbiter);
+        if (dce->oper[0])
+        {
+            esp_modem_nvs_set_str(sim800_dce->config.instance, SIM800_NVS_KEY_OPERATOR, dce->oper);
+        }
     }
-    free(sim800_dce);
+    esp_modem_ext_task_exit(&sim800_dce->identity);
+}
+
+bool sim800_is_registered(modem_dce_t *dce)
+{
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    return xEventGroupGetBits(sim800_dce->identity.events) & SIM800_BOOT_REGISTERED_BIT;
+}
+
+esp_err_t sim800_refresh_identity(modem_dce_t *dce)
+{
+    DCE_CHECK(dce, "Data Communication Equipment is not Connected to Data Terminal", err);
+    sim800_modem_dce_t *sim800_dce = __containerof(dce, sim800_modem_dce_t, parent);
+    xEventGroupSetBits(sim800_dce->identity.events, SIM800_IDENTITY_REFRESH_BIT);
     return ESP_OK;
+err:
+    return ESP_FAIL;
 }
 
-modem_dce_t *sim800_init(modem_dte_t *dte)
+modem_dce_t *sim800_init(modem_dte_t *dte, const sim800_config_t *config)
 {
     DCE_CHECK(dte, "DCE should bind with a DTE", err);
+    DCE_CHECK(config && config->instance < CONFIG_EXAMPLE_MODEM_INSTANCES, "invalid modem config", err);
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    sim800_storage_t *storage = esp_modem_static_calloc(&s_dce_pool);
+    DCE_CHECK(storage, "no static slot for sim800_dce", err);
+    sim800_modem_dce_t *sim800_dce = &storage->dce;
+#else
     /* malloc memory for sim800_dce object */
     sim800_modem_dce_t *sim800_dce = calloc(1, sizeof(sim800_modem_dce_t));
     DCE_CHECK(sim800_dce, "calloc sim800_dce failed", err);
+#endif
+    sim800_dce->config = *config;
     /* Bind DTE with DCE */
     sim800_dce->parent.dte = dte;
     dte->dce = &(sim800_dce->parent);
     /* Bind methods */
+    DCE_CHECK(esp_modem_dce_bind(&(sim800_dce->parent), &sim800_model) == ESP_OK, "bind sim800 model failed", err_io);
     sim800_dce->parent.handle_line = sim800_handle_response_default;
-    sim800_dce->parent.sync = esp_modem_dce_sync;
-    sim800_dce->parent.echo_mode = esp_modem_dce_echo;
-    sim800_dce->parent.store_profile = esp_modem_dce_store_profile;
-    sim800_dce->parent.set_flow_ctrl = esp_modem_dce_set_flow_ctrl;
-    sim800_dce->parent.define_pdp_context = esp_modem_dce_define_pdp_context;
-    sim800_dce->parent.hang_up = esp_modem_dce_hang_up;
-    sim800_dce->parent.get_signal_quality = sim800_get_signal_quality;
-    sim800_dce->parent.get_battery_status = sim800_get_battery_status;
-    sim800_dce->parent.set_working_mode = sim800_set_working_mode;
-    sim800_dce->parent.power_down = sim800_power_down;
     sim800_dce->parent.deinit = sim800_deinit;
     sim800_dce->parent.handle_line_default = sim800_handle_response_default;
-    
-sync:
-    /* Sync between DTE and DCE */
-    vTaskDelay(500);
-    DCE_CHECK(esp_modem_dce_sync(&(sim800_dce->parent)) == ESP_OK, "sync failed", sync);
+    sim800_dce->parent.handle_urc = sim800_handle_urc;
+    sim800_dce->parent.hard_reset = sim800_hard_reset;
+    sim800_dce->parent.power_cycle = sim800_power_cycle;
+    DCE_CHECK(esp_modem_ext_task_init(&sim800_dce->identity) == ESP_OK, "create boot event group failed", err_io);
+    sim800_load_identity(sim800_dce);
 
-    /* Close echo */
-    DCE_CHECK(esp_modem_dce_echo(&(sim800_dce->parent), false) == ESP_OK, "close echo mode failed", err_io);
-
-    /* Initialize modem. */
-    static const char *const init_strings[] = {
-        "+IPR=0",
-        "+CMEE = 2",
-        "+CMER=2,0,0,2,1",
-        "+CLTS=1",
-        "+IFC=0,0",
-        "Q0",
-        "&W",
-        "+CFUN=1",
-        NULL};
-
-    for (const char *const *command = init_strings; *command; command++)
-    {
-        if (sim800_at(&(sim800_dce->parent), *command, MODEM_COMMAND_TIMEOUT_DEFAULT) == ESP_FAIL)
-            printf("Setup AT commands failed: %s\n", *command);
-    }
+    sim800_dce->boot_baud_rate = dte->baud_rate;
+    DCE_CHECK(sim800_bring_up(sim800_dce) == ESP_OK, "bring up failed", err_io);
 
-    uint32_t stat = 0, mode = 0;
-    int attempts = 0;
-    while (stat != 1 && attempts++ < 5)
-    {
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-        sim800_get_network_status(&(sim800_dce->parent), &mode,&stat);
-    }
-
-    /* Get Module name */
-    DCE_CHECK(sim800_get_module_name(sim800_dce) == ESP_OK, "get module name failed", err_io);
-    /* Get IMEI number */
-    DCE_CHECK(sim800_get_imei_number(sim800_dce) == ESP_OK, "get imei failed", err_io);
-    /* Get IMSI number */
-    DCE_CHECK(sim800_get_imsi_number(sim800_dce) == ESP_OK, "get imsi failed. Check SIM Card.", err_io);
-    /* Get operator name */
-    DCE_CHECK(sim800_get_operator_name(sim800_dce) == ESP_OK, "get operator name failed", err_io);
+    /* Module name, IMEI, IMSI and operator are served from NVS and refreshed in the background */
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    StackType_t *stack = storage->identity_stack;
+#else
+    StackType_t *stack = NULL;
+#endif
+    DCE_CHECK(esp_modem_ext_task_start(&sim800_dce->identity, sim800_identity_task_entry, "sim800_id",
+                                       SIM800_IDENTITY_TASK_STACK_SIZE, SIM800_IDENTITY_TASK_PRIORITY, sim800_dce,
+                                       stack) == ESP_OK, "create identity task failed", err_io);
+    xEventGroupSetBits(sim800_dce->identity.events, SIM800_IDENTITY_REFRESH_BIT);
 
     return &(sim800_dce->parent);
 err_io:
+    dte->dce = NULL;
+    if (sim800_dce->identity.events)
+        esp_modem_ext_task_join(&sim800_dce->identity);
+    esp_modem_dce_unbind(&(sim800_dce->parent));
+#if CONFIG_EXAMPLE_MODEM_STATIC_ALLOCATION
+    esp_modem_static_free(&s_dce_pool, storage);
+#else
     free(sim800_dce);
+#endif
     
 err:
     return NULL;
 }
 
-void sim800_power_on()
+static modem_dce_t *sim800_driver_init(modem_dte_t *dte, const void *config)
+{
+    const sim800_config_t default_config = SIM800_DEFAULT_CONFIG();
+    return sim800_init(dte, config ? config : &default_config);
+}
+
+static const char *const sim800_models[] = {"SIM800", NULL};
+
+const esp_modem_driver_t sim800_driver = {
+    .name = "sim800",
+    .models = sim800_models,
+    .init = sim800_driver_init,
+};
+
+static void sim800_pwkey_release(void *arg)
+{
+    sim800_power_t *power = (sim800_power_t *)arg;
+    set_sim800_pwkey(&power->config);
+    sim800_boot_mark(power->config.instance, SIM800_BOOT_PHASE_PWKEY_DONE);
+}
+
+void sim800_power_on(const sim800_config_t *config)
 {
+    DCE_CHECK(config->instance < CONFIG_EXAMPLE_MODEM_INSTANCES, "no room for modem %d", err, config->instance);
+    sim800_power_t *power = &s_power[config->instance];
+    power->config = *config;
+
     gpio_config_t io_conf;
     io_conf.mode = GPIO_MODE_OUTPUT;
-    io_conf.pin_bit_mask = (1 << SIM800_PWKEY) + (1 << SIM800_RST) + (1 << SIM800_POWER);
+    io_conf.pin_bit_mask = (1ULL << config->pwkey_io_num) | (1ULL << config->rst_io_num) | (1ULL << config->power_io_num);
     io_conf.pull_down_en = 0;
     io_conf.pull_up_en = 0;
     io_conf.intr_type = GPIO_INTR_DISABLE;
     gpio_config(&io_conf);
 
-    ESP_LOGI(DCE_TAG, "Power up ...");
-    set_sim800_pwrsrc();
-    set_sim800_rst();
-    clear_sim800_pwkey();
+    ESP_LOGI(DCE_TAG, "Power up modem %d ...", config->instance);
+    sim800_boot_restart(config->instance);
+    set_sim800_pwrsrc(config);
+    set_sim800_rst(config);
+    clear_sim800_pwkey(config);
 
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
-    set_sim800_pwkey();
-    vTaskDelay(1900 / portTICK_PERIOD_MS);
+    /* Release PWKEY from a timer so the caller can set up the DTE meanwhile */
+    if (!power->pwkey_timer)
+    {
+        const esp_timer_create_args_t timer_args = {
+            .callback = sim800_pwkey_release,
+            .arg = power,
+            .name = "sim800_pwkey"};
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &power->pwkey_timer));
+    }
+    esp_timer_stop(power->pwkey_timer);
+    ESP_ERROR_CHECK(esp_timer_start_once(power->pwkey_timer, CONFIG_EXAMPLE_MODEM_PWKEY_PULSE_MS * 1000ULL));
+err:
+    return;
 }
 
-void sim800_power_off()
+void sim800_power_off(const sim800_config_t *config)
 {
-    ESP_LOGI(DCE_TAG, "Power down.");
-    clear_sim800_pwrsrc();
-}
\ No newline at end of file
+    ESP_LOGI(DCE_TAG, "Power down modem %d.", config->instance);
+    clear_sim800_pwrsrc(config);
+}
@@ -0,0 +1,263 @@
+/* Console example — command history kept on the FAT partition.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "linenoise/linenoise.h"
+#include "sdkconfig.h"
+#include "console_history.h"
+
+#if CONFIG_STORE_HISTORY
+
+static const char *TAG = "history";
+
+#define HISTORY_LINE_MAX (256)
+
+/* Every line the console accepts used to rewrite the whole file, which on wear
+ * levelled flash costs several sector writes before the command even runs.
+ * Lines are now queued in RAM and appended in one go by a low priority task;
+ * the last max_len lines are also kept here so the file can be cut back to
+ * them once it has grown past CONFIG_EXAMPLE_HISTORY_COMPACT_LINES.
+ */
+static struct {
+    const char *path;
+    int max_len;
+    SemaphoreHandle_t lock;  /* pending and recent */
+    SemaphoreHandle_t io;    /* the file */
+    TaskHandle_t writer;
+    char **pending;          /* lines not written yet, oldest first */
+    char **batch;            /* pending lines taken over by a flush */
+    int pending_count;
+    int64_t first_pending_us;
+    int64_t last_append_us;
+    char **recent;           /* ring of the newest max_len lines */
+    int recent_head;
+    int recent_count;
+    int file_lines;          /* lines in the file, as far as we know */
+} history;
+
+static void history_remember(char *line)
+{
+    if (history.recent_count < history.max_len) {
+        history.recent[(history.recent_head + history.recent_count++) % history.max_len] = line;
+    } else {
+        free(history.recent[history.recent_head]);
+        history.recent[history.recent_head] = line;
+        history.recent_head = (history.recent_head + 1) % history.max_len;
+    }
+}
+
+static const char *history_newest(void)
+{
+    if (!history.recent_count) {
+        return NULL;
+    }
+    return history.recent[(history.recent_head + history.recent_count - 1) % history.max_len];
+}
+
+/* Rewrite the file with the newest lines only, called with io held */
+static void history_compact(void)
+{
+    xSemaphoreTake(history.lock, portMAX_DELAY);
+    size_t size = 1;
+    for (int i = 0; i < history.recent_count; i++) {
+        size += strlen(history.recent[(history.recent_head + i) % history.max_len]) + 1;
+    }
+    char *text = malloc(size);
+    int lines = history.recent_count;
+    if (text) {
+        char *p = text;
+        for (int i = 0; i < history.recent_count; i++) {
+            const char *line = history.recent[(history.recent_head + i) % history.max_len];
+            size_t len = strlen(line);
+            memcpy(p, line, len);
+            p += len;
+            *p++ = '\n';
+        }
+        *p = '\0';
+    }
+    xSemaphoreGive(history.lock);
+    if (!text) {
+        return;
+    }
+    FILE *fp = fopen(history.path, "w");
+    if (fp) {
+        fputs(text, fp);
+        fclose(fp);
+        ESP_LOGI(TAG, "compacted %s from %d to %d lines", history.path, history.file_lines, lines);
+        history.file_lines = lines;
+    } else {
+        ESP_LOGE(TAG, "cannot rewrite %s", history.path);
+    }
+    free(text);
+}
+
+void console_history_flush(void)
+{
+    if (!history.lock) {
+        return;
+    }
+    xSemaphoreTake(history.io, portMAX_DELAY);
+    xSemaphoreTake(history.lock, portMAX_DELAY);
+    char **batch = history.pending;
+    int count = history.pending_count;
+    history.pending = history.batch;
+    history.batch = batch;
+    history.pending_count = 0;
+    xSemaphoreGive(history.lock);
+
+    if (count) {
+        FILE *fp = fopen(history.path, "a");
+        if (fp) {
+            for (int i = 0; i < count; i++) {
+                fputs(batch[i], fp);
+                fputc('\n', fp);
+            }
+            fclose(fp);
+            history.file_lines += count;
+            ESP_LOGD(TAG, "appended %d lines", count);
+        } else {
+            ESP_LOGE(TAG, "cannot append to %s, %d lines lost", history.path, count);
+        }
+        for (int i = 0; i < count; i++) {
+            free(batch[i]);
+        }
+    }
+    if (history.file_lines > CONFIG_EXAMPLE_HISTORY_COMPACT_LINES) {
+        history_compact();
+    }
+    xSemaphoreGive(history.io);
+}
+
+static void history_writer_task(void *arg)
+{
+    TickType_t wait = portMAX_DELAY;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        xSemaphoreTake(history.lock, portMAX_DELAY);
+        bool flush = false;
+        wait = portMAX_DELAY;
+        if (history.pending_count) {
+            int64_t now = esp_timer_get_time();
+            int64_t due = history.last_append_us + CONFIG_EXAMPLE_HISTORY_IDLE_MS * 1000LL;
+            int64_t deadline = history.first_pending_us + CONFIG_EXAMPLE_HISTORY_MAX_DELAY_MS * 1000LL;
+            if (deadline < due) {
+                due = deadline;
+            }
+            if (now >= due || history.pending_count >= history.max_len) {
+                flush = true;
+            } else {
+                wait = pdMS_TO_TICKS((due - now + 999) / 1000) + 1;
+            }
+        }
+        xSemaphoreGive(history.lock);
+        if (flush) {
+            console_history_flush();
+        }
+    }
+}
+
+void console_history_append(const char *line)
+{
+    if (!history.lock || !line || !line[0]) {
+        return;
+    }
+    xSemaphoreTake(history.lock, portMAX_DELAY);
+    /* linenoiseHistoryAdd() drops a repeat of the previous line, keep the file the same */
+    const char *newest = history_newest();
+    if (newest && !strcmp(newest, line)) {
+        xSemaphoreGive(history.lock);
+        return;
+    }
+    char *kept = strdup(line);
+    char *queued = strdup(line);
+    if (!kept || !queued) {
+        free(kept);
+        free(queued);
+        xSemaphoreGive(history.lock);
+        return;
+    }
+    history_remember(kept);
+    if (history.pending_count == history.max_len) {
+        /* The writer cannot keep up, the oldest queued line is still in recent */
+        free(history.pending[0]);
+        memmove(history.pending, history.pending + 1, (history.max_len - 1) * sizeof(char *));
+        history.pending_count--;
+    }
+    int64_t now = esp_timer_get_time();
+    if (!history.pending_count) {
+        history.first_pending_us = now;
+    }
+    history.pending[history.pending_count++] = queued;
+    history.last_append_us = now;
+    xSemaphoreGive(history.lock);
+    xTaskNotifyGive(history.writer);
+}
+
+esp_err_t console_history_init(const char *path, int max_len)
+{
+    history.path = path;
+    history.max_len = max_len;
+    history.recent = calloc(max_len, sizeof(char *));
+    history.pending = calloc(max_len, sizeof(char *));
+    history.batch = calloc(max_len, sizeof(char *));
+    history.lock = xSemaphoreCreateMutex();
+    history.io = xSemaphoreCreateMutex();
+    if (!history.recent || !history.pending || !history.batch || !history.lock || !history.io) {
+        goto err;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        char line[HISTORY_LINE_MAX + 2];
+        while (fgets(line, sizeof(line), fp)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            history.file_lines++;
+            char *kept = line[0] ? strdup(line) : NULL;
+            if (kept) {
+                history_remember(kept);
+            }
+        }
+        fclose(fp);
+        linenoiseHistoryLoad(path);
+        ESP_LOGI(TAG, "loaded %d of %d lines from %s", history.recent_count, history.file_lines, path);
+        if (history.file_lines > CONFIG_EXAMPLE_HISTORY_COMPACT_LINES) {
+            history_compact();
+        }
+    }
+
+    if (xTaskCreate(history_writer_task, "history", 3072, NULL, tskIDLE_PRIORITY + 1, &history.writer) != pdPASS) {
+        goto err;
+    }
+    return ESP_OK;
+err:
+    ESP_LOGE(TAG, "cannot start the history writer");
+    if (history.lock) {
+        vSemaphoreDelete(history.lock);
+        history.lock = NULL;
+    }
+    if (history.io) {
+        vSemaphoreDelete(history.io);
+    }
+    for (int i = 0; history.recent && i < history.recent_count; i++) {
+        free(history.recent[(history.recent_head + i) % max_len]);
+    }
+    free(history.recent);
+    free(history.pending);
+    free(history.batch);
+    return ESP_ERR_NO_MEM;
+}
+
+#endif // CONFIG_STORE_HISTORY
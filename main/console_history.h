@@ -0,0 +1,48 @@
+/* Console example — command history kept on the FAT partition.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+
+/**
+ * @brief Load the history file into linenoise and start the background writer
+ *
+ * A file grown past its limit is rewritten with the newest max_len lines first.
+ *
+ * @param path history file
+ * @param max_len lines kept, same as given to linenoiseHistorySetMaxLen()
+ * @return esp_err_t
+ *      - ESP_OK on success, also when there is no file yet
+ *      - ESP_ERR_NO_MEM if the writer cannot be created
+ */
+esp_err_t console_history_init(const char *path, int max_len);
+
+/**
+ * @brief Queue a line for the history file, call after linenoiseHistoryAdd()
+ *
+ * Lines are appended in batches once the console has been idle for a while, or
+ * at the latest after the configured delay.
+ *
+ * @param line command line
+ */
+void console_history_append(const char *line);
+
+/**
+ * @brief Write the queued lines now, for use before a restart or sleep
+ *
+ */
+void console_history_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,7 @@
 */
 #include <string.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/event_groups.h"
 
 #include "sdkconfig.h"
@@ -25,6 +26,9 @@
 
 #include "driver/uart.h"
 #include "cmd_decl.h"
+#include "console_history.h"
+#include "esp_modem.h"
+#include "esp_modem_pool.h"
 #include "sdkconfig.h"
 
 static const char *TAG = "console";
@@ -45,6 +49,8 @@ static const char *TAG = "console";
 #define CLS "\n\033[2J\n\033[H\n"
 #define FRAMED ESC_SEQ("53")
 
+#define HISTORY_LENGTH 20
+
 /* Console command history can be stored to and loaded from a file.
  * The easiest way to do this is to use FATFS filesystem on top of
  * wear_levelling library.
@@ -148,19 +154,72 @@ static void initialize_console()
     linenoiseSetHintsCallback((linenoiseHintsCallback *)&esp_console_get_hint);
 
     /* Set command history size */
-    linenoiseHistorySetMaxLen(20);
+    linenoiseHistorySetMaxLen(HISTORY_LENGTH);
 
-    /* Load command history from filesystem 
-    #if CONFIG_STORE_HISTORY
+#if CONFIG_STORE_HISTORY
+    /* Load command history from filesystem, new lines are appended in the background */
+    if (console_history_init(HISTORY_PATH, HISTORY_LENGTH) == ESP_OK)
+    {
+        register_system_shutdown_hook(console_history_flush);
+    }
+#endif
+}
 
-    linenoiseHistoryLoad(HISTORY_PATH);
-    #endif
-*/
+/* Read and run commands, in a task of its own so that it can be placed away from the modem tasks */
+static void console_task(void *param)
+{
+    const char *prompt = param;
+
+    /* Main loop */
+    while (true)
+    {
+        /* Get a line using linenoise.
+         * The line is returned when ENTER is pressed.
+         */
+        char *line = linenoise(prompt);
+        if (line == NULL)
+        { /* Ignore empty lines */
+            continue;
+        }
+        /* Add the command to the history */
+        linenoiseHistoryAdd(line);
+
+#if CONFIG_STORE_HISTORY
+        /* Queue it for the history file, written once the console is idle */
+        console_history_append(line);
+#endif
+
+        /* Try to run the command */
+        int ret;
+
+        esp_err_t err = esp_console_run(line, &ret);
+        if (err == ESP_ERR_NOT_FOUND)
+        {
+            console_send_raw(line);
+        }
+        else if (err == ESP_ERR_INVALID_ARG)
+        {
+            // command was empty
+        }
+        else if (err == ESP_OK && ret != ESP_OK)
+        {
+            printf("Command returned non-zero error code: 0x%x (%s)\n", ret, esp_err_to_name(err));
+        }
+        else if (err != ESP_OK)
+        {
+            printf("Internal error: %s\n", esp_err_to_name(err));
+        }
+        /* linenoise allocates line buffer on the heap, so need to free it */
+        linenoiseFree(line);
+    }
 }
 
 void app_main()
 {
+#if !CONFIG_EXAMPLE_MODEM_SUPPLY_BROWNOUT
+    /* A GPRS burst on a weak supply trips the detector */
     WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0); //disable brownout detector
+#endif
 
 tcpip_adapter_init();
     initialize_nvs();
@@ -175,6 +234,7 @@ tcpip_adapter_init();
     register_system();
     //register_wifi();
     register_modem_commands();
+    register_system_heap_report_hook(esp_modem_pool_report);
 
     /* Prompt to be printed before each line.
      * This can be customized, made dynamic, etc.
@@ -205,46 +265,11 @@ tcpip_adapter_init();
 #endif //CONFIG_LOG_COLORS
     }
 
-    /* Main loop */
-    while (true)
+    /* app_main returns once the console task runs, the main task then goes away */
+    if (xTaskCreatePinnedToCore(console_task, "console", CONFIG_EXAMPLE_CONSOLE_TASK_STACK_SIZE, (void *)prompt,
+                                CONFIG_EXAMPLE_CONSOLE_TASK_PRIORITY, NULL,
+                                ESP_MODEM_TASK_CORE(CONFIG_EXAMPLE_CONSOLE_TASK_CORE)) != pdPASS)
     {
-        /* Get a line using linenoise.
-         * The line is returned when ENTER is pressed.
-         */
-        char *line = linenoise(prompt);
-        if (line == NULL)
-        { /* Ignore empty lines */
-            continue;
-        }
-        /* Add the command to the history */
-        linenoiseHistoryAdd(line);
-
-#if CONFIG_STORE_HISTORY
-        /* Save command history to filesystem */
-        linenoiseHistorySave(HISTORY_PATH);
-#endif
-
-        /* Try to run the command */
-        int ret;
-
-        esp_err_t err = esp_console_run(line, &ret);
-        if (err == ESP_ERR_NOT_FOUND)
-        {
-            console_send_raw(line);
-        }
-        else if (err == ESP_ERR_INVALID_ARG)
-        {
-            // command was empty
-        }
-        else if (err == ESP_OK && ret != ESP_OK)
-        {
-            printf("Command returned non-zero error code: 0x%x (%s)\n", ret, esp_err_to_name(err));
-        }
-        else if (err != ESP_OK)
-        {
-            printf("Internal error: %s\n", esp_err_to_name(err));
-        }
-        /* linenoise allocates line buffer on the heap, so need to free it */
-        linenoiseFree(line);
+        ESP_LOGE(TAG, "create console task failed");
     }
 }
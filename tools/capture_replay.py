@@ -0,0 +1,229 @@
+#!/usr/bin/env python
+#
+# Read and replay modem UART captures written by "capture dump" or a fault dump.
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+"""
+Show a capture:
+
+    capture_replay.py show fault.cap
+
+Replay it, playing the modem: the bytes the modem sent (rx) are written to a serial
+port or pty at their recorded times, divided by --speed (0 sends them as soon as
+allowed). Before an answer is sent, the bytes the DTE sent just before it in the
+capture (tx) are awaited and compared, so the DTE under test stays in step and any
+difference in what it sends is reported. The time the DTE took to send each command
+is printed next to the recorded one.
+
+    capture_replay.py replay fault.cap --device /dev/ttyUSB0 --baud 115200 --speed 10
+    capture_replay.py replay fault.cap --pty
+
+--pty creates a pseudo terminal and prints its name, for a host build of the DTE.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import select
+import struct
+import sys
+import time
+
+MAGIC = b'MCAP'
+FILE_HEADER = struct.Struct('<4sHHII')
+RECORD_HEADER = struct.Struct('<IHBB')
+RX, TX, NOTE = 0, 1, 2
+TRUNCATED = 0x80
+DIR_NAMES = {RX: 'rx', TX: 'tx', NOTE: 'note'}
+
+
+class Record(object):
+    def __init__(self, time_us, direction, port, data, truncated):
+        self.time_us = time_us
+        self.direction = direction
+        self.port = port
+        self.data = data
+        self.truncated = truncated
+
+
+def load(path):
+    """Return the header fields and the records, times made monotonic from the first record"""
+    with open(path, 'rb') as f:
+        blob = f.read()
+    magic, version, header_size, records, overwritten = FILE_HEADER.unpack_from(blob, 0)
+    if magic != MAGIC:
+        raise ValueError('%s is not a modem capture' % path)
+    if version != 1:
+        raise ValueError('unsupported capture version %d' % version)
+    offset = FILE_HEADER.size
+    result = []
+    last = None
+    elapsed = 0
+    for _ in range(records):
+        time_us, length, direction, port = RECORD_HEADER.unpack_from(blob, offset)
+        offset += header_size
+        data = blob[offset:offset + length]
+        offset += length
+        if last is not None:
+            # 32 bit microseconds wrap every 71 minutes, records are in time order
+            elapsed += (time_us - last) & 0xffffffff
+        last = time_us
+        result.append(Record(elapsed, direction & ~TRUNCATED, port, data, bool(direction & TRUNCATED)))
+    return {'records': records, 'overwritten': overwritten}, result
+
+
+def printable(data, limit=None):
+    text = []
+    for b in bytearray(data[:limit] if limit else data):
+        if b == 0x0d:
+            text.append('\\r')
+        elif b == 0x0a:
+            text.append('\\n')
+        elif 0x20 <= b < 0x7f and b != 0x5c:
+            text.append(chr(b))
+        else:
+            text.append('\\x%02x' % b)
+    if limit and len(data) > limit:
+        text.append('... (%d bytes)' % len(data))
+    return ''.join(text)
+
+
+def show(args):
+    info, records = load(args.capture)
+    print('%d records, %d overwritten before the dump' % (info['records'], info['overwritten']))
+    for r in records:
+        if args.port is not None and r.port != args.port:
+            continue
+        print('%10.6f uart%d %-4s %s%s' % (r.time_us / 1e6, r.port, DIR_NAMES.get(r.direction, '?'),
+                                           printable(r.data, args.width), ' [truncated]' if r.truncated else ''))
+    return 0
+
+
+def open_device(args):
+    if args.pty:
+        import pty
+        master, slave = pty.openpty()
+        configure(slave, None)
+        print('modem simulated on %s' % os.ttyname(slave))
+        if args.wait:
+            input('press enter when the DTE has opened it')
+        return master
+    fd = os.open(args.device, os.O_RDWR | os.O_NOCTTY)
+    configure(fd, args.baud)
+    return fd
+
+
+def configure(fd, baud):
+    import termios
+    import tty
+    tty.setraw(fd)
+    if baud:
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, 'B%d' % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+
+
+def read_until(fd, count, timeout):
+    """Read up to count bytes, returning early on timeout"""
+    data = b''
+    deadline = time.time() + timeout
+    while len(data) < count:
+        remaining = deadline - time.time()
+        if remaining <= 0 or not select.select([fd], [], [], remaining)[0]:
+            break
+        chunk = os.read(fd, count - len(data))
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+def replay(args):
+    _, records = load(args.capture)
+    records = [r for r in records if r.direction != NOTE and (args.port is None or r.port == args.port)]
+    if not records:
+        print('nothing to replay')
+        return 1
+    fd = open_device(args)
+    speed = args.speed
+    mismatches = 0
+    expected = b''
+    recorded_delay = 0
+    tx_time = 0
+    last_time = records[0].time_us
+    start = time.time()
+    sent = received = 0
+    for r in records:
+        if r.direction == TX:
+            if not expected:
+                # How long the DTE took to send this after the previous answer
+                recorded_delay = (r.time_us - last_time) / 1e6
+            expected += r.data
+            tx_time = r.time_us
+            continue
+        gap = r.time_us - last_time
+        if expected and not args.no_sync:
+            # The modem answered after the DTE sent these, wait for the DTE to send them too
+            waited = time.time()
+            got = read_until(fd, len(expected), args.timeout)
+            waited = time.time() - waited
+            received += len(got)
+            status = 'ok' if got == expected else 'MISMATCH'
+            if got != expected:
+                mismatches += 1
+            print('%-8s tx %-40s dte %7.3f s, recorded %7.3f s' %
+                  (status, printable(expected, 36), waited, recorded_delay))
+            if got != expected:
+                print('         got %s' % printable(got, 60))
+            # Only the time the modem took to answer is left to wait
+            gap = r.time_us - tx_time
+            expected = b''
+        elif expected:
+            expected = b''
+        if speed:
+            time.sleep(gap / 1e6 / speed)
+        last_time = r.time_us
+        os.write(fd, r.data)
+        sent += len(r.data)
+    elapsed = time.time() - start
+    recorded = (records[-1].time_us - records[0].time_us) / 1e6
+    print('replayed %d bytes to and %d bytes from the DTE in %.3f s (recorded %.3f s), %d mismatches' %
+          (sent, received, elapsed, recorded, mismatches))
+    return 1 if mismatches else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Show or replay a modem UART capture')
+    commands = parser.add_subparsers(dest='command')
+    p = commands.add_parser('show', help='print the records')
+    p.add_argument('capture')
+    p.add_argument('--port', type=int, help='only this UART port')
+    p.add_argument('--width', type=int, default=80, help='bytes shown per record, 0 for all')
+    p = commands.add_parser('replay', help='play the modem side against a DTE')
+    p.add_argument('capture')
+    target = p.add_mutually_exclusive_group(required=True)
+    target.add_argument('--device', help='serial port the DTE is connected to')
+    target.add_argument('--pty', action='store_true', help='create a pseudo terminal for a host build')
+    p.add_argument('--wait', action='store_true', help='with --pty, wait for enter before starting')
+    p.add_argument('--baud', type=int, default=115200)
+    p.add_argument('--port', type=int, help='only this UART port of the capture')
+    p.add_argument('--speed', type=float, default=1.0, help='time scale, 0 for no delays')
+    p.add_argument('--timeout', type=float, default=5.0, help='seconds to wait for each command of the DTE')
+    p.add_argument('--no-sync', action='store_true', help='do not wait for the DTE, only follow the recorded times')
+    args = parser.parse_args()
+    if args.command == 'show':
+        return show(args)
+    if args.command == 'replay':
+        return replay(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,823 @@
+#!/usr/bin/env python
+#
+# Simulate a SIM800 or BG96 on a pseudo terminal, for the host build of the modem component.
+#
+# This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+# Unless required by applicable law or agreed to in writing, this
+# software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied.
+"""
+Create a pty and play the modem on it:
+
+    modem_sim.py --model sim800 --link /tmp/modem
+
+The modem powers on when the DTE opens the pty (--power-on open, the default for the
+SIM800, whose driver pulses PWKEY) or when the simulator starts (--power-on start). It
+then sends the boot URCs of the model and registers to the network a little later, all
+divided by --speed. Closing the pty powers the modem off, the stored profile (AT&W)
+survives as it would in the modem's NVRAM.
+
+Commands are echoed until ATE0 and answered with the usual framing after a random
+latency (--latency, per verb in a scenario). Errors, timeouts, garbled answers and
+URCs in the middle of answers are injected at the given rates into the verbs listed
+with --inject. ATD*99# answers CONNECT and starts a stream of HDLC framed PPP packets
+at --ppp-rate bytes/s; what the DTE sends meanwhile is checked frame by frame, and
+"+++" followed by --guard seconds of silence goes back to command mode.
+
+With --hang-after the modem stops answering that many seconds after each power on: no
+echo, no answers, no URCs and no PPP data, for --hang-for seconds or, by default, until
+it is powered off. The host build cuts the pty when the DTE pulls the reset or supply
+pin low, so a hard reset or a power cycle brings it back as it would a real modem.
+
+With --link, DTR arrives as "DTR 0" and "DTR 1" lines on the FIFO <link>.pins. After
+AT+CSCLK=1 (AT+QSCLK=1 on the BG96) the modem sleeps while DTR is high; its serial port
+is back 50 ms after DTR goes low. Bytes sent to a sleeping modem are lost and counted.
+URCs still come out, as RI would wake the DTE for them.
+
+The supply is nominal, AT+CBC reading 3950 to 4150 mV, until "!supply <mV>" sets it
+("!supply" alone makes it nominal again); --supply-dip schedules such a dip after each
+power on, and repeated it makes a sag of several steps. The SIM800 warns with
+UNDER-VOLTAGE WARNNING below 3500 mV and OVER-VOLTAGE WARNNING from 4350 mV, and at
+3400 mV sends UNDER-VOLTAGE POWER DOWN and powers off. In data mode the warnings wait
+for the return to command mode. Uplink sent while the supply is below 3500 mV is
+counted, as the bursts a weak supply would have to carry.
+
+A scenario file adds timed events, seconds after power on:
+
+    {
+      "boot": [[0.5, "RDY"], [2.0, "Call Ready"]],
+      "register_at": 3.0,
+      "logoff": 1.5,
+      "events": [[20.0, "+CREG: 2"], [25.0, "!nocarrier"], [40.0, "!reboot"]],
+      "responses": {"+CSQ": ["+CSQ: 9,0"]},
+      "latency": {"+COPS?": [200, 900]},
+      "errors": {"+CBC": 0.2}
+    }
+
+Events starting with "!" are actions: !reboot, !powerdown, !nocarrier, !register,
+!deregister, !hang, !unhang and !supply; anything else is sent as a URC. With --interactive the same is read from
+stdin, one per line. Counters are printed on exit.
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import random
+import re
+import select
+import signal
+import sys
+import time
+
+MODELS = {
+    'sim800': {
+        'boot': [(0.5, 'RDY'), (0.7, '+CFUN: 1'), (0.8, '+CPIN: READY'), (2.0, 'Call Ready'), (2.2, 'SMS Ready')],
+        'register_at': 3.0,
+        'name': 'SIMCOM_SIM800L',
+        'ati': ['SIM800 R14.18'],
+        'dial': 'D*99#',
+        'power_down': ('+CPOWD=1', ['NORMAL POWER DOWN'], None),
+        'logoff': 1.5,
+        'sleep_clock': '+CSCLK',
+        'wake': 0.05,
+        'power_on': 'open',
+        'voltage_urcs': ('UNDER-VOLTAGE WARNNING', 'UNDER-VOLTAGE POWER DOWN', 'OVER-VOLTAGE WARNNING'),
+    },
+    'bg96': {
+        'boot': [(0.3, 'RDY'), (0.5, '+CFUN: 1'), (0.6, '+CPIN: READY'), (0.8, '+QUSIM: 1'), (1.2, '+QIND: SMS DONE')],
+        'register_at': 1.5,
+        'name': 'BG96',
+        'ati': ['Quectel', 'BG96', 'Revision: BG96MAR02A07M1G'],
+        'dial': 'D*99***1#',
+        'power_down': ('+QPOWD=1', ['POWERED DOWN'], 'OK'),
+        'logoff': 1.0,
+        'sleep_clock': '+QSCLK',
+        'wake': 0.05,
+        'power_on': 'start',
+    },
+}
+
+IDENTITY = {
+    'imei': '868000012345678',
+    'imsi': '234150012345678',
+    'iccid': '89440000000000012345',
+    'operator': 'Simulated',
+}
+
+PPP_FLAG, PPP_ESCAPE, PPP_TRANS = 0x7E, 0x7D, 0x20
+FCS_INIT, FCS_GOOD = 0xFFFF, 0xF0B8
+URCS = ['+CIEV: 10,"23415","Simulated","Sim", 0,0', '+CREG: 1', '*PSUTTZ: 2020,1,1,12,0,0,"+0",0', '+CSQN: 18,0']
+
+
+def make_fcs_table():
+    table = []
+    for b in range(256):
+        v = b
+        for _ in range(8):
+            v = (v >> 1) ^ 0x8408 if v & 1 else v >> 1
+        table.append(v)
+    return table
+
+
+FCS_TABLE = make_fcs_table()
+
+
+def fcs16(data, fcs=FCS_INIT):
+    for b in data:
+        fcs = (fcs >> 8) ^ FCS_TABLE[(fcs ^ b) & 0xff]
+    return fcs
+
+
+def hdlc_frame(payload):
+    """Frame a packet as PPP in HDLC-like framing with the default ACCM"""
+    body = bytearray([0xFF, 0x03, 0x00, 0x21]) + payload
+    fcs = fcs16(body) ^ 0xFFFF
+    body += bytearray([fcs & 0xff, fcs >> 8])
+    out = bytearray([PPP_FLAG])
+    for b in body:
+        if b in (PPP_FLAG, PPP_ESCAPE) or b < PPP_TRANS:
+            out += bytearray([PPP_ESCAPE, b ^ PPP_TRANS])
+        else:
+            out.append(b)
+    out.append(PPP_FLAG)
+    return out
+
+
+class Deframer(object):
+    """Count the frames the DTE sends in data mode"""
+
+    def __init__(self):
+        self.frame = bytearray()
+        self.in_frame = self.escaped = False
+        self.good = self.bad = 0
+
+    def restart(self):
+        """A new session, what came before the escape is no frame"""
+        self.frame = bytearray()
+        self.in_frame = self.escaped = False
+
+    def feed(self, data):
+        for b in data:
+            if b == PPP_FLAG:
+                if self.in_frame and len(self.frame) >= 3:
+                    if fcs16(self.frame) == FCS_GOOD:
+                        self.good += 1
+                    else:
+                        self.bad += 1
+                self.frame = bytearray()
+                self.in_frame = True
+                self.escaped = False
+            elif not self.in_frame:
+                continue
+            elif b == PPP_ESCAPE:
+                self.escaped = True
+            else:
+                self.frame.append(b ^ PPP_TRANS if self.escaped else b)
+                self.escaped = False
+
+
+class Modem(object):
+    def __init__(self, args, scenario):
+        self.args = args
+        self.model = MODELS[args.model]
+        self.scenario = scenario
+        self.rng = random.Random(args.seed)
+        self.profile = {'cmee': 0, 'ifc': '0,0', 'ipr': 0}
+        self.powered = False
+        self.counts = {}
+        self.injected = {'error': 0, 'timeout': 0, 'garble': 0, 'urc': 0}
+        self.uplink = Deframer()
+        self.downlink_frames = self.downlink_bytes = 0
+        self.output = []
+        self.seq = 0
+        self.data_mode = False
+        self.dtr = 0
+        self.asleep = False
+        self.sleep_clock = 0
+        self.serial_at = 0.0
+        self.sleep_counts = {'sleeps': 0, 'wakes': 0, 'lost': 0, 'urcs': 0}
+        self.sleep_time = 0.0
+        self.supply = None
+        self.held_urcs = []
+        self.supply_counts = {'warnings': 0, 'low_bytes': 0, 'low_frames': 0}
+
+    # ---------------------------------------------------------------- power
+
+    def power_on(self, now):
+        self.powered = True
+        self.power_time = now
+        self.ready = False
+        self.echo = True
+        self.cmee = self.profile['cmee']
+        self.creg_n = 0
+        self.registered = False
+        self.data_mode = False
+        self.connected = False
+        self.hung = False
+        self.radio_off = False
+        # AT+CSCLK is not stored, DTR is the DTE's and stays as it was
+        self.sleep_clock = 0
+        self.serial_at = 0.0
+        self.line = bytearray()
+        self.busy_until = now
+        self.output = []
+        speed = self.args.speed
+        boot = self.scenario.get('boot', self.model['boot'])
+        self.booted_at = now + max([at for at, _ in boot] or [0]) / speed
+        for at, urc in boot:
+            self.schedule(now + at / speed, urc, mark_ready=(urc == 'RDY'))
+        # A boot list without RDY still has to end somewhere
+        if not any(urc == 'RDY' for _, urc in boot):
+            self.schedule(now, None, mark_ready=True)
+        register_at = self.scenario.get('register_at', self.model['register_at'])
+        self.schedule(now + register_at / speed, '!register')
+        for at, event in self.scenario.get('events', []):
+            self.schedule(now + at / speed, event)
+        if self.args.hang_after is not None:
+            self.schedule(now + self.args.hang_after / speed, '!hang')
+        for at, duration, mv in self.args.supply_dip or []:
+            self.schedule(now + at / speed, '!supply %d' % mv)
+            self.schedule(now + (at + duration) / speed, '!supply')
+        print('power on')
+        self.update_sleep(now)
+
+    def power_off(self, reason):
+        if self.powered:
+            print('power off (%s)' % reason)
+        self.powered = False
+        self.output = []
+        self.update_sleep(time.time())
+
+    # ---------------------------------------------------------------- sleep
+
+    def set_dtr(self, level, now):
+        self.dtr = level
+        self.update_sleep(now)
+
+    def update_sleep(self, now):
+        """Sleep while the sleep clock is enabled and DTR is high, in command mode"""
+        sleep = self.powered and self.sleep_clock == 1 and self.dtr == 1 and not self.data_mode
+        if sleep and not self.asleep:
+            self.asleep = True
+            self.sleep_start = now
+            self.sleep_counts['sleeps'] += 1
+        elif not sleep and self.asleep:
+            self.asleep = False
+            self.sleep_time += now - self.sleep_start
+            if self.powered:
+                self.sleep_counts['wakes'] += 1
+                self.serial_at = now + self.model['wake'] / self.args.speed
+
+    # --------------------------------------------------------------- supply
+
+    UNDER_MV = 3500
+    POWER_DOWN_MV = 3400
+    OVER_MV = 4350
+
+    def supply_mv(self):
+        if self.supply is None:
+            return self.rng.randint(3950, 4150)
+        return self.supply + self.rng.randint(-10, 10)
+
+    def supply_low(self):
+        return self.supply is not None and self.supply < self.UNDER_MV
+
+    def set_supply(self, mv, now):
+        """Change the supply, returning the warning the model sends for it"""
+        before = self.supply
+        self.supply = mv
+        print('supply %s' % ('nominal' if mv is None else '%d mV' % mv))
+        urcs = self.model.get('voltage_urcs')
+        if mv is None or urcs is None:
+            return bytearray()
+        under, power_down, over = urcs
+        if mv <= self.POWER_DOWN_MV:
+            out = self.urc(power_down)
+            self.power_off('under-voltage')
+            return out
+        if mv < self.UNDER_MV and (before is None or before >= self.UNDER_MV):
+            return self.warn(under)
+        if mv >= self.OVER_MV and (before is None or before < self.OVER_MV):
+            return self.warn(over)
+        return bytearray()
+
+    def warn(self, text):
+        self.supply_counts['warnings'] += 1
+        if self.data_mode:
+            self.held_urcs.append(text)
+            return bytearray()
+        return self.urc(text)
+
+    def release_urcs(self, now):
+        """Send what waited for the end of data mode"""
+        for text in self.held_urcs:
+            self.schedule(now, text)
+        self.held_urcs = []
+
+    # --------------------------------------------------------------- output
+
+    def schedule(self, due, text, raw=None, mark_ready=False):
+        self.seq += 1
+        self.output.append((due, self.seq, text, raw, mark_ready))
+        self.output.sort(key=lambda item: (item[0], item[1]))
+
+    def next_due(self):
+        return self.output[0][0] if self.output else None
+
+    def due_output(self, now):
+        """Return the bytes to send now, running the actions that are due"""
+        out = bytearray()
+        while self.output and self.output[0][0] <= now:
+            _, _, text, raw, mark_ready = self.output.pop(0)
+            if mark_ready:
+                self.ready = True
+            if raw is not None and not self.hung:
+                out += raw
+            elif text is not None and text.startswith('!'):
+                data = self.action(text, now)
+                if not self.hung:
+                    out += data
+            elif text is not None and not self.hung:
+                out += self.urc(text)
+            if not self.powered:
+                break
+        return out
+
+    def urc(self, text):
+        if text.startswith('+CREG: ') and self.creg_n == 0:
+            return bytearray()
+        if self.asleep:
+            self.sleep_counts['urcs'] += 1
+        return bytearray(('\r\n%s\r\n' % text).encode())
+
+    def action(self, name, now):
+        if name == '!register':
+            self.registered = True
+            return self.urc('+CREG: 1')
+        if name == '!deregister':
+            self.registered = False
+            return self.urc('+CREG: 2')
+        if name == '!nocarrier':
+            if self.data_mode or self.connected:
+                self.data_mode = self.connected = False
+                self.release_urcs(now)
+                return bytearray(b'\r\nNO CARRIER\r\n')
+            return bytearray()
+        if name == '!powerdown':
+            out = bytearray(b'\r\nNORMAL POWER DOWN\r\n')
+            self.power_off('powerdown')
+            return out
+        if name == '!reboot':
+            self.power_on(now)
+            return bytearray()
+        if name == '!hang':
+            if not self.hung:
+                print('hung')
+                self.hung = True
+                if self.args.hang_for:
+                    self.schedule(now + self.args.hang_for / self.args.speed, '!unhang')
+            return bytearray()
+        if name == '!unhang':
+            if self.hung:
+                print('answering again')
+                self.hung = False
+            return bytearray()
+        if name == '!supply' or name.startswith('!supply '):
+            mv = name.split()[1:]
+            return self.set_supply(int(mv[0]) if mv else None, now)
+        if name == '!off':
+            self.power_off('power down command')
+            return bytearray()
+        print('unknown action %s' % name)
+        return bytearray()
+
+    # ---------------------------------------------------------------- input
+
+    def feed(self, data, now):
+        """Handle bytes from the DTE, returning the echo"""
+        if not self.powered or not self.ready or self.hung:
+            return bytearray()
+        if self.asleep or now < self.serial_at:
+            self.sleep_counts['lost'] += len(data)
+            return bytearray()
+        if self.data_mode:
+            good = self.uplink.good
+            self.uplink.feed(bytearray(data))
+            if self.supply_low():
+                self.supply_counts['low_bytes'] += len(data)
+                self.supply_counts['low_frames'] += self.uplink.good - good
+            self.escape_tail = (getattr(self, 'escape_tail', b'') + data)[-3:]
+            if self.escape_tail == b'+++':
+                # The peer has terminated the link by now, nothing more comes down
+                self.escape_at = now
+            else:
+                self.escape_at = None
+            return bytearray()
+        echo = bytearray(data) if self.echo else bytearray()
+        for b in bytearray(data):
+            if b == 0x0D:
+                self.command(self.line.decode('latin-1'), now)
+                self.line = bytearray()
+            elif b != 0x0A:
+                self.line.append(b)
+        return echo
+
+    def tick(self, now):
+        """Data mode: escape detection and the downlink stream"""
+        if not self.data_mode or self.hung:
+            return bytearray()
+        if getattr(self, 'escape_at', None) is not None and now - self.escape_at >= self.args.guard:
+            self.escape_at = None
+            self.escape_tail = b''
+            self.data_mode = False
+            print('escaped to command mode, uplink %d good frames, %d bad' % (self.uplink.good, self.uplink.bad))
+            self.release_urcs(now)
+            return bytearray(b'\r\nOK\r\n')
+        out = bytearray()
+        if getattr(self, 'escape_at', None) is not None:
+            return out
+        allowed = self.args.ppp_rate * (now - self.data_start) - self.data_sent
+        while allowed >= self.args.ppp_frame:
+            payload = bytearray((self.downlink_frames + i) & 0xff for i in range(self.args.ppp_frame))
+            frame = hdlc_frame(payload)
+            out += frame
+            self.data_sent += self.args.ppp_frame
+            allowed -= self.args.ppp_frame
+            self.downlink_frames += 1
+            self.downlink_bytes += len(frame)
+        return out
+
+    # ------------------------------------------------------------- commands
+
+    def command(self, line, now):
+        line = line.strip()
+        if not line.upper().startswith('AT'):
+            return
+        body = line[2:]
+        if not body:
+            self.respond('', [], 'OK', now)
+            return
+        # Concatenated commands, "AT+A;+B"
+        infos = []
+        final = 'OK'
+        verb = ''
+        for part in body.split(';'):
+            part = part.strip()
+            if not part:
+                continue
+            verb = self.verb(part)
+            self.counts[verb] = self.counts.get(verb, 0) + 1
+            result = self.execute(part, now)
+            if result is None:
+                # Answered later or never, as after a power down
+                return
+            lines, final = result
+            infos += lines
+            if final != 'OK':
+                break
+        self.respond(verb, infos, final, now)
+
+    @staticmethod
+    def verb(part):
+        m = re.match(r'([+&*#$%^][A-Z]+|[A-Z])(\?|=\?)?', part.upper())
+        return (m.group(1) + (m.group(2) or '')) if m else part.upper()
+
+    def error(self):
+        if self.cmee == 2:
+            return '+CME ERROR: operation not allowed'
+        if self.cmee == 1:
+            return '+CME ERROR: 3'
+        return 'ERROR'
+
+    def execute(self, part, now):
+        """Return (information lines, final result code), or None when there is nothing to send now"""
+        cmd = re.sub(r'\s+', '', part).upper()
+        override = self.scenario.get('responses', {}).get(self.verb(part))
+        if override is not None:
+            return list(override), 'OK'
+        if cmd in ('E0', 'E1', 'E'):
+            self.echo = cmd == 'E1'
+            return [], 'OK'
+        if cmd in ('Q0', 'V1', '&F', 'Z'):
+            return [], 'OK'
+        if cmd == '&W':
+            self.profile['cmee'] = self.cmee
+            return [], 'OK'
+        if cmd == 'I':
+            return list(self.model['ati']), 'OK'
+        if cmd == '+CGMM':
+            return [self.model['name']], 'OK'
+        if cmd in ('+CGSN', '+GSN'):
+            return [IDENTITY['imei']], 'OK'
+        if cmd == '+CIMI':
+            return [IDENTITY['imsi']], 'OK'
+        if cmd in ('+CCID', '+QCCID'):
+            return [IDENTITY['iccid']], 'OK'
+        if cmd == '+CSQ':
+            return ['+CSQ: %d,0' % self.rng.randint(10, 25)], 'OK'
+        if cmd == '+CBC':
+            return ['+CBC: 0,%d,%d' % (self.rng.randint(80, 95), self.supply_mv())], 'OK'
+        if cmd == '+CREG?':
+            return ['+CREG: %d,%d' % (self.creg_n, 1 if self.registered else 2)], 'OK'
+        m = re.match(r'\+CREG=([012])$', cmd)
+        if m:
+            self.creg_n = int(m.group(1))
+            return [], 'OK'
+        if cmd == '+COPS?':
+            if not self.registered:
+                return ['+COPS: 0'], 'OK'
+            return ['+COPS: 0,0,"%s"' % IDENTITY['operator']], 'OK'
+        if cmd == '+CMEE?':
+            return ['+CMEE: %d' % self.cmee], 'OK'
+        m = re.match(r'\+CMEE=([012])$', cmd)
+        if m:
+            self.cmee = int(m.group(1))
+            return [], 'OK'
+        m = re.match(r'\+IPR=(\d+)$', cmd)
+        if m:
+            self.profile['ipr'] = int(m.group(1))
+            return [], 'OK'
+        m = re.match(r'\+IFC=([02]),([02])$', cmd)
+        if m:
+            self.profile['ifc'] = '%s,%s' % m.groups()
+            return [], 'OK'
+        if re.match(r'\+(CLTS|CMER|CGDCONT|QCFG|CGATT)=', cmd):
+            return [], 'OK'
+        sleep_clock = self.model['sleep_clock']
+        m = re.match(r'\%s=([012])$' % sleep_clock, cmd)
+        if m:
+            self.sleep_clock = int(m.group(1))
+            # Takes effect once DTR goes high, the answer is out by then
+            return [], 'OK'
+        if cmd == sleep_clock + '?':
+            return ['%s: %d' % (sleep_clock, self.sleep_clock)], 'OK'
+        if cmd == '+CFUN=0':
+            self.radio_off = True
+            self.schedule(self.busy_until + 0.1 / self.args.speed, '!deregister')
+            return [], 'OK'
+        if cmd == '+CFUN=1':
+            if self.radio_off:
+                self.radio_off = False
+                register_at = self.scenario.get('register_at', self.model['register_at'])
+                self.schedule(self.busy_until + register_at / self.args.speed, '!register')
+            return [], 'OK'
+        if cmd == '+CFUN=1,1':
+            self.respond('+CFUN', [], 'OK', now)
+            self.schedule(self.busy_until + 0.01, '!reboot')
+            return None
+        if cmd == '+CLAC':
+            return ['AT%s' % c for c in ('+CSQ', '+CBC', '+CREG', '+COPS', '+CGMM', '+CGSN', '+CIMI', '+CCID')], 'OK'
+        if cmd == self.model['dial'] or cmd == 'O':
+            if cmd == 'O' and not self.connected:
+                return [], 'NO CARRIER'
+            self.respond(self.verb(part), [], 'CONNECT', now)
+            self.schedule(self.busy_until, None, raw=bytearray())
+            self.connected = True
+            self.data_mode = True
+            self.data_start = self.busy_until
+            self.data_sent = 0
+            self.escape_at = None
+            self.uplink.restart()
+            print('data mode')
+            return None
+        if cmd in ('H', 'H0'):
+            self.connected = False
+            return [], 'OK'
+        if cmd == self.model['power_down'][0]:
+            _, lines, final = self.model['power_down']
+            if final:
+                self.respond(self.verb(part), [], final, now)
+            # The modem detaches from the network before it reports the power down
+            logoff = self.scenario.get('logoff', self.model['logoff'])
+            self.busy_until = max(self.busy_until, now) + logoff / self.args.speed
+            for text in lines:
+                self.schedule(self.busy_until + 0.05, text)
+                self.busy_until += 0.05
+            self.schedule(self.busy_until + 0.01, '!off')
+            return None
+        return [], self.error()
+
+    def respond(self, verb, infos, final, now):
+        """Queue an answer after the latency of the verb, with the configured faults"""
+        args = self.args
+        low, high = self.scenario.get('latency', {}).get(verb, args.latency)
+        due = max(now, self.busy_until) + self.rng.uniform(low, high) / 1000.0 / args.speed
+        injectable = verb in args.inject
+        error_rate = self.scenario.get('errors', {}).get(verb, args.error_rate if injectable else 0)
+        if final == 'OK' and self.rng.random() < error_rate:
+            self.injected['error'] += 1
+            infos, final = [], self.error()
+        if injectable and self.rng.random() < args.timeout_rate:
+            self.injected['timeout'] += 1
+            return
+        text = ''.join('\r\n%s\r\n' % info for info in infos) + '\r\n%s\r\n' % final
+        data = bytearray(text.encode())
+        if injectable and self.rng.random() < args.garble_rate:
+            self.injected['garble'] += 1
+            positions = [i for i, b in enumerate(data) if b not in (0x0D, 0x0A)]
+            data[self.rng.choice(positions)] ^= 0x20
+        if injectable and self.rng.random() < args.urc_rate:
+            self.injected['urc'] += 1
+            # Between the information lines and the result, where it hurts most
+            cut = len(data) - len('\r\n%s\r\n' % final)
+            data = data[:cut] + bytearray(('\r\n%s\r\n' % self.rng.choice(URCS)).encode()) + data[cut:]
+        self.busy_until = due
+        self.schedule(due, None, raw=data)
+
+    def report(self):
+        print('commands: %s' % ', '.join('%s %d' % item for item in sorted(self.counts.items())))
+        print('injected: %s' % ', '.join('%s %d' % item for item in sorted(self.injected.items())))
+        print('ppp: %d frames (%d bytes) to the DTE, %d good and %d bad frames from it' %
+              (self.downlink_frames, self.downlink_bytes, self.uplink.good, self.uplink.bad))
+        if self.asleep:
+            self.sleep_time += time.time() - self.sleep_start
+            self.sleep_start = time.time()
+        print('sleep: %d sleeps, %d wakes, %.1f s asleep, %d bytes lost to a sleeping modem, %d URCs while asleep' %
+              (self.sleep_counts['sleeps'], self.sleep_counts['wakes'], self.sleep_time, self.sleep_counts['lost'],
+               self.sleep_counts['urcs']))
+        print('supply: %d voltage warnings, %d bytes in %d frames from the DTE below %d mV' %
+              (self.supply_counts['warnings'], self.supply_counts['low_bytes'], self.supply_counts['low_frames'],
+               self.UNDER_MV))
+
+
+def open_pty(args):
+    import pty
+    import tty
+    master, slave = pty.openpty()
+    # The line discipline must not echo or translate before the DTE sets its own mode
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+    os.close(slave)
+    return master, name
+
+
+def publish(args, name):
+    """Tell the DTE where the modem is, once it can talk"""
+    if args.link:
+        if os.path.lexists(args.link):
+            os.remove(args.link)
+        os.symlink(name, args.link)
+    print('modem simulated on %s%s' % (name, ' (%s)' % args.link if args.link else ''))
+    sys.stdout.flush()
+
+
+def open_pins(args):
+    """The FIFO the host build writes DTR levels to, opened for writing too so that it never reads EOF"""
+    if not args.link:
+        return None
+    path = args.link + '.pins'
+    if os.path.lexists(path):
+        os.remove(path)
+    os.mkfifo(path)
+    return os.open(path, os.O_RDWR | os.O_NONBLOCK)
+
+
+def handle_pins(fd, modem):
+    try:
+        data = os.read(fd, 4096)
+    except OSError:
+        return
+    for line in data.decode('latin-1').splitlines():
+        m = re.match(r'DTR ([01])$', line.strip())
+        if m:
+            modem.set_dtr(int(m.group(1)), time.time())
+
+
+def dte_attached(poller):
+    """The master reports a hangup while no one has the slave open"""
+    for _, event in poller.poll(0):
+        if event & select.POLLHUP:
+            return False
+    return True
+
+
+def run(args, modem):
+    fd, name = open_pty(args)
+    pins = open_pins(args)
+    poller = select.poll()
+    poller.register(fd, select.POLLIN)
+    attached = False
+    power_on = args.power_on or modem.model['power_on']
+    published = False
+    if power_on == 'start':
+        modem.power_on(time.time())
+    inputs = [fd] + ([pins] if pins is not None else []) + ([sys.stdin] if args.interactive else [])
+    while True:
+        now = time.time()
+        was_attached, attached = attached, dte_attached(poller)
+        if attached != was_attached:
+            print('DTE %s' % ('attached' if attached else 'detached'))
+            if attached and power_on == 'open':
+                modem.power_on(now)
+            elif not attached and power_on == 'open':
+                modem.power_off('DTE closed the port')
+        out = bytearray()
+        if modem.powered:
+            out += modem.due_output(now)
+            if modem.powered:
+                out += modem.tick(now)
+        if out and attached:
+            os.write(fd, bytes(out))
+        # A modem that boots on its own is published once booted, as if it had been on for a while
+        if not published and (power_on == 'open' or now >= modem.booted_at):
+            publish(args, name)
+            published = True
+        timeout = 0.05
+        due = modem.next_due() if modem.powered else None
+        if due is not None:
+            timeout = max(0.0, min(timeout, due - time.time()))
+        if modem.powered and modem.data_mode:
+            timeout = min(timeout, 0.005)
+        if not attached:
+            # Reading a master without a slave fails at once, poll for the DTE instead
+            time.sleep(timeout or 0.001)
+            if pins is not None and select.select([pins], [], [], 0)[0]:
+                handle_pins(pins, modem)
+            if args.interactive and select.select([sys.stdin], [], [], 0)[0]:
+                handle_stdin(modem)
+            continue
+        ready = select.select(inputs, [], [], timeout)[0]
+        if fd in ready:
+            try:
+                data = os.read(fd, 4096)
+            except OSError:
+                data = b''
+            if data:
+                echo = modem.feed(data, time.time())
+                if echo:
+                    os.write(fd, bytes(echo))
+        if pins is not None and pins in ready:
+            handle_pins(pins, modem)
+        if sys.stdin in ready:
+            handle_stdin(modem)
+
+
+def handle_stdin(modem):
+    line = sys.stdin.readline()
+    if not line:
+        raise KeyboardInterrupt
+    line = line.strip()
+    if line and modem.powered:
+        modem.schedule(time.time(), line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulate a SIM800 or BG96 on a pseudo terminal')
+    parser.add_argument('--model', choices=sorted(MODELS), default='sim800')
+    parser.add_argument('--link', help='symlink to create to the pty, removed on exit')
+    parser.add_argument('--power-on', choices=['open', 'start'], help='when the modem boots (default per model)')
+    parser.add_argument('--scenario', help='JSON file with boot URCs, events, responses, latencies and errors')
+    parser.add_argument('--speed', type=float, default=1.0, help='divide boot and answer times by this')
+    parser.add_argument('--latency', type=float, nargs=2, default=[5.0, 30.0], metavar=('MIN', 'MAX'),
+                        help='answer latency in ms')
+    parser.add_argument('--inject', default='+CSQ,+CBC,+CREG?,+COPS?',
+                        help='comma separated verbs that errors, timeouts, garbling and URCs are injected into')
+    parser.add_argument('--error-rate', type=float, default=0.0, help='ERROR instead of the answer')
+    parser.add_argument('--timeout-rate', type=float, default=0.0, help='no answer at all')
+    parser.add_argument('--garble-rate', type=float, default=0.0, help='one flipped byte in the answer')
+    parser.add_argument('--urc-rate', type=float, default=0.0, help='a URC between the answer and OK')
+    parser.add_argument('--ppp-rate', type=float, default=11000.0,
+                        help='PPP payload bytes/s sent in data mode, default about what 115200 baud carries')
+    parser.add_argument('--ppp-frame', type=int, default=512, help='PPP payload bytes per frame')
+    parser.add_argument('--guard', type=float, default=0.5, help='silence after "+++" in seconds')
+    parser.add_argument('--hang-after', type=float, metavar='SECONDS',
+                        help='stop answering this long after each power on')
+    parser.add_argument('--hang-for', type=float, default=0.0, metavar='SECONDS',
+                        help='answer again after this long, default 0: only a power off ends the hang')
+    parser.add_argument('--supply-dip', type=float, nargs=3, metavar=('AT', 'FOR', 'MV'), action='append',
+                        help='drop the supply to MV millivolt AT seconds after each power on, for FOR seconds; '
+                             'repeat for steps, the end of any makes it nominal')
+    parser.add_argument('--seed', type=int, help='random seed, for repeatable runs')
+    parser.add_argument('--interactive', action='store_true', help='read URCs and !actions from stdin')
+    args = parser.parse_args()
+    args.inject = set(v.strip().upper() for v in args.inject.split(',') if v.strip())
+    scenario = {}
+    if args.scenario:
+        with open(args.scenario) as f:
+            scenario = json.load(f)
+    if sys.version_info[0] < 3:
+        print('needs Python 3')
+        return 1
+
+    def terminate(signum, frame):
+        raise KeyboardInterrupt
+    signal.signal(signal.SIGTERM, terminate)
+    modem = Modem(args, scenario)
+    try:
+        run(args, modem)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.link and os.path.islink(args.link):
+            os.remove(args.link)
+        if args.link and os.path.exists(args.link + '.pins'):
+            os.remove(args.link + '.pins')
+        modem.report()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())